@@ -5,7 +5,8 @@ here="$(realpath "$(dirname "$0")")"
 
 ############ Determine Build Configuration ############
 
-app=1    # build eexpr2json application
+app=1    # build applications (eexpr2json, eexpr-lsp, eexpr-fix, eexprdiff, eexpr-validate, eexprq, eexpr-api-check)
+bench=0  # build benchmarks (eexpr-mixfix-bench, eexpr-small-bench, eexpr-build-bench, eexpr-schema-bench)
 debug=1  # ATM, just turns on assert statements
 fast=0   # turn off all optimizations
 shared=0 # build shared library/application
@@ -17,12 +18,14 @@ while [ $# != 0 ]; do
     all) app=1 ; shared=1 ; static=1 ;;
     # turn settings on
     app) app=1 ;;
+    bench) bench=1 ;;
     debug) debug=1 ;;
     fast) fast=1 ;;
     shared) shared=1 ;;
     static) static=1 ;;
     # turn settings off
     no-app) app=0 ;;
+    no-bench) bench=0 ;;
     no-debug) debug=0 ;;
     no-fast) fast=0 ;;
     no-shared) shared=0 ;;
@@ -72,20 +75,47 @@ function main() {
 
 function mkStaticApp() {
   mkdir -p bin/static
-  $compile \
-    -I src/app -I src/shim \
-    src/shim/*.c src/app/*.c \
-    -I src/api -L bin/static -l eexpr \
-    -o bin/static/eexpr2json
+  mkApp static eexpr2json src/app/main.c src/app/json.c src/app/cbor.c src/app/mixfixSpec.c
+  mkApp static eexpr-lsp src/app/lsp.c src/app/jsonRead.c src/app/json.c -pthread
+  mkApp static eexpr-fix src/app/fix.c src/app/json.c
+  mkApp static eexprdiff src/app/diff.c src/app/json.c
+  mkApp static eexpr-validate src/app/validate.c src/app/json.c
+  mkApp static eexprq src/app/query.c -pthread
+  mkApp static eexpr-api-check src/app/apiCheck.c src/app/json.c src/app/mixfixSpec.c
+  if [ "$bench" == 1 ]; then
+    mkApp static eexpr-mixfix-bench src/app/mixfixBench.c src/app/mixfixSpec.c src/app/json.c
+    mkApp static eexpr-small-bench src/app/smallBench.c
+    mkApp static eexpr-build-bench src/app/buildBench.c
+    mkApp static eexpr-schema-bench src/app/schemaBench.c
+  fi
 }
 
 function mkSharedApp() {
   mkdir -p bin/shared
+  mkApp shared eexpr2json src/app/main.c src/app/json.c src/app/cbor.c src/app/mixfixSpec.c
+  mkApp shared eexpr-lsp src/app/lsp.c src/app/jsonRead.c src/app/json.c -pthread
+  mkApp shared eexpr-fix src/app/fix.c src/app/json.c
+  mkApp shared eexprdiff src/app/diff.c src/app/json.c
+  mkApp shared eexpr-validate src/app/validate.c src/app/json.c
+  mkApp shared eexprq src/app/query.c -pthread
+  mkApp shared eexpr-api-check src/app/apiCheck.c src/app/json.c src/app/mixfixSpec.c
+  if [ "$bench" == 1 ]; then
+    mkApp shared eexpr-mixfix-bench src/app/mixfixBench.c src/app/mixfixSpec.c src/app/json.c
+    mkApp shared eexpr-small-bench src/app/smallBench.c
+    mkApp shared eexpr-build-bench src/app/buildBench.c
+    mkApp shared eexpr-schema-bench src/app/schemaBench.c
+  fi
+}
+
+# usage: mkApp <static|shared> <app name> <source files and extra flags>...
+function mkApp() {
+  local linkage="$1" name="$2"
+  shift 2
   $compile \
     -I src/app -I src/shim \
-    src/shim/*.c src/app/*.c \
-    -I src/api -L bin/shared -l eexpr \
-    -o bin/shared/eexpr2json
+    src/shim/*.c "$@" \
+    -I src/api -L "bin/$linkage" -l eexpr \
+    -o "bin/$linkage/$name"
 }
 
 function mkStaticLibrary() {
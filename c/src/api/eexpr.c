@@ -2,20 +2,31 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "arena.h"
 #include "common.h"
+#include "diff.h"
 #include "engine.h"
+#include "hash.h"
+#include "mixfix.h"
+#include "printer.h"
+#include "query.h"
+#include "schema.h"
+#include "share.h"
 
 
 struct eexpr_parserInternal {
   engine st;
   struct outputCaps {
     size_t eexprs;
+    size_t spans;
     size_t tokens;
     size_t errors;
     size_t warnings;
   } caps;
   enum eexpr_parsePauseAt resumeFrom;
+  bool idle; // set by `eexpr_parser_reset`, so the next call to `eexpr_parse` starts over with a new input
 };
 
 
@@ -90,6 +101,7 @@ void drainTokens(eexpr_parser* parser) {
     if (parser->tokens != NULL) {
       free(parser->tokens);
       parser->tokens = NULL;
+      parser->impl->caps.tokens = 0;
     }
     parser->nTokens = 0;
   }
@@ -99,13 +111,46 @@ static
 void drainEexprs(eexpr_parser* parser) {
   parser->nEexprs = parser->impl->st.eexprStream.len;
   parser->eexprs = parser->impl->st.eexprStream.data;
+  parser->impl->caps.eexprs = parser->impl->st.eexprStream.cap;
   parser->impl->st.eexprStream.len = 0;
   parser->impl->st.eexprStream.cap = 0;
   parser->impl->st.eexprStream.data = NULL;
+  // the spans go along with them
+  parser->nSpans = parser->impl->st.spanStream.len;
+  parser->spans = parser->impl->st.spanStream.data;
+  parser->impl->caps.spans = parser->impl->st.spanStream.cap;
+  parser->impl->st.spanStream.len = 0;
+  parser->impl->st.spanStream.cap = 0;
+  parser->impl->st.spanStream.data = NULL;
+}
+
+// Set up the internals of a parser that is about to be given a new input: either for the first time, or after `eexpr_parser_reset`.
+static
+void startParser(eexpr_parser* parser) {
+  if (parser->impl == NULL) {
+    // initialize internals
+    parser->impl = malloc(sizeof(eexpr_parserInternal));
+    checkOom(parser->impl);
+    // save input capacities; initialize output lengths
+    parser->impl->caps.eexprs = parser->nEexprs; parser->nEexprs = 0;
+    parser->impl->caps.spans = parser->nSpans; parser->nSpans = 0;
+    parser->impl->caps.tokens = parser->nTokens; parser->nTokens = 0;
+    parser->impl->caps.errors = parser->nErrors; parser->nErrors = 0;
+    parser->impl->caps.warnings = parser->nWarnings; parser->nWarnings = 0;
+    // initialize the engine
+    parser->impl->st = engine_newFromStrn(0, NULL);
+  }
+  // otherwise, everything was cleared out (but kept) by `eexpr_parser_reset`
+  parser->impl->idle = false;
+  parser->impl->st.lazyPayloads = parser->lazyPayloads;
+  parser->impl->st.symbols = parser->symbols;
+  parser->impl->st.shared = parser->shared;
+  parser->impl->st.shareSpans = parser->shared != NULL && parser->shareSpans;
+  parser->impl->st.limits = parser->limits;
 }
 
 bool eexpr_parse(eexpr_parser* parser, size_t nBytes, uint8_t* utf8Input) {
-  if (parser->impl == NULL) { goto start; }
+  if (parser->impl == NULL || parser->impl->idle) { goto start; }
   else {
     assert(nBytes == 0);
     assert(utf8Input == NULL);
@@ -119,16 +164,17 @@ bool eexpr_parse(eexpr_parser* parser, size_t nBytes, uint8_t* utf8Input) {
   } assert(false);
 
   start: {
-    // initialize internals
-    parser->impl = malloc(sizeof(eexpr_parserInternal));
-    checkOom(parser->impl);
-    // save input capacities; initialize output lengths
-    parser->impl->caps.eexprs = parser->nEexprs; parser->nEexprs = 0;
-    parser->impl->caps.tokens = parser->nTokens; parser->nTokens = 0;
-    parser->impl->caps.errors = parser->nErrors; parser->nErrors = 0;
-    parser->impl->caps.warnings = parser->nWarnings; parser->nWarnings = 0;
-    // initialize the engine
-    parser->impl->st = engine_newFromStrn(nBytes, utf8Input);
+    str input = {.len = nBytes, .bytes = utf8Input};
+    bool fresh = parser->impl == NULL;
+    startParser(parser);
+    parser->impl->st.rest = input;
+    if (parser->lazyLines) {
+      if (!fresh) { eexpr_lineIndex_del(parser->lines); }
+      parser->lines = NULL;
+    }
+    else if (fresh || parser->lines == NULL) { parser->lines = lineIndex_new(input); }
+    else { lineIndex_rebuild(parser->lines, input); }
+    parser->impl->st.lines = parser->lines;
     // save progress and possibly pause
     parser->impl->resumeFrom = EEXPR_PAUSE_AFTER_START;
     if (parser->pauseAt == EEXPR_PAUSE_AFTER_START) { return true; }
@@ -161,6 +207,7 @@ bool eexpr_parse(eexpr_parser* parser, size_t nBytes, uint8_t* utf8Input) {
       free(parser->tokens);
       parser->nTokens = 0;
       parser->tokens = NULL;
+      parser->impl->caps.tokens = 0;
     }
     engine_parse(&parser->impl->st);
     drainEexprs(parser);
@@ -178,13 +225,67 @@ bool eexpr_parse(eexpr_parser* parser, size_t nBytes, uint8_t* utf8Input) {
 
 
 
+bool eexpr_parseBatch(eexpr_parser* parser, size_t n, const size_t* nBytes, uint8_t* const* utf8Inputs, eexpr_batchResult* results) {
+  assert(parser->impl == NULL || parser->impl->idle);
+  startParser(parser);
+  engine* st = &parser->impl->st;
+  bool ok = true;
+  for (size_t i = 0; i < n; ++i) {
+    eexpr_batchResult* out = &results[i];
+    out->firstEexpr = st->eexprStream.len;
+    out->firstError = parser->nErrors;
+    out->firstWarning = parser->nWarnings;
+    out->firstSpan = st->spanStream.len;
+    str input = {.len = nBytes[i], .bytes = utf8Inputs[i]};
+    st->rest = input;
+    out->lines = parser->lazyLines ? NULL : lineIndex_new(input);
+    st->lines = out->lines;
+    // the same stages as `eexpr_parse`, except that errors are only counted for the one input
+    engine_rawLex(st);
+    drainErrors(parser);
+    if (parser->nErrors == out->firstError) {
+      engine_cookLex(st);
+      drainErrors(parser);
+    }
+    if (parser->nErrors == out->firstError) {
+      engine_parse(st);
+      drainErrors(parser);
+    }
+    out->nEexprs = st->eexprStream.len - out->firstEexpr;
+    out->nErrors = parser->nErrors - out->firstError;
+    out->nWarnings = parser->nWarnings - out->firstWarning;
+    out->nSpans = st->spanStream.len - out->firstSpan;
+    ok = ok && out->nErrors == 0;
+    // clear out the engine for the next input, except for the eexprs (and their spans), which are accumulating
+    size_t nEexprs = st->eexprStream.len;
+    size_t nSpans = st->spanStream.len;
+    st->eexprStream.len = 0;
+    engine_reset(st);
+    st->eexprStream.len = nEexprs;
+    st->spanStream.len = nSpans;
+  }
+  drainEexprs(parser);
+  parser->impl->resumeFrom = EEXPR_DO_NOT_PAUSE;
+  return ok;
+}
+
+
 void eexpr_parserInitDefault(eexpr_parser* parser) {
   parser->nEexprs = 0; parser->eexprs = NULL;
   parser->nTokens = 0; parser->tokens = NULL;
   parser->nErrors = 0; parser->errors = NULL;
   parser->nWarnings = 0; parser->warnings = NULL;
+  parser->lines = NULL;
+  parser->nSpans = 0; parser->spans = NULL;
   struct eexpr_parseErrorLevels opts = { false, false, false, false, false };
   parser->isError = opts;
+  parser->lazyPayloads = false;
+  parser->lazyLines = false;
+  parser->symbols = NULL;
+  parser->shared = NULL;
+  parser->shareSpans = false;
+  struct eexpr_parseLimits limits = { 0, 0, 0, 0, 0, 0 };
+  parser->limits = limits;
   parser->pauseAt = EEXPR_DO_NOT_PAUSE;
   parser->impl = NULL;
 }
@@ -198,35 +299,79 @@ void eexpr_parser_deinit(eexpr_parser* parser) {
     parser->impl->st.eexprStream.cap = 0;
     parser->impl->st.eexprStream.data = NULL;
   }
+  if (parser->spans == parser->impl->st.spanStream.data) {
+    // likewise their spans
+    parser->impl->st.spanStream.len = 0;
+    parser->impl->st.spanStream.cap = 0;
+    parser->impl->st.spanStream.data = NULL;
+  }
   engine_deinit(&parser->impl->st);
   free(parser->impl); // free the internal state
   parser->impl = NULL;
 }
 
+void eexpr_parser_reset(eexpr_parser* parser) {
+  if (parser->impl == NULL) { return; }
+  eexpr_parserInternal* impl = parser->impl;
+  // take back the eexprs array (it was handed over by `drainEexprs`), deleting its contents
+  if (parser->eexprs != NULL) {
+    for (size_t i = 0; i < parser->nEexprs; ++i) {
+      eexpr_del(parser->eexprs[i]);
+    }
+    free(impl->st.eexprStream.data);
+    impl->st.eexprStream.len = 0;
+    impl->st.eexprStream.cap = impl->caps.eexprs;
+    impl->st.eexprStream.data = parser->eexprs;
+  }
+  else if (impl->st.eexprStream.data == NULL) {
+    dynarr_init_eexpr_p(&impl->st.eexprStream, 64);
+  }
+  parser->nEexprs = 0;
+  parser->eexprs = NULL;
+  // and likewise the spans, which need no deleting
+  if (parser->spans != NULL) {
+    free(impl->st.spanStream.data);
+    impl->st.spanStream.len = 0;
+    impl->st.spanStream.cap = impl->caps.spans;
+    impl->st.spanStream.data = parser->spans;
+  }
+  parser->nSpans = 0;
+  parser->spans = NULL;
+  engine_reset(&impl->st);
+  // the other outputs are only emptied
+  parser->nTokens = 0;
+  parser->nErrors = 0;
+  parser->nWarnings = 0;
+  impl->idle = true;
+}
+
 
 //////////////////////////////////// `eexpr_as*` Functions ////////////////////////////////////
 
 void eexpr_del(eexpr* self) {
-  if (self == NULL) { return; }
+  if (self == NULL || self->flags & (FLAG_SHARED | FLAG_ARENA)) { return; }
   eexpr_deinit(self);
   free(self);
 }
 
 void eexpr_deinit(eexpr* self) {
-  if (self == NULL) { return; }
+  if (self == NULL || self->flags & (FLAG_SHARED | FLAG_ARENA)) { return; }
+  bool lazy = self->flags & FLAG_LAZY; // then payloads are borrowed from the input
   switch (self->type) {
     case EEXPR_SYMBOL: {
+      if (self->as.symbol.id != EEXPR_NO_SYMBOL) { break; } // text is borrowed from the symbol table
       if (self->as.symbol.text.bytes != NULL) { free(self->as.symbol.text.bytes); }
     }; break;
     case EEXPR_NUMBER: {
+      if (lazy) { break; }
       free(self->as.number.mantissa.buf);
       free(self->as.number.exponent.buf);
     }; break;
     case EEXPR_STRING: {
-      free(self->as.string.text1.bytes);
+      if (!lazy) { free(self->as.string.text1.bytes); }
       for (size_t i = 0; i < self->as.string.parts.len; ++i) {
         eexpr_del(self->as.string.parts.data[i].subexpr);
-        free(self->as.string.parts.data[i].utf8str);
+        if (!lazy) { free(self->as.string.parts.data[i].utf8str); }
       }
       dynarr_deinit_strTemplPart(&self->as.string.parts);
     }; break;
@@ -249,7 +394,6 @@ void eexpr_deinit(eexpr* self) {
       for (size_t i = 0; i < self->as.list.len; ++i) {
         eexpr_del(self->as.list.data[i]);
       }
-      dynarr_deinit_eexpr_p(&self->as.list);
     }; break;
     case EEXPR_PREDOT: {
       eexpr_del(self->as.wrap);
@@ -258,13 +402,11 @@ void eexpr_deinit(eexpr* self) {
       for (size_t i = 0; i < self->as.list.len; ++i) {
         eexpr_del(self->as.list.data[i]);
       }
-      dynarr_deinit_eexpr_p(&self->as.list);
     }; break;
     case EEXPR_SPACE: {
       for (size_t i = 0; i < self->as.list.len; ++i) {
         eexpr_del(self->as.list.data[i]);
       }
-      dynarr_deinit_eexpr_p(&self->as.list);
     }; break;
     case EEXPR_ELLIPSIS: {
       if (self->as.ellipsis[0] != NULL) {
@@ -282,22 +424,29 @@ void eexpr_deinit(eexpr* self) {
       for (size_t i = 0; i < self->as.list.len; ++i) {
         eexpr_del(self->as.list.data[i]);
       }
-      dynarr_deinit_eexpr_p(&self->as.list);
     }; break;
     case EEXPR_SEMICOLON: {
       for (size_t i = 0; i < self->as.list.len; ++i) {
         eexpr_del(self->as.list.data[i]);
       }
-      dynarr_deinit_eexpr_p(&self->as.list);
+    }; break;
+    case EEXPR_MIXFIX: {
+      for (size_t i = 0; i < self->as.mixfix.args.len; ++i) {
+        eexpr_del(self->as.mixfix.args.data[i]);
+      }
     }; break;
   }
 }
 
 
-eexpr_loc eexpr_locate(const eexpr* self) {
+eexpr_span eexpr_getSpan(const eexpr* self) {
   return self->loc;
 }
 
+eexpr_loc eexpr_locate(const eexpr_lineIndex* lines, const eexpr* self) {
+  return eexpr_resolveSpan(lines, self->loc);
+}
+
 eexpr_type eexpr_getType(const eexpr* self) {
   return self->type;
 }
@@ -310,8 +459,16 @@ bool eexpr_asSymbol(const eexpr* self, size_t* nBytes, uint8_t** utf8str) {
   return true;
 }
 
+bool eexpr_asSymbolId(const eexpr* self, uint32_t* id) {
+  if (self->type != EEXPR_SYMBOL) { return false; }
+  if (self->as.symbol.id == EEXPR_NO_SYMBOL) { return false; }
+  *id = self->as.symbol.id;
+  return true;
+}
+
 bool eexpr_asNumber(const eexpr* self, eexpr_number* value) {
   if (self->type != EEXPR_NUMBER) { return false; }
+  lexer_forceEexpr((eexpr*)self); // memoize the payload on first access, see `FLAG_LAZY`
   value->isPositive = self->as.number.mantissa.pos;
   value->nBigDigits = self->as.number.mantissa.len;
   value->bigDigits = self->as.number.mantissa.buf;
@@ -328,6 +485,7 @@ bool eexpr_asNumber(const eexpr* self, eexpr_number* value) {
 bool eexpr_asString(const eexpr* self, eexpr_string* value) {
   if (self->type != EEXPR_STRING) { return false; }
   if (value != NULL) {
+    lexer_forceEexpr((eexpr*)self); // memoize the payload on first access, see `FLAG_LAZY`
     value->head.nBytes = self->as.string.text1.len;
     value->head.utf8str = self->as.string.text1.bytes;
     value->nSubexprs = self->as.string.parts.len;
@@ -411,6 +569,14 @@ bool eexpr_asSemicolon(const eexpr* self, size_t* nSubexprs, eexpr*** subexprs)
   return true;
 }
 
+bool eexpr_asMixfix(const eexpr* self, uint32_t* op, size_t* nArgs, eexpr*** args) {
+  if (self->type != EEXPR_MIXFIX) { return false; }
+  if (op != NULL) { *op = self->as.mixfix.op; }
+  if (nArgs != NULL) { *nArgs = self->as.mixfix.args.len; }
+  if (args != NULL) { *args = self->as.mixfix.args.data; }
+  return true;
+}
+
 
 //////////////////////////////////// `eexpr_tokenAs*` Functions ////////////////////////////////////
 
@@ -422,10 +588,14 @@ bool eexpr_tokenIsTransparent(const eexpr_token* self) {
   return self->transparent;
 }
 
-eexpr_loc eexpr_tokenLocate(const eexpr_token* self) {
+eexpr_span eexpr_getTokenSpan(const eexpr_token* self) {
   return self->loc;
 }
 
+eexpr_loc eexpr_tokenLocate(const eexpr_lineIndex* lines, const eexpr_token* self) {
+  return eexpr_resolveSpan(lines, self->loc);
+}
+
 
 bool eexpr_tokenAsSymbol(const eexpr_token* self, size_t* nBytes, uint8_t** utf8str) {
   if (self->type != EEXPR_TOK_SYMBOL) { return false; }
@@ -437,6 +607,7 @@ bool eexpr_tokenAsSymbol(const eexpr_token* self, size_t* nBytes, uint8_t** utf8
 bool eexpr_tokenAsNumber(const eexpr_token* self, eexpr_number* value) {
   if (self->type != EEXPR_TOK_NUMBER) { return false; }
   if (value != NULL) {
+    lexer_forceToken((eexpr_token*)self); // memoize the payload on first access, see `FLAG_LAZY`
     assert(self->as.number.mantissa.len == 0
           ? (self->as.number.mantissa.buf == NULL && !self->as.number.mantissa.pos)
           : true);
@@ -457,6 +628,9 @@ bool eexpr_tokenAsNumber(const eexpr_token* self, eexpr_number* value) {
 
 bool eexpr_tokenAsString(const eexpr_token* self, eexpr_stringType* type, size_t* nBytes, uint8_t** utf8str) {
   if (self->type != EEXPR_TOK_STRING) { return false; }
+  if (nBytes != NULL || utf8str != NULL) {
+    lexer_forceToken((eexpr_token*)self); // memoize the payload on first access, see `FLAG_LAZY`
+  }
   if (type != NULL) { *type = self->as.string.splice; }
   if (nBytes != NULL) { *nBytes = self->as.string.text.len; }
   if (utf8str != NULL) { *utf8str = self->as.string.text.bytes; }
@@ -484,3 +658,860 @@ bool eexpr_tokenAsWrap(const eexpr_token* self, eexpr_wrapType* type, bool* isOp
   if (isOpen != NULL) { *isOpen = self->as.wrap.isOpen; }
   return true;
 }
+
+
+//////////////////////////////////// Line Index Functions ////////////////////////////////////
+
+// Like `eexpr_resolvePoint`, but when `hint` is an already-resolved point earlier on the same line,
+//   columns are counted on from there rather than from the start of the line.
+// This keeps resolving the many (mostly increasing) locations of a whole tree from going quadratic on long lines.
+static
+struct eexpr_locPoint resolveFrom(const eexpr_lineIndex* lines, const struct eexpr_locPoint* hint, size_t byte) {
+  if (lines == NULL) {
+    struct eexpr_locPoint out = {.line = 0, .col = 0, .col16 = 0, .byte = byte};
+    return out;
+  }
+  if (byte > lines->input.len) { byte = lines->input.len; }
+  size_t line = lineIndex_lineOf(lines, byte);
+  struct eexpr_locPoint out = {.line = line, .col = 0, .col16 = 0, .byte = lines->starts[line]};
+  if (hint != NULL && hint->line == line && hint->byte <= byte) {
+    out = *hint;
+  }
+  str rest = {.len = byte - out.byte, .bytes = lines->input.bytes + out.byte};
+  out.byte = byte;
+  while (rest.len != 0) {
+    char32_t c;
+    size_t adv = peekUchar(&c, rest);
+    if (c == UCHAR_NULL) {
+      // the lexer gives bad bytes no width, but editors will show a replacement character
+      out.col16 += 1;
+    }
+    else {
+      out.col += 1;
+      out.col16 += c < 0x10000 ? 1 : 2;
+    }
+    rest.len -= adv;
+    rest.bytes += adv;
+  }
+  return out;
+}
+
+eexpr_lineIndex* eexpr_lineIndex_new(size_t nBytes, const uint8_t* utf8Input) {
+  // the index only reads its input
+  str input = {.len = nBytes, .bytes = (uint8_t*)utf8Input};
+  return lineIndex_new(input);
+}
+
+struct eexpr_locPoint eexpr_resolvePoint(const eexpr_lineIndex* lines, size_t byte) {
+  return resolveFrom(lines, NULL, byte);
+}
+
+eexpr_loc eexpr_resolveSpan(const eexpr_lineIndex* lines, eexpr_span span) {
+  eexpr_loc out = {.start = eexpr_resolvePoint(lines, span.start), .end = eexpr_resolvePoint(lines, span.end)};
+  return out;
+}
+
+size_t eexpr_lineCount(const eexpr_lineIndex* lines) {
+  return lines->nLines;
+}
+
+size_t eexpr_lineStart(const eexpr_lineIndex* lines, size_t line) {
+  if (line >= lines->nLines) { line = lines->nLines - 1; }
+  return lines->starts[line];
+}
+
+void eexpr_lineIndex_del(eexpr_lineIndex* lines) {
+  if (lines == NULL) { return; }
+  free(lines->starts);
+  free(lines);
+}
+
+
+//////////////////////////////////// Symbol Tables ////////////////////////////////////
+
+eexpr_symtab* eexpr_symtab_new(void) {
+  return symtab_new();
+}
+
+void eexpr_symtab_del(eexpr_symtab* self) {
+  if (self == NULL) { return; }
+  for (size_t i = 0; i < self->symbols.len; ++i) {
+    free(self->symbols.data[i].bytes);
+  }
+  dynarr_deinit_str(&self->symbols);
+  free(self->slots);
+  free(self);
+}
+
+size_t eexpr_symtab_size(const eexpr_symtab* self) {
+  return self->symbols.len;
+}
+
+uint32_t eexpr_symtab_intern(eexpr_symtab* self, size_t nBytes, const uint8_t* utf8str) {
+  str text = {.len = nBytes, .bytes = (uint8_t*)utf8str};
+  return symtab_intern(self, text);
+}
+
+uint32_t eexpr_symtab_find(const eexpr_symtab* self, size_t nBytes, const uint8_t* utf8str) {
+  str text = {.len = nBytes, .bytes = (uint8_t*)utf8str};
+  return symtab_find(self, text);
+}
+
+bool eexpr_symtab_lookup(const eexpr_symtab* self, uint32_t id, size_t* nBytes, const uint8_t** utf8str) {
+  if (id >= self->symbols.len) { return false; }
+  *nBytes = self->symbols.data[id].len;
+  *utf8str = self->symbols.data[id].bytes;
+  return true;
+}
+
+
+//////////////////////////////////// Share Tables ////////////////////////////////////
+
+eexpr_shareTable* eexpr_shareTable_new(void) {
+  return shareTable_new();
+}
+
+void eexpr_shareTable_del(eexpr_shareTable* self) {
+  if (self == NULL) { return; }
+  // Shared eexprs point at each other, so all their payloads are freed before any of the eexprs themselves are.
+  // Meanwhile, `eexpr_deinit` still sees the subexprs as shared, and leaves them alone.
+  for (size_t i = 0; i < self->nSlots; ++i) {
+    eexpr* e = self->slots[i];
+    if (e == NULL) { continue; }
+    e->flags &= ~FLAG_SHARED;
+    eexpr_deinit(e);
+    e->flags |= FLAG_SHARED;
+  }
+  for (size_t i = 0; i < self->nSlots; ++i) {
+    free(self->slots[i]);
+  }
+  free(self->slots);
+  free(self->digests);
+  free(self);
+}
+
+size_t eexpr_shareTable_size(const eexpr_shareTable* self) {
+  return self->nEexprs;
+}
+
+
+//////////////////////////////////// Building Eexprs ////////////////////////////////////
+
+eexpr_arena* eexpr_arena_new(void) {
+  return arena_new();
+}
+
+void eexpr_arena_del(eexpr_arena* self) {
+  if (self == NULL) { return; }
+  arena_del(self);
+}
+
+void eexpr_arena_reset(eexpr_arena* self) {
+  arena_reset(self);
+}
+
+void* eexpr_arena_alloc(eexpr_arena* self, size_t nBytes) {
+  return arena_alloc(self, nBytes);
+}
+
+static
+eexpr* newEexpr(eexpr_arena* arena, eexpr_type type, eexpr_span loc) {
+  eexpr* out = arena_alloc(arena, sizeof(eexpr));
+  out->loc = loc;
+  out->type = type;
+  out->flags = FLAG_ARENA;
+  return out;
+}
+
+static
+str arenaCopy(eexpr_arena* arena, size_t nBytes, const uint8_t* utf8str) {
+  str out = {.len = nBytes, .bytes = NULL};
+  if (nBytes != 0) {
+    out.bytes = arena_alloc(arena, nBytes);
+    memcpy(out.bytes, utf8str, nBytes);
+  }
+  return out;
+}
+
+// Unlike `eexprList_new`, the subexprs are not copied into the eexpr: `.small` goes unused, and `.data` is the caller's array.
+static
+eexpr* newList(eexpr_arena* arena, eexpr_type type, eexpr_span loc, size_t n, eexpr** subexprs) {
+  eexpr* out = newEexpr(arena, type, loc);
+  out->as.list.len = n;
+  out->as.list.data = subexprs;
+  return out;
+}
+
+eexpr* eexpr_newSymbol(eexpr_arena* arena, eexpr_span loc, size_t nBytes, const uint8_t* utf8str) {
+  eexpr* out = newEexpr(arena, EEXPR_SYMBOL, loc);
+  out->as.symbol.text = arenaCopy(arena, nBytes, utf8str);
+  out->as.symbol.id = EEXPR_NO_SYMBOL;
+  return out;
+}
+
+eexpr* eexpr_newInt(eexpr_arena* arena, eexpr_span loc, int64_t value) {
+  eexpr* out = newEexpr(arena, EEXPR_NUMBER, loc);
+  eexprNumber* num = &out->as.number;
+  // negating in unsigned arithmetic, so that even `INT64_MIN` has a magnitude
+  uint64_t mag = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+  num->mantissa.pos = value > 0; // zero is not positive, see `bigint`
+  num->mantissa.len = mag == 0 ? 0 : mag >> 32 == 0 ? 1 : 2;
+  num->mantissa.buf = NULL;
+  if (mag != 0) {
+    num->mantissa.buf = arena_alloc(arena, num->mantissa.len * sizeof(uint32_t));
+    num->mantissa.buf[0] = (uint32_t)mag;
+    if (num->mantissa.len == 2) { num->mantissa.buf[1] = (uint32_t)(mag >> 32); }
+  }
+  num->radix = 10;
+  num->fractionalDigits = 0;
+  num->exponent.pos = false;
+  num->exponent.len = 0;
+  num->exponent.buf = NULL;
+  return out;
+}
+
+eexpr* eexpr_newNumber(eexpr_arena* arena, eexpr_span loc, const eexpr_number* value) {
+  assert(value->nBigDigits <= UINT16_MAX && value->nBigDigits_exp <= UINT16_MAX);
+  assert(value->nBigDigits == 0 ? (value->bigDigits == NULL && !value->isPositive) : value->bigDigits[value->nBigDigits - 1] != 0);
+  assert(value->nBigDigits_exp == 0 ? (value->bigDigits_exp == NULL && !value->isPositive_exp) : value->bigDigits_exp[value->nBigDigits_exp - 1] != 0);
+  eexpr* out = newEexpr(arena, EEXPR_NUMBER, loc);
+  eexprNumber* num = &out->as.number;
+  num->mantissa.pos = value->isPositive;
+  num->mantissa.len = value->nBigDigits;
+  num->mantissa.buf = value->bigDigits;
+  num->radix = value->radix;
+  num->fractionalDigits = value->nFracDigits;
+  num->exponent.pos = value->isPositive_exp;
+  num->exponent.len = value->nBigDigits_exp;
+  num->exponent.buf = value->bigDigits_exp;
+  return out;
+}
+
+eexpr* eexpr_newString(eexpr_arena* arena, eexpr_span loc, size_t nBytes, const uint8_t* utf8str, size_t nSubexprs, struct eexpr_strTemplate* tail) {
+  eexpr* out = newEexpr(arena, EEXPR_STRING, loc);
+  out->as.string.text1 = arenaCopy(arena, nBytes, utf8str);
+  for (size_t i = 0; i < nSubexprs; ++i) {
+    tail[i].utf8str = arenaCopy(arena, tail[i].nBytes, tail[i].utf8str).bytes;
+  }
+  out->as.string.parts.len = nSubexprs;
+  out->as.string.parts.cap = nSubexprs;
+  out->as.string.parts.data = tail;
+  return out;
+}
+
+eexpr* eexpr_newParen(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr) {
+  eexpr* out = newEexpr(arena, EEXPR_PAREN, loc);
+  out->as.wrap = subexpr;
+  return out;
+}
+
+eexpr* eexpr_newBrack(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr) {
+  eexpr* out = newEexpr(arena, EEXPR_BRACK, loc);
+  out->as.wrap = subexpr;
+  return out;
+}
+
+eexpr* eexpr_newBrace(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr) {
+  eexpr* out = newEexpr(arena, EEXPR_BRACE, loc);
+  out->as.wrap = subexpr;
+  return out;
+}
+
+eexpr* eexpr_newBlock(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs) {
+  return newList(arena, EEXPR_BLOCK, loc, nSubexprs, subexprs);
+}
+
+eexpr* eexpr_newPredot(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr) {
+  assert(subexpr != NULL);
+  eexpr* out = newEexpr(arena, EEXPR_PREDOT, loc);
+  out->as.wrap = subexpr;
+  return out;
+}
+
+eexpr* eexpr_newChain(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs) {
+  return newList(arena, EEXPR_CHAIN, loc, nSubexprs, subexprs);
+}
+
+eexpr* eexpr_newSpace(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs) {
+  return newList(arena, EEXPR_SPACE, loc, nSubexprs, subexprs);
+}
+
+eexpr* eexpr_newEllipsis(eexpr_arena* arena, eexpr_span loc, eexpr* before, eexpr* after) {
+  eexpr* out = newEexpr(arena, EEXPR_ELLIPSIS, loc);
+  out->as.ellipsis[0] = before;
+  out->as.ellipsis[1] = after;
+  return out;
+}
+
+eexpr* eexpr_newColon(eexpr_arena* arena, eexpr_span loc, eexpr* before, eexpr* after) {
+  assert(before != NULL && after != NULL);
+  eexpr* out = newEexpr(arena, EEXPR_COLON, loc);
+  out->as.pair[0] = before;
+  out->as.pair[1] = after;
+  return out;
+}
+
+eexpr* eexpr_newComma(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs) {
+  return newList(arena, EEXPR_COMMA, loc, nSubexprs, subexprs);
+}
+
+eexpr* eexpr_newSemicolon(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs) {
+  return newList(arena, EEXPR_SEMICOLON, loc, nSubexprs, subexprs);
+}
+
+
+//////////////////////////////////// Flat Serialization ////////////////////////////////////
+
+static
+size_t serialWords_bytes(size_t nBytes) {
+  return 1 + (nBytes + 7) / 8;
+}
+
+static
+size_t serialWords_bignum(size_t nBigDigits) {
+  return 1 + (nBigDigits * sizeof(uint32_t) + 7) / 8;
+}
+
+static
+size_t serialWords(const eexpr* self) {
+  if (self == NULL) { return 1; }
+  size_t out = 1 + 6;
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      out += serialWords_bytes(self->as.symbol.text.len);
+    }; break;
+    case EEXPR_NUMBER: {
+      lexer_forceEexpr((eexpr*)self);
+      out += 2;
+      out += serialWords_bignum(self->as.number.mantissa.len);
+      out += serialWords_bignum(self->as.number.exponent.len);
+    }; break;
+    case EEXPR_STRING: {
+      lexer_forceEexpr((eexpr*)self);
+      out += serialWords_bytes(self->as.string.text1.len);
+      for (size_t i = 0; i < self->as.string.parts.len; ++i) {
+        out += serialWords(self->as.string.parts.data[i].subexpr);
+        out += serialWords_bytes(self->as.string.parts.data[i].nBytes);
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      out += serialWords(self->as.wrap);
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        out += serialWords(self->as.list.data[i]);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      out += serialWords(self->as.ellipsis[0]);
+      out += serialWords(self->as.ellipsis[1]);
+    }; break;
+    case EEXPR_COLON: {
+      out += serialWords(self->as.pair[0]);
+      out += serialWords(self->as.pair[1]);
+    }; break;
+    case EEXPR_MIXFIX: {
+      out += 1;
+      for (size_t i = 0; i < self->as.mixfix.args.len; ++i) {
+        out += serialWords(self->as.mixfix.args.data[i]);
+      }
+    }; break;
+  }
+  return out;
+}
+
+size_t eexpr_serializedSize(size_t n, eexpr* const* eexprs) {
+  size_t words = 1;
+  for (size_t i = 0; i < n; ++i) {
+    words += serialWords(eexprs[i]);
+  }
+  return words * sizeof(uint64_t);
+}
+
+typedef struct serializer {
+  const eexpr_lineIndex* lines;
+  uint64_t* next;
+  struct eexpr_locPoint cursor; // the last start point resolved, used to speed up resolving the next
+} serializer;
+
+static
+void serialPutBytes(serializer* st, size_t nBytes, const uint8_t* bytes) {
+  *st->next++ = nBytes;
+  size_t nWords = (nBytes + 7) / 8;
+  if (nWords != 0) {
+    st->next[nWords - 1] = 0; // zero the padding
+    memcpy(st->next, bytes, nBytes);
+  }
+  st->next += nWords;
+}
+
+static
+void serialPutBignum(serializer* st, const bigint* n) {
+  *st->next++ = (uint64_t)n->pos | ((uint64_t)n->len << 1);
+  size_t nBytes = n->len * sizeof(uint32_t);
+  size_t nWords = (nBytes + 7) / 8;
+  if (nWords != 0) {
+    st->next[nWords - 1] = 0;
+    memcpy(st->next, n->buf, nBytes);
+  }
+  st->next += nWords;
+}
+
+static
+void serialPutLoc(serializer* st, eexpr_span span) {
+  if (st->lines == NULL) {
+    uint64_t* loc = st->next;
+    loc[0] = span.start; loc[1] = 0; loc[2] = 0;
+    loc[3] = span.end; loc[4] = 0; loc[5] = 0;
+  }
+  else {
+    // preorder visits start points in increasing order, so they can all be resolved from the last one
+    st->cursor = resolveFrom(st->lines, &st->cursor, span.start);
+    struct eexpr_locPoint end = resolveFrom(st->lines, &st->cursor, span.end);
+    uint64_t* loc = st->next;
+    loc[0] = st->cursor.byte; loc[1] = st->cursor.line; loc[2] = st->cursor.col;
+    loc[3] = end.byte; loc[4] = end.line; loc[5] = end.col;
+  }
+  st->next += 6;
+}
+
+static
+void serialPut(serializer* st, const eexpr* self) {
+  if (self == NULL) {
+    *st->next++ = EEXPR_SERIAL_ABSENT;
+    return;
+  }
+  uint64_t* header = st->next++;
+  uint64_t n = 0;
+  serialPutLoc(st, self->loc);
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      serialPutBytes(st, self->as.symbol.text.len, self->as.symbol.text.bytes);
+    }; break;
+    case EEXPR_NUMBER: {
+      lexer_forceEexpr((eexpr*)self);
+      *st->next++ = self->as.number.radix;
+      *st->next++ = self->as.number.fractionalDigits;
+      serialPutBignum(st, &self->as.number.mantissa);
+      serialPutBignum(st, &self->as.number.exponent);
+    }; break;
+    case EEXPR_STRING: {
+      lexer_forceEexpr((eexpr*)self);
+      n = self->as.string.parts.len;
+      serialPutBytes(st, self->as.string.text1.len, self->as.string.text1.bytes);
+      for (size_t i = 0; i < n; ++i) {
+        const strTemplPart* part = &self->as.string.parts.data[i];
+        serialPut(st, part->subexpr);
+        serialPutBytes(st, part->nBytes, part->utf8str);
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      serialPut(st, self->as.wrap);
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      n = self->as.list.len;
+      for (size_t i = 0; i < n; ++i) {
+        serialPut(st, self->as.list.data[i]);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      serialPut(st, self->as.ellipsis[0]);
+      serialPut(st, self->as.ellipsis[1]);
+    }; break;
+    case EEXPR_COLON: {
+      serialPut(st, self->as.pair[0]);
+      serialPut(st, self->as.pair[1]);
+    }; break;
+    case EEXPR_MIXFIX: {
+      n = self->as.mixfix.args.len;
+      *st->next++ = self->as.mixfix.op;
+      for (size_t i = 0; i < n; ++i) {
+        serialPut(st, self->as.mixfix.args.data[i]);
+      }
+    }; break;
+  }
+  *header = (uint64_t)self->type | (n << 8);
+}
+
+size_t eexpr_serialize(const eexpr_lineIndex* lines, size_t n, eexpr* const* eexprs, uint64_t* buf) {
+  serializer st = {.lines = lines, .next = buf, .cursor = {.line = 0, .col = 0, .col16 = 0, .byte = 0}};
+  *st.next++ = n;
+  for (size_t i = 0; i < n; ++i) {
+    serialPut(&st, eexprs[i]);
+  }
+  return (st.next - buf) * sizeof(uint64_t);
+}
+
+
+//////////////////////////////////// Flat Trees ////////////////////////////////////
+
+typedef struct flatCounts {
+  size_t nodes;
+  size_t bytes;
+  size_t texts;
+  size_t numbers;
+  size_t digits;
+  size_t strings;
+  size_t strParts;
+} flatCounts;
+
+static
+void flatCount(flatCounts* counts, const eexpr* self) {
+  if (self == NULL) { return; }
+  counts->nodes += 1;
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      counts->texts += 1;
+      counts->bytes += self->as.symbol.text.len;
+    }; break;
+    case EEXPR_NUMBER: {
+      lexer_forceEexpr((eexpr*)self);
+      counts->numbers += 1;
+      counts->digits += self->as.number.mantissa.len + self->as.number.exponent.len;
+    }; break;
+    case EEXPR_STRING: {
+      lexer_forceEexpr((eexpr*)self);
+      counts->strings += 1;
+      counts->texts += 1 + self->as.string.parts.len;
+      counts->strParts += self->as.string.parts.len;
+      counts->bytes += self->as.string.text1.len;
+      for (size_t i = 0; i < self->as.string.parts.len; ++i) {
+        flatCount(counts, self->as.string.parts.data[i].subexpr);
+        counts->bytes += self->as.string.parts.data[i].nBytes;
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      flatCount(counts, self->as.wrap);
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: case EEXPR_MIXFIX: {
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        flatCount(counts, self->as.list.data[i]);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      flatCount(counts, self->as.ellipsis[0]);
+      flatCount(counts, self->as.ellipsis[1]);
+    }; break;
+    case EEXPR_COLON: {
+      flatCount(counts, self->as.pair[0]);
+      flatCount(counts, self->as.pair[1]);
+    }; break;
+  }
+}
+
+// Allocate space for `n` elements of `size` bytes, or `NULL` if `n` is zero.
+static
+void* flatAlloc(size_t n, size_t size) {
+  if (n == 0) { return NULL; }
+  void* out = malloc(n * size);
+  checkOom(out);
+  return out;
+}
+
+static
+uint32_t flatPutText(eexpr_flat* out, size_t nBytes, const uint8_t* bytes) {
+  uint32_t i = out->nTexts++;
+  out->texts[i].offset = out->nBytes;
+  out->texts[i].nBytes = nBytes;
+  if (nBytes != 0) { memcpy(&out->bytes[out->nBytes], bytes, nBytes); }
+  out->nBytes += nBytes;
+  return i;
+}
+
+static
+uint32_t* flatPutDigits(eexpr_flat* out, const bigint* n) {
+  if (n->len == 0) { return NULL; }
+  uint32_t* digits = &out->digits[out->nDigits];
+  memcpy(digits, n->buf, n->len * sizeof(uint32_t));
+  out->nDigits += n->len;
+  return digits;
+}
+
+// Append the node and its subtree, returning its index.
+// The counters in `out` double as write cursors; `flatCount` has already sized every array.
+static
+uint32_t flatPut(eexpr_flat* out, const eexpr* self, uint32_t parent) {
+  uint32_t i = out->nNodes++;
+  out->type[i] = self->type;
+  out->parent[i] = parent;
+  out->startByte[i] = self->loc.start;
+  out->endByte[i] = self->loc.end;
+  out->payload[i] = EEXPR_FLAT_NONE;
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      out->payload[i] = flatPutText(out, self->as.symbol.text.len, self->as.symbol.text.bytes);
+    }; break;
+    case EEXPR_NUMBER: {
+      uint32_t k = out->nNumbers++;
+      eexpr_number* value = &out->numbers[k];
+      value->isPositive = self->as.number.mantissa.pos;
+      value->nBigDigits = self->as.number.mantissa.len;
+      value->bigDigits = flatPutDigits(out, &self->as.number.mantissa);
+      value->radix = self->as.number.radix;
+      value->nFracDigits = self->as.number.fractionalDigits;
+      value->isPositive_exp = self->as.number.exponent.pos;
+      value->nBigDigits_exp = self->as.number.exponent.len;
+      value->bigDigits_exp = flatPutDigits(out, &self->as.number.exponent);
+      out->payload[i] = k;
+    }; break;
+    case EEXPR_STRING: {
+      uint32_t k = out->nStrings++;
+      size_t nParts = self->as.string.parts.len;
+      out->strings[k].head = flatPutText(out, self->as.string.text1.len, self->as.string.text1.bytes);
+      out->strings[k].nParts = nParts;
+      // reserve the parts up front, since nested strings will claim parts of their own
+      out->strings[k].firstPart = out->nStrParts;
+      out->nStrParts += nParts;
+      for (size_t j = 0; j < nParts; ++j) {
+        const strTemplPart* part = &self->as.string.parts.data[j];
+        eexpr_flatStrPart* flatPart = &out->strParts[out->strings[k].firstPart + j];
+        flatPart->subexpr = part->subexpr == NULL ? EEXPR_FLAT_NONE : flatPut(out, part->subexpr, i);
+        flatPart->text = flatPutText(out, part->nBytes, part->utf8str);
+      }
+      out->payload[i] = k;
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      if (self->as.wrap != NULL) { flatPut(out, self->as.wrap, i); }
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      for (size_t j = 0; j < self->as.list.len; ++j) {
+        flatPut(out, self->as.list.data[j], i);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      out->payload[i] = (self->as.ellipsis[0] != NULL ? 1 : 0) | (self->as.ellipsis[1] != NULL ? 2 : 0);
+      if (self->as.ellipsis[0] != NULL) { flatPut(out, self->as.ellipsis[0], i); }
+      if (self->as.ellipsis[1] != NULL) { flatPut(out, self->as.ellipsis[1], i); }
+    }; break;
+    case EEXPR_COLON: {
+      flatPut(out, self->as.pair[0], i);
+      flatPut(out, self->as.pair[1], i);
+    }; break;
+    case EEXPR_MIXFIX: {
+      out->payload[i] = self->as.mixfix.op;
+      for (size_t j = 0; j < self->as.mixfix.args.len; ++j) {
+        flatPut(out, self->as.mixfix.args.data[j], i);
+      }
+    }; break;
+  }
+  out->subtreeSize[i] = out->nNodes - i;
+  return i;
+}
+
+eexpr_flat* eexpr_flatten(size_t n, eexpr* const* eexprs) {
+  flatCounts counts = {0};
+  for (size_t i = 0; i < n; ++i) {
+    flatCount(&counts, eexprs[i]);
+  }
+  if (counts.nodes >= EEXPR_FLAT_NONE || counts.texts >= EEXPR_FLAT_NONE || counts.strParts >= EEXPR_FLAT_NONE) {
+    return NULL;
+  }
+  eexpr_flat* out = malloc(sizeof(eexpr_flat));
+  checkOom(out);
+  *out = (eexpr_flat){
+    .type = flatAlloc(counts.nodes, sizeof(uint8_t)),
+    .parent = flatAlloc(counts.nodes, sizeof(uint32_t)),
+    .subtreeSize = flatAlloc(counts.nodes, sizeof(uint32_t)),
+    .startByte = flatAlloc(counts.nodes, sizeof(size_t)),
+    .endByte = flatAlloc(counts.nodes, sizeof(size_t)),
+    .payload = flatAlloc(counts.nodes, sizeof(uint32_t)),
+    .bytes = flatAlloc(counts.bytes, sizeof(uint8_t)),
+    .texts = flatAlloc(counts.texts, sizeof(eexpr_flatText)),
+    .numbers = flatAlloc(counts.numbers, sizeof(eexpr_number)),
+    .digits = flatAlloc(counts.digits, sizeof(uint32_t)),
+    .strings = flatAlloc(counts.strings, sizeof(eexpr_flatString)),
+    .strParts = flatAlloc(counts.strParts, sizeof(eexpr_flatStrPart))
+  };
+  for (size_t i = 0; i < n; ++i) {
+    flatPut(out, eexprs[i], EEXPR_FLAT_NONE);
+  }
+  assert(out->nNodes == counts.nodes && out->nBytes == counts.bytes && out->nDigits == counts.digits);
+  return out;
+}
+
+void eexpr_flat_del(eexpr_flat* self) {
+  if (self == NULL) { return; }
+  free(self->type);
+  free(self->parent);
+  free(self->subtreeSize);
+  free(self->startByte);
+  free(self->endByte);
+  free(self->payload);
+  free(self->bytes);
+  free(self->texts);
+  free(self->numbers);
+  free(self->digits);
+  free(self->strings);
+  free(self->strParts);
+  free(self);
+}
+
+uint32_t eexpr_flat_firstChild(const eexpr_flat* self, uint32_t node) {
+  return self->subtreeSize[node] > 1 ? node + 1 : EEXPR_FLAT_NONE;
+}
+
+uint32_t eexpr_flat_nextSibling(const eexpr_flat* self, uint32_t node) {
+  size_t next = (size_t)node + self->subtreeSize[node];
+  if (next >= self->nNodes || self->parent[next] != self->parent[node]) { return EEXPR_FLAT_NONE; }
+  return next;
+}
+
+bool eexpr_flat_asSymbol(const eexpr_flat* self, uint32_t node, size_t* nBytes, const uint8_t** utf8str) {
+  if (self->type[node] != EEXPR_SYMBOL) { return false; }
+  const eexpr_flatText* text = &self->texts[self->payload[node]];
+  *nBytes = text->nBytes;
+  *utf8str = &self->bytes[text->offset];
+  return true;
+}
+
+bool eexpr_flat_asNumber(const eexpr_flat* self, uint32_t node, eexpr_number* value) {
+  if (self->type[node] != EEXPR_NUMBER) { return false; }
+  *value = self->numbers[self->payload[node]];
+  return true;
+}
+
+bool eexpr_flat_asString(const eexpr_flat* self, uint32_t node, size_t* nBytes, const uint8_t** head, size_t* nParts) {
+  if (self->type[node] != EEXPR_STRING) { return false; }
+  const eexpr_flatString* string = &self->strings[self->payload[node]];
+  const eexpr_flatText* text = &self->texts[string->head];
+  *nBytes = text->nBytes;
+  *head = &self->bytes[text->offset];
+  *nParts = string->nParts;
+  return true;
+}
+
+bool eexpr_flat_strPart(const eexpr_flat* self, uint32_t node, size_t i, uint32_t* subexpr, size_t* nBytes, const uint8_t** utf8str) {
+  if (self->type[node] != EEXPR_STRING) { return false; }
+  const eexpr_flatString* string = &self->strings[self->payload[node]];
+  if (i >= string->nParts) { return false; }
+  const eexpr_flatStrPart* part = &self->strParts[string->firstPart + i];
+  const eexpr_flatText* text = &self->texts[part->text];
+  *subexpr = part->subexpr;
+  *nBytes = text->nBytes;
+  *utf8str = &self->bytes[text->offset];
+  return true;
+}
+
+bool eexpr_flat_asEllipsis(const eexpr_flat* self, uint32_t node, uint32_t* before, uint32_t* after) {
+  if (self->type[node] != EEXPR_ELLIPSIS) { return false; }
+  uint32_t present = self->payload[node];
+  uint32_t child = node + 1;
+  *before = EEXPR_FLAT_NONE;
+  *after = EEXPR_FLAT_NONE;
+  if (present & 1) {
+    *before = child;
+    child += self->subtreeSize[child];
+  }
+  if (present & 2) { *after = child; }
+  return true;
+}
+
+
+//////////////////////////////////// Mixfixes ////////////////////////////////////
+
+eexpr_mixfixTable* eexpr_mixfixTable_new(size_t nDefs, const eexpr_mixfixDef* defs, size_t* nErrors, eexpr_mixfixDefError** errors) {
+  return mixfixTable_new(nDefs, defs, nErrors, errors);
+}
+
+void eexpr_mixfixTable_del(eexpr_mixfixTable* self) {
+  mixfixTable_del(self);
+}
+
+bool eexpr_mixfixTable_name(const eexpr_mixfixTable* self, uint32_t op, size_t* nBytes, const uint8_t** utf8str) {
+  if (op >= self->nOps) { return false; }
+  *nBytes = self->ops[op].name.len;
+  *utf8str = self->ops[op].name.bytes;
+  return true;
+}
+
+bool eexpr_mixfixTable_level(const eexpr_mixfixTable* self, uint32_t op, uint32_t* level) {
+  if (op >= self->nOps) { return false; }
+  *level = self->ops[op].level;
+  return true;
+}
+
+bool eexpr_mixfixRewrite(const eexpr_mixfixTable* table, size_t n, eexpr** eexprs, size_t* nErrors, eexpr_mixfixError** errors) {
+  return mixfixRewrite(table, n, eexprs, nErrors, errors);
+}
+
+
+//////////////////////////////////// Printing Eexprs ////////////////////////////////////
+
+size_t eexpr_print(size_t n, eexpr* const* eexprs, size_t cap, uint8_t* buf) {
+  return printer_print(NULL, n, eexprs, cap, buf);
+}
+
+bool eexpr_fprint(FILE* fp, size_t n, eexpr* const* eexprs) {
+  return printer_print(fp, n, eexprs, 0, NULL) != SIZE_MAX;
+}
+
+
+//////////////////////////////////// Hashing and Comparing Eexprs ////////////////////////////////////
+
+uint64_t eexpr_hash(const eexpr* self, bool withSpans) {
+  return hash_eexpr(self, withSpans);
+}
+
+bool eexpr_equal(const eexpr* a, const eexpr* b, bool withSpans) {
+  return hash_equal(a, b, withSpans);
+}
+
+
+//////////////////////////////////// Diffing Eexprs ////////////////////////////////////
+
+bool eexpr_diff(size_t nA, eexpr* const* a, size_t nB, eexpr* const* b, size_t* nEdits, eexpr_edit** edits) {
+  return diff_forests(nA, a, NULL, nB, b, NULL, nEdits, edits);
+}
+
+bool eexpr_diffShared(size_t nA, eexpr* const* a, const eexpr_span* aSpans, size_t nB, eexpr* const* b, const eexpr_span* bSpans, size_t* nEdits, eexpr_edit** edits) {
+  return diff_forests(nA, a, aSpans, nB, b, bSpans, nEdits, edits);
+}
+
+
+//////////////////////////////////// Validating Eexprs ////////////////////////////////////
+
+eexpr_schema* eexpr_schemaCompile(size_t nDefs, eexpr* const* defs, size_t* nErrors, eexpr_schemaError** errors) {
+  return schema_compile(nDefs, defs, nErrors, errors);
+}
+
+void eexpr_schema_del(eexpr_schema* self) {
+  schema_del(self);
+}
+
+size_t eexpr_schema_size(const eexpr_schema* self) {
+  return self->nDefs;
+}
+
+bool eexpr_schema_name(const eexpr_schema* self, uint32_t def, size_t* nBytes, const uint8_t** utf8str) {
+  if (def >= self->nDefs) { return false; }
+  *nBytes = self->defs[def].nameLen;
+  *utf8str = &self->text[self->defs[def].name];
+  return true;
+}
+
+uint32_t eexpr_schema_find(const eexpr_schema* self, size_t nBytes, const uint8_t* utf8str) {
+  for (uint32_t i = 0; i < self->nDefs; ++i) {
+    const schemaDef* def = &self->defs[i];
+    if (def->nameLen == nBytes && memcmp(&self->text[def->name], utf8str, nBytes) == 0) { return i; }
+  }
+  return EEXPR_SCHEMA_NONE;
+}
+
+bool eexpr_schemaValidate(const eexpr_schema* schema, uint32_t def, size_t n, eexpr* const* eexprs, size_t* nErrors, eexpr_schemaError* errors) {
+  return schema_validate(schema, def, n, eexprs, nErrors, errors);
+}
+
+
+//////////////////////////////////// Querying Eexprs ////////////////////////////////////
+
+eexpr_query* eexpr_queryCompile(size_t nBytes, const uint8_t* utf8str, eexpr_queryError* error) {
+  return query_compile(nBytes, utf8str, error);
+}
+
+void eexpr_query_del(eexpr_query* self) {
+  query_del(self);
+}
+
+size_t eexpr_queryRun(const eexpr_query* self, size_t n, eexpr* const* eexprs, eexpr_queryCallback onMatch, void* ctx) {
+  return query_run(self, n, eexprs, onMatch, ctx);
+}
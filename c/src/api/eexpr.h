@@ -4,8 +4,9 @@
 This defines an interface to an e-expression (eexpr) parser and data type.
 The parser is configurable and can also be made to output tokens at an intermediate stages.
 The eexpr and token data types are kept abstract; the data they hold can be accessed through a number of accessor functions.
-The parser annotates every token and expression with its location in the source, both byte offset and line/col offset
-  (column offsets count unicode codepoints, not grapheme clusters or user-perceived characters).
+The parser annotates every token and expression with the span of bytes it occupies in the source.
+Line/col offsets are recovered from these byte offsets on demand using a line index that the parser builds alongside its output
+  (column offsets count unicode codepoints, not grapheme clusters or user-perceived characters; UTF-16 columns are also available).
 
 The parsing algorithm is in `eexpr_parse` and the key to its operation is an `eexpr_parser` value.
 An ``eexpr_parser` is used to configure the parsing process, hold internal state during parsing, and present output data.
@@ -13,7 +14,7 @@ All of the inner state however is hidden behind a pointer to implementation.
 
 The main output data if the parser are pointers to abstract `eexpr` and `eexpr_token` types.
 The `eexpr_as*` and `eexpr_tokenAs*` families of functions pull out the constituent data of eexprs and tokens respectively.
-Location data is obtained with `eexpr_locate` and `eexpr_tokenLocate`.
+Byte spans are obtained with `eexpr_getSpan` and `eexpr_getTokenSpan`, and full locations with `eexpr_locate` and `eexpr_tokenLocate`.
 
 When eexpr data is no longer needed, it can be easily cleaned up with `eexpr_del` or `eexpr_deinit`.
 Token data is inherently transient, and is cleaned up as soon as parsing completes.
@@ -24,18 +25,23 @@ Every identifier in this interface begins with either `eexpr_` or `EXPR_` (with
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <uchar.h>
 
 
 #define EEXPR_VERSION_MAJOR 0
-#define EEXPR_VERSION_MINOR 1
-#define EEXPR_VERSION_PATCH 1
+#define EEXPR_VERSION_MINOR 2
+#define EEXPR_VERSION_PATCH 0
 
 
 typedef struct eexpr_token eexpr_token;
 
 typedef struct eexpr eexpr;
 typedef struct eexpr_error eexpr_error;
+typedef struct eexpr_lineIndex eexpr_lineIndex;
+typedef struct eexpr_symtab eexpr_symtab;
+typedef struct eexpr_shareTable eexpr_shareTable;
+typedef struct eexpr_span eexpr_span;
 
 
 //////////////////////////////////// Producing Eexprs ////////////////////////////////////
@@ -77,6 +83,16 @@ typedef struct eexpr_parser {
   // On output: An array holding generated lexing/parsing warnings.
   // Like `.errors`, this array and its contents are owned by the owner of this struct.
   eexpr_error* warnings;
+  // Output member: The line index of the input, which is needed to turn byte offsets into line/col offsets (see `eexpr_locate`).
+  // It is available as soon as parsing starts (unless `.lazyLines` is set), and is owned by the owner of this struct; free it with `eexpr_lineIndex_del`.
+  // Initialize to `NULL` before parsing.
+  eexpr_lineIndex* lines;
+  // Output member: The number of spans in the `.spans` array.
+  size_t nSpans;
+  // Output member: When parsing with `.shared` and `.shareSpans`, the span of each place each eexpr in `.eexprs` occurs, in preorder (see `eexpr_shareTable`).
+  // Initialize to `NULL` before parsing.
+  // Like `.eexprs`, once initialized this array is owned by the owner of this struct.
+  eexpr_span* spans;
   // Some conditions can be treated as either errors or warnings.
   // When members of this struct are true, they are retained as errors, but when false (default) are demoted to warnings.
   // `eexpr_parser` refuses to continue parsing if there are any errors, but does not stop for warnings.
@@ -88,6 +104,44 @@ typedef struct eexpr_parser {
     bool badDigitSeparator;
     // NOTE if more fields are added here, remember to edit `eexpr_parserInitDefault`
   } isError;
+  // When true, number and string payloads are not decoded during parsing;
+  //   instead, they are decoded on the first call to `eexpr_asNumber`/`eexpr_asString` (or the `eexpr_tokenAs*` equivalents) and then kept.
+  // Lexing errors (bad escapes, digit separators, and so on) are still reported during parsing as usual.
+  // This saves work and memory when consumers only look at some of the literals in the input, but it has costs:
+  //   * the input passed to `eexpr_parse` must outlive the tokens and eexprs that came from it,
+  //   * the first access to a payload mutates the eexpr, so it is not safe to race on that first access between threads.
+  // Default false.
+  bool lazyPayloads;
+  // When true, the line index is not built during parsing, and `.lines` is left `NULL`.
+  // Parsing only ever needs byte offsets, so this saves a pass over the input when locations are never (or only rarely) shown to anyone;
+  //   an index can be built afterwards, only if it turns out to be needed, with `eexpr_lineIndex_new`.
+  // Default false.
+  bool lazyLines;
+  // When non-null, the text of each distinct symbol is stored once in this table, and symbols are given ids (see `eexpr_asSymbolId`).
+  // The table is borrowed, and must outlive the tokens and eexprs produced with it.
+  // One table may be shared by many parsers, so that ids agree between inputs, but not by parsers running concurrently.
+  // Default `NULL`.
+  eexpr_symtab* symbols;
+  // When non-null, structurally identical subexprs are stored just once, in this table, and shared by every place they occur (see `eexpr_shareTable`).
+  // As with `.symbols`, the table is borrowed, must outlive the eexprs produced with it,
+  //   and may be shared by many parsers (so that they share subexprs with each other), but not by parsers running concurrently.
+  // Default `NULL`.
+  eexpr_shareTable* shared;
+  // When true (and `.shared` is set), the spans that shared eexprs can no longer hold are recorded in `.spans` instead.
+  // Default false.
+  bool shareSpans;
+  // Bounds on the work done for one input, for when that input is untrusted.
+  // A limit of zero (the default for all of them) means unlimited.
+  // Going over any limit stops the parse promptly with an `EEXPR_ERR_LIMIT_EXCEEDED` error that says which limit it was.
+  struct eexpr_parseLimits {
+    size_t bytes; // length of the input
+    size_t tokens; // number of raw tokens (which includes whitespace and comments)
+    size_t depth; // nesting of parens/brackets/braces/indentation/string templates
+    size_t digits; // digits in the mantissa or exponent of any one number
+    size_t errors; // errors and warnings, combined
+    size_t memory; // bytes allocated for tokens, eexprs, payloads and errors (a close estimate, not an exact count)
+    // NOTE if more fields are added here, remember to edit `eexpr_parserInitDefault`
+  } limits;
   // Specify a stage of parsing to pause at.
   // Calling `eexpr_parse` on the same parser will resume the parsing from where it was left off.
   enum eexpr_parsePauseAt {
@@ -119,6 +173,7 @@ alter options
 `eexpr_parse(&parser, len, inp)`
 initialize                                            memory allocated for internal data structures
   |    |                                              inp is borrowed (i.e. must remain stable)
+  |    |                                              line index output initialized
   |    \_________> if pause after start
   |                `parser.pauseAt = …`
   V                `eexpr_parse(&parser, 0, NULL)`
@@ -135,7 +190,7 @@ post-lexing stage  <________/
 parsing stage  <____________/                         pointers obtained from tokens are now invalid
   |    |                                              error/warning outputs initialized
   |    \_________> if pause after parse               eexprs output initialized
-  |                         V                         memory accessible from eexprs is owned (and uniquely referenced) by the caller
+  |                         V                         memory accessible from eexprs is owned (and uniquely referenced) by the caller (unless `parser.shared`)
   |                `parser.pauseAt = …`
   V                `eexpr_parse(&parser, 0, NULL)`
 finished  <_________________/
@@ -143,6 +198,9 @@ finished  <_________________/
   V
 `eexpr_parser_deinit(&parser)`                        internal data structures are deinitialized
                                                       the parser can now be re-configured and re-used
+(or, from any point after initialization)
+`eexpr_parser_reset(&parser)`                         outputs are deleted, but all memory is kept
+                                                      the parser can now be re-used with the same configuration, starting from `eexpr_parse(&parser, len, inp)`
 */
 bool eexpr_parse
   // Input configuration from and output parsed eexprs to this data structure
@@ -160,14 +218,68 @@ bool eexpr_parse
 // Calling this multiple times is idempotent.
 void eexpr_parser_deinit(eexpr_parser* parser);
 
+// Prepare a parser that has been used to parse something else for another call to `eexpr_parse` with a new input.
+// This is like `eexpr_parser_deinit`, except that no memory is given back:
+//   internal buffers, the `.eexprs`, `.tokens`, `.errors` and `.warnings` arrays, and the `.lines` index all keep their capacity,
+//   so that parsing many small inputs one after another does not have to allocate them all over again.
+// The outputs of the previous parse are deleted (the eexprs in `.eexprs`) or overwritten (the rest, including `.lines`),
+//   so anything that is still wanted must be taken out first, e.g. by copying the `.eexprs` array and its length and then setting `.eexprs = NULL`.
+// Options (`.isError`, `.lazyPayloads`, `.symbols`, `.shared`, `.limits`, `.pauseAt`) are left as they are, but may be changed before the next parse.
+// Does nothing to a parser that has not started parsing.
+void eexpr_parser_reset(eexpr_parser* parser);
+
+// Where the output for one of the inputs to `eexpr_parseBatch` can be found.
+// The spans index into the parser's output arrays, which hold the outputs for all the inputs one after another.
+typedef struct eexpr_batchResult {
+  // The eexprs parsed from this input are `parser.eexprs[firstEexpr]` up to (not including) `parser.eexprs[firstEexpr + nEexprs]`.
+  size_t firstEexpr;
+  size_t nEexprs;
+  // likewise, into `parser.errors`
+  size_t firstError;
+  size_t nErrors;
+  // likewise, into `parser.warnings`
+  size_t firstWarning;
+  size_t nWarnings;
+  // likewise, into `parser.spans`
+  size_t firstSpan;
+  size_t nSpans;
+  // The line index of this input (since the byte offsets in the eexprs, errors and warnings are relative to the start of this input).
+  // Owned by the caller, like `eexpr_parser.lines`.
+  eexpr_lineIndex* lines;
+} eexpr_batchResult;
+
+// Parse many separate inputs in one go, as if each were given to `eexpr_parse` with a parser that is reset in between.
+// This way, the internals of the parser are set up only once,
+//   and the outputs of all the inputs are collected into the parser's output arrays, so that they are also allocated only once.
+// The output for the ith input is described by `results[i]`, which the caller provides space for.
+// Each input is parsed as far as it can be without errors, regardless of errors in the others,
+//   and the parser's options apply to each input separately (in particular, `.limits` are per input).
+// All inputs are borrowed as in `eexpr_parse`, and `.pauseAt` is ignored.
+// The parser must not have started parsing, or else must have been reset (see `eexpr_parser_reset`);
+//   afterwards, it must be reset (or deinitialized) before it is used again.
+// Returns true if there were no errors in any of the inputs.
+bool eexpr_parseBatch
+  ( eexpr_parser* parser
+  // number of inputs
+  , size_t n
+  // the number of bytes in each input
+  , const size_t* nBytes
+  // each input, utf8-encoded (not NUL-terminated)
+  , uint8_t* const* utf8Inputs
+  // output: array of `n` results
+  , eexpr_batchResult* results
+  );
+
 
 //////////////////////////////////// Consuming Eexprs ////////////////////////////////////
 
 
 // Recursively free this eexpr and all its data.
+// Eexprs that belong to an `eexpr_shareTable` or an `eexpr_arena` are left alone (they are freed along with the table or arena).
 void eexpr_del(eexpr* self);
 
 // Recursively frees data used by the given eexpr, but does not free the eexpr itself.
+// This leaves eexprs from an `eexpr_shareTable` or `eexpr_arena` alone too, so it must not be paired with `free` on them; use `eexpr_del`.
 void eexpr_deinit(eexpr* self);
 
 
@@ -185,7 +297,8 @@ typedef enum eexpr_type {
   EEXPR_ELLIPSIS,
   EEXPR_COLON,
   EEXPR_COMMA,
-  EEXPR_SEMICOLON
+  EEXPR_SEMICOLON,
+  EEXPR_MIXFIX // only produced by `eexpr_mixfixRewrite`
 } eexpr_type;
 
 // This is provided so that a if-elif-else or switch can quickly determine which of the `eexpr_as*` functions to call.
@@ -202,12 +315,17 @@ The `eexpr_as*` functions follow a common pattern:
 
 Note that the pointers returned from these functions are owned by the eexpr, and are never referenced from another eexpr.
 Only *you* have the power to prevent forest fires^W^W^W alias these pointers.
+(The exception is the text of symbols parsed with `eexpr_parser.symbols` set, which is owned by that symbol table.)
 
 Unless otherwise noted, the pointers input to or output from these functions are non-null.
 */
 
 bool eexpr_asSymbol(const eexpr* self, size_t* nBytes, uint8_t** utf8str);
 
+// Outputs the id the symbol was interned with (see `eexpr_parser.symbols`).
+// Returns false if the eexpr is not a symbol, or was parsed without a symbol table.
+bool eexpr_asSymbolId(const eexpr* self, uint32_t* id);
+
 // Since numerical eexprs can easily outstrip the representational power of fixed-size machine formats,
 //   eexprs have to represent these numbers as bignums.
 // The numerical value is given by `significand * radix^(exp - nFracDigits)`;
@@ -300,6 +418,11 @@ bool eexpr_asComma(const eexpr* self, size_t* nSubexprs, eexpr*** subexprs);
 // Oof… three-star programming? Same explanation as for `eexpr_asBlock`.
 bool eexpr_asSemicolon(const eexpr* self, size_t* nSubexprs, eexpr*** subexprs);
 
+// An operator application built by `eexpr_mixfixRewrite`.
+// The operator is the index of its definition in the array the `eexpr_mixfixTable` was built from,
+//   and the args are the eexprs that filled its holes, in order.
+bool eexpr_asMixfix(const eexpr* self, uint32_t* op, size_t* nArgs, eexpr*** args);
+
 
 
 // I do not report filenames as part of a location.
@@ -310,6 +433,16 @@ bool eexpr_asSemicolon(const eexpr* self, size_t* nSubexprs, eexpr*** subexprs);
 // If this is so, I recommend first pattern-matching an eexpr into a data type that represents the language being interpreted;
 //   such a data type should be able to accomodate location data beyond what the eexpr library itself defines.
 
+// Tokens, eexprs, and errors only record the bytes they span.
+// Start and end are byte offsets from the start of input (zero-indexed), and the end is exclusive.
+struct eexpr_span {
+  size_t start;
+  size_t end;
+};
+
+// Return the byte span of an eexpr.
+eexpr_span eexpr_getSpan(const eexpr* self);
+
 struct eexpr_locPoint {
   // Line offset within input; i.e. `.line = 0` means the first line of the file (or other input).
   size_t line;
@@ -317,6 +450,8 @@ struct eexpr_locPoint {
   // Columns are counted as unicode codepoints.
   // NOTE This means the `.col` is not necessarily the same as the number of user-percieved characters or grapheme clusters!
   size_t col;
+  // Column offset within a line, but counted in UTF-16 code units, as e.g. the Language Server Protocol expects.
+  size_t col16;
   // The byte offset from the start of input (zero-indexed again).
   size_t byte;
 };
@@ -326,8 +461,660 @@ typedef struct eexpr_loc {
   struct eexpr_locPoint end;
 } eexpr_loc;
 
-// Return the location of an eexpr.
-eexpr_loc eexpr_locate(const eexpr* self);
+// A line index records where each line of an input starts, so that line/col offsets need not be tracked during parsing.
+// It is produced by the parser (see `eexpr_parser.lines`) and borrows the parser's input:
+//   the input must remain stable for as long as locations are resolved with the index.
+// Lookups take logarithmic time in the number of lines, plus linear time in the length of the line (to count columns).
+
+// Build a line index for an input (which is borrowed), just as the parser does.
+// This is for when the parser was told not to (see `eexpr_parser.lazyLines`).
+eexpr_lineIndex* eexpr_lineIndex_new(size_t nBytes, const uint8_t* utf8Input);
+
+// Resolve a byte offset into a full location point.
+// Bytes beyond the end of input are clamped to the end of input.
+// With no line index (`lines == NULL`), only the byte offset is filled in, and line/col are zero.
+struct eexpr_locPoint eexpr_resolvePoint(const eexpr_lineIndex* lines, size_t byte);
+// Resolve both ends of a byte span.
+eexpr_loc eexpr_resolveSpan(const eexpr_lineIndex* lines, eexpr_span span);
+// Return the location of an eexpr; same as `eexpr_resolveSpan(lines, eexpr_getSpan(self))`.
+eexpr_loc eexpr_locate(const eexpr_lineIndex* lines, const eexpr* self);
+
+// The number of lines in the input (always at least one).
+size_t eexpr_lineCount(const eexpr_lineIndex* lines);
+// The byte offset where line number `line` (zero-indexed) starts.
+// Lines beyond the end of input are clamped to the last line.
+size_t eexpr_lineStart(const eexpr_lineIndex* lines, size_t line);
+
+// Free a line index. Passing `NULL` is a no-op.
+void eexpr_lineIndex_del(eexpr_lineIndex* lines);
+
+
+//////////////////////////////////// Symbol Tables ////////////////////////////////////
+
+/*
+A symbol table gives each distinct symbol a small integer id, assigned in order of first appearance (starting from zero).
+Grammar code can look up the ids of its keywords once (with `eexpr_symtab_intern`),
+  and then compare ids (or switch on them) rather than comparing strings.
+*/
+
+#define EEXPR_NO_SYMBOL UINT32_MAX
+
+eexpr_symtab* eexpr_symtab_new(void);
+// Free a symbol table and all the text it holds. Passing `NULL` is a no-op.
+void eexpr_symtab_del(eexpr_symtab* self);
+// The number of distinct symbols in the table; ids range from zero up to (not including) this.
+size_t eexpr_symtab_size(const eexpr_symtab* self);
+// The id of the given text, adding it to the table if it is not already there.
+uint32_t eexpr_symtab_intern(eexpr_symtab* self, size_t nBytes, const uint8_t* utf8str);
+// The id of the given text, or `EEXPR_NO_SYMBOL` if it is not in the table.
+uint32_t eexpr_symtab_find(const eexpr_symtab* self, size_t nBytes, const uint8_t* utf8str);
+// Outputs the text of a symbol by id; the pointer is owned by the table.
+// Returns false if there is no such id.
+bool eexpr_symtab_lookup(const eexpr_symtab* self, uint32_t id, size_t* nBytes, const uint8_t** utf8str);
+
+
+//////////////////////////////////// Share Tables ////////////////////////////////////
+
+/*
+A share table stores each distinct eexpr once (hash-consing), so that input which repeats itself
+  (generated configuration, tables of data, and the like) takes memory in proportion to what is distinct in it, rather than to its size.
+When parsing with `eexpr_parser.shared`, each eexpr is looked up in the table as soon as it is parsed, subexprs first;
+  if the table already holds a structurally identical eexpr (as by `eexpr_equal` without spans), the new one is freed and the old one used in its place.
+The eexprs of a shared parse are then a DAG rather than a tree, and so:
+  * they belong to the table (even the ones in `eexpr_parser.eexprs`), and are freed along with it,
+  * they must not be changed, in particular by `eexpr_mixfixRewrite`,
+  * their payloads are decoded as they are parsed, even if `eexpr_parser.lazyPayloads` is set (the table compares decoded payloads),
+  * each has only the span of the first place it was parsed.
+The span of every occurrence is recorded separately in `eexpr_parser.spans` if `eexpr_parser.shareSpans` is set.
+These are in preorder, as if the forest were a tree: each eexpr comes before its subexprs, which come in the order the `eexpr_as*` functions give them
+  (for strings, the spliced subexprs in order), and absent subexprs (such as a missing side of an ellipsis) are skipped.
+So, the spans can be paired up with eexprs by any depth-first walk of the forest just by counting.
+*/
+
+eexpr_shareTable* eexpr_shareTable_new(void);
+// Free a share table and all the eexprs in it. Passing `NULL` is a no-op.
+void eexpr_shareTable_del(eexpr_shareTable* self);
+// The number of distinct eexprs in the table.
+size_t eexpr_shareTable_size(const eexpr_shareTable* self);
+
+
+//////////////////////////////////// Building Eexprs ////////////////////////////////////
+
+/*
+Eexprs can also be built directly, e.g. to generate text with `eexpr_print` without going through a string builder and the parser.
+Built eexprs are allocated from an arena, and all freed at once along with it (or when it is reset);
+  `eexpr_del` and `eexpr_deinit` leave them alone.
+The subexprs of a built eexpr can be any eexprs, but the arena does not take them over:
+  built eexprs holding parsed subexprs must be outlived by those subexprs, and the parsed ones freed separately.
+Likewise, parsed eexprs can hold built subexprs only as long as the arena is not freed or reset.
+
+Arrays passed to the constructors (of subexprs, template parts or big digits) are used in place rather than copied,
+  so they must last as long as the eexpr built from them; the easiest way is to allocate them with `eexpr_arena_alloc` as well.
+Text, on the other hand, is copied into the arena.
+Locations can be anything (the parser is not involved); for eexprs that do not come from any input, use an empty span like `{0, 0}`.
+
+Built eexprs should have the same shape as parsed ones (e.g. no space directly inside another space, no chain of fewer than two subexprs),
+  or else printing them will not give text that parses back to the same eexprs.
+The constructors never allocate anything outside the arena.
+Like shared eexprs, built eexprs must not be passed to `eexpr_mixfixRewrite`.
+*/
+
+typedef struct eexpr_arena eexpr_arena;
+
+eexpr_arena* eexpr_arena_new(void);
+// Free an arena and everything allocated from it. Passing `NULL` is a no-op.
+void eexpr_arena_del(eexpr_arena* self);
+// Free everything allocated from an arena at once, but keep its memory to allocate from again.
+void eexpr_arena_reset(eexpr_arena* self);
+// Allocate memory (suitably aligned for any type) that lives as long as the arena.
+void* eexpr_arena_alloc(eexpr_arena* self, size_t nBytes);
+
+eexpr* eexpr_newSymbol(eexpr_arena* arena, eexpr_span loc, size_t nBytes, const uint8_t* utf8str);
+// An integer, written in decimal.
+eexpr* eexpr_newInt(eexpr_arena* arena, eexpr_span loc, int64_t value);
+// Any number, as described in `eexpr_number`, including its invariants (no leading zero big digits, `NULL` digits when there are none).
+// The big digit arrays are used in place; each may have at most `UINT16_MAX` digits.
+eexpr* eexpr_newNumber(eexpr_arena* arena, eexpr_span loc, const eexpr_number* value);
+// A string (template), as described in `eexpr_string`: the head text is copied, and so is each text part of the tail,
+//   but the tail array itself is used in place (and the text pointers in it are replaced with the copies).
+eexpr* eexpr_newString(eexpr_arena* arena, eexpr_span loc, size_t nBytes, const uint8_t* utf8str, size_t nSubexprs, struct eexpr_strTemplate* tail);
+// The subexpr may be `NULL`, for an empty pair of parens.
+eexpr* eexpr_newParen(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr);
+// The subexpr may be `NULL`, for an empty pair of brackets.
+eexpr* eexpr_newBrack(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr);
+// The subexpr may be `NULL`, for an empty pair of braces.
+eexpr* eexpr_newBrace(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr);
+eexpr* eexpr_newBlock(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs);
+eexpr* eexpr_newPredot(eexpr_arena* arena, eexpr_span loc, eexpr* subexpr);
+eexpr* eexpr_newChain(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs);
+eexpr* eexpr_newSpace(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs);
+// Either (or both) of the before and after subexprs may be `NULL`.
+eexpr* eexpr_newEllipsis(eexpr_arena* arena, eexpr_span loc, eexpr* before, eexpr* after);
+eexpr* eexpr_newColon(eexpr_arena* arena, eexpr_span loc, eexpr* before, eexpr* after);
+eexpr* eexpr_newComma(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs);
+eexpr* eexpr_newSemicolon(eexpr_arena* arena, eexpr_span loc, size_t nSubexprs, eexpr** subexprs);
+
+
+//////////////////////////////////// Flat Serialization ////////////////////////////////////
+
+/*
+Walking a large tree through the accessor functions means several calls per node,
+  which is expensive when each call has to cross a foreign-function boundary.
+Instead, a whole forest can be written into one flat buffer, which other languages can then decode in a single pass.
+
+The buffer is a sequence of native-endian `uint64_t` words.
+Byte strings are written in-line, zero-padded up to a multiple of eight bytes.
+```
+forest ::= nEexprs:word eexpr{nEexprs}
+eexpr  ::= header:word loc payload
+  -- where the low 8 bits of `header` are the `eexpr_type`, and the rest (`header >> 8`) is a count `n`:
+  --   the number of subexprs for block, chain, space, comma and semicolon, the number of template parts for string,
+  --   the number of args for mixfix, and zero otherwise
+loc    ::= startByte:word startLine:word startCol:word endByte:word endLine:word endCol:word
+  -- line/col are zero-indexed as in `eexpr_locPoint`, and are all zero when no line index is given
+payload
+  ::= bytes                                                   -- symbol
+   |  radix:word nFracDigits:word bignum bignum               -- number: significand, then exponent
+   |  bytes (eexpr? bytes){n}                                 -- string: head, then subexpr/text pairs
+   |  eexpr?                                                  -- paren, bracket, brace
+   |  eexpr                                                   -- predot
+   |  eexpr{n}                                                -- block, chain, space, comma, semicolon
+   |  eexpr? eexpr?                                           -- ellipsis
+   |  eexpr eexpr                                             -- colon
+   |  op:word eexpr{n}                                        -- mixfix
+eexpr? ::= EEXPR_SERIAL_ABSENT:word | eexpr
+bytes  ::= nBytes:word (the bytes, padded)
+bignum ::= (isPositive | nBigDigits << 1):word (the `uint32_t` big digits, little-endian as in `eexpr_number`, padded)
+```
+*/
+
+#define EEXPR_SERIAL_ABSENT UINT64_MAX
+
+// The size in bytes of the buffer needed to serialize the given eexprs.
+// If payloads are lazy, this decodes them (see `eexpr_parser.lazyPayloads`).
+size_t eexpr_serializedSize(size_t n, eexpr* const* eexprs);
+// Write the given eexprs into `buf` in the format above, and return the number of bytes written.
+// `buf` must be aligned for `uint64_t` and have room for at least `eexpr_serializedSize(n, eexprs)` bytes.
+// `lines` is used to fill in line/col offsets, and may be `NULL` if only byte offsets are wanted.
+size_t eexpr_serialize(const eexpr_lineIndex* lines, size_t n, eexpr* const* eexprs, uint64_t* buf);
+
+
+//////////////////////////////////// Flat Trees ////////////////////////////////////
+
+/*
+The pointer tree is convenient for pattern-matching, but whole-forest analyses
+  (e.g. "find every symbol named X", "count colons") spend most of their time chasing pointers.
+`eexpr_flatten` copies a forest into parallel arrays instead, indexed by node number.
+
+Nodes are numbered in preorder across the whole forest, so:
+  * the subtree of node `i` is exactly the nodes `i` up to (not including) `i + subtreeSize[i]`,
+  * the first child of `i` (if any) is `i + 1`,
+  * the next sibling of `i` (if any) is `i + subtreeSize[i]`, provided it has the same parent.
+The children of a node are its non-`NULL` subexprs, in the order the `eexpr_as*` functions report them.
+Scans over a single column (say `type`) touch no other memory, and so are easy for a compiler to vectorize.
+
+Payloads live in shared pools, and `payload[i]` is an index whose meaning depends on `type[i]`:
+  * symbol: an index into `texts`,
+  * number: an index into `numbers`,
+  * string: an index into `strings`,
+  * ellipsis: a bitmask, bit 0 set if there is a before-part, bit 1 if there is an after-part,
+  * mixfix: the operator (see `eexpr_asMixfix`),
+  * otherwise: `EEXPR_FLAT_NONE`.
+*/
+
+#define EEXPR_FLAT_NONE UINT32_MAX
+
+// A slice of `eexpr_flat.bytes`.
+typedef struct eexpr_flatText {
+  size_t offset;
+  size_t nBytes;
+} eexpr_flatText;
+
+typedef struct eexpr_flatString {
+  uint32_t head; // index into `texts`
+  uint32_t nParts;
+  uint32_t firstPart; // index into `strParts`; the parts of one string are contiguous
+} eexpr_flatString;
+
+typedef struct eexpr_flatStrPart {
+  uint32_t subexpr; // node index, or `EEXPR_FLAT_NONE` if the template was missing an expression
+  uint32_t text; // index into `texts`
+} eexpr_flatStrPart;
+
+typedef struct eexpr_flat {
+  ////// Per-node columns, each `nNodes` long //////
+  size_t nNodes;
+  uint8_t* type; // an `eexpr_type`
+  uint32_t* parent; // `EEXPR_FLAT_NONE` for the roots of the forest
+  uint32_t* subtreeSize; // including the node itself
+  size_t* startByte;
+  size_t* endByte;
+  uint32_t* payload;
+  ////// Payload pools //////
+  size_t nBytes;
+  uint8_t* bytes; // utf8 text of all symbols and string parts, back-to-back
+  size_t nTexts;
+  eexpr_flatText* texts;
+  size_t nNumbers;
+  eexpr_number* numbers; // whose big digits point into `digits`
+  size_t nDigits;
+  uint32_t* digits;
+  size_t nStrings;
+  eexpr_flatString* strings;
+  size_t nStrParts;
+  eexpr_flatStrPart* strParts;
+} eexpr_flat;
+
+// Copy the given forest into a freshly-allocated flat tree.
+// The eexprs are not modified (except that lazy payloads are decoded) and may be freed independently.
+// Returns `NULL` if the forest is too large to index with `uint32_t` (over four billion nodes or text parts).
+eexpr_flat* eexpr_flatten(size_t n, eexpr* const* eexprs);
+// Free a flat tree and all its arrays. Passing `NULL` is a no-op.
+void eexpr_flat_del(eexpr_flat* self);
+
+// Navigation. These return `EEXPR_FLAT_NONE` when there is no such node.
+uint32_t eexpr_flat_firstChild(const eexpr_flat* self, uint32_t node);
+uint32_t eexpr_flat_nextSibling(const eexpr_flat* self, uint32_t node);
+
+// These mirror the `eexpr_as*` functions: they return false (and write nothing) if the node has a different type.
+// Output pointers are owned by the flat tree.
+bool eexpr_flat_asSymbol(const eexpr_flat* self, uint32_t node, size_t* nBytes, const uint8_t** utf8str);
+bool eexpr_flat_asNumber(const eexpr_flat* self, uint32_t node, eexpr_number* value);
+// Outputs the head text of the template and the number of subexpr/text parts that follow it (see `eexpr_flat_strPart`).
+bool eexpr_flat_asString(const eexpr_flat* self, uint32_t node, size_t* nBytes, const uint8_t** head, size_t* nParts);
+// Outputs the `i`th part of a string node; the subexpr may be `EEXPR_FLAT_NONE`.
+// Returns false if the node is not a string or has no such part.
+bool eexpr_flat_strPart(const eexpr_flat* self, uint32_t node, size_t i, uint32_t* subexpr, size_t* nBytes, const uint8_t** utf8str);
+// Either (or both) of the outputs could be `EEXPR_FLAT_NONE`.
+bool eexpr_flat_asEllipsis(const eexpr_flat* self, uint32_t node, uint32_t* before, uint32_t* after);
+
+
+//////////////////////////////////// Mixfixes ////////////////////////////////////
+
+/*
+A mixfix operator is defined by a template of literal symbols and holes, e.g. `() + ()` or `if () then () else ()`.
+Rewriting finds the literals of a set of operators within space-separated eexprs, and replaces them with `EEXPR_MIXFIX` eexprs
+  whose args are whatever filled the holes; consecutive non-literals fill a single hole (as a space eexpr).
+
+A template must contain at least one literal and at least one hole, and no two holes may be adjacent.
+Operators are grouped by the literal that starts them (or that follows their leading hole),
+  and operators in the same group are matched together:
+  e.g. `if () then ()` and `if () then () else ()` can be defined side-by-side, and an `else` goes to the nearest `if`.
+Operators in the same group must have the same precedence and associativity,
+  and may not disagree about whether some part is a hole or a literal,
+  except that one may end where the other continues with a literal.
+
+Precedence is given relative to other operators by name, in the same terms as the Haskell `Data.Eexpr.Mixfix` definitions:
+  an operator "higher than" another is applied first (binds tighter), and "same as" puts two operators at the same level.
+Compiling a table solves these constraints once, so that rewriting only ever compares small integer levels.
+*/
+
+#define EEXPR_MIXFIX_NONE UINT32_MAX
+
+typedef struct eexpr_mixfixTable eexpr_mixfixTable;
+
+typedef struct eexpr_mixfixText {
+  size_t nBytes;
+  const uint8_t* utf8str;
+} eexpr_mixfixText;
+
+typedef enum eexpr_mixfixAssoc {
+  EEXPR_ASSOC_NONE,
+  EEXPR_ASSOC_LEFT,
+  EEXPR_ASSOC_RIGHT
+} eexpr_mixfixAssoc;
+
+typedef struct eexpr_mixfixDef {
+  eexpr_mixfixText name;
+  // The parts of the template, in order; a part with a `NULL` `.utf8str` is a hole.
+  size_t nParts;
+  const eexpr_mixfixText* parts;
+  eexpr_mixfixAssoc assoc;
+  // Names of other definitions (in the same table) that this one is relative to.
+  struct eexpr_mixfixNames {
+    size_t n;
+    const eexpr_mixfixText* names;
+  } lowerThan, sameAs, higherThan;
+} eexpr_mixfixDef;
+
+typedef enum eexpr_mixfixDefErrorType {
+  EEXPR_MIXFIX_EMPTY_TEMPLATE,
+  EEXPR_MIXFIX_ZERO_HOLES,
+  EEXPR_MIXFIX_ZERO_LITERALS,
+  EEXPR_MIXFIX_DOUBLED_HOLES,
+  EEXPR_MIXFIX_DUPLICATE_NAME, // `.other` is the earlier definition with the same name
+  EEXPR_MIXFIX_UNKNOWN_NAME, // `.name` is the name that was not defined
+  EEXPR_MIXFIX_UNSOLVABLE_PRECEDENCE, // a constraint of `.def` relative to `.other` contradicts the rest
+  EEXPR_MIXFIX_AMBIGUOUS // `.def` cannot be matched alongside `.other`, which starts the same way
+} eexpr_mixfixDefErrorType;
+
+typedef struct eexpr_mixfixDefError {
+  eexpr_mixfixDefErrorType type;
+  size_t def; // index of the offending definition
+  size_t other; // index of a related definition, or `EEXPR_MIXFIX_NONE`
+  eexpr_mixfixText name; // borrowed from the definitions; only for unknown names
+} eexpr_mixfixDefError;
+
+// Compile definitions into a table. Nothing in `defs` is referenced after this returns.
+// On success, outputs zero errors.
+// Otherwise, returns `NULL` and outputs a freshly-allocated array of errors, which the caller must free.
+eexpr_mixfixTable* eexpr_mixfixTable_new(size_t nDefs, const eexpr_mixfixDef* defs, size_t* nErrors, eexpr_mixfixDefError** errors);
+// Free a mixfix table. Passing `NULL` is a no-op.
+void eexpr_mixfixTable_del(eexpr_mixfixTable* self);
+// The name of an operator; the pointer is owned by the table.
+bool eexpr_mixfixTable_name(const eexpr_mixfixTable* self, uint32_t op, size_t* nBytes, const uint8_t** utf8str);
+// The precedence level an operator was solved to; operators with higher levels bind tighter.
+bool eexpr_mixfixTable_level(const eexpr_mixfixTable* self, uint32_t op, uint32_t* level);
+
+typedef enum eexpr_mixfixErrorType {
+  EEXPR_MIXFIX_ERR_EXPECTED_OPERAND, // a hole had nothing to fill it
+  EEXPR_MIXFIX_ERR_EXPECTED_LITERAL, // an operator was left incomplete
+  EEXPR_MIXFIX_ERR_UNEXPECTED_LITERAL, // a literal that does not belong to any operator at that position
+  EEXPR_MIXFIX_ERR_NON_ASSOCIATIVE // two operators at the same level were chained, but they do not associate that way
+} eexpr_mixfixErrorType;
+
+typedef struct eexpr_mixfixError {
+  eexpr_span loc; // the offending eexpr, or an empty span at the end of the space eexpr if something was missing
+  eexpr_mixfixErrorType type;
+  uint32_t op; // the operator being matched, or `EEXPR_MIXFIX_NONE`
+} eexpr_mixfixError;
+
+// Rewrite every space eexpr within the given eexprs (recursively), replacing them in-place.
+// The eexprs must not come from an `eexpr_shareTable` or an `eexpr_arena`.
+// Space eexprs without any literals in them are left alone.
+// Errors are reported for each space eexpr that could not be rewritten, and such eexprs are left as they were.
+// Outputs a freshly-allocated array of errors (`NULL` if there are none), which the caller must free.
+// Returns true when there were no errors.
+bool eexpr_mixfixRewrite(const eexpr_mixfixTable* table, size_t n, eexpr** eexprs, size_t* nErrors, eexpr_mixfixError** errors);
+
+
+//////////////////////////////////// Printing Eexprs ////////////////////////////////////
+
+/*
+Printing writes out text that parses back into the same eexprs, in a canonical form
+  (the same as `normalText` in the Haskell `Data.Eexpr.Text.Normal`):
+  * each eexpr goes on its own line, blocks are indented by two spaces per level,
+  * separators are written as `a b`, `a.b`, `a..b`, `a: b`, `a, b` and `a; b`,
+  * numbers are written in the radix they were parsed in, without digit separators, and with any exponent as `^<decimal>`,
+  * strings are written between double-quotes, escaping only what must be escaped;
+    but strings that contain a newline (and have nothing spliced into them) are written as heredocs.
+Spans are not taken into account: comments, blank lines and the original spacing are not reproduced.
+
+Only eexprs shaped the way the parser would produce them are guaranteed to come back the same
+  (e.g. a space directly inside another space will not).
+Mixfix eexprs have no text of their own, so they are written as their args in parentheses.
+
+Printing takes time linear in the size of the eexprs (save for bignums, which are converted to their radix a word at a time),
+  and does not allocate per eexpr.
+*/
+
+// Write the text of the given eexprs into `buf`, which has room for `cap` bytes.
+// Returns the length of the whole text, which is not NUL-terminated.
+// As with `snprintf`, a result larger than `cap` means the text was cut short;
+//   passing `cap = 0` (and `buf = NULL`) measures the text without writing it.
+// If payloads are lazy, this decodes them (see `eexpr_parser.lazyPayloads`).
+size_t eexpr_print(size_t n, eexpr* const* eexprs, size_t cap, uint8_t* buf);
+// Write the text of the given eexprs to a file.
+// Returns false if writing to the file failed.
+bool eexpr_fprint(FILE* fp, size_t n, eexpr* const* eexprs);
+
+
+//////////////////////////////////// Hashing and Comparing Eexprs ////////////////////////////////////
+
+/*
+A digest is a 64-bit hash of the structure of an eexpr: its type, its payload, and (recursively) its subexprs.
+Spans are left out unless asked for with `withSpans`, so that the same text parsed at different places in a file
+  (or in different files) has the same digest.
+Payloads are compared by their decoded values (e.g. `"a\x41"` and `"aA"` are the same string, but `0x10` and `16` are not the same number, see `eexpr_number.radix`),
+  and symbols by their text, whether or not they were parsed with a symbol table.
+Mixfix eexprs are compared by the index of their operator, so only eexprs rewritten with the same table are meaningfully compared.
+
+Digests are not cached, so each hash walks the whole eexpr; callers that need the digests of many subexprs should keep them as they go.
+Hashing decodes any lazy payloads (see `eexpr_parser.lazyPayloads`), so it is not safe to race on the first hash of a lazily-parsed eexpr between threads.
+Digests are the same from one run to the next, but not between machines of different endianness.
+*/
+
+// Return the digest of an eexpr (see above).
+uint64_t eexpr_hash(const eexpr* self, bool withSpans);
+// Return true when two eexprs are structurally the same (including their spans, if `withSpans`).
+// This walks both eexprs side by side (without hashing them), and returns false at the first difference;
+//   like hashing, it decodes any lazy payloads it reaches.
+// Either eexpr may be `NULL`, which is only equal to `NULL`.
+bool eexpr_equal(const eexpr* a, const eexpr* b, bool withSpans);
+
+
+//////////////////////////////////// Diffing Eexprs ////////////////////////////////////
+
+/*
+A diff is a list of edits that take one forest of eexprs (`a`, say the old version of a file) to another (`b`, the new version).
+Every edit is to a whole eexpr:
+  * delete: `.a` is gone from the new forest,
+  * insert: `.b` is new to the new forest,
+  * replace: `.b` stands where `.a` did, but is otherwise unlike it (such as a changed symbol, number or string, or an eexpr of another type),
+  * move: `.a` became `.b` (see below), but under another parent, or in another order among its siblings.
+The eexprs of the two forests are matched up by their digests (see `eexpr_hash`), so spans are not taken into account:
+  first the largest eexprs that are exactly the same are matched, then eexprs that hold mostly matched subexprs,
+  and finally the subexprs left over under matched eexprs are paired by type and by their first subexpr
+  (so that, e.g., colons with the same key pair up, and the change to their value is what is reported).
+Matched eexprs that differ only in their subexprs (such as a block with a changed item) are not themselves edited;
+  the edits are to their subexprs.
+This takes time and memory roughly linear in the size of the forests (about 60 bytes per eexpr on each side, on top of the forests themselves),
+  but is not guaranteed to find the fewest edits.
+
+An eexpr that is deleted, inserted or replaced as a whole might hold subexprs that are matched elsewhere;
+  those are reported as moves of their own.
+*/
+
+typedef enum eexpr_editType {
+  EEXPR_EDIT_DELETE,
+  EEXPR_EDIT_INSERT,
+  EEXPR_EDIT_REPLACE,
+  EEXPR_EDIT_MOVE
+} eexpr_editType;
+
+typedef struct eexpr_edit {
+  eexpr_editType type;
+  // The eexpr from the old forest, or `NULL` for an insert.
+  const eexpr* a;
+  // The eexpr from the new forest, or `NULL` for a delete.
+  const eexpr* b;
+  // Spans in the old and new inputs.
+  // They are the spans of `.a` and `.b`, except that a delete has an empty `.bSpan` where the eexpr would have been in the new input,
+  //   and an insert has an empty `.aSpan` where the eexpr would have gone in the old input.
+  eexpr_span aSpan;
+  eexpr_span bSpan;
+} eexpr_edit;
+
+// Diff two forests (see above), writing the edits to `*edits`, in order of their `.aSpan` (then of their `.bSpan`).
+// Returns true when there are no edits, i.e. the forests are the same.
+// The edits array is owned by the caller (and is `NULL` when empty), but the eexprs it points to belong to the forests.
+// Like `eexpr_hash`, this may mutate the eexprs.
+bool eexpr_diff(size_t nA, eexpr* const* a, size_t nB, eexpr* const* b, size_t* nEdits, eexpr_edit** edits);
+// The same, for forests parsed with `eexpr_parser.shared` and `eexpr_parser.shareSpans`, each given with its `eexpr_parser.spans`,
+//   which are where the edits' spans are taken from (the shared eexprs only hold the span of the first place each was parsed).
+// Both forests should be parsed into the same table, so that subexprs they have in common are compared by pointer.
+bool eexpr_diffShared(size_t nA, eexpr* const* a, const eexpr_span* aSpans, size_t nB, eexpr* const* b, const eexpr_span* bSpans, size_t* nEdits, eexpr_edit** edits);
+
+
+//////////////////////////////////// Validating Eexprs ////////////////////////////////////
+
+/*
+A schema describes which eexprs are allowed, and is itself written as eexprs: a list of definitions, each either
+  `name: type`, or `name:` followed by an indented block of `key: type` fields (a record, see below).
+Names of definitions may be used as types anywhere in the schema, including recursively.
+Types are:
+  * `any`: any eexpr at all.
+  * `symbol` and `symbol "pattern"`, `string` and `string "pattern"`: a symbol or string, optionally matching a glob pattern
+      (`*` for any run of characters, `?` for any one character, `[a-z]` and `[!a-z]` for sets of characters, `\` to escape the next).
+    Strings with splices never match a pattern.
+  * `int`, `int lo..hi`, `number`, `number lo..hi`: a number, where either bound of the (inclusive) range may be left out, as in `int 0..`.
+    An int is a number without fractional digits (beyond what its exponent makes up for), that fits in an `int64_t`;
+      numbers are compared as `double`s.
+  * `is x`: exactly the symbol, string (without splices) or int `x`.
+  * `paren T`, `brack T`, `brace T`, `predot T`: that kind of wrapper, around a `T`;
+      with `T` left off, the wrapper may hold anything (or nothing, except for a predot).
+  * `block T`, `chain T`, `space T`, `comma T`, `semicolon T`: that kind of list, of which every subexpr is a `T`;
+      with `T` left off, any such list.
+  * `block [T1, T2, …]` (and so on for the other lists), `colon [K, V]`: exactly so many subexprs, of the given types in order.
+  * `ellipsis`, `colon`: any eexpr of that kind.
+  * `list T`: a bracket list, i.e. `[]`, `[x]` or `[x, y, …]`, of which every element is a `T`.
+  * `{k1: T1, k2: T2, …}` or an indented block of the same: a record, which matches either
+      a brace or a block holding `key: value` colons (or, in a block, `key:` followed by an indented block as the value),
+      where each key is a symbol naming one of the fields, and its value matches the field's type.
+    Each field may only be given once, and every field must be given unless its type is written `optional T`.
+    A record can have at most 64 fields.
+  * `oneOf [T1, T2, …]`: the first of the types that matches.
+  * `(T)`: just `T`, for grouping.
+A definition may not refer back to itself other than from inside a subexpr (e.g. `a: oneOf [int, a]` is an error, but `a: oneOf [int, list a]` is fine).
+
+Compiling a schema resolves names and checks the whole schema up-front, then flattens it into a table of nodes.
+Validation is then a single walk over the eexprs, stepping through that table:
+  each node knows which eexpr types it could possibly match, so a `oneOf` only tries the alternatives that could match the type of eexpr in hand
+  (and, for alternatives like `space [is server, …]`, whose first subexpr is right).
+It only has to try more than one (and report `EEXPR_SCHEMA_ERR_NO_ALTERNATIVE` rather than a more specific error) when they still overlap.
+Validation allocates nothing; errors are written to an array given by the caller.
+Like `eexpr_hash`, it may decode lazy payloads (see `eexpr_parser.lazyPayloads`), but otherwise leaves the eexprs alone;
+  a schema is never changed once compiled, and may be used by many threads at once.
+*/
+
+#define EEXPR_SCHEMA_NONE UINT32_MAX
+
+typedef struct eexpr_schema eexpr_schema;
+
+typedef enum eexpr_schemaErrorType {
+  // from `eexpr_schemaCompile`, located in the schema
+  EEXPR_SCHEMA_ERR_NO_DEFINITIONS,
+  EEXPR_SCHEMA_ERR_BAD_DEFINITION, // not `name: type`, or the name is also a built-in type
+  EEXPR_SCHEMA_ERR_DUPLICATE_NAME, // `.as.name` is the name that was defined again
+  EEXPR_SCHEMA_ERR_UNKNOWN_NAME, // `.as.name` is the name that was not defined
+  EEXPR_SCHEMA_ERR_BAD_TYPE, // an eexpr that does not describe a type
+  EEXPR_SCHEMA_ERR_BAD_ARGUMENT, // a built-in type given the wrong kind (or number) of arguments
+  EEXPR_SCHEMA_ERR_BAD_PATTERN,
+  EEXPR_SCHEMA_ERR_BAD_RANGE, // a bound that is not a number (or not an int, for `int`), or a range with its bounds out of order
+  EEXPR_SCHEMA_ERR_BAD_FIELD, // a record field that is not `key: type`
+  EEXPR_SCHEMA_ERR_TOO_MANY_FIELDS,
+  EEXPR_SCHEMA_ERR_CYCLE, // the definition refers back to itself without going into a subexpr
+  // from `eexpr_schemaValidate`, located in the eexprs being validated
+  EEXPR_SCHEMA_ERR_WRONG_TYPE, // `.as.expected` are the types that would have been accepted
+  EEXPR_SCHEMA_ERR_NO_MATCH, // a symbol or string that does not match its pattern
+  EEXPR_SCHEMA_ERR_NOT_INTEGER,
+  EEXPR_SCHEMA_ERR_OUT_OF_RANGE,
+  EEXPR_SCHEMA_ERR_NOT_EQUAL, // not the eexpr required by `is`
+  EEXPR_SCHEMA_ERR_WRONG_LENGTH, // `.as.length` subexprs were expected
+  EEXPR_SCHEMA_ERR_MISSING_FIELD, // located at the whole record; `.as.name` is the field (borrowed from the schema)
+  EEXPR_SCHEMA_ERR_UNKNOWN_FIELD, // `.as.name` is the key (borrowed from the eexpr)
+  EEXPR_SCHEMA_ERR_DUPLICATE_FIELD, // ditto; also reported by `eexpr_schemaCompile` for records in the schema
+  EEXPR_SCHEMA_ERR_NO_ALTERNATIVE // none of the types in a `oneOf` matched
+} eexpr_schemaErrorType;
+
+typedef struct eexpr_schemaError {
+  eexpr_span loc;
+  eexpr_schemaErrorType type;
+  uint32_t def; // the definition being compiled, or validated against, or `EEXPR_SCHEMA_NONE`
+  union eexpr_schemaErrorInfo {
+    uint32_t expected; // a bitset of `1 << eexpr_type`
+    size_t length;
+    struct eexpr_schemaText {
+      size_t nBytes;
+      const uint8_t* utf8str;
+    } name;
+  } as;
+} eexpr_schemaError;
+
+// Compile a schema from its definitions (see above). Nothing in `defs` is referenced after this returns.
+// On success, outputs zero errors.
+// Otherwise, returns `NULL` and outputs a freshly-allocated array of errors, which the caller must free
+//   (any names in them are borrowed from `defs`).
+eexpr_schema* eexpr_schemaCompile(size_t nDefs, eexpr* const* defs, size_t* nErrors, eexpr_schemaError** errors);
+// Free a schema. Passing `NULL` is a no-op.
+void eexpr_schema_del(eexpr_schema* self);
+// The number of definitions, which are indexed in the order they were given.
+size_t eexpr_schema_size(const eexpr_schema* self);
+// The name of a definition; the pointer is owned by the schema.
+bool eexpr_schema_name(const eexpr_schema* self, uint32_t def, size_t* nBytes, const uint8_t** utf8str);
+// The index of the definition with the given name, or `EEXPR_SCHEMA_NONE`.
+uint32_t eexpr_schema_find(const eexpr_schema* self, size_t nBytes, const uint8_t* utf8str);
+
+// Check that each of the eexprs matches the type of definition `def` (see above).
+// On input, `*nErrors` is the capacity of `errors`; on output, it is the number of errors written.
+// Validation stops as soon as the errors array is full, so a capacity of zero just answers whether the eexprs are valid.
+// Returns true when there were no errors.
+// Like `eexpr_asNumber` and `eexpr_asString`, this decodes the lazy payloads it checks (see `eexpr_parser.lazyPayloads`), which writes to those eexprs;
+//   eexprs from a share table or an arena always have their payloads decoded already, so they are only ever read.
+bool eexpr_schemaValidate(const eexpr_schema* schema, uint32_t def, size_t n, eexpr* const* eexprs, size_t* nErrors, eexpr_schemaError* errors);
+
+
+//////////////////////////////////// Querying Eexprs ////////////////////////////////////
+
+/*
+A query picks out entries from eexprs by the path of keys that leads to them, e.g. `server//port` or `//limits/cpu[int]`.
+An entry is an eexpr with a key, which is a symbol, and a value, which is the rest of its subexprs (possibly none):
+  * `key: value`, i.e. a colon whose left side is a symbol,
+  * `key:` followed by an indented block, or `key.rest`, i.e. a chain that starts with a symbol,
+  * `key rest…`, i.e. a space that starts with a symbol (so `server host1: …` is a `server` entry, whose value is a `host1` entry).
+Blocks, commas, semicolons, parens, brackets and braces are looked through:
+  the entries in a value are found in its subexprs, or in the items of those that are lists or wrappers, and so on.
+
+Queries have their own syntax, since most of it is not valid in an eexpr:
+  * A query is a path of steps separated by `/`.
+    The first step picks out the entries at the top level, and each step after that picks out entries in the values of those picked out by the one before.
+  * Writing `//` rather than `/` before a step (including at the start of the query) picks out entries at any depth within, rather than only at the top.
+  * Each step is a glob pattern (as for `eexpr_schemaCompile`) that the key must match, so `*` is any key at all;
+      but in a step, `[` starts a predicate rather than a set (write `\[` for a literal one), and `\/` is a literal `/`.
+  * A step can be followed by any number of predicates in square brackets, each of which must hold of the value.
+    Predicates only ever hold of a value made of exactly one eexpr.
+    - `[symbol]`, `[number]`, `[block]`, and so on: the value is of that type (named as in `eexpr_type`, in lowercase);
+        `[int]` is a number that is an int (as for `eexpr_schemaCompile`).
+    - `[= x]` and `[!= x]`: the value is (or is not) `x`, which is a number, a symbol (written bare) or a string (written in double-quotes, with `\` escapes);
+        numbers are compared as `double`s, and symbols and strings (without splices) by their text, so that `[= "on"]` and `[= on]` are the same.
+    - `[~ pattern]`: the value is a symbol or string whose text matches a glob pattern, which is written like `x` above.
+    - `[< n]`, `[<= n]`, `[> n]`, `[>= n]`: the value is a number, compared to `n` as `double`s.
+  Spaces are allowed inside predicates, but not in steps.
+The matches are the entries picked out by the last step, in the order they appear.
+
+Compiling a query checks it and flattens it into an array of steps.
+Running it is a single walk over the eexprs, carrying along the set of steps that are still in play (as a bitset), so that:
+  an entry is visited (and reported) only once, however many ways the query could reach it;
+  subexprs where no step can match any more are skipped;
+  and the walk stops as soon as the callback says so.
+Nothing is copied or allocated while running.
+Like `eexpr_hash`, this may decode lazy payloads (see `eexpr_parser.lazyPayloads`), but otherwise leaves the eexprs alone;
+  a query is never changed once compiled, and may be used by many threads at once.
+*/
+
+// The most steps a query can have.
+#define EEXPR_QUERY_MAX_STEPS 64
+
+typedef struct eexpr_query eexpr_query;
+
+typedef enum eexpr_queryErrorType {
+  EEXPR_QUERY_ERR_EMPTY_STEP, // includes an empty query, and a `/` at the end
+  EEXPR_QUERY_ERR_BAD_PATTERN, // a glob pattern with an unclosed set or a dangling escape
+  EEXPR_QUERY_ERR_BAD_PREDICATE, // neither a type name nor an operator
+  EEXPR_QUERY_ERR_BAD_LITERAL, // a missing or malformed operand, or one that is not a number for `<` and the like
+  EEXPR_QUERY_ERR_UNCLOSED_PREDICATE,
+  EEXPR_QUERY_ERR_EXPECTED_SLASH, // something other than a `/` or `[` after a predicate
+  EEXPR_QUERY_ERR_TOO_MANY_STEPS
+} eexpr_queryErrorType;
+
+typedef struct eexpr_queryError {
+  size_t offset; // the byte offset into the query text
+  eexpr_queryErrorType type;
+} eexpr_queryError;
+
+// Called for each match, with the entry and its value.
+// Returning false stops the query.
+typedef bool (*eexpr_queryCallback)(void* ctx, const eexpr* entry, size_t nValues, eexpr* const* values);
+
+// Compile a query from its text (see above), which is not referenced after this returns.
+// Returns `NULL` on error, with the first error written to `*error`.
+eexpr_query* eexpr_queryCompile(size_t nBytes, const uint8_t* utf8str, eexpr_queryError* error);
+// Free a query. Passing `NULL` is a no-op.
+void eexpr_query_del(eexpr_query* self);
+
+// Run a query over the given eexprs, passing each match to `onMatch` (along with `ctx`) in the order they appear, until it returns false.
+// Returns the number of matches passed to `onMatch`.
+size_t eexpr_queryRun(const eexpr_query* self, size_t n, eexpr* const* eexprs, eexpr_queryCallback onMatch, void* ctx);
 
 
 //////////////////////////////////// Parse Errors ////////////////////////////////////
@@ -364,9 +1151,21 @@ typedef enum eexpr_errorType {
   EEXPR_ERR_UNBALANCED_WRAP,
   EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT,
   EEXPR_ERR_MISSING_TEMPLATE_EXPR,
-  EEXPR_ERR_MISSING_CLOSE_TEMPLATE
+  EEXPR_ERR_MISSING_CLOSE_TEMPLATE,
+  // resource limits (see `eexpr_parser.limits`)
+  EEXPR_ERR_LIMIT_EXCEEDED
 } eexpr_errorType;
 
+// Which of `eexpr_parser.limits` was exceeded.
+typedef enum eexpr_limitType {
+  EEXPR_LIMIT_BYTES,
+  EEXPR_LIMIT_TOKENS,
+  EEXPR_LIMIT_DEPTH,
+  EEXPR_LIMIT_DIGITS,
+  EEXPR_LIMIT_ERRORS,
+  EEXPR_LIMIT_MEMORY
+} eexpr_limitType;
+
 typedef enum eexpr_wrapType {
   EEXPR_WRAP_NULL, // only used internally
   EEXPR_WRAP_PAREN,
@@ -382,7 +1181,7 @@ typedef enum eexpr_indentType {
 } eexpr_indentType;
 
 struct eexpr_error {
-  eexpr_loc loc;
+  eexpr_span loc;
   eexpr_errorType type;
   union eexpr_errorInfo {
     char32_t badChar;
@@ -392,12 +1191,13 @@ struct eexpr_error {
     char32_t badStringChar;
     struct eexpr_mixedIndentationInfo {
       eexpr_indentType establishedType;
-      eexpr_loc establishedAt;
+      eexpr_span establishedAt;
     } mixedIndentation;
     struct eexpr_unbalancedWrapInfo {
       eexpr_wrapType type; // what close wrap was left open, or WRAP_NULL for start-of-file
-      eexpr_loc loc; // location where the unmatched open wrap is
+      eexpr_span loc; // location where the unmatched open wrap is
     } unbalancedWrap;
+    eexpr_limitType limitExceeded;
   } as;
 };
 
@@ -449,7 +1249,9 @@ eexpr_tokenType eexpr_getTokenType(const eexpr_token* self);
 
 bool eexpr_tokenIsTransparent(const eexpr_token* self);
 
-eexpr_loc eexpr_tokenLocate(const eexpr_token* self);
+eexpr_span eexpr_getTokenSpan(const eexpr_token* self);
+
+eexpr_loc eexpr_tokenLocate(const eexpr_lineIndex* lines, const eexpr_token* self);
 
 
 bool eexpr_tokenAsSymbol(const eexpr_token* self, size_t* nBytes, uint8_t** utf8str);
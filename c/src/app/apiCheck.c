@@ -0,0 +1,925 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "mixfixSpec.h"
+
+/*
+Checks of library functions whose results do not show up in eexpr2json's output, for use by the test suite.
+
+  eexpr-api-check flat [-flazy-payloads] [-m <spec file>] <file>
+  eexpr-api-check symtab <file>...
+  eexpr-api-check hash [-m <spec file>] <file>
+  eexpr-api-check build <file>
+  eexpr-api-check batch <file>...
+  eexpr-api-check share <file>...
+
+Each check writes what it looked at to stdout, and anything that disagrees with the pointer tree to stderr.
+The exit code is 0 if all is well, 1 if anything disagreed, and 2 if the input could not be read or parsed.
+
+flat: parses the file (rewriting mixfixes with the spec, if one is given) and flattens the forest (see `eexpr_flatten`).
+  Every node of the flat tree is then checked against the eexpr it came from:
+  its type, parent and span, its payload as seen through the `eexpr_flat_as*` functions,
+  and that `eexpr_flat_firstChild` and `eexpr_flat_nextSibling` visit the same children as the `eexpr_as*` functions report.
+  The nodes are written out one per line, in index order.
+symtab: parses each file in turn into one symbol table (see `eexpr_parser.symbols`), after interning `if` up front as a grammar would.
+  Every symbol must have an id, the text it reports must be the table's copy, and the id must be the one the table finds for that text.
+  Each file's eexprs (and the file's text) are freed before the next file is parsed,
+  and at the end the text of every symbol seen is read back through the pointers the symbols reported, which must still hold it.
+  The symbols of each file are written out with their ids, followed by the whole table.
+  The first file is also parsed without a table, in which case no symbol may report an id.
+hash: parses the file (rewriting mixfixes with the spec, if one is given) and compares its top-level eexprs with each other (see `eexpr_equal`).
+  Eexprs that are equal must have the same digest (see `eexpr_hash`), and those that are not must have different digests;
+  with spans, no two of them may be equal, since they sit at different places in the file.
+  For each eexpr, the earlier ones it is equal to are written out.
+  The file is also parsed twice more, and each eexpr must be equal (with spans) to its copies, with the same digests:
+  once with lazy payloads, and once hashed before mixfixes are rewritten, so that any digest hashing left behind on the eexprs would show as stale.
+build: builds a fixed forest with every one of the constructors (see `eexpr_newSymbol` and friends), and prints it.
+  Each built eexpr must be equal (without spans) to the corresponding eexpr parsed from the file, which should hold the same text.
+  Then built and parsed eexprs are mixed: a parsed space has one of its subexprs swapped for a built one, and is freed with `eexpr_del`,
+  which must leave the built subexpr alone; and a built space holding a parsed subexpr is passed to `eexpr_del`, which must do nothing.
+batch: parses the files in one batch (see `eexpr_parseBatch`), with an empty input after the first, whether or not they have errors.
+  Each input's eexprs, errors and warnings must be the same (spans included, and resolved to the same lines and columns)
+  as parsing that input alone, and the results must tile the parser's output arrays with nothing left over.
+  The parser is then reset and the same result array reused for the inputs in reverse order, which must check out just the same.
+  A line is written out for each input of each batch.
+share: parses each file in turn into one share table (see `eexpr_shareTable`), and again without it.
+  Each shared eexpr must be equal (without spans) to the plain one, and the shared spans must be those of the plain eexprs, in preorder.
+  The shared parse's top-level eexprs are then freed with `eexpr_del`, which must leave them to the table:
+  the table must hold just as many eexprs, and parsing the file into it again must give back the very same eexprs, still equal to the plain ones.
+  The table itself is only deleted at the end, after every file's eexprs have been freed.
+  A line is written out for each parse.
+*/
+
+void die(const char* msg) {
+  fprintf(stderr, "%s\n", msg);
+  exit(2);
+}
+
+static const char* const typeNames[] = {
+  "symbol", "number", "string", "paren", "brack", "brace", "block", "predot",
+  "chain", "space", "ellipsis", "colon", "comma", "semicolon", "mixfix"
+};
+
+static bool failed = false;
+
+static
+void mismatch(uint32_t node, const char* what) {
+  fprintf(stderr, "node %u: %s differs from the tree\n", node, what);
+  failed = true;
+}
+
+//////////////////////////////////// Parsing ////////////////////////////////////
+
+typedef struct input {
+  const char* filename;
+  str text;
+  eexpr_parser parser;
+} input;
+
+static
+void parseInput(input* in, bool lazyPayloads, eexpr_symtab* symbols, eexpr_shareTable* shared) {
+  in->text = readFile(in->filename);
+  if (in->text.bytes == NULL) { die("error opening input file for reading"); }
+  eexpr_parserInitDefault(&in->parser);
+  in->parser.lazyPayloads = lazyPayloads;
+  in->parser.symbols = symbols;
+  in->parser.shared = shared;
+  in->parser.shareSpans = shared != NULL;
+  eexpr_parse(&in->parser, in->text.len, in->text.bytes);
+  if (in->parser.nErrors == 0) { return; }
+  fprintf(stderr, "{ \"filename\": ");
+  fdumpCStr(stderr, (char*)in->filename);
+  fprintf(stderr, "\n, \"errors\":");
+  fdumpErrorArray(stderr, in->parser.lines, "  ", in->parser.nErrors, in->parser.errors);
+  fprintf(stderr, "\n}\n");
+  exit(2);
+}
+
+// Does nothing without a mixfix table.
+static
+void rewriteInput(input* in, const eexpr_mixfixTable* mixfixes) {
+  if (mixfixes == NULL) { return; }
+  size_t nErrors;
+  eexpr_mixfixError* errors;
+  eexpr_mixfixRewrite(mixfixes, in->parser.nEexprs, in->parser.eexprs, &nErrors, &errors);
+  free(errors);
+  if (nErrors != 0) { die("mixfix rewriting failed"); }
+}
+
+static
+void delInput(input* in) {
+  eexpr_parser_deinit(&in->parser);
+  for (size_t i = 0; i < in->parser.nEexprs; ++i) {
+    eexpr_del(in->parser.eexprs[i]);
+  }
+  free(in->parser.eexprs);
+  free(in->parser.spans);
+  free(in->parser.errors);
+  free(in->parser.warnings);
+  eexpr_lineIndex_del(in->parser.lines);
+  free(in->text.bytes);
+}
+
+//////////////////////////////////// Trees ////////////////////////////////////
+
+// The `k`th non-`NULL` subexpr, in the order the `eexpr_as*` functions report them, or `NULL` if there are not that many.
+static
+eexpr* childOf(const eexpr* self, size_t k) {
+  eexpr* one;
+  eexpr* two;
+  size_t n;
+  eexpr** xs;
+  eexpr_string string;
+  uint32_t op;
+  if (eexpr_asSymbol(self, &n, &(uint8_t*){NULL}) || eexpr_asNumber(self, &(eexpr_number){0})) {
+    return NULL;
+  }
+  else if (eexpr_asString(self, &string)) {
+    for (size_t i = 0; i < string.nSubexprs; ++i) {
+      if (string.tail[i].subexpr == NULL) { continue; }
+      if (k-- == 0) { return string.tail[i].subexpr; }
+    }
+    return NULL;
+  }
+  else if (eexpr_asParen(self, &one) || eexpr_asBrack(self, &one) || eexpr_asBrace(self, &one) || eexpr_asPredot(self, &one)) {
+    return k == 0 ? one : NULL;
+  }
+  else if (eexpr_asEllipsis(self, &one, &two) || eexpr_asColon(self, &one, &two)) {
+    if (one == NULL) { one = two; two = NULL; }
+    return k == 0 ? one : k == 1 ? two : NULL;
+  }
+  else if (eexpr_asBlock(self, &n, &xs) || eexpr_asChain(self, &n, &xs) || eexpr_asSpace(self, &n, &xs)
+        || eexpr_asComma(self, &n, &xs) || eexpr_asSemicolon(self, &n, &xs) || eexpr_asMixfix(self, &op, &n, &xs)) {
+    return k < n ? xs[k] : NULL;
+  }
+  return NULL;
+}
+
+//////////////////////////////////// Flat Trees ////////////////////////////////////
+
+// Empty texts and digit arrays may be `NULL`.
+static
+bool sameText(size_t n, const uint8_t* a, const uint8_t* b) {
+  return n == 0 || memcmp(a, b, n) == 0;
+}
+
+static
+bool sameDigits(size_t n, const uint32_t* a, const uint32_t* b) {
+  return n == 0 || memcmp(a, b, n * sizeof(uint32_t)) == 0;
+}
+
+static
+void fdumpDigits(FILE* fp, bool isPositive, size_t n, const uint32_t* digits) {
+  fprintf(fp, "%c[", isPositive ? '+' : '-');
+  for (size_t i = 0; i < n; ++i) {
+    fprintf(fp, i == 0 ? "%u" : ",%u", digits[i]);
+  }
+  fprintf(fp, "]");
+}
+
+// Check the payload of a node against its eexpr, writing it out as we go.
+static
+void checkPayload(const eexpr_flat* flat, uint32_t node, const eexpr* x) {
+  size_t nBytes;
+  uint8_t* text;
+  size_t flatBytes;
+  const uint8_t* flatText;
+  eexpr_number number;
+  eexpr_number flatNumber;
+  eexpr_string string;
+  size_t nParts;
+  eexpr* before;
+  eexpr* after;
+  uint32_t flatBefore, flatAfter;
+  size_t nArgs;
+  eexpr** args;
+  uint32_t op;
+  if (eexpr_asSymbol(x, &nBytes, &text)) {
+    if (!eexpr_flat_asSymbol(flat, node, &flatBytes, &flatText)) { mismatch(node, "symbol"); return; }
+    if (flatBytes != nBytes || !sameText(nBytes, flatText, text)) { mismatch(node, "symbol text"); }
+    fprintf(stdout, " ");
+    fdumpStrn(stdout, flatBytes, (uint8_t*)flatText);
+  }
+  else if (eexpr_asNumber(x, &number)) {
+    if (!eexpr_flat_asNumber(flat, node, &flatNumber)) { mismatch(node, "number"); return; }
+    if (flatNumber.isPositive != number.isPositive
+     || flatNumber.nBigDigits != number.nBigDigits || !sameDigits(number.nBigDigits, flatNumber.bigDigits, number.bigDigits)
+     || flatNumber.radix != number.radix || flatNumber.nFracDigits != number.nFracDigits
+     || flatNumber.isPositive_exp != number.isPositive_exp
+     || flatNumber.nBigDigits_exp != number.nBigDigits_exp || !sameDigits(number.nBigDigits_exp, flatNumber.bigDigits_exp, number.bigDigits_exp)) {
+      mismatch(node, "number value");
+    }
+    fprintf(stdout, " ");
+    fdumpDigits(stdout, flatNumber.isPositive, flatNumber.nBigDigits, flatNumber.bigDigits);
+    fprintf(stdout, " radix=%u frac=%u exp=", flatNumber.radix, flatNumber.nFracDigits);
+    fdumpDigits(stdout, flatNumber.isPositive_exp, flatNumber.nBigDigits_exp, flatNumber.bigDigits_exp);
+  }
+  else if (eexpr_asString(x, &string)) {
+    if (!eexpr_flat_asString(flat, node, &flatBytes, &flatText, &nParts)) { mismatch(node, "string"); return; }
+    if (flatBytes != string.head.nBytes || !sameText(flatBytes, flatText, string.head.utf8str)) { mismatch(node, "string head"); }
+    if (nParts != string.nSubexprs) { mismatch(node, "number of string parts"); }
+    fprintf(stdout, " ");
+    fdumpStrn(stdout, flatBytes, (uint8_t*)flatText);
+    // the subexprs are the node's children, in order
+    uint32_t child = eexpr_flat_firstChild(flat, node);
+    for (size_t i = 0; i < nParts; ++i) {
+      uint32_t subexpr;
+      if (!eexpr_flat_strPart(flat, node, i, &subexpr, &flatBytes, &flatText)) { mismatch(node, "string part"); return; }
+      if (i < string.nSubexprs) {
+        struct eexpr_strTemplate* part = &string.tail[i];
+        if (part->subexpr == NULL ? subexpr != EEXPR_FLAT_NONE : subexpr != child) { mismatch(node, "string part subexpr"); }
+        if (flatBytes != part->nBytes || !sameText(flatBytes, flatText, part->utf8str)) { mismatch(node, "string part text"); }
+      }
+      if (subexpr == EEXPR_FLAT_NONE) { fprintf(stdout, " ()"); }
+      else {
+        fprintf(stdout, " (%u)", subexpr);
+        if (child != EEXPR_FLAT_NONE) { child = eexpr_flat_nextSibling(flat, child); }
+      }
+      fprintf(stdout, " ");
+      fdumpStrn(stdout, flatBytes, (uint8_t*)flatText);
+    }
+    if (eexpr_flat_strPart(flat, node, nParts, &(uint32_t){0}, &flatBytes, &flatText)) { mismatch(node, "number of string parts"); }
+  }
+  else if (eexpr_asEllipsis(x, &before, &after)) {
+    if (!eexpr_flat_asEllipsis(flat, node, &flatBefore, &flatAfter)) { mismatch(node, "ellipsis"); return; }
+    uint32_t first = eexpr_flat_firstChild(flat, node);
+    uint32_t second = first == EEXPR_FLAT_NONE ? EEXPR_FLAT_NONE : eexpr_flat_nextSibling(flat, first);
+    if (flatBefore != (before == NULL ? EEXPR_FLAT_NONE : first)) { mismatch(node, "ellipsis before-part"); }
+    if (flatAfter != (after == NULL ? EEXPR_FLAT_NONE : before == NULL ? first : second)) { mismatch(node, "ellipsis after-part"); }
+    fprintf(stdout, flatBefore == EEXPR_FLAT_NONE ? " before=none" : " before=%u", flatBefore);
+    fprintf(stdout, flatAfter == EEXPR_FLAT_NONE ? " after=none" : " after=%u", flatAfter);
+  }
+  else if (eexpr_asMixfix(x, &op, &nArgs, &args)) {
+    if (flat->payload[node] != op) { mismatch(node, "mixfix operator"); }
+    fprintf(stdout, " op=%u", flat->payload[node]);
+  }
+  // the other accessors must all turn the node down
+  if (eexpr_getType(x) != EEXPR_SYMBOL && eexpr_flat_asSymbol(flat, node, &flatBytes, &flatText)) { mismatch(node, "type (as symbol)"); }
+  if (eexpr_getType(x) != EEXPR_NUMBER && eexpr_flat_asNumber(flat, node, &flatNumber)) { mismatch(node, "type (as number)"); }
+  if (eexpr_getType(x) != EEXPR_STRING && eexpr_flat_asString(flat, node, &flatBytes, &flatText, &nParts)) { mismatch(node, "type (as string)"); }
+  if (eexpr_getType(x) != EEXPR_ELLIPSIS && eexpr_flat_asEllipsis(flat, node, &flatBefore, &flatAfter)) { mismatch(node, "type (as ellipsis)"); }
+}
+
+// Check the node and its subtree against the eexpr, returning the size of the subtree.
+static
+uint32_t checkNode(const eexpr_flat* flat, uint32_t node, uint32_t parent, const eexpr* x) {
+  eexpr_span span = eexpr_getSpan(x);
+  if (flat->type[node] != eexpr_getType(x)) { mismatch(node, "type"); }
+  if (flat->parent[node] != parent) { mismatch(node, "parent"); }
+  if (flat->startByte[node] != span.start || flat->endByte[node] != span.end) { mismatch(node, "span"); }
+  fprintf(stdout, "%u %s", node, typeNames[flat->type[node]]);
+  fprintf(stdout, parent == EEXPR_FLAT_NONE ? " parent=none" : " parent=%u", parent);
+  fprintf(stdout, " size=%u bytes=%zu-%zu", flat->subtreeSize[node], flat->startByte[node], flat->endByte[node]);
+  checkPayload(flat, node, x);
+  fprintf(stdout, "\n");
+  uint32_t size = 1;
+  uint32_t child = eexpr_flat_firstChild(flat, node);
+  for (size_t k = 0; ; ++k) {
+    eexpr* sub = childOf(x, k);
+    if (sub == NULL || child == EEXPR_FLAT_NONE) {
+      if (sub != NULL || child != EEXPR_FLAT_NONE) { mismatch(node, "number of children"); }
+      break;
+    }
+    if (child != node + size) { mismatch(node, "child index"); }
+    size += checkNode(flat, child, node, sub);
+    child = eexpr_flat_nextSibling(flat, child);
+  }
+  if (flat->subtreeSize[node] != size) { mismatch(node, "subtree size"); }
+  return size;
+}
+
+static
+void checkFlat(int argc, char** argv) {
+  bool lazyPayloads = false;
+  char* specFile = NULL;
+  char* filename = NULL;
+  for (int i = 0; i < argc; ++i) {
+    if (!strcmp(argv[i], "-flazy-payloads")) { lazyPayloads = true; }
+    else if (!strcmp(argv[i], "-m")) {
+      ++i; if (i >= argc) { die("missing mixfix spec file"); }
+      specFile = argv[i];
+    }
+    else if (filename == NULL) { filename = argv[i]; }
+    else { die("only one input file is supported"); }
+  }
+  if (filename == NULL) { die("no input file"); }
+
+  eexpr_mixfixTable* mixfixes = NULL;
+  if (specFile != NULL) {
+    mixfixes = readMixfixSpec(stderr, specFile);
+    if (mixfixes == NULL) { exit(2); }
+  }
+  input in = {.filename = filename};
+  parseInput(&in, lazyPayloads, NULL, NULL);
+  rewriteInput(&in, mixfixes);
+
+  eexpr_flat* flat = eexpr_flatten(in.parser.nEexprs, in.parser.eexprs);
+  if (flat == NULL) { die("forest too large to flatten"); }
+  uint32_t node = in.parser.nEexprs == 0 ? EEXPR_FLAT_NONE : 0;
+  for (size_t i = 0; i < in.parser.nEexprs; ++i) {
+    if (node == EEXPR_FLAT_NONE) { mismatch(flat->nNodes, "number of roots"); break; }
+    checkNode(flat, node, EEXPR_FLAT_NONE, in.parser.eexprs[i]);
+    node = eexpr_flat_nextSibling(flat, node);
+  }
+  if (node != EEXPR_FLAT_NONE) { mismatch(node, "number of roots"); }
+  fprintf(stdout, "%zu nodes, %zu texts, %zu numbers, %zu strings, %zu string parts\n",
+    flat->nNodes, flat->nTexts, flat->nNumbers, flat->nStrings, flat->nStrParts);
+
+  eexpr_flat_del(flat);
+  delInput(&in);
+  eexpr_mixfixTable_del(mixfixes);
+}
+
+//////////////////////////////////// Symbol Tables ////////////////////////////////////
+
+// A symbol as it was seen while its eexpr was still alive.
+typedef struct seenSymbol {
+  uint32_t id;
+  size_t nBytes;
+  const uint8_t* utf8str;
+} seenSymbol;
+#define TYPE seenSymbol
+#include "dynarr.h"
+
+static
+void checkSymbols(const char* filename, const eexpr_symtab* table, dynarr_seenSymbol* seen, const eexpr* x) {
+  size_t nBytes;
+  uint8_t* text;
+  uint32_t id;
+  if (eexpr_asSymbol(x, &nBytes, &text)) {
+    if (table == NULL) {
+      if (eexpr_asSymbolId(x, &id)) {
+        fprintf(stderr, "%s: symbol parsed without a table has id %u\n", filename, id);
+        failed = true;
+      }
+      return;
+    }
+    if (!eexpr_asSymbolId(x, &id)) {
+      fprintf(stderr, "%s: symbol has no id\n", filename);
+      failed = true;
+      return;
+    }
+    size_t tableBytes;
+    const uint8_t* tableText;
+    if (!eexpr_symtab_lookup(table, id, &tableBytes, &tableText)) {
+      fprintf(stderr, "%s: symbol id %u is not in the table\n", filename, id);
+      failed = true;
+      return;
+    }
+    if (tableBytes != nBytes || tableText != text) {
+      fprintf(stderr, "%s: symbol %u does not use the table's text\n", filename, id);
+      failed = true;
+    }
+    if (eexpr_symtab_find(table, nBytes, text) != id) {
+      fprintf(stderr, "%s: the table finds another id for symbol %u\n", filename, id);
+      failed = true;
+    }
+    fprintf(stdout, " ");
+    fdumpStrn(stdout, nBytes, text);
+    fprintf(stdout, "=%u", id);
+    seenSymbol sym = {.id = id, .nBytes = nBytes, .utf8str = text};
+    dynarr_push_seenSymbol(seen, &sym);
+    return;
+  }
+  if (eexpr_asSymbolId(x, &id)) {
+    fprintf(stderr, "%s: a %s has a symbol id\n", filename, typeNames[eexpr_getType(x)]);
+    failed = true;
+  }
+  eexpr* sub;
+  for (size_t k = 0; (sub = childOf(x, k)) != NULL; ++k) {
+    checkSymbols(filename, table, seen, sub);
+  }
+}
+
+static
+void checkSymtab(int argc, char** argv) {
+  if (argc == 0) { die("no input file"); }
+  eexpr_symtab* table = eexpr_symtab_new();
+  uint32_t ifId = eexpr_symtab_intern(table, 2, (const uint8_t*)"if");
+  fprintf(stdout, "interned \"if\" as %u\n", ifId);
+  dynarr_seenSymbol seen; dynarr_init_seenSymbol(&seen, 32);
+
+  input bare = {.filename = argv[0]};
+  parseInput(&bare, false, NULL, NULL);
+  for (size_t i = 0; i < bare.parser.nEexprs; ++i) {
+    checkSymbols(bare.filename, NULL, &seen, bare.parser.eexprs[i]);
+  }
+  delInput(&bare);
+
+  for (int i = 0; i < argc; ++i) {
+    input in = {.filename = argv[i]};
+    parseInput(&in, false, table, NULL);
+    fprintf(stdout, "%s:", in.filename);
+    for (size_t j = 0; j < in.parser.nEexprs; ++j) {
+      checkSymbols(in.filename, table, &seen, in.parser.eexprs[j]);
+    }
+    fprintf(stdout, "\n");
+    // nothing the symbols reported may have been owned by the eexprs or the input
+    delInput(&in);
+  }
+
+  for (size_t i = 0; i < seen.len; ++i) {
+    size_t tableBytes;
+    const uint8_t* tableText;
+    seenSymbol* sym = &seen.data[i];
+    if (!eexpr_symtab_lookup(table, sym->id, &tableBytes, &tableText)
+     || tableBytes != sym->nBytes || tableText != sym->utf8str
+     || eexpr_symtab_find(table, sym->nBytes, sym->utf8str) != sym->id) {
+      fprintf(stderr, "symbol %u changed after its eexpr was freed\n", sym->id);
+      failed = true;
+    }
+  }
+  fprintf(stdout, "%zu symbols still readable after eexpr_del\n", seen.len);
+  fprintf(stdout, "table:");
+  for (uint32_t id = 0; id < eexpr_symtab_size(table); ++id) {
+    size_t nBytes;
+    const uint8_t* text;
+    eexpr_symtab_lookup(table, id, &nBytes, &text);
+    fprintf(stdout, " %u=", id);
+    fdumpStrn(stdout, nBytes, (uint8_t*)text);
+  }
+  fprintf(stdout, "\n");
+  if (eexpr_symtab_lookup(table, eexpr_symtab_size(table), &(size_t){0}, &(const uint8_t*){NULL})) {
+    fprintf(stderr, "the table looks up an id past its end\n");
+    failed = true;
+  }
+
+  dynarr_deinit_seenSymbol(&seen);
+  eexpr_symtab_del(table);
+}
+
+//////////////////////////////////// Hashing ////////////////////////////////////
+
+// Check that two parses of the same file agree, eexpr by eexpr.
+static
+void checkCopies(const char* what, const input* a, const input* b) {
+  bool same = a->parser.nEexprs == b->parser.nEexprs;
+  for (size_t i = 0; same && i < a->parser.nEexprs; ++i) {
+    const eexpr* x = a->parser.eexprs[i];
+    const eexpr* y = b->parser.eexprs[i];
+    same = eexpr_equal(x, y, true) && eexpr_equal(y, x, false)
+        && eexpr_hash(x, false) == eexpr_hash(y, false) && eexpr_hash(x, true) == eexpr_hash(y, true);
+  }
+  if (!same) {
+    fprintf(stderr, "%s: not the same as the plain parse\n", what);
+    failed = true;
+  }
+  fprintf(stdout, "%s: %s\n", what, same ? "same digests, equal with spans" : "differs");
+}
+
+static
+void checkHash(int argc, char** argv) {
+  char* specFile = NULL;
+  char* filename = NULL;
+  for (int i = 0; i < argc; ++i) {
+    if (!strcmp(argv[i], "-m")) {
+      ++i; if (i >= argc) { die("missing mixfix spec file"); }
+      specFile = argv[i];
+    }
+    else if (filename == NULL) { filename = argv[i]; }
+    else { die("only one input file is supported"); }
+  }
+  if (filename == NULL) { die("no input file"); }
+
+  eexpr_mixfixTable* mixfixes = NULL;
+  if (specFile != NULL) {
+    mixfixes = readMixfixSpec(stderr, specFile);
+    if (mixfixes == NULL) { exit(2); }
+  }
+  input plain = {.filename = filename};
+  parseInput(&plain, false, NULL, NULL);
+  rewriteInput(&plain, mixfixes);
+  size_t n = plain.parser.nEexprs;
+  eexpr** xs = plain.parser.eexprs;
+
+  if (eexpr_equal(NULL, NULL, false) != true || (n != 0 && (eexpr_equal(xs[0], NULL, false) || eexpr_equal(NULL, xs[0], false)))) {
+    fprintf(stderr, "NULL is not only equal to NULL\n");
+    failed = true;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    eexpr_span span = eexpr_getSpan(xs[i]);
+    fprintf(stdout, "%zu (bytes %zu-%zu):", i, span.start, span.end);
+    bool unique = true;
+    for (size_t j = 0; j < i; ++j) {
+      bool equal = eexpr_equal(xs[j], xs[i], false);
+      if (equal != eexpr_equal(xs[i], xs[j], false)) {
+        fprintf(stderr, "%zu and %zu: equality is not symmetric\n", j, i);
+        failed = true;
+      }
+      if (equal != (eexpr_hash(xs[j], false) == eexpr_hash(xs[i], false))) {
+        fprintf(stderr, "%zu and %zu: digests disagree with equality\n", j, i);
+        failed = true;
+      }
+      if (eexpr_equal(xs[j], xs[i], true) || eexpr_hash(xs[j], true) == eexpr_hash(xs[i], true)) {
+        fprintf(stderr, "%zu and %zu: the same with spans\n", j, i);
+        failed = true;
+      }
+      if (equal) {
+        fprintf(stdout, " equal to %zu", j);
+        unique = false;
+      }
+    }
+    if (!eexpr_equal(xs[i], xs[i], true)) {
+      fprintf(stderr, "%zu: not equal to itself\n", i);
+      failed = true;
+    }
+    fprintf(stdout, unique ? " unlike any before\n" : "\n");
+  }
+
+  input lazy = {.filename = filename};
+  parseInput(&lazy, true, NULL, NULL);
+  rewriteInput(&lazy, mixfixes);
+  checkCopies("lazy payloads", &plain, &lazy);
+  delInput(&lazy);
+
+  if (mixfixes != NULL) {
+    // hashing before the rewrite replaces subexprs must leave nothing behind that the rewrite would make stale
+    input hashed = {.filename = filename};
+    parseInput(&hashed, false, NULL, NULL);
+    for (size_t i = 0; i < hashed.parser.nEexprs; ++i) {
+      eexpr_hash(hashed.parser.eexprs[i], false);
+      eexpr_hash(hashed.parser.eexprs[i], true);
+    }
+    rewriteInput(&hashed, mixfixes);
+    checkCopies("hashed before rewriting", &plain, &hashed);
+    delInput(&hashed);
+  }
+
+  delInput(&plain);
+  eexpr_mixfixTable_del(mixfixes);
+}
+
+//////////////////////////////////// Building ////////////////////////////////////
+
+static const eexpr_span noSpan = {0, 0};
+
+static
+eexpr** newArray(eexpr_arena* arena, size_t n) {
+  return eexpr_arena_alloc(arena, n * sizeof(eexpr*));
+}
+
+static
+eexpr* newCStr(eexpr_arena* arena, const char* s) {
+  return eexpr_newSymbol(arena, noSpan, strlen(s), (const uint8_t*)s);
+}
+
+static
+eexpr* newPair(eexpr_arena* arena, const char* key, eexpr* value) {
+  return eexpr_newColon(arena, noSpan, newCStr(arena, key), value);
+}
+
+static
+eexpr* newFrac(eexpr_arena* arena, uint32_t digits, uint8_t radix, uint32_t nFracDigits, uint32_t exponent) {
+  uint32_t* mantissa = eexpr_arena_alloc(arena, sizeof(uint32_t));
+  *mantissa = digits;
+  eexpr_number value =
+    { .isPositive = true, .nBigDigits = 1, .bigDigits = mantissa
+    , .radix = radix, .nFracDigits = nFracDigits
+    , .isPositive_exp = false, .nBigDigits_exp = 0, .bigDigits_exp = NULL
+    };
+  if (exponent != 0) {
+    uint32_t* exp = eexpr_arena_alloc(arena, sizeof(uint32_t));
+    *exp = exponent;
+    value.isPositive_exp = true;
+    value.nBigDigits_exp = 1;
+    value.bigDigits_exp = exp;
+  }
+  return eexpr_newNumber(arena, noSpan, &value);
+}
+
+// The text of the eexprs built here is expected in the input file.
+static
+size_t buildForest(eexpr_arena* arena, eexpr*** out) {
+  // server host7:
+  //   port: 8007
+  //   tags: [web, "prod `name`!", -3, 0]
+  //   limits: {cpu: 1.50; mem: 0x1.8h2}
+  struct eexpr_strTemplate* tail = eexpr_arena_alloc(arena, sizeof(struct eexpr_strTemplate));
+  tail[0] = (struct eexpr_strTemplate){.subexpr = newCStr(arena, "name"), .nBytes = 1, .utf8str = (uint8_t*)"!"};
+  eexpr** tags = newArray(arena, 4);
+  tags[0] = newCStr(arena, "web");
+  tags[1] = eexpr_newString(arena, noSpan, 5, (const uint8_t*)"prod ", 1, tail);
+  tags[2] = eexpr_newInt(arena, noSpan, -3);
+  tags[3] = eexpr_newInt(arena, noSpan, 0);
+  eexpr** limits = newArray(arena, 2);
+  limits[0] = newPair(arena, "cpu", newFrac(arena, 150, 10, 2, 0));
+  limits[1] = newPair(arena, "mem", newFrac(arena, 24, 16, 1, 2));
+  eexpr** body = newArray(arena, 3);
+  body[0] = newPair(arena, "port", eexpr_newInt(arena, noSpan, 8007));
+  body[1] = newPair(arena, "tags", eexpr_newBrack(arena, noSpan, eexpr_newComma(arena, noSpan, 4, tags)));
+  body[2] = newPair(arena, "limits", eexpr_newBrace(arena, noSpan, eexpr_newSemicolon(arena, noSpan, 2, limits)));
+  eexpr** chain = newArray(arena, 2);
+  chain[0] = newCStr(arena, "host7");
+  chain[1] = eexpr_newBlock(arena, noSpan, 3, body);
+  eexpr** server = newArray(arena, 2);
+  server[0] = newCStr(arena, "server");
+  server[1] = eexpr_newChain(arena, noSpan, 2, chain);
+
+  // f(x).y [a..b] [..] .pre () (,)
+  eexpr** call = newArray(arena, 3);
+  call[0] = newCStr(arena, "f");
+  call[1] = eexpr_newParen(arena, noSpan, newCStr(arena, "x"));
+  call[2] = newCStr(arena, "y");
+  eexpr** lone = newArray(arena, 0);
+  eexpr** misc = newArray(arena, 6);
+  misc[0] = eexpr_newChain(arena, noSpan, 3, call);
+  misc[1] = eexpr_newBrack(arena, noSpan, eexpr_newEllipsis(arena, noSpan, newCStr(arena, "a"), newCStr(arena, "b")));
+  misc[2] = eexpr_newBrack(arena, noSpan, eexpr_newEllipsis(arena, noSpan, NULL, NULL));
+  misc[3] = eexpr_newPredot(arena, noSpan, newCStr(arena, "pre"));
+  misc[4] = eexpr_newParen(arena, noSpan, NULL);
+  misc[5] = eexpr_newParen(arena, noSpan, eexpr_newComma(arena, noSpan, 0, lone));
+
+  eexpr** forest = newArray(arena, 2);
+  forest[0] = eexpr_newSpace(arena, noSpan, 2, server);
+  forest[1] = eexpr_newSpace(arena, noSpan, 6, misc);
+  *out = forest;
+  return 2;
+}
+
+static
+void checkBuild(int argc, char** argv) {
+  if (argc != 1) { die("only one input file is supported"); }
+  eexpr_arena* arena = eexpr_arena_new();
+  eexpr** built;
+  size_t n = buildForest(arena, &built);
+  eexpr_fprint(stdout, n, built);
+
+  input in = {.filename = argv[0]};
+  parseInput(&in, false, NULL, NULL);
+  if (in.parser.nEexprs != n) {
+    fprintf(stderr, "built %zu eexprs, but parsed %zu\n", n, in.parser.nEexprs);
+    failed = true;
+  }
+  for (size_t i = 0; i < n && i < in.parser.nEexprs; ++i) {
+    bool equal = eexpr_equal(built[i], in.parser.eexprs[i], false);
+    if (!equal) {
+      fprintf(stderr, "%zu: built eexpr differs from the parsed text\n", i);
+      failed = true;
+    }
+    fprintf(stdout, "%zu: %s\n", i, equal ? "equal to the parsed text" : "differs");
+  }
+
+  // a parsed eexpr holding a built one: only the parsed part is freed
+  size_t nSubexprs;
+  eexpr** subexprs;
+  if (in.parser.nEexprs < 2 || !eexpr_asSpace(in.parser.eexprs[1], &nSubexprs, &subexprs)) {
+    die("the second eexpr of the input should be a space");
+  }
+  eexpr* parsed = subexprs[0];
+  subexprs[0] = newCStr(arena, "swapped");
+  eexpr_fprint(stdout, 1, &in.parser.eexprs[1]);
+  eexpr_del(in.parser.eexprs[1]);
+  in.parser.eexprs[1] = NULL;
+  fprintf(stdout, "freed a parsed space holding a built symbol\n");
+
+  // a built eexpr holding a parsed one: nothing is freed
+  eexpr** holder = newArray(arena, 2);
+  holder[0] = newCStr(arena, "holding");
+  holder[1] = parsed;
+  eexpr* mixed = eexpr_newSpace(arena, noSpan, 2, holder);
+  eexpr_del(mixed);
+  eexpr_fprint(stdout, 1, &mixed);
+  eexpr_del(parsed);
+  fprintf(stdout, "freed a parsed chain after freeing the built space holding it\n");
+
+  delInput(&in);
+  eexpr_arena_del(arena);
+}
+
+//////////////////////////////////// Batches ////////////////////////////////////
+
+static
+bool sameLoc(const eexpr_lineIndex* aLines, eexpr_span a, const eexpr_lineIndex* bLines, eexpr_span b) {
+  eexpr_loc x = eexpr_resolveSpan(aLines, a);
+  eexpr_loc y = eexpr_resolveSpan(bLines, b);
+  return a.start == b.start && a.end == b.end
+      && x.start.line == y.start.line && x.start.col == y.start.col && x.end.line == y.end.line && x.end.col == y.end.col;
+}
+
+// Errors compare by type and location only, since that is all that `eexpr_parseBatch` could get wrong.
+static
+bool sameErrors(const eexpr_lineIndex* aLines, size_t n, const eexpr_error* a, const eexpr_lineIndex* bLines, const eexpr_error* b) {
+  for (size_t i = 0; i < n; ++i) {
+    if (a[i].type != b[i].type || !sameLoc(aLines, a[i].loc, bLines, b[i].loc)) { return false; }
+  }
+  return true;
+}
+
+// Check the result of one input in a batch against parsing that input alone.
+static
+void checkBatchResult(const char* what, const eexpr_parser* batch, const eexpr_batchResult* r, str text) {
+  eexpr_parser alone; eexpr_parserInitDefault(&alone);
+  eexpr_parse(&alone, text.len, text.bytes);
+  bool same = r->nEexprs == alone.nEexprs && r->nErrors == alone.nErrors && r->nWarnings == alone.nWarnings && r->nSpans == alone.nSpans;
+  for (size_t i = 0; same && i < r->nEexprs; ++i) {
+    const eexpr* x = batch->eexprs[r->firstEexpr + i];
+    same = eexpr_equal(x, alone.eexprs[i], true) && sameLoc(r->lines, eexpr_getSpan(x), alone.lines, eexpr_getSpan(alone.eexprs[i]));
+  }
+  same = same && sameErrors(r->lines, r->nErrors, &batch->errors[r->firstError], alone.lines, alone.errors);
+  same = same && sameErrors(r->lines, r->nWarnings, &batch->warnings[r->firstWarning], alone.lines, alone.warnings);
+  same = same && eexpr_lineCount(r->lines) == eexpr_lineCount(alone.lines);
+  if (!same) {
+    fprintf(stderr, "%s: not the same as parsing it alone\n", what);
+    failed = true;
+  }
+  fprintf( stdout, "%s: %zu eexprs, %zu errors, %zu warnings, %s\n"
+         , what, r->nEexprs, r->nErrors, r->nWarnings, same ? "same as parsed alone" : "differs");
+  eexpr_parser_deinit(&alone);
+  for (size_t i = 0; i < alone.nEexprs; ++i) {
+    eexpr_del(alone.eexprs[i]);
+  }
+  free(alone.eexprs);
+  free(alone.errors);
+  free(alone.warnings);
+  eexpr_lineIndex_del(alone.lines);
+}
+
+static
+void runBatch(const char* name, eexpr_parser* parser, size_t n, const char* const* filenames, const str* texts, eexpr_batchResult* results) {
+  size_t* nBytes = calloc(n, sizeof(size_t));
+  uint8_t** inputs = calloc(n, sizeof(uint8_t*));
+  if (nBytes == NULL || inputs == NULL) { die("out of memory"); }
+  for (size_t i = 0; i < n; ++i) {
+    nBytes[i] = texts[i].len;
+    inputs[i] = texts[i].bytes;
+  }
+  bool ok = eexpr_parseBatch(parser, n, nBytes, inputs, results);
+  size_t nEexprs = 0, nErrors = 0, nWarnings = 0, nSpans = 0;
+  bool tiled = true;
+  for (size_t i = 0; i < n; ++i) {
+    const eexpr_batchResult* r = &results[i];
+    tiled = tiled && r->firstEexpr == nEexprs && r->firstError == nErrors && r->firstWarning == nWarnings && r->firstSpan == nSpans;
+    nEexprs += r->nEexprs; nErrors += r->nErrors; nWarnings += r->nWarnings; nSpans += r->nSpans;
+    char what[256];
+    snprintf(what, sizeof(what), "%s, input %zu (%s)", name, i, filenames[i]);
+    checkBatchResult(what, parser, r, texts[i]);
+  }
+  tiled = tiled && parser->nEexprs == nEexprs && parser->nErrors == nErrors && parser->nWarnings == nWarnings && parser->nSpans == nSpans;
+  if (!tiled) {
+    fprintf(stderr, "%s: the results do not tile the parser's outputs\n", name);
+    failed = true;
+  }
+  if (ok != (nErrors == 0)) {
+    fprintf(stderr, "%s: returned %s, but there were %zu errors\n", name, ok ? "true" : "false", nErrors);
+    failed = true;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    eexpr_lineIndex_del(results[i].lines);
+  }
+  free(nBytes);
+  free(inputs);
+}
+
+static
+void checkBatch(int argc, char** argv) {
+  if (argc == 0) { die("no input file"); }
+  // the files, with an empty input after the first
+  size_t n = (size_t)argc + 1;
+  const char** filenames = malloc(n * sizeof(char*));
+  str* texts = malloc(n * sizeof(str));
+  eexpr_batchResult* results = malloc(n * sizeof(eexpr_batchResult));
+  if (filenames == NULL || texts == NULL || results == NULL) { die("out of memory"); }
+  for (size_t i = 0, j = 0; i < n; ++i) {
+    if (i == 1) {
+      filenames[i] = "empty";
+      texts[i] = (str){.len = 0, .bytes = NULL};
+      continue;
+    }
+    filenames[i] = argv[j++];
+    texts[i] = readFile(filenames[i]);
+    if (texts[i].bytes == NULL) { die("error opening input file for reading"); }
+  }
+
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  runBatch("first batch", &parser, n, filenames, texts, results);
+  // the same parser and results again, with the inputs the other way around so that anything left over would show
+  eexpr_parser_reset(&parser);
+  for (size_t i = 0; i < n / 2; ++i) {
+    const char* filename = filenames[i]; filenames[i] = filenames[n-1-i]; filenames[n-1-i] = filename;
+    str text = texts[i]; texts[i] = texts[n-1-i]; texts[n-1-i] = text;
+  }
+  runBatch("reversed batch", &parser, n, filenames, texts, results);
+
+  eexpr_parser_deinit(&parser);
+  for (size_t i = 0; i < parser.nEexprs; ++i) {
+    eexpr_del(parser.eexprs[i]);
+  }
+  free(parser.eexprs);
+  free(parser.errors);
+  free(parser.warnings);
+  for (size_t i = 0; i < n; ++i) {
+    free(texts[i].bytes);
+  }
+  free(filenames);
+  free(texts);
+  free(results);
+}
+
+//////////////////////////////////// Sharing ////////////////////////////////////
+
+// Pair the shared spans, from `next` on, with the eexprs of the plain parse under `x`, returning where the next subtree's spans start.
+static
+size_t checkSpans(const input* in, size_t next, const eexpr* x) {
+  if (next == in->parser.nSpans) {
+    fprintf(stderr, "%s: fewer shared spans than eexprs\n", in->filename);
+    failed = true;
+    return next;
+  }
+  eexpr_span want = eexpr_getSpan(x);
+  eexpr_span got = in->parser.spans[next];
+  if (got.start != want.start || got.end != want.end) {
+    fprintf(stderr, "%s: shared span %zu is bytes %zu-%zu, not %zu-%zu\n", in->filename, next, got.start, got.end, want.start, want.end);
+    failed = true;
+  }
+  next += 1;
+  eexpr* sub;
+  for (size_t k = 0; (sub = childOf(x, k)) != NULL; ++k) {
+    next = checkSpans(in, next, sub);
+  }
+  return next;
+}
+
+// Check that the shared eexprs `xs` are still equal to the plain parse.
+static
+bool sameAsPlain(const input* plain, size_t n, eexpr* const* xs) {
+  if (n != plain->parser.nEexprs) { return false; }
+  for (size_t i = 0; i < n; ++i) {
+    if (!eexpr_equal(xs[i], plain->parser.eexprs[i], false)) { return false; }
+  }
+  return true;
+}
+
+static
+void checkShare(int argc, char** argv) {
+  if (argc == 0) { die("no input file"); }
+  eexpr_shareTable* table = eexpr_shareTable_new();
+  for (int i = 0; i < argc; ++i) {
+    input plain = {.filename = argv[i]};
+    parseInput(&plain, false, NULL, NULL);
+    input in = {.filename = argv[i]};
+    parseInput(&in, false, NULL, table);
+    size_t n = in.parser.nEexprs;
+    if (!sameAsPlain(&plain, n, in.parser.eexprs)) {
+      fprintf(stderr, "%s: the shared eexprs differ from the plain ones\n", in.filename);
+      failed = true;
+    }
+    size_t nSpans = 0;
+    for (size_t j = 0; j < plain.parser.nEexprs; ++j) {
+      nSpans = checkSpans(&in, nSpans, plain.parser.eexprs[j]);
+    }
+    if (nSpans != in.parser.nSpans) {
+      fprintf(stderr, "%s: more shared spans than eexprs\n", in.filename);
+      failed = true;
+    }
+    size_t size = eexpr_shareTable_size(table);
+    fprintf(stdout, "%s: %zu eexprs, %zu spans, %zu in the table\n", in.filename, n, in.parser.nSpans, size);
+
+    // the table, not the parse, owns the eexprs, so freeing them must change nothing
+    eexpr** kept = malloc((n == 0 ? 1 : n) * sizeof(eexpr*));
+    if (kept == NULL) { die("out of memory"); }
+    memcpy(kept, in.parser.eexprs, n * sizeof(eexpr*));
+    delInput(&in);
+    input again = {.filename = argv[i]};
+    parseInput(&again, false, NULL, table);
+    bool same = again.parser.nEexprs == n && eexpr_shareTable_size(table) == size && sameAsPlain(&plain, n, kept);
+    for (size_t j = 0; same && j < n; ++j) {
+      same = again.parser.eexprs[j] == kept[j];
+    }
+    if (!same) {
+      fprintf(stderr, "%s: freeing the shared eexprs took them out of the table\n", again.filename);
+      failed = true;
+    }
+    fprintf(stdout, "%s: %s\n", again.filename, same ? "after eexpr_del, parsed again into the same eexprs" : "differs after eexpr_del");
+    delInput(&again);
+    free(kept);
+    delInput(&plain);
+  }
+  eexpr_shareTable_del(table);
+}
+
+//////////////////////////////////// Main ////////////////////////////////////
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s flat [-flazy-payloads] [-m <spec file>] <file>\n", argv[0]);
+    fprintf(stderr, "       %s symtab <file>...\n", argv[0]);
+    fprintf(stderr, "       %s hash [-m <spec file>] <file>\n", argv[0]);
+    fprintf(stderr, "       %s build <file>\n", argv[0]);
+    fprintf(stderr, "       %s batch <file>...\n", argv[0]);
+    fprintf(stderr, "       %s share <file>...\n", argv[0]);
+    return 2;
+  }
+       if (!strcmp(argv[1], "flat")) { checkFlat(argc - 2, &argv[2]); }
+  else if (!strcmp(argv[1], "symtab")) { checkSymtab(argc - 2, &argv[2]); }
+  else if (!strcmp(argv[1], "hash")) { checkHash(argc - 2, &argv[2]); }
+  else if (!strcmp(argv[1], "build")) { checkBuild(argc - 2, &argv[2]); }
+  else if (!strcmp(argv[1], "batch")) { checkBatch(argc - 2, &argv[2]); }
+  else if (!strcmp(argv[1], "share")) { checkShare(argc - 2, &argv[2]); }
+  else {
+    fprintf(stderr, "unrecognized check %s\n", argv[1]);
+    return 2;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "eexpr.h"
+
+/*
+Benchmark for generating eexprs, comparing the constructors (see `eexpr_newSymbol` and friends) with writing text by hand.
+
+  eexpr-build-bench [records] [iterations]
+
+Each iteration generates a document of server records like this one:
+
+  server host7:
+    port: 8007
+    tags: [web, "prod", 7]
+    limits: {cpu: 2, mem: 512}
+
+The document is generated in four ways:
+  * text: written out with `snprintf`,
+  * text+parse: as text, then parsed, which is what it takes to get eexprs (or checked text) without the constructors,
+  * build: built with the constructors, in an arena that is reset between iterations,
+  * build+print: as build, then printed with `eexpr_print`, which gives both the eexprs and the text.
+Before timing, the built eexprs are checked against the parsed text with `eexpr_equal`.
+*/
+
+static
+double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static const eexpr_span noSpan = {0, 0};
+
+static
+size_t writeText(long nRecords, size_t cap, char* buf) {
+  size_t len = 0;
+  for (long i = 0; i < nRecords; ++i) {
+    int n = snprintf(&buf[len], cap - len,
+      "server host%ld:\n  port: %ld\n  tags: [web, \"prod\", %ld]\n  limits: {cpu: 2, mem: 512}\n",
+      i, 8000 + i, i);
+    if (n < 0 || (size_t)n >= cap - len) { fprintf(stderr, "text buffer too small\n"); exit(1); }
+    len += n;
+  }
+  return len;
+}
+
+static
+eexpr** newArray(eexpr_arena* arena, size_t n) {
+  return eexpr_arena_alloc(arena, n * sizeof(eexpr*));
+}
+
+static
+eexpr* newCStr(eexpr_arena* arena, const char* s) {
+  return eexpr_newSymbol(arena, noSpan, strlen(s), (const uint8_t*)s);
+}
+
+static
+eexpr* newPair(eexpr_arena* arena, const char* key, eexpr* value) {
+  return eexpr_newColon(arena, noSpan, newCStr(arena, key), value);
+}
+
+static
+eexpr* buildRecord(eexpr_arena* arena, long i) {
+  char name[32];
+  snprintf(name, sizeof(name), "host%ld", i);
+
+  eexpr** tags = newArray(arena, 3);
+  tags[0] = newCStr(arena, "web");
+  tags[1] = eexpr_newString(arena, noSpan, 4, (const uint8_t*)"prod", 0, NULL);
+  tags[2] = eexpr_newInt(arena, noSpan, i);
+  eexpr** limits = newArray(arena, 2);
+  limits[0] = newPair(arena, "cpu", eexpr_newInt(arena, noSpan, 2));
+  limits[1] = newPair(arena, "mem", eexpr_newInt(arena, noSpan, 512));
+
+  eexpr** body = newArray(arena, 3);
+  body[0] = newPair(arena, "port", eexpr_newInt(arena, noSpan, 8000 + i));
+  body[1] = newPair(arena, "tags", eexpr_newBrack(arena, noSpan, eexpr_newComma(arena, noSpan, 3, tags)));
+  body[2] = newPair(arena, "limits", eexpr_newBrace(arena, noSpan, eexpr_newComma(arena, noSpan, 2, limits)));
+  // an indented block after a colon is chained onto what comes before the colon
+  eexpr** chain = newArray(arena, 2);
+  chain[0] = newCStr(arena, name);
+  chain[1] = eexpr_newBlock(arena, noSpan, 3, body);
+  eexpr** line = newArray(arena, 2);
+  line[0] = newCStr(arena, "server");
+  line[1] = eexpr_newChain(arena, noSpan, 2, chain);
+  return eexpr_newSpace(arena, noSpan, 2, line);
+}
+
+static
+void build(eexpr_arena* arena, long nRecords, eexpr** out) {
+  for (long i = 0; i < nRecords; ++i) {
+    out[i] = buildRecord(arena, i);
+  }
+}
+
+static
+void delParser(eexpr_parser* parser) {
+  eexpr_parser_deinit(parser);
+  for (size_t i = 0; i < parser->nEexprs; ++i) {
+    eexpr_del(parser->eexprs[i]);
+  }
+  free(parser->eexprs);
+  free(parser->errors);
+  free(parser->warnings);
+  eexpr_lineIndex_del(parser->lines);
+}
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    fprintf(stderr, "usage: %s [records] [iterations]\n", argv[0]);
+    return 1;
+  }
+  long nRecords = argc >= 2 ? strtol(argv[1], NULL, 10) : 1000;
+  long iterations = argc >= 3 ? strtol(argv[2], NULL, 10) : 1000;
+  if (nRecords <= 0) { nRecords = 1; }
+  if (iterations <= 0) { iterations = 1; }
+
+  size_t cap = 128 * (size_t)nRecords;
+  char* text = malloc(cap);
+  eexpr** built = malloc(nRecords * sizeof(eexpr*));
+  if (text == NULL || built == NULL) { fprintf(stderr, "out of memory\n"); return 1; }
+  eexpr_arena* arena = eexpr_arena_new();
+
+  // check that the constructors build what the parser would
+  size_t len = writeText(nRecords, cap, text);
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  parser.lazyLines = true;
+  eexpr_parse(&parser, len, (uint8_t*)text);
+  build(arena, nRecords, built);
+  bool ok = parser.nErrors == 0 && parser.nEexprs == (size_t)nRecords;
+  for (size_t i = 0; ok && i < parser.nEexprs; ++i) {
+    ok = eexpr_equal(parser.eexprs[i], built[i], false);
+  }
+  if (!ok) {
+    fprintf(stderr, "built eexprs differ from the parsed text\n");
+    return 1;
+  }
+  eexpr_parser_reset(&parser);
+
+  double start = now();
+  for (long k = 0; k < iterations; ++k) {
+    writeText(nRecords, cap, text);
+  }
+  double timeText = now() - start;
+
+  start = now();
+  for (long k = 0; k < iterations; ++k) {
+    len = writeText(nRecords, cap, text);
+    eexpr_parse(&parser, len, (uint8_t*)text);
+    eexpr_parser_reset(&parser);
+  }
+  double timeParse = now() - start;
+
+  start = now();
+  for (long k = 0; k < iterations; ++k) {
+    eexpr_arena_reset(arena);
+    build(arena, nRecords, built);
+  }
+  double timeBuild = now() - start;
+
+  start = now();
+  for (long k = 0; k < iterations; ++k) {
+    eexpr_arena_reset(arena);
+    build(arena, nRecords, built);
+    if (eexpr_print(nRecords, built, cap, (uint8_t*)text) > cap) {
+      fprintf(stderr, "text buffer too small\n");
+      return 1;
+    }
+  }
+  double timePrint = now() - start;
+
+  printf("iterations: %ld of %ld records (%zu bytes)\n", iterations, nRecords, len);
+  printf("text: %.1f ns/record\n", timeText / (double)iterations / (double)nRecords * 1e9);
+  printf("text+parse: %.1f ns/record\n", timeParse / (double)iterations / (double)nRecords * 1e9);
+  printf("build: %.1f ns/record\n", timeBuild / (double)iterations / (double)nRecords * 1e9);
+  printf("build+print: %.1f ns/record\n", timePrint / (double)iterations / (double)nRecords * 1e9);
+
+  delParser(&parser);
+  eexpr_arena_del(arena);
+  free(built);
+  free(text);
+  return 0;
+}
@@ -0,0 +1,360 @@
+#include "cbor.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "json.h"
+
+
+//////////////////////////////////// Data Items ////////////////////////////////////
+
+typedef enum cborMajor {
+  CBOR_UINT = 0,
+  CBOR_NINT = 1,
+  CBOR_BYTES = 2,
+  CBOR_TEXT = 3,
+  CBOR_ARRAY = 4,
+  CBOR_MAP = 5,
+  CBOR_TAG = 6,
+  CBOR_SIMPLE = 7
+} cborMajor;
+
+// the initial byte(s) of a data item: its major type and an argument in the shortest encoding that holds it
+static
+void cborHead(FILE* fp, cborMajor major, uint64_t n) {
+  uint8_t buf[9];
+  size_t len;
+  if (n < 24) {
+    buf[0] = (uint8_t)(major << 5 | n);
+    len = 1;
+  }
+  else {
+    size_t nBytes = n <= 0xFF ? 1 : n <= 0xFFFF ? 2 : n <= 0xFFFFFFFF ? 4 : 8;
+    buf[0] = (uint8_t)(major << 5 | (nBytes == 1 ? 24 : nBytes == 2 ? 25 : nBytes == 4 ? 26 : 27));
+    for (size_t i = 0; i < nBytes; ++i) {
+      buf[nBytes - i] = (uint8_t)(n >> (8 * i));
+    }
+    len = 1 + nBytes;
+  }
+  fwrite(buf, 1/*byte per element*/, len/*many elements*/, fp);
+}
+
+void cborMapHead(FILE* fp, size_t n) { cborHead(fp, CBOR_MAP, n); }
+void cborArrayHead(FILE* fp, size_t n) { cborHead(fp, CBOR_ARRAY, n); }
+
+static
+void cborInt(FILE* fp, int64_t n) {
+  if (n >= 0) { cborHead(fp, CBOR_UINT, (uint64_t)n); }
+  else { cborHead(fp, CBOR_NINT, (uint64_t)(-1 - n)); }
+}
+
+static
+void cborNull(FILE* fp) { fputc(CBOR_SIMPLE << 5 | 22, fp); }
+
+static
+void cborTrue(FILE* fp) { fputc(CBOR_SIMPLE << 5 | 21, fp); }
+
+static
+void cborText(FILE* fp, size_t nBytes, const uint8_t* utf8str) {
+  cborHead(fp, CBOR_TEXT, nBytes);
+  if (nBytes == 0) { return; }
+  fwrite(utf8str, 1/*byte per element*/, nBytes/*many elements*/, fp);
+}
+
+void cborDumpCStr(FILE* fp, const char* s) {
+  cborText(fp, strlen(s), (const uint8_t*)s);
+}
+
+// a single codepoint as a text string (empty if it is not a codepoint at all)
+static
+void cborChar(FILE* fp, char32_t c) {
+  utf8Char enc = encodeUchar(c);
+  if (0x10FFFF < c) { enc.nbytes = 0; }
+  cborText(fp, enc.nbytes, enc.codeunits);
+}
+
+static
+void cborLoc(FILE* fp, const eexpr_lineIndex* lines, eexpr_span span) {
+  eexpr_loc loc = eexpr_resolveSpan(lines, span);
+  cborArrayHead(fp, 4);
+  cborHead(fp, CBOR_UINT, loc.start.line + 1);
+  cborHead(fp, CBOR_UINT, loc.start.col + 1);
+  cborHead(fp, CBOR_UINT, loc.end.line + 1);
+  cborHead(fp, CBOR_UINT, loc.end.col + 1);
+}
+
+
+//////////////////////////////////// Numbers ////////////////////////////////////
+
+// An integer given by a sign and little-endian base-2^32 digits (as in `eexpr_number`).
+// It is a plain CBOR integer if it fits in 64 bits, and otherwise a tag 2/3 bignum whose bytes are taken straight from the digits.
+static
+void cborBigint(FILE* fp, bool isPositive, size_t nDigits, const uint32_t* digits) {
+  // CBOR negative integers hold `-1 - value`, so the magnitude is decremented for them
+  bool neg = !isPositive && nDigits != 0;
+  if (nDigits <= 2) {
+    uint64_t m = nDigits == 0 ? 0 : digits[0] | (nDigits == 2 ? (uint64_t)digits[1] << 32 : 0);
+    cborHead(fp, neg ? CBOR_NINT : CBOR_UINT, neg ? m - 1 : m);
+    return;
+  }
+  size_t nBytes = 4 * nDigits;
+  uint8_t* bytes = malloc(nBytes);
+  checkOom(bytes);
+  for (size_t i = 0; i < nDigits; ++i) {
+    uint32_t digit = digits[nDigits - 1 - i];
+    bytes[4*i + 0] = (uint8_t)(digit >> 24);
+    bytes[4*i + 1] = (uint8_t)(digit >> 16);
+    bytes[4*i + 2] = (uint8_t)(digit >> 8);
+    bytes[4*i + 3] = (uint8_t)digit;
+  }
+  if (neg) {
+    for (size_t i = nBytes; i-- > 0; ) {
+      if (bytes[i] != 0) { bytes[i] -= 1; break; }
+      bytes[i] = 0xFF;
+    }
+  }
+  size_t skip = 0;
+  while (skip < nBytes && bytes[skip] == 0) { ++skip; }
+  if (nBytes - skip <= 8) { // only possible for `-2^64`
+    uint64_t m = 0;
+    for (size_t i = skip; i < nBytes; ++i) { m = m << 8 | bytes[i]; }
+    cborHead(fp, CBOR_NINT, m);
+  }
+  else {
+    cborHead(fp, CBOR_TAG, neg ? 3 : 2);
+    cborHead(fp, CBOR_BYTES, nBytes - skip);
+    fwrite(&bytes[skip], 1/*byte per element*/, nBytes - skip/*many elements*/, fp);
+  }
+  free(bytes);
+}
+
+/*
+Integers are plain integers or bignums (see `cborBigint`).
+Numbers with a fractional part or an exponent become `[exponent, mantissa]` arrays under
+  tag 4 (decimal fraction) when written in radix 10, or
+  tag 5 (bigfloat) when written in radix 2, 8 or 16 (the exponent is scaled to base 2),
+  where the exponent has already been adjusted for the number of fractional digits.
+Anything else (radix 12, or an exponent too large for a CBOR integer) is written out in parts, as in the json:
+  `{"mantissa": <integer>, "radix": <radix>, "exponent": {"fractional": <-nFracDigits>, "explicit": <integer>}}`,
+  where the members of `"exponent"` only appear when non-zero.
+*/
+static
+void cborDumpNumber(FILE* fp, const eexpr_number* num) {
+  if (num->nFracDigits == 0 && num->nBigDigits_exp == 0) {
+    cborBigint(fp, num->isPositive, num->nBigDigits, num->bigDigits);
+    return;
+  }
+  int log2Radix = num->radix == 2 ? 1 : num->radix == 8 ? 3 : num->radix == 16 ? 4 : 0;
+  if ((num->radix == 10 || log2Radix != 0) && num->nBigDigits_exp <= 1) {
+    int64_t exp = num->nBigDigits_exp == 0 ? 0 : (int64_t)num->bigDigits_exp[0];
+    if (!num->isPositive_exp) { exp = -exp; }
+    exp -= num->nFracDigits;
+    cborHead(fp, CBOR_TAG, num->radix == 10 ? 4 : 5);
+    cborArrayHead(fp, 2);
+    cborInt(fp, num->radix == 10 ? exp : exp * log2Radix);
+    cborBigint(fp, num->isPositive, num->nBigDigits, num->bigDigits);
+    return;
+  }
+  cborMapHead(fp, 3);
+  cborDumpCStr(fp, "mantissa");
+  cborBigint(fp, num->isPositive, num->nBigDigits, num->bigDigits);
+  cborDumpCStr(fp, "radix");
+  cborHead(fp, CBOR_UINT, num->radix);
+  cborDumpCStr(fp, "exponent");
+  cborMapHead(fp, (num->nFracDigits != 0) + (num->nBigDigits_exp != 0));
+  if (num->nFracDigits != 0) {
+    cborDumpCStr(fp, "fractional");
+    cborInt(fp, -(int64_t)num->nFracDigits);
+  }
+  if (num->nBigDigits_exp != 0) {
+    cborDumpCStr(fp, "explicit");
+    cborBigint(fp, num->isPositive_exp, num->nBigDigits_exp, num->bigDigits_exp);
+  }
+}
+
+
+//////////////////////////////////// Eexprs ////////////////////////////////////
+
+static
+void cborMaybeEexpr(FILE* fp, const eexpr_lineIndex* lines, const eexpr* x) {
+  if (x == NULL) { cborNull(fp); }
+  else { cborDumpEexpr(fp, lines, x); }
+}
+
+static
+void cborOperator(FILE* fp, uint32_t op) {
+  size_t n; const uint8_t* name;
+  if (op == EEXPR_MIXFIX_NONE) {
+    cborNull(fp);
+  }
+  else if (jsonMixfixes != NULL && eexpr_mixfixTable_name(jsonMixfixes, op, &n, &name)) {
+    cborText(fp, n, name);
+  }
+  else {
+    cborHead(fp, CBOR_UINT, op);
+  }
+}
+
+// the walk is shared with the json output (see `eexprFieldsOf`), so only the way each kind of field is written is here
+void cborDumpEexpr(FILE* fp, const eexpr_lineIndex* lines, const eexpr* x) {
+  eexprFields e; eexprFieldsOf(&e, x);
+  // every eexpr is a map with `"loc"` and `"type"`, plus its fields (and a `"radix"` for numbers not in decimal)
+  bool hasRadix = e.fields[0].type == FIELD_NUMBER && e.number.radix != 10;
+  cborMapHead(fp, 2 + e.n + hasRadix);
+  cborDumpCStr(fp, "loc");
+  cborLoc(fp, lines, jsonSpanOf(x));
+  cborDumpCStr(fp, "type");
+  cborDumpCStr(fp, e.type);
+  for (size_t k = 0; k < e.n; ++k) {
+    const eexprField* f = &e.fields[k];
+    cborDumpCStr(fp, f->name);
+    switch (f->type) {
+      case FIELD_TEXT: cborText(fp, f->nBytes, f->text); break;
+      case FIELD_NUMBER: {
+        cborDumpNumber(fp, &e.number);
+        if (hasRadix) {
+          cborDumpCStr(fp, "radix");
+          cborHead(fp, CBOR_UINT, e.number.radix);
+        }
+      }; break;
+      case FIELD_TEMPLATE: {
+        const eexpr_string* s = &e.string;
+        cborArrayHead(fp, 1 + 2 * s->nSubexprs);
+        cborText(fp, s->head.nBytes, s->head.utf8str);
+        for (size_t i = 0; i < s->nSubexprs; ++i) {
+          cborMaybeEexpr(fp, lines, s->tail[i].subexpr);
+          cborText(fp, s->tail[i].nBytes, s->tail[i].utf8str);
+        }
+      }; break;
+      case FIELD_EEXPR: cborDumpEexpr(fp, lines, f->subexprs[0]); break;
+      case FIELD_MAYBE_EEXPR: cborMaybeEexpr(fp, lines, f->subexprs[0]); break;
+      case FIELD_EEXPRS: cborDumpEexprArray(fp, lines, f->n, f->subexprs); break;
+      case FIELD_OPERATOR: cborOperator(fp, f->op); break;
+    }
+  }
+}
+
+
+//////////////////////////////////// Errors ////////////////////////////////////
+
+void cborDumpError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_error* err) {
+  size_t nEntries = 2;
+  switch (err->type) {
+    case EEXPR_ERR_BAD_CHAR:
+    case EEXPR_ERR_BAD_ESCAPE_CHAR:
+    case EEXPR_ERR_BAD_ESCAPE_CODE:
+    case EEXPR_ERR_UNICODE_OVERFLOW:
+    case EEXPR_ERR_BAD_STRING_CHAR:
+    case EEXPR_ERR_MIXED_INDENTATION:
+    case EEXPR_ERR_UNBALANCED_WRAP:
+    case EEXPR_ERR_LIMIT_EXCEEDED:
+      nEntries = 3;
+      break;
+    default: break;
+  }
+  cborMapHead(fp, nEntries);
+  cborDumpCStr(fp, "loc");
+  cborLoc(fp, lines, err->loc);
+  cborDumpCStr(fp, "type");
+  cborDumpCStr(fp, errorName(err->type));
+  switch (err->type) {
+    case EEXPR_ERR_BAD_CHAR: {
+      cborDumpCStr(fp, "input");
+      cborChar(fp, err->as.badChar);
+    }; break;
+    case EEXPR_ERR_BAD_ESCAPE_CHAR: {
+      cborDumpCStr(fp, "input");
+      cborChar(fp, err->as.badEscapeChar);
+    }; break;
+    case EEXPR_ERR_BAD_ESCAPE_CODE: {
+      // the same characters as in the json, including any padding
+      utf8Char encs[6];
+      size_t nBytes = 0;
+      for (size_t i = 0; i < 6; ++i) {
+        encs[i] = encodeUchar(err->as.badEscapeCode[i]);
+        if (0x10FFFF < err->as.badEscapeCode[i]) { encs[i].nbytes = 0; }
+        nBytes += encs[i].nbytes;
+      }
+      cborDumpCStr(fp, "input");
+      cborHead(fp, CBOR_TEXT, nBytes);
+      for (size_t i = 0; i < 6; ++i) {
+        fwrite(encs[i].codeunits, 1/*byte per element*/, encs[i].nbytes/*many elements*/, fp);
+      }
+    }; break;
+    case EEXPR_ERR_UNICODE_OVERFLOW: {
+      cborDumpCStr(fp, "value");
+      cborInt(fp, (int32_t)err->as.unicodeOverflow);
+    }; break;
+    case EEXPR_ERR_BAD_STRING_CHAR: {
+      cborDumpCStr(fp, "input");
+      cborChar(fp, err->as.badStringChar);
+    }; break;
+    case EEXPR_ERR_MIXED_INDENTATION: {
+      cborDumpCStr(fp, "established");
+      cborMapHead(fp, 2);
+      cborDumpCStr(fp, "type");
+      switch (err->as.mixedIndentation.establishedType) {
+        case EEXPR_INDENT_SPACES: cborChar(fp, ' '); break;
+        case EEXPR_INDENT_TABS: cborChar(fp, '\t'); break;
+        case EEXPR_INDENT_NULL: assert(false); break;
+      }
+      cborDumpCStr(fp, "loc");
+      cborLoc(fp, lines, err->as.mixedIndentation.establishedAt);
+    }; break;
+    case EEXPR_ERR_UNBALANCED_WRAP: {
+      if (err->as.unbalancedWrap.type != EEXPR_WRAP_NULL) {
+        cborDumpCStr(fp, "unclosed");
+        cborMapHead(fp, 2);
+        cborDumpCStr(fp, "open");
+        cborDumpCStr(fp, wrapName(err->as.unbalancedWrap.type));
+        cborDumpCStr(fp, "loc");
+        cborLoc(fp, lines, err->as.unbalancedWrap.loc);
+      }
+      else {
+        cborDumpCStr(fp, "unopened");
+        cborTrue(fp);
+      }
+    }; break;
+    case EEXPR_ERR_LIMIT_EXCEEDED: {
+      cborDumpCStr(fp, "limit");
+      cborDumpCStr(fp, limitName(err->as.limitExceeded));
+    }; break;
+    default: break;
+  }
+}
+
+void cborDumpMixfixError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_mixfixError* err) {
+  cborMapHead(fp, 3);
+  cborDumpCStr(fp, "loc");
+  cborLoc(fp, lines, err->loc);
+  cborDumpCStr(fp, "type");
+  cborDumpCStr(fp, mixfixErrorName(err->type));
+  cborDumpCStr(fp, "operator");
+  cborOperator(fp, err->op);
+}
+
+
+//////////////////////////////////// Arrays ////////////////////////////////////
+
+void cborDumpEexprArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, eexpr** xs) {
+  cborArrayHead(fp, n);
+  for (size_t i = 0; i < n; ++i) {
+    cborDumpEexpr(fp, lines, xs[i]);
+  }
+}
+
+void cborDumpErrorArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, const eexpr_error* arr) {
+  cborArrayHead(fp, n);
+  for (size_t i = 0; i < n; ++i) {
+    cborDumpError(fp, lines, &arr[i]);
+  }
+}
+
+void cborDumpMixfixErrorArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, const eexpr_mixfixError* arr) {
+  cborArrayHead(fp, n);
+  for (size_t i = 0; i < n; ++i) {
+    cborDumpMixfixError(fp, lines, &arr[i]);
+  }
+}
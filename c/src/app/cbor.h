@@ -0,0 +1,29 @@
+#ifndef APP_CBOR_H
+#define APP_CBOR_H
+
+#include <stdio.h>
+
+#include "eexpr.h"
+
+/*
+CBOR (RFC 8949) output, with the same document shape as the json output (see `json.h`), except that:
+  * locations are an array of four integers `[fromLine, fromCol, toLine, toCol]`, one-indexed like the json,
+  * numbers are native CBOR numbers rather than decimal strings (see `cborDumpNumber` in `cbor.c`),
+  * strings are raw utf-8 text strings.
+All maps and arrays have definite lengths.
+*/
+
+void cborMapHead(FILE* fp, size_t n);
+void cborArrayHead(FILE* fp, size_t n);
+void cborDumpCStr(FILE* fp, const char* s);
+
+void cborDumpEexpr(FILE* fp, const eexpr_lineIndex* lines, const eexpr* x);
+void cborDumpError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_error* err);
+void cborDumpMixfixError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_mixfixError* err);
+
+void cborDumpEexprArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, eexpr** xs);
+void cborDumpErrorArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, const eexpr_error* arr);
+void cborDumpMixfixErrorArray(FILE* fp, const eexpr_lineIndex* lines, size_t n, const eexpr_mixfixError* arr);
+
+
+#endif
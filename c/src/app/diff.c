@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/*
+Structural diff of two eexpr files.
+
+  eexprdiff [-fno-share-subtrees] <old file> <new file>
+
+The edits that take the old file to the new one (see `eexpr_diff`) are written to stdout as json,
+  each with the location of the edit in both files.
+Both files are parsed into one share table (see `eexpr_diffShared`), unless `-fno-share-subtrees` is passed;
+  the output is the same either way, but sharing takes about half the memory to hold the parsed files.
+As with diff(1), the exit code is 0 if the files are the same, 1 if they differ, and 2 if either could not be read or parsed
+  (in which case the errors are written to stderr in the same format as eexpr2json's).
+*/
+
+void die(const char* msg) {
+  fprintf(stderr, "%s\n", msg);
+  exit(2);
+}
+
+typedef struct input {
+  char* filename;
+  str text;
+  eexpr_parser parser;
+} input;
+
+// With a share table, both inputs are parsed into it, so that what they have in common is stored (and compared) once;
+//   the spans of each input are kept in its `.parser.spans` instead.
+static
+bool parseInput(input* in, eexpr_shareTable* shared) {
+  in->text = readFile(in->filename);
+  if (in->text.bytes == NULL) { die("error opening input file for reading"); }
+  eexpr_parserInitDefault(&in->parser);
+  if (shared != NULL) {
+    in->parser.shared = shared;
+    in->parser.shareSpans = true;
+  }
+  else {
+    // payloads are only decoded if they have to be compared
+    in->parser.lazyPayloads = true;
+  }
+  eexpr_parse(&in->parser, in->text.len, in->text.bytes);
+  // the tokens are done with, so give them back before the other input is parsed
+  eexpr_parser_deinit(&in->parser);
+  if (in->parser.nErrors == 0) { return true; }
+  fprintf(stderr, "{ \"filename\": ");
+  fdumpCStr(stderr, in->filename);
+  fprintf(stderr, "\n, \"errors\":");
+  fdumpErrorArray(stderr, in->parser.lines, "  ", in->parser.nErrors, in->parser.errors);
+  fprintf(stderr, "\n}\n");
+  return false;
+}
+
+static
+void delInput(input* in) {
+  eexpr_parser_deinit(&in->parser);
+  // shared eexprs are left alone, to be freed along with their table
+  for (size_t i = 0; i < in->parser.nEexprs; ++i) {
+    eexpr_del(in->parser.eexprs[i]);
+  }
+  free(in->parser.eexprs);
+  free(in->parser.spans);
+  free(in->parser.errors);
+  free(in->parser.warnings);
+  eexpr_lineIndex_del(in->parser.lines);
+  free(in->text.bytes);
+}
+
+static
+const char* editName(eexpr_editType type) {
+  switch (type) {
+    case EEXPR_EDIT_DELETE: return "delete";
+    case EEXPR_EDIT_INSERT: return "insert";
+    case EEXPR_EDIT_REPLACE: return "replace";
+    case EEXPR_EDIT_MOVE: return "move";
+  }
+  return "unknown";
+}
+
+int main(int argc, char** argv) {
+  bool share = true;
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+         if (!strcmp(argv[i], "-fshare-subtrees")) { share = true; }
+    else if (!strcmp(argv[i], "-fno-share-subtrees")) { share = false; }
+    else {
+      fprintf(stderr, "unrecognized option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (argc - i != 2) {
+    fprintf(stderr, "usage: %s [-fno-share-subtrees] <old file> <new file>\n", argv[0]);
+    return 2;
+  }
+  eexpr_shareTable* shared = share ? eexpr_shareTable_new() : NULL;
+  input old = {.filename = argv[i]};
+  input new = {.filename = argv[i + 1]};
+  bool ok = parseInput(&old, shared);
+  ok = parseInput(&new, shared) && ok;
+  if (!ok) {
+    delInput(&old);
+    delInput(&new);
+    eexpr_shareTable_del(shared);
+    return 2;
+  }
+
+  size_t nEdits;
+  eexpr_edit* edits;
+  bool same = share
+    ? eexpr_diffShared
+        ( old.parser.nEexprs, old.parser.eexprs, old.parser.spans
+        , new.parser.nEexprs, new.parser.eexprs, new.parser.spans
+        , &nEdits, &edits
+        )
+    : eexpr_diff(old.parser.nEexprs, old.parser.eexprs, new.parser.nEexprs, new.parser.eexprs, &nEdits, &edits);
+
+  fprintf(stdout, "{ \"old\": ");
+  fdumpCStr(stdout, old.filename);
+  fprintf(stdout, "\n, \"new\": ");
+  fdumpCStr(stdout, new.filename);
+  fprintf(stdout, "\n, \"edits\":");
+  if (nEdits == 0) {
+    fprintf(stdout, " []");
+  }
+  for (size_t j = 0; j < nEdits; ++j) {
+    fprintf(stdout, "\n  %c {\"type\":\"%s\",\"old\":", j == 0 ? '[' : ',', editName(edits[j].type));
+    fdumpLoc(stdout, old.parser.lines, edits[j].aSpan);
+    fprintf(stdout, ",\"new\":");
+    fdumpLoc(stdout, new.parser.lines, edits[j].bSpan);
+    fprintf(stdout, "}");
+  }
+  if (nEdits != 0) {
+    fprintf(stdout, "\n  ]");
+  }
+  fprintf(stdout, "\n}\n");
+
+  free(edits);
+  delInput(&old);
+  delInput(&new);
+  eexpr_shareTable_del(shared);
+  return same ? 0 : 1;
+}
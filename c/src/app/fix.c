@@ -0,0 +1,412 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "eexpr.h"
+#include "json.h"
+
+/*
+Streaming fixer for the conditions that eexpr2json reports as warnings by default:
+  trailing space, mixed newlines, mixed space, and a missing trailing newline.
+
+  eexpr-fix [options] <input file> [output file]
+
+The fixed text goes to the output file, or stdout if none is given.
+The input is never held in memory all at once.
+Instead, it is read in chunks that are cut just after a newline token outside of any string template;
+  each chunk is lexed (raw lexing only, so errors elsewhere in the input do not stop the fixes),
+  and then copied to the output, editing only the spans that the warnings (or the raw tokens) point at.
+Memory use is therefore bounded by the chunk size, unless a single token (such as a heredoc) is larger than that.
+
+Where the lexer stops at an error (such as invalid UTF-8, or a bad heredoc opener), the rest of that line is copied without edits,
+  a warning naming the error is printed, and lexing starts over on the next line.
+The exit code is then 1, even though the rest of the file is fixed.
+
+The edits are:
+  * trailing space is deleted,
+  * newlines are all made the same as the first one in the file,
+  * mixed space is replaced with spaces, each tab becoming `-t <width>` spaces (default 2),
+  * a newline is added at the end of the file if it is missing.
+Any of these can be turned off with the same `-N<warning>` options that eexpr2json takes.
+*/
+
+void die(const char* msg) {
+  fprintf(stderr, "%s\n", msg);
+  exit(1);
+}
+
+typedef struct options {
+  char* inFilename;
+  char* outFilename;
+  struct {
+    bool mixedSpace;
+    bool mixedNewlines;
+    bool trailingSpace;
+    bool noTrailingNewline;
+  } fix;
+  size_t tabWidth;
+  size_t chunkSize;
+} options;
+
+typedef enum editType {
+  EDIT_DELETE,
+  EDIT_NEWLINE,
+  EDIT_SPACES
+} editType;
+typedef struct edit {
+  eexpr_span loc; // in bytes from the start of the chunk
+  editType type;
+} edit;
+#define TYPE edit
+#include "dynarr.h"
+
+typedef struct fixer {
+  const options* opts;
+  FILE* in;
+  FILE* out;
+  // The first `PREFIX_CAP` bytes are kept free to put the file's newline in front of each chunk.
+  // That way, the lexer warns about exactly the newlines that differ from the file's first newline, even in later chunks.
+  // The file's newline is followed by a record separator (a newline of its own that never combines with another byte),
+  //   since a chunk can start with a `\r` or `\n` that would otherwise be lexed together with a one-byte file newline.
+  uint8_t* buf;
+  size_t cap;
+  size_t len; // bytes of input in the buffer (not counting the prefix area)
+  bool eof;
+  uint8_t newline[2];
+  size_t newlineLen; // zero until the first newline of the file is found
+  dynarr_edit edits;
+  size_t offset; // bytes of input already written out, i.e. where the buffer starts in the input
+  bool failed;
+  bool lexFailed;
+} fixer;
+#define PREFIX_CAP 3
+
+
+//////////////////////////////////// Options ////////////////////////////////////
+
+options parseOpts(int argc, char** argv) {
+  options opts =
+    { .inFilename = NULL
+    , .outFilename = NULL
+    , .fix =
+      { .mixedSpace = true
+      , .mixedNewlines = true
+      , .trailingSpace = true
+      , .noTrailingNewline = true
+      }
+    , .tabWidth = 2
+    , .chunkSize = 1 << 20
+    };
+  for (int i = 1; i < argc; ++i) {
+    size_t len = strlen(argv[i]);
+    if (len >= 2 && argv[i][0] == '-') {
+      if (argv[i][1] == 't' || argv[i][1] == 'c') {
+        size_t* n_p = argv[i][1] == 't' ? &opts.tabWidth : &opts.chunkSize;
+        if (argv[i][2] != '\0') { die("sizes are given as -t <width> or -c <bytes>"); }
+        ++i; if (i >= argc) { die("missing size"); }
+        char* end;
+        unsigned long long n = strtoull(argv[i], &end, 10);
+        if (argv[i][0] == '\0' || *end != '\0') {
+          fprintf(stderr, "bad size %s\n", argv[i]);
+          exit(1);
+        }
+        *n_p = n;
+      }
+      else if (argv[i][1] == 'N') {
+        argv[i] = &argv[i][2];
+             if (false) { assert(false); }
+        else if (!strcmp(argv[i], "mixed-space")) { opts.fix.mixedSpace = false; }
+        else if (!strcmp(argv[i], "mixed-newlines")) { opts.fix.mixedNewlines = false; }
+        else if (!strcmp(argv[i], "trailing-space")) { opts.fix.trailingSpace = false; }
+        else if (!strcmp(argv[i], "no-trailing-newline")) { opts.fix.noTrailingNewline = false; }
+        else {
+          fprintf(stderr, "unrecognized warning type %s\n", argv[i]);
+          exit(1);
+        }
+      }
+      else {
+        fprintf(stderr, "unrecognized option: %s\n", argv[i]);
+        exit(1);
+      }
+    }
+    else if (opts.inFilename == NULL) { opts.inFilename = argv[i]; }
+    else if (opts.outFilename == NULL) { opts.outFilename = argv[i]; }
+    else { die("only one input and one output file are supported"); }
+  }
+  if (opts.inFilename == NULL) { die("no input file"); }
+  if (opts.chunkSize == 0) { opts.chunkSize = 1; }
+  return opts;
+}
+
+
+//////////////////////////////////// Finding Edits ////////////////////////////////////
+
+// Find the first newline sequence in the input, as the lexer would decode it.
+// Returns false if more input is needed to be sure.
+static
+bool findNewline(fixer* fx) {
+  const uint8_t* data = &fx->buf[PREFIX_CAP];
+  for (size_t i = 0; i < fx->len; ++i) {
+    uint8_t c = data[i];
+    if (c != '\n' && c != '\r' && c != '\x1E') { continue; }
+    fx->newline[0] = c;
+    fx->newlineLen = 1;
+    if (c == '\x1E') { return true; }
+    if (i + 1 == fx->len) {
+      if (!fx->eof) { fx->newlineLen = 0; return false; }
+      return true;
+    }
+    uint8_t other = c == '\n' ? '\r' : '\n';
+    if (data[i + 1] == other) {
+      fx->newline[1] = other;
+      fx->newlineLen = 2;
+    }
+    return true;
+  }
+  if (!fx->eof) { return false; }
+  // a file without newlines gets unix ones
+  fx->newline[0] = '\n';
+  fx->newlineLen = 1;
+  return true;
+}
+
+static
+void addEdit(fixer* fx, size_t prefixLen, eexpr_span loc, editType type) {
+  if (loc.start < prefixLen) { return; }
+  edit e = {.loc = {.start = loc.start - prefixLen, .end = loc.end - prefixLen}, .type = type};
+  dynarr_push_edit(&fx->edits, &e);
+}
+
+// whether the lexer stopped at a fatal error (which is then the last error) rather than at the end of the chunk
+static
+bool lexStopped(const eexpr_parser* parser) {
+  return parser->nTokens == 0 || eexpr_getTokenType(parser->tokens[parser->nTokens - 1]) != EEXPR_TOK_EOF;
+}
+
+// Collect the edits for the lexed chunk, and return how many bytes of the chunk can be written out.
+// That is either the whole chunk (at the end of the input, if it all lexed),
+//   or up to the end of the last newline token that lies outside of a string template and is not the last thing in the chunk.
+static
+size_t findEdits(fixer* fx, const eexpr_parser* parser, size_t prefixLen) {
+  const options* opts = fx->opts;
+  size_t lexLen = prefixLen + fx->len;
+  size_t cut = 0;
+  size_t templateDepth = 0;
+  for (size_t i = 0; i < parser->nTokens; ++i) {
+    const eexpr_token* tok = parser->tokens[i];
+    eexpr_span loc = eexpr_getTokenSpan(tok);
+    switch (eexpr_getTokenType(tok)) {
+      case EEXPR_TOK_STRING: {
+        eexpr_stringType type; size_t n; uint8_t* s;
+        eexpr_tokenAsString(tok, &type, &n, &s);
+        if (type == EEXPR_STROPEN) { templateDepth += 1; }
+        else if (type == EEXPR_STRCLOSE && templateDepth != 0) { templateDepth -= 1; }
+      }; break;
+      case EEXPR_TOK_UNKNOWN_SPACE: {
+        // `space end-of-line`, as in the post-lexer
+        eexpr_spaceType type; size_t n;
+        eexpr_tokenAsSpace(tok, &type, &n);
+        if (!opts->fix.trailingSpace || type == EEXPR_WSLINECONTINUE || i + 1 == parser->nTokens) { break; }
+        eexpr_tokenType next = eexpr_getTokenType(parser->tokens[i + 1]);
+        if (next == EEXPR_TOK_UNKNOWN_NEWLINE || next == EEXPR_TOK_EOF) {
+          addEdit(fx, prefixLen, loc, EDIT_DELETE);
+        }
+      }; break;
+      case EEXPR_TOK_UNKNOWN_NEWLINE: {
+        if (templateDepth == 0 && loc.start >= prefixLen && loc.end < lexLen) { cut = loc.end - prefixLen; }
+      }; break;
+      case EEXPR_TOK_EOF: {
+        // `^(newline | start-of-file) end-of-file`, as in the post-lexer (the prefix stands in for start-of-file)
+        if (!opts->fix.noTrailingNewline || i == 0) { break; }
+        if (eexpr_getTokenType(parser->tokens[i - 1]) != EEXPR_TOK_UNKNOWN_NEWLINE) {
+          addEdit(fx, prefixLen, loc, EDIT_NEWLINE);
+        }
+      }; break;
+      default: break;
+    }
+  }
+  for (size_t i = 0; i < parser->nWarnings; ++i) {
+    const eexpr_error* warn = &parser->warnings[i];
+    switch (warn->type) {
+      case EEXPR_ERR_MIXED_SPACE: {
+        if (opts->fix.mixedSpace) { addEdit(fx, prefixLen, warn->loc, EDIT_SPACES); }
+      }; break;
+      case EEXPR_ERR_MIXED_NEWLINES: {
+        if (opts->fix.mixedNewlines) { addEdit(fx, prefixLen, warn->loc, EDIT_NEWLINE); }
+      }; break;
+      case EEXPR_ERR_TRAILING_SPACE: {
+        if (opts->fix.trailingSpace) { addEdit(fx, prefixLen, warn->loc, EDIT_DELETE); }
+      }; break;
+      default: break;
+    }
+  }
+  return fx->eof && !lexStopped(parser) ? fx->len : cut;
+}
+
+// If the lexer stopped at an error, return how many bytes of the chunk there are up to the end of the line that the error ends on.
+// Returns zero if the lexer did not stop, or if that line is not all in the buffer yet,
+//   since then the error may only be from a token being cut short by the end of the chunk.
+static
+size_t findBadLine(const fixer* fx, const eexpr_parser* parser, size_t prefixLen) {
+  if (!lexStopped(parser) || parser->nErrors == 0) { return 0; }
+  const uint8_t* data = &fx->buf[PREFIX_CAP];
+  size_t end = parser->errors[parser->nErrors - 1].loc.end;
+  for (size_t i = end < prefixLen ? 0 : end - prefixLen; i < fx->len; ++i) {
+    uint8_t c = data[i];
+    if (c != '\n' && c != '\r' && c != '\x1E') { continue; }
+    if (c == '\x1E') { return i + 1; }
+    if (i + 1 == fx->len) { return fx->eof ? i + 1 : 0; }
+    uint8_t other = c == '\n' ? '\r' : '\n';
+    return data[i + 1] == other ? i + 2 : i + 1;
+  }
+  return fx->eof ? fx->len : 0;
+}
+
+// by position, and deletions first when two edits start at the same place
+static
+int compareEdits(const void* a, const void* b) {
+  const edit* x = a, *y = b;
+  if (x->loc.start != y->loc.start) { return x->loc.start < y->loc.start ? -1 : 1; }
+  return (int)x->type - (int)y->type;
+}
+
+
+//////////////////////////////////// Writing Output ////////////////////////////////////
+
+static
+void put(fixer* fx, size_t n, const uint8_t* bytes) {
+  if (n != 0 && fwrite(bytes, 1, n, fx->out) != n) { fx->failed = true; }
+}
+
+static
+void putSpaces(fixer* fx, const uint8_t* from, const uint8_t* to) {
+  static const uint8_t spaces[] = "                                ";
+  for (const uint8_t* c = from; c < to; ++c) {
+    size_t n = *c == '\t' ? fx->opts->tabWidth : 1;
+    while (n != 0) {
+      size_t m = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+      put(fx, m, spaces);
+      n -= m;
+    }
+  }
+}
+
+// Write the first `cut` bytes of the chunk, applying the edits that fall in that range.
+static
+void writeChunk(fixer* fx, size_t cut) {
+  const uint8_t* data = &fx->buf[PREFIX_CAP];
+  qsort(fx->edits.data, fx->edits.len, sizeof(edit), compareEdits);
+  size_t at = 0;
+  for (size_t i = 0; i < fx->edits.len; ++i) {
+    const edit* e = &fx->edits.data[i];
+    if (e->loc.start < at || e->loc.end > cut) { continue; }
+    put(fx, e->loc.start - at, &data[at]);
+    switch (e->type) {
+      case EDIT_DELETE: break;
+      case EDIT_NEWLINE: put(fx, fx->newlineLen, fx->newline); break;
+      case EDIT_SPACES: putSpaces(fx, &data[e->loc.start], &data[e->loc.end]); break;
+    }
+    at = e->loc.end;
+  }
+  put(fx, cut - at, &data[at]);
+  fx->edits.len = 0;
+}
+
+
+//////////////////////////////////// Main Loop ////////////////////////////////////
+
+static
+void fill(fixer* fx) {
+  while (!fx->eof && fx->len < fx->cap) {
+    size_t n = fread(&fx->buf[PREFIX_CAP + fx->len], 1, fx->cap - fx->len, fx->in);
+    fx->len += n;
+    if (n == 0) {
+      if (ferror(fx->in)) { fx->failed = true; }
+      fx->eof = true;
+    }
+  }
+}
+
+static
+void grow(fixer* fx) {
+  fx->cap *= 2;
+  fx->buf = realloc(fx->buf, PREFIX_CAP + fx->cap);
+  checkOom(fx->buf);
+}
+
+static
+void run(fixer* fx) {
+  while (!fx->failed) {
+    fill(fx);
+    if (fx->newlineLen == 0 && !findNewline(fx)) {
+      grow(fx);
+      continue;
+    }
+    size_t prefixLen = fx->newlineLen + 1;
+    uint8_t* lexStart = &fx->buf[PREFIX_CAP - prefixLen];
+    memcpy(lexStart, fx->newline, fx->newlineLen);
+    lexStart[fx->newlineLen] = '\x1E';
+    eexpr_parser parser; eexpr_parserInitDefault(&parser);
+    parser.lazyPayloads = true;
+    parser.pauseAt = EEXPR_PAUSE_AFTER_RAWLEX;
+    eexpr_parse(&parser, prefixLen + fx->len, lexStart);
+    size_t cut = findEdits(fx, &parser, prefixLen);
+    size_t badLine = findBadLine(fx, &parser, prefixLen);
+    if (badLine != 0) {
+      // the lines before the error are fixed as usual, but the rest of its line is copied as it is, and lexing starts over after it
+      const eexpr_error* err = &parser.errors[parser.nErrors - 1];
+      size_t at = err->loc.start < prefixLen ? 0 : err->loc.start - prefixLen;
+      fprintf(stderr, "%s: byte %zu: %s, copied to the end of the line without fixes\n", fx->opts->inFilename, fx->offset + at, errorName(err->type));
+      fx->lexFailed = true;
+      writeChunk(fx, cut);
+      put(fx, badLine - cut, &fx->buf[PREFIX_CAP + cut]);
+      cut = badLine;
+    }
+    eexpr_parser_deinit(&parser);
+    free(parser.errors);
+    free(parser.warnings);
+    eexpr_lineIndex_del(parser.lines);
+    if (cut == 0 && !fx->eof) {
+      // no safe place to cut yet, so take in more input and try again
+      fx->edits.len = 0;
+      if (fx->len == fx->cap) { grow(fx); }
+      continue;
+    }
+    if (badLine == 0) { writeChunk(fx, cut); }
+    memmove(&fx->buf[PREFIX_CAP], &fx->buf[PREFIX_CAP + cut], fx->len - cut);
+    fx->len -= cut;
+    fx->offset += cut;
+    if (fx->eof && fx->len == 0) { break; }
+  }
+}
+
+int main(int argc, char** argv) {
+  options opts = parseOpts(argc, argv);
+  fixer fx =
+    { .opts = &opts
+    , .in = fopen(opts.inFilename, "rb")
+    , .out = opts.outFilename == NULL ? stdout : fopen(opts.outFilename, "wb")
+    , .buf = malloc(PREFIX_CAP + opts.chunkSize)
+    , .cap = opts.chunkSize
+    , .len = 0
+    , .eof = false
+    , .newlineLen = 0
+    , .offset = 0
+    , .failed = false
+    , .lexFailed = false
+    };
+  if (fx.in == NULL) { die("error opening input file for reading"); }
+  if (fx.out == NULL) { die("error opening output file for writing"); }
+  checkOom(fx.buf);
+  dynarr_init_edit(&fx.edits, 64);
+  run(&fx);
+  dynarr_deinit_edit(&fx.edits);
+  free(fx.buf);
+  fclose(fx.in);
+  if (fx.out != stdout && fclose(fx.out) != 0) { fx.failed = true; }
+  else if (fx.out == stdout && fflush(stdout) != 0) { fx.failed = true; }
+  if (fx.failed) { die("error reading input or writing output"); }
+  return fx.lexFailed ? 1 : 0;
+}
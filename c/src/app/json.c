@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "bigint.h"
 
@@ -37,9 +38,65 @@ void fdumpChar(FILE* fp, char32_t c) {
   fjsonEscapeChar(fp, c);
   fprintf(fp, "\"");
 }
+
+// Bytes that `fdumpStr` cannot copy straight through, eight at a time.
+// Each byte of the result has its high bit set if the corresponding byte of `w` is
+//   non-ascii (and so needs utf-8 checking), or an ascii character that `needsJsonEscape`.
+// The inputs to the subtractions are ascii with the high bit forced on, so no borrow crosses into the next byte and the answer is exact for each of them.
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+static
+uint64_t swarIsZero(uint64_t x) {
+  return ~((x | SWAR_HIGHS) - SWAR_ONES) & SWAR_HIGHS;
+}
+static
+uint64_t swarAttention(uint64_t w) {
+  uint64_t ascii = w & ~SWAR_HIGHS;
+  uint64_t control = ~((ascii | SWAR_HIGHS) - 0x20 * SWAR_ONES) & SWAR_HIGHS;
+  return (w & SWAR_HIGHS)
+       | control
+       | swarIsZero(ascii ^ ('\"' * SWAR_ONES))
+       | swarIsZero(ascii ^ ('\\' * SWAR_ONES))
+       | swarIsZero(ascii ^ (0x7F * SWAR_ONES))
+       ;
+}
+
+// The length of the prefix of `text` that `fdumpStr` would copy through unchanged:
+//   ascii that needs no escape, and utf-8 sequences that decode to codepoints that need no escape.
+static
+size_t cleanPrefix(str text) {
+  size_t i = 0;
+  while (i < text.len) {
+    // skip over clean ascii a word at a time
+    while (i + 8 <= text.len) {
+      uint64_t w; memcpy(&w, &text.bytes[i], 8);
+      if (swarAttention(w) != 0) { break; }
+      i += 8;
+    }
+    if (i == text.len) { break; }
+    if (text.bytes[i] < 0x80) {
+      if (needsJsonEscape(text.bytes[i])) { break; }
+      i += 1;
+    }
+    else {
+      str rest = {.len = text.len - i, .bytes = &text.bytes[i]};
+      char32_t c; size_t adv = peekUchar(&c, rest);
+      if (0x10FFFF < c || needsJsonEscape(c)) { break; }
+      i += adv;
+    }
+  }
+  return i;
+}
+
 void fdumpStr(FILE* fp, str text) {
   fprintf(fp, "\"");
   while (text.len > 0) {
+    // copy a clean run in one go, then deal with the one character that stopped it
+    size_t clean = cleanPrefix(text);
+    fwrite(text.bytes, 1/*byte per element*/, clean/*many elements*/, fp);
+    text.len -= clean;
+    text.bytes += clean;
+    if (text.len == 0) { break; }
     char32_t c;
     size_t adv = peekUchar(&c, text);
     if (c < 0 || 0x10FFFF < c) {
@@ -80,14 +137,32 @@ const char* wrapName(eexpr_wrapType type) {
   return "";
 }
 
-void fdumpToken(FILE* fp, const eexpr_token* tok) {
-  eexpr_loc loc = eexpr_tokenLocate(tok);
-  fprintf(fp, "{\"loc\":{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}"
+const char* limitName(eexpr_limitType type) {
+  switch (type) {
+    case EEXPR_LIMIT_BYTES: return "bytes";
+    case EEXPR_LIMIT_TOKENS: return "tokens";
+    case EEXPR_LIMIT_DEPTH: return "depth";
+    case EEXPR_LIMIT_DIGITS: return "digits";
+    case EEXPR_LIMIT_ERRORS: return "errors";
+    case EEXPR_LIMIT_MEMORY: return "memory";
+  }
+  return "";
+}
+
+// locations are output one-indexed, for human consumption
+void fdumpLoc(FILE* fp, const eexpr_lineIndex* lines, eexpr_span span) {
+  eexpr_loc loc = eexpr_resolveSpan(lines, span);
+  fprintf(fp, "{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}"
          , loc.start.line + 1
          , loc.start.col + 1
          , loc.end.line + 1
          , loc.end.col + 1
          );
+}
+
+void fdumpToken(FILE* fp, const eexpr_lineIndex* lines, const eexpr_token* tok) {
+  fprintf(fp, "{\"loc\":");
+  fdumpLoc(fp, lines, eexpr_getTokenSpan(tok));
   if (eexpr_tokenIsTransparent(tok)) {
     fprintf(fp, ",\"ignore\":true");
   }
@@ -193,7 +268,7 @@ void fdumpToken(FILE* fp, const eexpr_token* tok) {
     case EEXPR_TOK_UNKNOWN_SPACE: {
       eexpr_spaceType type; size_t nChars;
       eexpr_tokenAsSpace(tok, &type, &nChars);
-      char* typeDesc;
+      char* typeDesc = "";
       switch (type) {
         case EEXPR_WSMIXED: typeDesc = ",\"mixed\":true"; break;
         case EEXPR_WSSPACES: typeDesc = ",\"char\":\" \""; break;
@@ -219,299 +294,347 @@ void fdumpToken(FILE* fp, const eexpr_token* tok) {
   fprintf(fp, "}");
 }
 
-void fdumpEexpr(FILE* fp, int indent, const eexpr* x) {
-  eexpr_loc loc = eexpr_locate(x);
-  fprintf(fp, "{ \"loc\":{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}"
-         , loc.start.line + 1
-         , loc.start.col + 1
-         , loc.end.line + 1
-         , loc.end.col + 1
-         );
-  eexpr_type type = eexpr_getType(x);
-  switch (type) {
+static
+void fdumpNumber(FILE* fp, const eexpr_number* num) {
+  {
+    bigint mantissa = {.pos = num->isPositive, .len = num->nBigDigits, .buf = num->bigDigits};
+    str tmp = bigint_toDecimal(mantissa);
+    fprintf(fp, ",\"%s\":", num->nFracDigits == 0 ? "value" : "mantissa");
+    fdumpStr(fp, tmp);
+    free(tmp.bytes);
+  }
+  if (num->radix != 10) {
+    fprintf(fp, ",\"radix\":%d", num->radix);
+  }
+  if (num->nFracDigits != 0 || num->nBigDigits_exp != 0) {
+    fprintf(fp, ",\"exponent\":{");
+    bool needsComma = false;
+    if (num->nFracDigits != 0) {
+      fprintf(fp, "%s\"fractional\":-%"PRIu32, needsComma ? "," : "", num->nFracDigits);
+      needsComma = true;
+    }
+    if (num->nBigDigits_exp != 0) {
+      bigint exponent = {.pos = num->isPositive_exp, .len = num->nBigDigits_exp, .buf = num->bigDigits_exp};
+      str tmp = bigint_toDecimal(exponent);
+      fprintf(fp, "%s\"explicit\":", needsComma ? "," : "");
+      fdumpStr(fp, tmp);
+      free(tmp.bytes);
+    }
+    fprintf(fp, "}");
+  }
+}
+
+static
+void setField(eexprField* f, const char* name, eexprFieldType type) {
+  f->name = name;
+  f->type = type;
+}
+
+void eexprFieldsOf(eexprFields* out, const eexpr* x) {
+  out->n = 1;
+  eexprField* f = &out->fields[0];
+  switch (eexpr_getType(x)) {
     case EEXPR_SYMBOL: {
-      size_t n; uint8_t* s; eexpr_asSymbol(x, &n, &s);
-      fprintf(fp, "\n%*s, \"type\":\"symbol\",\"text\":", indent, "");
-      fdumpStrn(fp, n, s);
+      uint8_t* text; eexpr_asSymbol(x, &f->nBytes, &text);
+      f->text = text;
+      out->type = "symbol";
+      setField(f, "text", FIELD_TEXT);
     }; break;
     case EEXPR_NUMBER: {
-      eexpr_number num; eexpr_asNumber(x, &num);
-      {
-        bigint mantissa = {.pos = num.isPositive, .len = num.nBigDigits, .buf = num.bigDigits};
-        str tmp = bigint_toDecimal(mantissa);
-        fprintf( fp, "\n%*s, \"type\":\"number\",\"%s\":"
-               , indent, ""
-               , num.nFracDigits == 0 ? "value" : "mantissa");
-        fdumpStr(fp, tmp);
-        free(tmp.bytes);
-      }
-      if (num.radix != 10) {
-        fprintf(fp, ",\"radix\":%d", num.radix);
-      }
-      if (num.nFracDigits != 0 || num.nBigDigits_exp != 0) {
-        fprintf(fp, ",\"exponent\":{");
-        bool needsComma = false;
-        if (num.nFracDigits != 0) {
-          fprintf(fp, "%s\"fractional\":-%"PRIu32, needsComma ? "," : "", num.nFracDigits);
-          needsComma = true;
-        }
-        if (num.nBigDigits_exp != 0) {
-          bigint exponent = {.pos = num.isPositive_exp, .len = num.nBigDigits_exp, .buf = num.bigDigits_exp};
-          str tmp = bigint_toDecimal(exponent);
-          fprintf(fp, "%s\"explicit\":", needsComma ? "," : "");
-          fdumpStr(fp, tmp);
-          free(tmp.bytes);
-        }
-        fprintf(fp, "}");
-      }
+      eexpr_asNumber(x, &out->number);
+      out->type = "number";
+      setField(f, "value", FIELD_NUMBER);
     }; break;
     case EEXPR_STRING: {
-      eexpr_string s; eexpr_asString(x, &s);
-      fprintf(fp, "\n%*s, \"type\":\"string\"", indent, "");
-      if (s.nSubexprs == 0) {
-        fprintf(fp, ",\"text\":");
-        fdumpStrn(fp, s.head.nBytes, s.head.utf8str);
+      eexpr_asString(x, &out->string);
+      out->type = "string";
+      if (out->string.nSubexprs == 0) {
+        setField(f, "text", FIELD_TEXT);
+        f->nBytes = out->string.head.nBytes;
+        f->text = out->string.head.utf8str;
       }
       else {
-        fprintf(fp, ",\"template\":\n%*s[ ", indent+2, "");
-        fdumpStrn(fp, s.head.nBytes, s.head.utf8str);
-        for (size_t i = 0; i < s.nSubexprs; ++i) {
-          fprintf(fp, "\n%*s, ", indent+2, "");
-          if (s.tail[i].subexpr != NULL) {
-            fdumpEexpr(fp, indent+4, s.tail[i].subexpr);
-          }
-          else {
-            fprintf(fp, "null");
-          }
-          fprintf(fp, "\n%*s, ", indent+2, "");
-          fdumpStrn(fp, s.tail[i].nBytes, s.tail[i].utf8str);
-        }
-        fprintf(fp, "\n%*s]", indent+2, "");
+        setField(f, "template", FIELD_TEMPLATE);
       }
     }; break;
     case EEXPR_PAREN: {
-      eexpr* y; eexpr_asParen(x, &y);
-      fprintf(fp, "\n%*s, \"type\":\"paren\"", indent, "");
-      if (y == NULL) {
-        fprintf(fp, ",\"subexpr\":null");
-      }
-      else {
-        fprintf(fp, ",\"subexpr\":\n%*s  ", indent, "");
-        fdumpEexpr(fp, indent+2, y);
-      }
+      eexpr_asParen(x, &out->pair[0]);
+      out->type = "paren";
+      setField(f, "subexpr", FIELD_MAYBE_EEXPR);
+      f->subexprs = out->pair;
     }; break;
     case EEXPR_BRACK: {
-      eexpr* y; eexpr_asBrack(x, &y);
-      fprintf(fp, "\n%*s, \"type\":\"bracket\"", indent, "");
-      if (y == NULL) {
-        fprintf(fp, ",\"subexpr\":null");
-      }
-      else {
-        fprintf(fp, ",\"subexpr\":\n%*s  ", indent, "");
-        fdumpEexpr(fp, indent+2, y);
-      }
+      eexpr_asBrack(x, &out->pair[0]);
+      out->type = "bracket";
+      setField(f, "subexpr", FIELD_MAYBE_EEXPR);
+      f->subexprs = out->pair;
     }; break;
     case EEXPR_BRACE: {
-      eexpr* y; eexpr_asBrace(x, &y);
-      fprintf(fp, "\n%*s, \"type\":\"brace\"", indent, "");
-      if (y == NULL) {
-        fprintf(fp, ",\"subexpr\":null");
-      }
-      else {
-        fprintf(fp, ",\"subexpr\":\n%*s  ", indent, "");
-        fdumpEexpr(fp, indent+2, y);
-      }
-    }; break;
-    case EEXPR_BLOCK: {
-      size_t n; eexpr** ys; eexpr_asBlock(x, &n, &ys);
-      fprintf(fp, "\n%*s, \"type\":\"block\",\"subexprs\":", indent, "");
-      fdumpEexprArray(fp, indent+2, n, ys);
+      eexpr_asBrace(x, &out->pair[0]);
+      out->type = "brace";
+      setField(f, "subexpr", FIELD_MAYBE_EEXPR);
+      f->subexprs = out->pair;
     }; break;
     case EEXPR_PREDOT: {
-      eexpr* y; eexpr_asPredot(x, &y);
-      fprintf(fp, "\n%*s, \"type\":\"predot\",\"subexpr\":", indent, "");
-      fdumpEexpr(fp, indent+2, y);
+      eexpr_asPredot(x, &out->pair[0]);
+      out->type = "predot";
+      setField(f, "subexpr", FIELD_EEXPR);
+      f->subexprs = out->pair;
+    }; break;
+    case EEXPR_BLOCK: {
+      eexpr_asBlock(x, &f->n, &f->subexprs);
+      out->type = "block";
+      setField(f, "subexprs", FIELD_EEXPRS);
     }; break;
     case EEXPR_CHAIN: {
-      size_t n; eexpr** ys; eexpr_asChain(x, &n, &ys);
-      fprintf(fp, "\n%*s, \"type\":\"chain\",\"subexprs\":", indent, "");
-      fdumpEexprArray(fp, indent+2, n, ys);
+      eexpr_asChain(x, &f->n, &f->subexprs);
+      out->type = "chain";
+      setField(f, "subexprs", FIELD_EEXPRS);
     }; break;
     case EEXPR_SPACE: {
-      size_t n; eexpr** ys; eexpr_asSpace(x, &n, &ys);
-      fprintf(fp, "\n%*s, \"type\":\"space\",\"subexprs\":", indent, "");
-      fdumpEexprArray(fp, indent+2, n, ys);
+      eexpr_asSpace(x, &f->n, &f->subexprs);
+      out->type = "space";
+      setField(f, "subexprs", FIELD_EEXPRS);
     }; break;
     case EEXPR_ELLIPSIS: {
-      eexpr* before, *after; eexpr_asEllipsis(x, &before, &after);
-      fprintf(fp, "\n%*s, \"type\":\"ellipsis\"", indent, "");
-      fprintf(fp, "\n%*s, \"before\":", indent, "");
-      if (before == NULL) {
-        fprintf(fp, "null");
-      }
-      else {
-        fprintf(fp, "\n%*s", indent+2, "");
-        fdumpEexpr(fp, indent+2, before);
-      }
-      fprintf(fp, "\n%*s, \"after\":", indent, "");
-      if (after == NULL) {
-        fprintf(fp, "null");
-      }
-      else {
-        fprintf(fp, "\n%*s", indent+2, "");
-        fdumpEexpr(fp, indent+2, after);
-      }
+      eexpr_asEllipsis(x, &out->pair[0], &out->pair[1]);
+      out->type = "ellipsis";
+      out->n = 2;
+      setField(&out->fields[0], "before", FIELD_MAYBE_EEXPR);
+      out->fields[0].subexprs = &out->pair[0];
+      setField(&out->fields[1], "after", FIELD_MAYBE_EEXPR);
+      out->fields[1].subexprs = &out->pair[1];
     }; break;
     case EEXPR_COLON: {
-      eexpr* before, *after; eexpr_asColon(x, &before, &after);
-      fprintf(fp, "\n%*s, \"type\":\"colon\",\"subexprs\":\n%*s[ ", indent, "", indent+2, "");
-      fdumpEexpr(fp, indent+4, before);
-      fprintf(fp, "\n%*s, ", indent+2, "");
-      fdumpEexpr(fp, indent+4, after);
-      fprintf(fp, "\n%*s]", indent+2, "");
+      eexpr_asColon(x, &out->pair[0], &out->pair[1]);
+      out->type = "colon";
+      setField(f, "subexprs", FIELD_EEXPRS);
+      f->n = 2;
+      f->subexprs = out->pair;
     }; break;
     case EEXPR_COMMA: {
-      size_t n; eexpr** ys; eexpr_asComma(x, &n, &ys);
-      fprintf(fp, "\n%*s, \"type\":\"comma\",\"subexprs\":", indent, "");
-      fdumpEexprArray(fp, indent+2, n, ys);
+      eexpr_asComma(x, &f->n, &f->subexprs);
+      out->type = "comma";
+      setField(f, "subexprs", FIELD_EEXPRS);
     }; break;
     case EEXPR_SEMICOLON: {
-      size_t n; eexpr** ys; eexpr_asSemicolon(x, &n, &ys);
-      fprintf(fp, "\n%*s, \"type\":\"semicolon\",\"subexprs\":", indent, "");
-      fdumpEexprArray(fp, indent+2, n, ys);
+      eexpr_asSemicolon(x, &f->n, &f->subexprs);
+      out->type = "semicolon";
+      setField(f, "subexprs", FIELD_EEXPRS);
+    }; break;
+    case EEXPR_MIXFIX: {
+      out->type = "mixfix";
+      out->n = 2;
+      setField(&out->fields[0], "operator", FIELD_OPERATOR);
+      setField(&out->fields[1], "subexprs", FIELD_EEXPRS);
+      eexpr_asMixfix(x, &out->fields[0].op, &out->fields[1].n, &out->fields[1].subexprs);
     }; break;
   }
+}
+
+void fdumpEexpr(FILE* fp, const eexpr_lineIndex* lines, int indent, const eexpr* x) {
+  fprintf(fp, "{ \"loc\":");
+  fdumpLoc(fp, lines, jsonSpanOf(x));
+  eexprFields e; eexprFieldsOf(&e, x);
+  fprintf(fp, "\n%*s, \"type\":\"%s\"", indent, "", e.type);
+  for (size_t k = 0; k < e.n; ++k) {
+    const eexprField* f = &e.fields[k];
+    // optional subexprs each start their own line when there are more than one (i.e. in an ellipsis)
+    if (f->type == FIELD_MAYBE_EEXPR && e.n != 1) { fprintf(fp, "\n%*s, \"%s\":", indent, "", f->name); }
+    else if (f->type != FIELD_NUMBER) { fprintf(fp, ",\"%s\":", f->name); }
+    switch (f->type) {
+      case FIELD_TEXT: fdumpStrn(fp, f->nBytes, (uint8_t*)f->text); break;
+      case FIELD_NUMBER: fdumpNumber(fp, &e.number); break;
+      case FIELD_TEMPLATE: {
+        const eexpr_string* s = &e.string;
+        fprintf(fp, "\n%*s[ ", indent+2, "");
+        fdumpStrn(fp, s->head.nBytes, s->head.utf8str);
+        for (size_t i = 0; i < s->nSubexprs; ++i) {
+          fprintf(fp, "\n%*s, ", indent+2, "");
+          if (s->tail[i].subexpr != NULL) {
+            fdumpEexpr(fp, lines, indent+4, s->tail[i].subexpr);
+          }
+          else {
+            fprintf(fp, "null");
+          }
+          fprintf(fp, "\n%*s, ", indent+2, "");
+          fdumpStrn(fp, s->tail[i].nBytes, s->tail[i].utf8str);
+        }
+        fprintf(fp, "\n%*s]", indent+2, "");
+      }; break;
+      case FIELD_EEXPR: fdumpEexpr(fp, lines, indent+2, f->subexprs[0]); break;
+      case FIELD_MAYBE_EEXPR: {
+        if (f->subexprs[0] == NULL) {
+          fprintf(fp, "null");
+        }
+        else {
+          fprintf(fp, "\n%*s", indent+2, "");
+          fdumpEexpr(fp, lines, indent+2, f->subexprs[0]);
+        }
+      }; break;
+      case FIELD_EEXPRS: fdumpEexprArray(fp, lines, indent+2, f->n, f->subexprs); break;
+      case FIELD_OPERATOR: fdumpOperator(fp, f->op); break;
+    }
+  }
   fprintf(fp, "\n%*s}", indent, "");
 }
 
-void fdumpError(FILE* fp, const eexpr_error* err) {
-  fprintf(fp, "{\"loc\":{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}"
-         , err->loc.start.line + 1
-         , err->loc.start.col + 1
-         , err->loc.end.line + 1
-         , err->loc.end.col + 1
-         );
+const eexpr_mixfixTable* jsonMixfixes = NULL;
+
+const eexpr_span* jsonSpans = NULL;
+
+eexpr_span jsonSpanOf(const eexpr* x) {
+  if (jsonSpans == NULL) { return eexpr_getSpan(x); }
+  return *jsonSpans++;
+}
+
+void fdumpOperator(FILE* fp, uint32_t op) {
+  size_t n; const uint8_t* name;
+  if (op == EEXPR_MIXFIX_NONE) {
+    fprintf(fp, "null");
+  }
+  else if (jsonMixfixes != NULL && eexpr_mixfixTable_name(jsonMixfixes, op, &n, &name)) {
+    fdumpStrn(fp, n, (uint8_t*)name);
+  }
+  else {
+    fprintf(fp, "%"PRIu32, op);
+  }
+}
+
+const char* mixfixErrorName(eexpr_mixfixErrorType type) {
+  switch (type) {
+    case EEXPR_MIXFIX_ERR_EXPECTED_OPERAND: return "expected-operand";
+    case EEXPR_MIXFIX_ERR_EXPECTED_LITERAL: return "expected-literal";
+    case EEXPR_MIXFIX_ERR_UNEXPECTED_LITERAL: return "unexpected-literal";
+    case EEXPR_MIXFIX_ERR_NON_ASSOCIATIVE: return "non-associative";
+  }
+  assert(false);
+  return NULL;
+}
+
+void fdumpMixfixError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_mixfixError* err) {
+  fprintf(fp, "{\"loc\":");
+  fdumpLoc(fp, lines, err->loc);
+  fprintf(fp, ",\"type\":\"%s\",\"operator\":", mixfixErrorName(err->type));
+  fdumpOperator(fp, err->op);
+  fprintf(fp, "}");
+}
+
+const char* errorName(eexpr_errorType type) {
+  switch (type) {
+    case EEXPR_ERR_NOERROR: assert(false); break;
+    case EEXPR_ERR_BAD_BYTES: return "bad-bytes";
+    case EEXPR_ERR_BAD_CHAR: return "bad-char";
+    case EEXPR_ERR_MIXED_SPACE: return "mixed-space";
+    case EEXPR_ERR_MIXED_NEWLINES: return "mixed-newlines";
+    case EEXPR_ERR_BAD_DIGIT_SEPARATOR: return "bad-digit-separator";
+    case EEXPR_ERR_MISSING_EXPONENT: return "missing-exponent";
+    case EEXPR_ERR_BAD_EXPONENT_SIGN: return "bad-exponent-sign";
+    case EEXPR_ERR_BAD_ESCAPE_CHAR: return "bad-escape-char";
+    case EEXPR_ERR_BAD_ESCAPE_CODE: return "bad-escape-code";
+    case EEXPR_ERR_UNICODE_OVERFLOW: return "unicode-overflow";
+    case EEXPR_ERR_BAD_STRING_CHAR: return "bad-string-char";
+    case EEXPR_ERR_MISSING_LINE_PICKUP: return "missing-line-pickup";
+    case EEXPR_ERR_UNCLOSED_STRING: return "unclosed-string";
+    case EEXPR_ERR_UNCLOSED_MULTILINE_STRING: return "unclosed-multiline-string";
+    case EEXPR_ERR_MIXED_INDENTATION: return "mixed-indentation";
+    case EEXPR_ERR_HEREDOC_BAD_OPEN: return "heredoc-bad-open";
+    case EEXPR_ERR_HEREDOC_BAD_INDENT_DEFINITION: return "heredoc-bad-indent-definition";
+    case EEXPR_ERR_HEREDOC_BAD_INDENTATION: return "heredoc-bad-indentation";
+    case EEXPR_ERR_TRAILING_SPACE: return "trailing-space";
+    case EEXPR_ERR_NO_TRAILING_NEWLINE: return "no-trailing-newline";
+    case EEXPR_ERR_SHALLOW_INDENT: return "shallow-indent";
+    case EEXPR_ERR_OFFSIDES: return "offsides";
+    case EEXPR_ERR_BAD_DOT: return "bad-dot";
+    case EEXPR_ERR_CRAMMED_TOKENS: return "crammed-tokens";
+    case EEXPR_ERR_UNBALANCED_WRAP: return "unbalanced-wrap";
+    case EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT: return "expect-newline-or-dedent";
+    case EEXPR_ERR_MISSING_TEMPLATE_EXPR: return "missing-template-expr";
+    case EEXPR_ERR_MISSING_CLOSE_TEMPLATE: return "missing-close-template";
+    case EEXPR_ERR_LIMIT_EXCEEDED: return "limit-exceeded";
+  }
+  return "";
+}
+
+void fdumpError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_error* err) {
+  fprintf(fp, "{\"loc\":");
+  fdumpLoc(fp, lines, err->loc);
+  fprintf(fp, ",\"type\":\"%s\"", errorName(err->type));
   switch (err->type) {
     case EEXPR_ERR_NOERROR: { assert(false); }; break;
-    case EEXPR_ERR_BAD_BYTES: {
-      fprintf(fp, ",\"type\":\"bad-bytes\"");
-    }; break;
+    case EEXPR_ERR_BAD_BYTES: break;
     case EEXPR_ERR_BAD_CHAR: {
-      fprintf(fp, ",\"type\":\"bad-char\",\"input\":");
+      fprintf(fp, ",\"input\":");
       fdumpChar(fp, err->as.badChar);
     }; break;
-    case EEXPR_ERR_MIXED_SPACE: {
-      fprintf(fp, ",\"type\":\"mixed-space\"");
-    }; break;
-    case EEXPR_ERR_MIXED_NEWLINES: {
-      fprintf(fp, ",\"type\":\"mixed-newlines\"");
-    }; break;
-    case EEXPR_ERR_BAD_DIGIT_SEPARATOR: {
-      fprintf(fp, ",\"type\":\"bad-digit-separator\"");
-    }; break;
-    case EEXPR_ERR_MISSING_EXPONENT: {
-      fprintf(fp, ",\"type\":\"missing-exponent\"");
-    }; break;
-    case EEXPR_ERR_BAD_EXPONENT_SIGN: {
-      fprintf(fp, ",\"type\":\"bad-exponent-sign\"");
-    }; break;
+    case EEXPR_ERR_MIXED_SPACE: break;
+    case EEXPR_ERR_MIXED_NEWLINES: break;
+    case EEXPR_ERR_BAD_DIGIT_SEPARATOR: break;
+    case EEXPR_ERR_MISSING_EXPONENT: break;
+    case EEXPR_ERR_BAD_EXPONENT_SIGN: break;
     case EEXPR_ERR_BAD_ESCAPE_CHAR: {
-      fprintf(fp, ",\"type\":\"bad-escape-char\",\"input\":");
+      fprintf(fp, ",\"input\":");
       fdumpChar(fp, err->as.badEscapeChar);
     }; break;
     case EEXPR_ERR_BAD_ESCAPE_CODE: {
-      fprintf(fp, ",\"type\":\"bad-escape-code\",\"input\":\"");
+      fprintf(fp, ",\"input\":\"");
       for (size_t i = 0; i < 6; ++i) {
         fjsonEscapeChar(fp, err->as.badEscapeCode[i]);
       }
       fprintf(fp, "\"");
     }; break;
     case EEXPR_ERR_UNICODE_OVERFLOW: {
-      fprintf(fp, ",\"type\":\"unicode-overflow\",\"value\":%"PRIi32, err->as.unicodeOverflow);
+      fprintf(fp, ",\"value\":%"PRIi32, err->as.unicodeOverflow);
     }; break;
     case EEXPR_ERR_BAD_STRING_CHAR: {
-      fprintf(fp, ",\"type\":\"bad-string-char\",\"input\":");
+      fprintf(fp, ",\"input\":");
       fdumpChar(fp, err->as.badStringChar);
     }; break;
-    case EEXPR_ERR_MISSING_LINE_PICKUP: {
-      fprintf(fp, ",\"type\":\"missing-line-pickup\"");
-    }; break;
-    case EEXPR_ERR_UNCLOSED_STRING: {
-      fprintf(fp, ",\"type\":\"unclosed-string\"");
-    }; break;
-    case EEXPR_ERR_UNCLOSED_MULTILINE_STRING: {
-      fprintf(fp, ",\"type\":\"unclosed-multiline-string\"");
-    }; break;
+    case EEXPR_ERR_MISSING_LINE_PICKUP: break;
+    case EEXPR_ERR_UNCLOSED_STRING: break;
+    case EEXPR_ERR_UNCLOSED_MULTILINE_STRING: break;
     case EEXPR_ERR_MIXED_INDENTATION: {
-      fprintf(fp, ",\"type\":\"mixed-indentation\",\"established\":{\"type\":");
+      fprintf(fp, ",\"established\":{\"type\":");
       switch (err->as.mixedIndentation.establishedType) {
         case EEXPR_INDENT_SPACES: fdumpChar(fp, ' '); break;
         case EEXPR_INDENT_TABS: fdumpChar(fp, '\t'); break;
         case EEXPR_INDENT_NULL: assert(false); break;
       }
-      fprintf(fp, ",\"loc\":{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}}"
-         , err->as.mixedIndentation.establishedAt.start.line + 1
-         , err->as.mixedIndentation.establishedAt.start.col + 1
-         , err->as.mixedIndentation.establishedAt.end.line + 1
-         , err->as.mixedIndentation.establishedAt.end.col + 1
-         );
-    }; break;
-    case EEXPR_ERR_HEREDOC_BAD_OPEN: {
-      fprintf(fp, ",\"type\":\"heredoc-bad-open\"");
-    }; break;
-    case EEXPR_ERR_HEREDOC_BAD_INDENT_DEFINITION: {
-      fprintf(fp, ",\"type\":\"heredoc-bad-indent-definition\"");
-    }; break;
-    case EEXPR_ERR_HEREDOC_BAD_INDENTATION: {
-      fprintf(fp, ",\"type\":\"heredoc-bad-indentation\"");
-    }; break;
-    case EEXPR_ERR_TRAILING_SPACE: {
-      fprintf(fp, ",\"type\":\"trailing-space\"");
-    }; break;
-    case EEXPR_ERR_NO_TRAILING_NEWLINE: {
-      fprintf(fp, ",\"type\":\"no-trailing-newline\"");
-    }; break;
-    case EEXPR_ERR_SHALLOW_INDENT: {
-      fprintf(fp, ",\"type\":\"shallow-indent\"");
-    }; break;
-    case EEXPR_ERR_OFFSIDES: {
-      fprintf(fp, ",\"type\":\"offsides\"");
-    }; break;
-    case EEXPR_ERR_BAD_DOT: {
-      fprintf(fp, ",\"type\":\"bad-dot\"");
-    }; break;
-    case EEXPR_ERR_CRAMMED_TOKENS: {
-      fprintf(fp, ",\"type\":\"crammed-tokens\"");
-    }; break;
+      fprintf(fp, ",\"loc\":");
+      fdumpLoc(fp, lines, err->as.mixedIndentation.establishedAt);
+      fprintf(fp, "}");
+    }; break;
+    case EEXPR_ERR_HEREDOC_BAD_OPEN: break;
+    case EEXPR_ERR_HEREDOC_BAD_INDENT_DEFINITION: break;
+    case EEXPR_ERR_HEREDOC_BAD_INDENTATION: break;
+    case EEXPR_ERR_TRAILING_SPACE: break;
+    case EEXPR_ERR_NO_TRAILING_NEWLINE: break;
+    case EEXPR_ERR_SHALLOW_INDENT: break;
+    case EEXPR_ERR_OFFSIDES: break;
+    case EEXPR_ERR_BAD_DOT: break;
+    case EEXPR_ERR_CRAMMED_TOKENS: break;
     case EEXPR_ERR_UNBALANCED_WRAP: {
-      fprintf(fp, ",\"type\":\"unbalanced-wrap\"");
       if (err->as.unbalancedWrap.type != EEXPR_WRAP_NULL) {
         fprintf(fp, ",\"unclosed\":{\"open\":\"%s\"", wrapName(err->as.unbalancedWrap.type));
-        fprintf(fp, ",\"loc\":{\"from\":{\"line\":%zu,\"col\":%zu},\"to\":{\"line\":%zu,\"col\":%zu}}}"
-           , err->as.unbalancedWrap.loc.start.line + 1
-           , err->as.unbalancedWrap.loc.start.col + 1
-           , err->as.unbalancedWrap.loc.end.line + 1
-           , err->as.unbalancedWrap.loc.end.col + 1
-           );
+        fprintf(fp, ",\"loc\":");
+        fdumpLoc(fp, lines, err->as.unbalancedWrap.loc);
+        fprintf(fp, "}");
       }
       else {
         fprintf(fp, ",\"unopened\":true}");
       }
     }; break;
-    case EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT: {
-      fprintf(fp, ",\"type\":\"expect-newline-or-dedent\"");
-    }; break;
-    case EEXPR_ERR_MISSING_TEMPLATE_EXPR: {
-      fprintf(fp, ",\"type\":\"missing-template-expr\"");
-    }; break;
-    case EEXPR_ERR_MISSING_CLOSE_TEMPLATE: {
-      fprintf(fp, ",\"type\":\"missing-close-template\"");
+    case EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT: break;
+    case EEXPR_ERR_MISSING_TEMPLATE_EXPR: break;
+    case EEXPR_ERR_MISSING_CLOSE_TEMPLATE: break;
+    case EEXPR_ERR_LIMIT_EXCEEDED: {
+      fprintf(fp, ",\"limit\":\"%s\"", limitName(err->as.limitExceeded));
     }; break;
   }
   fprintf(fp, "}");
 }
 
-void fdumpTokenArray(FILE* fp, const char* indent, size_t n, eexpr_token** arr) {
+void fdumpTokenArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_token** arr) {
   if (n == 0) {
     fprintf(fp, " []");
   }
@@ -519,14 +642,14 @@ void fdumpTokenArray(FILE* fp, const char* indent, size_t n, eexpr_token** arr)
     char* separator = "[ ";
     for (size_t i = 0; i < n; ++i) {
       fprintf(fp, "\n%s%s", indent, separator);
-      fdumpToken(fp, arr[i]);
+      fdumpToken(fp, lines, arr[i]);
       separator = ", ";
     }
     fprintf(fp, "\n%s]", indent);
   }
 }
 
-void fdumpEexprArray(FILE* fp, int indent, size_t n, eexpr** xs) {
+void fdumpEexprArray(FILE* fp, const eexpr_lineIndex* lines, int indent, size_t n, eexpr** xs) {
   if (n == 0) {
     fprintf(fp, "[]");
   }
@@ -534,14 +657,29 @@ void fdumpEexprArray(FILE* fp, int indent, size_t n, eexpr** xs) {
     char* separator = "[ ";
     for (size_t i = 0; i < n; ++i) {
       fprintf(fp, "\n%*s%s", indent, "", separator);
-      fdumpEexpr(fp, indent + 2, xs[i]);
+      fdumpEexpr(fp, lines, indent + 2, xs[i]);
       separator = ", ";
     }
     fprintf(fp, "\n%*s]", indent, "");
   }
 }
 
-void fdumpErrorArray(FILE* fp, const char* indent, size_t n, eexpr_error* arr) {
+void fdumpErrorArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_error* arr) {
+  if (n == 0) {
+    fprintf(fp, " []");
+  }
+  else {
+    char* separator = "[ ";
+    for (size_t i = 0; i < n; ++i) {
+      fprintf(fp, "\n%s%s", indent, separator);
+      fdumpError(fp, lines, &arr[i]);
+      separator = ", ";
+    }
+    fprintf(fp, "\n%s]", indent);
+  }
+}
+
+void fdumpMixfixErrorArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_mixfixError* arr) {
   if (n == 0) {
     fprintf(fp, " []");
   }
@@ -549,7 +687,7 @@ void fdumpErrorArray(FILE* fp, const char* indent, size_t n, eexpr_error* arr) {
     char* separator = "[ ";
     for (size_t i = 0; i < n; ++i) {
       fprintf(fp, "\n%s%s", indent, separator);
-      fdumpError(fp, &arr[i]);
+      fdumpMixfixError(fp, lines, &arr[i]);
       separator = ", ";
     }
     fprintf(fp, "\n%s]", indent);
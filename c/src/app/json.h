@@ -10,13 +10,65 @@
 
 void fdumpStr(FILE* fp, str text);
 void fdumpCStr(FILE* fp, char* s);
+void fdumpStrn(FILE* fp, size_t nBytes, uint8_t* utf8str);
+void fdumpLoc(FILE* fp, const eexpr_lineIndex* lines, eexpr_span span);
 
-void fdumpToken(FILE* fp, const eexpr_token* tok);
-void fdumpError(FILE* fp, const eexpr_error* err);
+// Locations are resolved to line/col with `lines`.
+void fdumpToken(FILE* fp, const eexpr_lineIndex* lines, const eexpr_token* tok);
+void fdumpError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_error* err);
 
-void fdumpTokenArray(FILE* fp, const char* indent, size_t n, eexpr_token** arr);
-void fdumpEexprArray(FILE* fp, int indent, size_t n, eexpr** xs);
-void fdumpErrorArray(FILE* fp, const char* indent, size_t n, eexpr_error* arr);
+// the name used for the `"type"` field of errors
+const char* errorName(eexpr_errorType type);
+// the names used for wrap families and resource limits in errors
+const char* wrapName(eexpr_wrapType type);
+const char* limitName(eexpr_limitType type);
+
+/*
+What an eexpr is written as (besides its `"loc"`), shared by the json and CBOR outputs so that they walk eexprs the same way:
+  the name for its `"type"` field, and its other fields in order.
+The outputs differ only in how they write each kind of field.
+*/
+typedef enum eexprFieldType {
+  FIELD_TEXT, // `.nBytes` and `.text`
+  FIELD_NUMBER, // `eexprFields.number`, written as one or more fields as each output sees fit
+  FIELD_TEMPLATE, // `eexprFields.string`, which has subexprs
+  FIELD_EEXPR, // `.subexprs[0]`
+  FIELD_MAYBE_EEXPR, // `.subexprs[0]`, which may be NULL
+  FIELD_EEXPRS, // `.n` and `.subexprs`
+  FIELD_OPERATOR // `.op`, a mixfix operator (see `jsonMixfixes`)
+} eexprFieldType;
+typedef struct eexprField {
+  const char* name;
+  eexprFieldType type;
+  size_t nBytes; const uint8_t* text;
+  size_t n; eexpr** subexprs;
+  uint32_t op;
+} eexprField;
+typedef struct eexprFields {
+  const char* type;
+  size_t n;
+  eexprField fields[2];
+  eexpr_number number;
+  eexpr_string string;
+  eexpr* pair[2]; // the subexprs of a colon or ellipsis
+} eexprFields;
+void eexprFieldsOf(eexprFields* out, const eexpr* x);
+
+void fdumpTokenArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_token** arr);
+void fdumpEexprArray(FILE* fp, const eexpr_lineIndex* lines, int indent, size_t n, eexpr** xs);
+void fdumpErrorArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_error* arr);
+
+// When set, mixfix operators are written by name rather than by index.
+extern const eexpr_mixfixTable* jsonMixfixes;
+// When set, the locations of eexprs are taken from here (one per eexpr written, advancing as they are), rather than from the eexprs themselves.
+// This is for eexprs parsed with `eexpr_parser.shared`, which only know the span of their first occurrence (see `eexpr_parser.spans`).
+extern const eexpr_span* jsonSpans;
+eexpr_span jsonSpanOf(const eexpr* x);
+void fdumpOperator(FILE* fp, uint32_t op);
+// the name used for the `"type"` field of mixfix rewriting errors
+const char* mixfixErrorName(eexpr_mixfixErrorType type);
+void fdumpMixfixError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_mixfixError* err);
+void fdumpMixfixErrorArray(FILE* fp, const eexpr_lineIndex* lines, const char* indent, size_t n, eexpr_mixfixError* arr);
 
 
 #endif
@@ -0,0 +1,319 @@
+#include "jsonRead.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+#define TYPE jsonValue
+#include "dynarr.h"
+#define TYPE jsonMember
+#include "dynarr.h"
+
+
+typedef struct reader {
+  const uint8_t* here;
+  const uint8_t* end;
+} reader;
+
+static bool readValue(reader* st, jsonValue* out, int depth);
+
+// nesting beyond this is rejected rather than risking the C stack
+#define MAX_DEPTH 512
+
+
+static void skipSpace(reader* st) {
+  while (st->here < st->end) {
+    switch (*st->here) {
+      case ' ': case '\t': case '\n': case '\r': st->here++; break;
+      default: return;
+    }
+  }
+}
+
+static bool expectLiteral(reader* st, const char* lit) {
+  size_t len = strlen(lit);
+  if ((size_t)(st->end - st->here) < len) { return false; }
+  if (memcmp(st->here, lit, len) != 0) { return false; }
+  st->here += len;
+  return true;
+}
+
+static int hexDigit(uint8_t c) {
+  if ('0' <= c && c <= '9') { return c - '0'; }
+  if ('a' <= c && c <= 'f') { return c - 'a' + 10; }
+  if ('A' <= c && c <= 'F') { return c - 'A' + 10; }
+  return -1;
+}
+
+static bool readHex4(reader* st, char32_t* out) {
+  if (st->end - st->here < 4) { return false; }
+  char32_t c = 0;
+  for (int i = 0; i < 4; ++i) {
+    int d = hexDigit(st->here[i]);
+    if (d < 0) { return false; }
+    c = (c << 4) | (char32_t)d;
+  }
+  st->here += 4;
+  *out = c;
+  return true;
+}
+
+static void appendUtf8(strBuilder* buf, char32_t c) {
+  utf8Char enc = encodeUchar(c);
+  str tmp = {.len = enc.nbytes, .bytes = enc.codeunits};
+  strBuilder_append(buf, tmp);
+}
+
+// expects the opening quote to be the next byte
+static bool readString(reader* st, str* out) {
+  st->here++;
+  strBuilder buf = strBuilder_new(16);
+  while (st->here < st->end) {
+    // copy unescaped runs in one go
+    const uint8_t* start = st->here;
+    while (st->here < st->end && *st->here != '\"' && *st->here != '\\' && *st->here >= 0x20) {
+      st->here++;
+    }
+    str run = {.len = st->here - start, .bytes = (uint8_t*)start};
+    strBuilder_append(&buf, run);
+    if (st->here == st->end || *st->here < 0x20) { break; }
+    if (*st->here == '\"') {
+      st->here++;
+      out->len = buf.len;
+      out->bytes = buf.bytes;
+      return true;
+    }
+    // escape sequence
+    st->here++;
+    if (st->here == st->end) { break; }
+    char32_t c;
+    switch (*st->here++) {
+      case '\"': c = '\"'; break;
+      case '\\': c = '\\'; break;
+      case '/': c = '/'; break;
+      case 'b': c = '\b'; break;
+      case 'f': c = '\f'; break;
+      case 'n': c = '\n'; break;
+      case 'r': c = '\r'; break;
+      case 't': c = '\t'; break;
+      case 'u': {
+        if (!readHex4(st, &c)) { goto fail; }
+        if (0xD800 <= c && c < 0xDC00) {
+          // combine a utf-16 surrogate pair, if there is one
+          char32_t lo;
+          reader save = *st;
+          if (expectLiteral(st, "\\u") && readHex4(st, &lo) && 0xDC00 <= lo && lo < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+          }
+          else {
+            *st = save;
+            c = 0xFFFD;
+          }
+        }
+        else if (0xDC00 <= c && c < 0xE000) {
+          c = 0xFFFD;
+        }
+      }; break;
+      default: goto fail;
+    }
+    appendUtf8(&buf, c);
+  }
+  fail:
+  free(buf.bytes);
+  return false;
+}
+
+static bool readNumber(reader* st, double* out) {
+  // strtod is more permissive than json, so validate the syntax first
+  const uint8_t* start = st->here;
+  const uint8_t* p = st->here;
+  if (p < st->end && *p == '-') { p++; }
+  if (p == st->end || *p < '0' || '9' < *p) { return false; }
+  if (*p == '0') { p++; }
+  else { while (p < st->end && '0' <= *p && *p <= '9') { p++; } }
+  if (p < st->end && *p == '.') {
+    p++;
+    if (p == st->end || *p < '0' || '9' < *p) { return false; }
+    while (p < st->end && '0' <= *p && *p <= '9') { p++; }
+  }
+  if (p < st->end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < st->end && (*p == '+' || *p == '-')) { p++; }
+    if (p == st->end || *p < '0' || '9' < *p) { return false; }
+    while (p < st->end && '0' <= *p && *p <= '9') { p++; }
+  }
+  size_t len = p - start;
+  char small[64];
+  char* buf = len < sizeof(small) ? small : malloc(len + 1);
+  checkOom(buf);
+  memcpy(buf, start, len);
+  buf[len] = '\0';
+  *out = strtod(buf, NULL);
+  if (buf != small) { free(buf); }
+  st->here = p;
+  return true;
+}
+
+static bool readArray(reader* st, jsonValue* out, int depth) {
+  st->here++;
+  dynarr_jsonValue items; dynarr_init_jsonValue(&items, 4);
+  skipSpace(st);
+  if (st->here < st->end && *st->here == ']') {
+    st->here++;
+    goto done;
+  }
+  while (true) {
+    jsonValue item;
+    if (!readValue(st, &item, depth + 1)) { goto fail; }
+    dynarr_push_jsonValue(&items, &item);
+    skipSpace(st);
+    if (st->here == st->end) { goto fail; }
+    if (*st->here == ',') { st->here++; continue; }
+    if (*st->here == ']') { st->here++; break; }
+    goto fail;
+  }
+  done:
+  out->type = JSON_ARRAY;
+  out->as.array.len = items.len;
+  out->as.array.items = items.data;
+  return true;
+  fail:
+  for (size_t i = 0; i < items.len; ++i) {
+    jsonValue_deinit(&items.data[i]);
+  }
+  dynarr_deinit_jsonValue(&items);
+  return false;
+}
+
+static bool readObject(reader* st, jsonValue* out, int depth) {
+  st->here++;
+  dynarr_jsonMember members; dynarr_init_jsonMember(&members, 4);
+  skipSpace(st);
+  if (st->here < st->end && *st->here == '}') {
+    st->here++;
+    goto done;
+  }
+  while (true) {
+    jsonMember member;
+    skipSpace(st);
+    if (st->here == st->end || *st->here != '\"') { goto fail; }
+    if (!readString(st, &member.key)) { goto fail; }
+    skipSpace(st);
+    if (st->here == st->end || *st->here != ':') { free(member.key.bytes); goto fail; }
+    st->here++;
+    if (!readValue(st, &member.value, depth + 1)) { free(member.key.bytes); goto fail; }
+    dynarr_push_jsonMember(&members, &member);
+    skipSpace(st);
+    if (st->here == st->end) { goto fail; }
+    if (*st->here == ',') { st->here++; continue; }
+    if (*st->here == '}') { st->here++; break; }
+    goto fail;
+  }
+  done:
+  out->type = JSON_OBJECT;
+  out->as.object.len = members.len;
+  out->as.object.members = members.data;
+  return true;
+  fail:
+  for (size_t i = 0; i < members.len; ++i) {
+    free(members.data[i].key.bytes);
+    jsonValue_deinit(&members.data[i].value);
+  }
+  dynarr_deinit_jsonMember(&members);
+  return false;
+}
+
+static bool readValue(reader* st, jsonValue* out, int depth) {
+  out->type = JSON_NULL;
+  if (depth > MAX_DEPTH) { return false; }
+  skipSpace(st);
+  if (st->here == st->end) { return false; }
+  switch (*st->here) {
+    case 'n': return expectLiteral(st, "null");
+    case 't': {
+      if (!expectLiteral(st, "true")) { return false; }
+      out->type = JSON_BOOL;
+      out->as.boolean = true;
+      return true;
+    }
+    case 'f': {
+      if (!expectLiteral(st, "false")) { return false; }
+      out->type = JSON_BOOL;
+      out->as.boolean = false;
+      return true;
+    }
+    case '\"': {
+      if (!readString(st, &out->as.string)) { return false; }
+      out->type = JSON_STRING;
+      return true;
+    }
+    case '[': return readArray(st, out, depth);
+    case '{': return readObject(st, out, depth);
+    default: {
+      if (!readNumber(st, &out->as.number)) { return false; }
+      out->type = JSON_NUMBER;
+      return true;
+    }
+  }
+}
+
+bool jsonParse(jsonValue* out, str in) {
+  reader st = {.here = in.bytes, .end = in.bytes + in.len};
+  if (!readValue(&st, out, 0)) { return false; }
+  skipSpace(&st);
+  if (st.here != st.end) {
+    jsonValue_deinit(out);
+    return false;
+  }
+  return true;
+}
+
+void jsonValue_deinit(jsonValue* self) {
+  switch (self->type) {
+    case JSON_NULL: break;
+    case JSON_BOOL: break;
+    case JSON_NUMBER: break;
+    case JSON_STRING: {
+      free(self->as.string.bytes);
+    }; break;
+    case JSON_ARRAY: {
+      for (size_t i = 0; i < self->as.array.len; ++i) {
+        jsonValue_deinit(&self->as.array.items[i]);
+      }
+      free(self->as.array.items);
+    }; break;
+    case JSON_OBJECT: {
+      for (size_t i = 0; i < self->as.object.len; ++i) {
+        free(self->as.object.members[i].key.bytes);
+        jsonValue_deinit(&self->as.object.members[i].value);
+      }
+      free(self->as.object.members);
+    }; break;
+  }
+  self->type = JSON_NULL;
+}
+
+const jsonValue* jsonGet(const jsonValue* self, const char* key) {
+  if (self == NULL || self->type != JSON_OBJECT) { return NULL; }
+  size_t len = strlen(key);
+  for (size_t i = 0; i < self->as.object.len; ++i) {
+    const jsonMember* member = &self->as.object.members[i];
+    if (member->key.len == len && memcmp(member->key.bytes, key, len) == 0) {
+      return &member->value;
+    }
+  }
+  return NULL;
+}
+
+bool jsonAsString(const jsonValue* self, str* out) {
+  if (self == NULL || self->type != JSON_STRING) { return false; }
+  *out = self->as.string;
+  return true;
+}
+
+bool jsonAsNumber(const jsonValue* self, double* out) {
+  if (self == NULL || self->type != JSON_NUMBER) { return false; }
+  *out = self->as.number;
+  return true;
+}
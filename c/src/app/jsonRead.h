@@ -0,0 +1,66 @@
+#ifndef APP_JSONREAD_H
+#define APP_JSONREAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "strstuff.h"
+
+/*
+A small reader for json values.
+This is only what the language server needs to understand incoming messages;
+  it builds a malloc-backed tree, and makes no attempt at streaming or at reporting where a syntax error is.
+*/
+
+typedef enum jsonType {
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+} jsonType;
+
+typedef struct jsonValue jsonValue;
+typedef struct jsonMember jsonMember;
+
+struct jsonValue {
+  jsonType type;
+  union jsonData {
+    bool boolean;
+    double number;
+    str string; // owned, escapes already decoded
+    struct jsonArray {
+      size_t len;
+      jsonValue* items; // owned
+    } array;
+    struct jsonObject {
+      size_t len;
+      jsonMember* members; // owned
+    } object;
+  } as;
+};
+
+struct jsonMember {
+  str key; // owned
+  jsonValue value;
+};
+
+
+// Parse the entirety of `in` as a single json value (surrounding whitespace allowed).
+// On failure, returns false and `out` is left as a json null.
+bool jsonParse(jsonValue* out, str in);
+
+// Recursively free the data owned by the value, leaving it as a json null.
+void jsonValue_deinit(jsonValue* self);
+
+// Look up a member of an object by key.
+// Returns NULL if `self` is NULL, not an object, or has no such member.
+const jsonValue* jsonGet(const jsonValue* self, const char* key);
+
+// Convenience accessors that check the type of (possibly NULL) values.
+bool jsonAsString(const jsonValue* self, str* out);
+bool jsonAsNumber(const jsonValue* self, double* out);
+
+
+#endif
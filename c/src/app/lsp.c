@@ -0,0 +1,1520 @@
+// open_memstream is POSIX rather than C11
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "common.h"
+#include "json.h"
+#include "jsonRead.h"
+#include "strstuff.h"
+
+/*
+A language server for eexprs, speaking the Language Server Protocol over stdio.
+
+The main thread only reads messages, edits document text, and answers from already-computed results.
+All lexing and parsing happens on a single worker thread, which waits for a document to go quiet (debouncing) before re-analyzing it.
+Analysis works on a snapshot of the document, so edits can keep arriving while the worker is busy.
+Once a snapshot is analyzed, the worker publishes diagnostics and answers any requests that were waiting for a fresh result.
+
+Everything shared between the threads is guarded by the one `server.lock`;
+  the lock is also held while writing messages so that they go out whole and in order.
+*/
+
+void die(const char* msg) {
+  fprintf(stderr, "%s\n", msg);
+  exit(1);
+}
+
+// json-rpc error codes
+#define RPC_PARSE_ERROR -32700
+#define RPC_INVALID_REQUEST -32600
+#define RPC_METHOD_NOT_FOUND -32601
+#define RPC_INVALID_PARAMS -32602
+#define RPC_SERVER_NOT_INITIALIZED -32002
+
+// semantic token legend; indices must match `semanticTokenType`
+static const char* tokenLegend[] = {"comment", "string", "number", "variable", "operator"};
+
+// symbol kinds from the protocol
+#define SYMBOL_KIND_OBJECT 19
+#define SYMBOL_KIND_KEY 20
+
+
+//////////////////////////////////// Data Structures ////////////////////////////////////
+
+typedef enum requestKind {
+  REQ_SEMANTIC_TOKENS,
+  REQ_DOCUMENT_SYMBOLS
+} requestKind;
+
+typedef struct pendingRequest {
+  char* id; // owned, already serialized as json
+  requestKind kind;
+  uint64_t revision; // answer once analysis has caught up to this revision
+} pendingRequest;
+
+// Json fragments computed by the worker.
+// Each is NULL until computed, and otherwise a malloc'd NUL-terminated string.
+typedef struct analysis {
+  char* diagnostics;
+  char* semanticTokens;
+  char* symbols;
+} analysis;
+
+// Positions in the protocol are zero-based lines and utf-16 code unit offsets into the line.
+typedef struct position {
+  size_t line;
+  size_t character;
+} position;
+
+/*
+Analysis results are kept per chunk of the document, so that after an edit only the chunks around it need to be analyzed again (see `reanalyze`).
+A chunk is a top-level eexpr together with any comments and blank lines after it, and always starts at the start of a line.
+Each chunk holds its share of the results as json fragments, which are joined into whole results after every analysis.
+Positions in a fragment are as of when it was written;
+  when an edit moves a chunk to other lines, its line numbers are rewritten as the fragments are joined (see `lineRef`).
+*/
+
+// A line number in a fragment.
+typedef struct lineRef {
+  size_t at; // byte offset of the number in the fragment's text
+  size_t len; // length of the number as written
+  size_t line; // the number as written
+} lineRef;
+
+#define TYPE lineRef
+#include "dynarr.h"
+
+typedef struct fragment {
+  char* text; // owned, NUL-terminated; NULL if there is no result
+  size_t len;
+  dynarr_lineRef lines;
+} fragment;
+
+typedef struct chunk {
+  size_t start; // byte offset into the document
+  size_t line; // the line that `start` is on
+  size_t writtenLine; // `line` when the fragments were written
+  // Semantic tokens are positioned relative to the token before, which for the first token in a chunk is in another chunk.
+  // So `tokens` starts with the length of the first token, and its position is kept here instead.
+  size_t nTokens;
+  position firstToken;
+  position lastToken;
+  fragment tokens;
+  // comma-separated json objects, without the enclosing brackets
+  fragment errors;
+  fragment warnings;
+  fragment symbols; // no result if the chunk could not be parsed
+} chunk;
+
+#define TYPE chunk
+#include "dynarr.h"
+
+// What the worker keeps from one analysis of a document to the next.
+typedef struct analysisCache {
+  dynarr_chunk chunks; // empty if there is nothing to re-use
+  size_t textLen; // length of the text the chunks are for
+  size_t parsedFrom, parsedTo; // the bytes that the latest analysis parsed (only for `--check-incremental`)
+} analysisCache;
+
+// The bytes changed since the last snapshot, as [from, to) in the current text.
+typedef struct editRange {
+  bool any;
+  size_t from;
+  size_t to;
+} editRange;
+
+#define TYPE size_t
+#include "dynarr.h"
+#define TYPE pendingRequest
+#include "dynarr.h"
+
+typedef struct document {
+  str uri; // owned
+  int64_t version; // as given by the client
+  uint64_t revision; // bumped on every change to the text
+  strBuilder text;
+  dynarr_size_t lines; // byte offset of the start of each line
+  struct timespec changedAt;
+  editRange edits;
+  // analysis state
+  uint64_t analyzedRevision;
+  int64_t analyzedVersion;
+  bool busy; // the worker is analyzing a snapshot of this document
+  bool closed; // closed while busy; the worker is responsible for deleting it
+  analysis results;
+  analysisCache cache; // only used by the worker
+  dynarr_pendingRequest pending;
+} document;
+
+typedef document* document_p;
+#define TYPE document_p
+#include "dynarr.h"
+
+typedef struct server {
+  mtx_t lock;
+  cnd_t wake; // signals the worker that there may be new work
+  cnd_t idle; // signals that the worker has finished analyzing something
+  thrd_t worker;
+  dynarr_document_p docs;
+  long debounceMs;
+  bool initialized;
+  bool shutdown;
+  bool flushing; // analyze immediately, ignoring the debounce timer
+  bool checkIncremental; // see `parseOpts`
+  bool quit;
+} server;
+
+// a read-only copy of the document the worker can analyze without holding the lock
+typedef struct snapshot {
+  str text;
+  size_t nLines;
+  size_t* lines; // owned copy of `document.lines`
+  editRange edits; // since the snapshot before
+  uint64_t revision;
+  int64_t version;
+} snapshot;
+
+
+//////////////////////////////////// Output ////////////////////////////////////
+
+typedef struct message {
+  FILE* fp;
+  char* buf;
+  size_t len;
+} message;
+
+static FILE* message_begin(message* msg) {
+  msg->fp = open_memstream(&msg->buf, &msg->len);
+  checkOom(msg->fp);
+  return msg->fp;
+}
+
+// finish a message and return its (owned) contents
+static char* message_end(message* msg) {
+  fclose(msg->fp);
+  return msg->buf;
+}
+
+// The caller must hold the server lock (or be the only thread running).
+static void message_send(message* msg) {
+  fclose(msg->fp);
+  fprintf(stdout, "Content-Length: %zu\r\n\r\n", msg->len);
+  fwrite(msg->buf, 1/*byte per element*/, msg->len/*elements*/, stdout);
+  fflush(stdout);
+  free(msg->buf);
+}
+
+// Writes the json fragments for a chunk.
+typedef struct fragmentWriter {
+  const snapshot* doc;
+  size_t shift; // added to a byte offset into the parser's input to get one into the document (see `analyzeRegion`)
+  message msg;
+  FILE* fp;
+  dynarr_lineRef lines;
+} fragmentWriter;
+
+static FILE* fragment_begin(fragmentWriter* w) {
+  w->lines.cap = 0;
+  w->lines.len = 0;
+  w->lines.data = NULL;
+  return w->fp = message_begin(&w->msg);
+}
+
+static fragment fragment_end(fragmentWriter* w) {
+  fragment out;
+  out.text = message_end(&w->msg);
+  out.len = w->msg.len;
+  out.lines = w->lines;
+  return out;
+}
+
+static void fragment_deinit(fragment* self) {
+  free(self->text);
+  dynarr_deinit_lineRef(&self->lines);
+}
+
+static void sendResult(const char* id, const char* result) {
+  message msg; FILE* fp = message_begin(&msg);
+  fprintf(fp, "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":%s}", id, result);
+  message_send(&msg);
+}
+
+static void sendError(const char* id, int code, const char* text) {
+  message msg; FILE* fp = message_begin(&msg);
+  fprintf(fp, "{\"jsonrpc\":\"2.0\",\"id\":%s,\"error\":{\"code\":%d,\"message\":", id, code);
+  fdumpCStr(fp, (char*)text);
+  fprintf(fp, "}}");
+  message_send(&msg);
+}
+
+static char* serializeId(const jsonValue* id) {
+  message msg; FILE* fp = message_begin(&msg);
+  if (id == NULL) {
+    fprintf(fp, "null");
+  }
+  else switch (id->type) {
+    case JSON_NUMBER: {
+      double n = id->as.number;
+      if (n == (double)(int64_t)n) { fprintf(fp, "%"PRId64, (int64_t)n); }
+      else { fprintf(fp, "%.17g", n); }
+    }; break;
+    case JSON_STRING: {
+      fdumpStr(fp, id->as.string);
+    }; break;
+    default: {
+      fprintf(fp, "null");
+    }; break;
+  }
+  return message_end(&msg);
+}
+
+
+//////////////////////////////////// Positions ////////////////////////////////////
+
+static size_t utf16Units(char32_t c) {
+  return (0x10000 <= c && c <= 0x10FFFF) ? 2 : 1;
+}
+
+static bool isNewlineByte(uint8_t c) {
+  return c == '\n' || c == '\r';
+}
+
+// Recompute line starts from line `from` onward.
+// Lines end at `\n`, `\r\n`, or `\r`, the same as the protocol.
+static void scanLines(dynarr_size_t* lines, str text, size_t from) {
+  if (from >= lines->len) { from = lines->len == 0 ? 0 : lines->len - 1; }
+  if (lines->len == 0) {
+    size_t zero = 0;
+    dynarr_push_size_t(lines, &zero);
+  }
+  lines->len = from + 1;
+  for (size_t i = lines->data[from]; i < text.len; ++i) {
+    if (text.bytes[i] == '\r') {
+      if (i + 1 < text.len && text.bytes[i+1] == '\n') { ++i; }
+    }
+    else if (text.bytes[i] != '\n') {
+      continue;
+    }
+    size_t start = i + 1;
+    dynarr_push_size_t(lines, &start);
+  }
+}
+
+// Convert a protocol position into a byte offset, clamping to the end of the line or text.
+static size_t byteOffset(str text, const size_t* lines, size_t nLines, position pos) {
+  if (pos.line >= nLines) { return text.len; }
+  str rest = {.len = text.len - lines[pos.line], .bytes = text.bytes + lines[pos.line]};
+  size_t units = 0;
+  while (rest.len != 0 && units < pos.character && !isNewlineByte(rest.bytes[0])) {
+    char32_t c;
+    size_t adv = peekUchar(&c, rest);
+    if (adv == 0) { break; }
+    units += utf16Units(c);
+    rest.len -= adv;
+    rest.bytes += adv;
+  }
+  return text.len - rest.len;
+}
+
+// Convert a byte offset into a protocol position.
+// This goes by the document's own line starts (see `scanLines`) rather than the parser's line index,
+//   which disagrees with the protocol about `\n\r` (one newline) and `\x1E` (a newline of its own).
+static position toPosition(const snapshot* doc, size_t byte) {
+  if (byte > doc->text.len) { byte = doc->text.len; }
+  // find the last line that starts at or before `byte`
+  size_t lo = 0, hi = doc->nLines;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (doc->lines[mid] <= byte) { lo = mid; }
+    else { hi = mid; }
+  }
+  position out = {.line = lo, .character = 0};
+  str rest = {.len = byte - doc->lines[lo], .bytes = doc->text.bytes + doc->lines[lo]};
+  while (rest.len != 0) {
+    char32_t c;
+    size_t adv = peekUchar(&c, rest);
+    if (adv == 0) { break; }
+    out.character += utf16Units(c);
+    rest.len -= adv;
+    rest.bytes += adv;
+  }
+  return out;
+}
+
+// The position of the end of a line (just before its newline, if any).
+static position lineEnd(const snapshot* doc, size_t line) {
+  size_t byte = doc->lines[line];
+  while (byte < doc->text.len && !isNewlineByte(doc->text.bytes[byte])) {
+    byte += 1;
+  }
+  return toPosition(doc, byte);
+}
+
+static void fdumpPosition(fragmentWriter* w, position pos) {
+  fprintf(w->fp, "{\"line\":");
+  lineRef ref = {.at = (size_t)ftell(w->fp), .line = pos.line};
+  ref.len = (size_t)fprintf(w->fp, "%zu", pos.line);
+  dynarr_push_lineRef(&w->lines, &ref);
+  fprintf(w->fp, ",\"character\":%zu}", pos.character);
+}
+
+// `span` is in the parser's input
+static void fdumpRange(fragmentWriter* w, eexpr_span span) {
+  fprintf(w->fp, "{\"start\":");
+  fdumpPosition(w, toPosition(w->doc, span.start + w->shift));
+  fprintf(w->fp, ",\"end\":");
+  fdumpPosition(w, toPosition(w->doc, span.end + w->shift));
+  fprintf(w->fp, "}");
+}
+
+
+//////////////////////////////////// Analysis ////////////////////////////////////
+
+typedef enum semanticTokenType {
+  SEM_COMMENT,
+  SEM_STRING,
+  SEM_NUMBER,
+  SEM_VARIABLE,
+  SEM_OPERATOR,
+  SEM_NONE
+} semanticTokenType;
+
+static semanticTokenType classifyToken(eexpr_tokenType type) {
+  switch (type) {
+    case EEXPR_TOK_COMMENT: return SEM_COMMENT;
+    case EEXPR_TOK_STRING: return SEM_STRING;
+    case EEXPR_TOK_NUMBER: return SEM_NUMBER;
+    case EEXPR_TOK_SYMBOL: return SEM_VARIABLE;
+    case EEXPR_TOK_COLON: return SEM_OPERATOR;
+    case EEXPR_TOK_ELLIPSIS: return SEM_OPERATOR;
+    case EEXPR_TOK_CHAIN: return SEM_OPERATOR;
+    case EEXPR_TOK_PREDOT: return SEM_OPERATOR;
+    case EEXPR_TOK_SEMICOLON: return SEM_OPERATOR;
+    case EEXPR_TOK_COMMA: return SEM_OPERATOR;
+    case EEXPR_TOK_UNKNOWN_COLON: return SEM_OPERATOR;
+    case EEXPR_TOK_UNKNOWN_DOT: return SEM_OPERATOR;
+    default: return SEM_NONE;
+  }
+}
+
+// What semantic highlighting needs from a raw token, since tokens do not outlive the rest of the parse.
+typedef struct semanticToken {
+  eexpr_span span; // in the document
+  semanticTokenType type;
+} semanticToken;
+
+#define TYPE semanticToken
+#include "dynarr.h"
+
+typedef struct semanticEncoder {
+  FILE* fp;
+  size_t nTokens;
+  position first;
+  position prev;
+} semanticEncoder;
+
+// Emit a single-line token in the protocol's relative encoding.
+// The first token is emitted without its position, see `chunk.tokens`.
+static void encodeSemantic(semanticEncoder* enc, position start, size_t len, semanticTokenType type) {
+  if (len == 0) { return; }
+  if (enc->nTokens == 0) {
+    enc->first = start;
+    fprintf(enc->fp, "%zu,%d,0", len, (int)type);
+  }
+  else {
+    size_t deltaLine = start.line - enc->prev.line;
+    size_t deltaChar = deltaLine == 0 ? start.character - enc->prev.character : start.character;
+    fprintf(enc->fp, ",%zu,%zu,%zu,%d,0", deltaLine, deltaChar, len, (int)type);
+  }
+  enc->nTokens += 1;
+  enc->prev = start;
+}
+
+static void encodeToken(semanticEncoder* enc, const snapshot* doc, const semanticToken* tok) {
+  position start = toPosition(doc, tok->span.start);
+  position end = toPosition(doc, tok->span.end);
+  if (start.line == end.line) {
+    encodeSemantic(enc, start, end.character - start.character, tok->type);
+  }
+  else {
+    // the protocol does not (portably) allow tokens to span lines, so split them
+    position eol = lineEnd(doc, start.line);
+    encodeSemantic(enc, start, eol.character - start.character, tok->type);
+    for (size_t line = start.line + 1; line < end.line; ++line) {
+      position bol = {.line = line, .character = 0};
+      eol = lineEnd(doc, line);
+      encodeSemantic(enc, bol, eol.character, tok->type);
+    }
+    position bol = {.line = end.line, .character = 0};
+    encodeSemantic(enc, bol, end.character, tok->type);
+  }
+}
+
+static void fdumpDiagnostic(fragmentWriter* w, int severity, const eexpr_error* err, bool* first) {
+  const char* name = errorName(err->type);
+  fprintf(w->fp, "%s{\"range\":", *first ? "" : ",");
+  fdumpRange(w, err->loc);
+  fprintf(w->fp, ",\"severity\":%d,\"source\":\"eexpr\",\"code\":\"%s\",\"message\":\"%s\"}", severity, name, name);
+  *first = false;
+}
+
+static int compareErrors(const void* a, const void* b) {
+  const eexpr_error* x = *(const eexpr_error* const*)a;
+  const eexpr_error* y = *(const eexpr_error* const*)b;
+  if (x->loc.start != y->loc.start) { return x->loc.start < y->loc.start ? -1 : 1; }
+  return x < y ? -1 : x > y;
+}
+
+// Diagnostics are listed in document order (and otherwise in the order the parser found them),
+//   so that they come out the same however the document is split into chunks.
+static const eexpr_error** sortErrors(size_t n, const eexpr_error* errs) {
+  const eexpr_error** out = malloc((n + 1) * sizeof(eexpr_error*));
+  checkOom(out);
+  for (size_t i = 0; i < n; ++i) { out[i] = &errs[i]; }
+  qsort(out, n, sizeof(eexpr_error*), compareErrors);
+  return out;
+}
+
+// name a symbol after (the first line of) the source text in `span`
+static void fdumpSymbolName(fragmentWriter* w, eexpr_span span) {
+  size_t from = span.start + w->shift, to = span.end + w->shift;
+  if (to > w->doc->text.len || from >= to) {
+    fdumpCStr(w->fp, ":");
+    return;
+  }
+  str name = {.len = to - from, .bytes = w->doc->text.bytes + from};
+  for (size_t i = 0; i < name.len; ++i) {
+    if (isNewlineByte(name.bytes[i])) { name.len = i; break; }
+  }
+  const size_t maxLen = 80;
+  if (name.len > maxLen) {
+    name.len = maxLen;
+    // do not cut a utf-8 sequence in half
+    while (name.len > 0 && (name.bytes[name.len] & 0xC0) == 0x80) { name.len--; }
+  }
+  fdumpStr(w->fp, name);
+}
+
+/*
+A colon followed by an indented block (e.g. `def foo:` on its own line) does not produce a colon eexpr;
+  instead, the block is chained onto whatever came before the colon.
+Returns that block if `x` ends in one, and sets `nameEnd` to the end of whatever came before it.
+*/
+static eexpr* trailingBlock(const eexpr* x, size_t* nameEnd) {
+  size_t n; eexpr** xs;
+  if (!eexpr_asChain(x, &n, &xs) && !eexpr_asSpace(x, &n, &xs)) { return NULL; }
+  if (n == 0) { return NULL; }
+  if (eexpr_getType(xs[n-1]) != EEXPR_BLOCK) { return trailingBlock(xs[n-1], nameEnd); }
+  if (n < 2) { return NULL; }
+  *nameEnd = eexpr_getSpan(xs[n-2]).end;
+  return xs[n-1];
+}
+
+static void fdumpSymbols(fragmentWriter* w, size_t n, eexpr** xs);
+
+// emit the symbol for `x`, if it is one
+static void fdumpSymbol(fragmentWriter* w, const eexpr* x, bool* first) {
+  eexpr_span nameLoc;
+  eexpr* body;
+  eexpr* before, *after;
+  if (eexpr_asColon(x, &before, &after)) {
+    nameLoc = eexpr_getSpan(before);
+    body = after;
+  }
+  else {
+    nameLoc = eexpr_getSpan(x);
+    body = trailingBlock(x, &nameLoc.end);
+    if (body == NULL) { return; }
+  }
+  size_t nChildren; eexpr** children;
+  bool isBlock = eexpr_asBlock(body, &nChildren, &children);
+  fprintf(w->fp, "%s{\"name\":", *first ? "" : ",");
+  fdumpSymbolName(w, nameLoc);
+  fprintf(w->fp, ",\"kind\":%d,\"range\":", isBlock ? SYMBOL_KIND_OBJECT : SYMBOL_KIND_KEY);
+  fdumpRange(w, eexpr_getSpan(x));
+  fprintf(w->fp, ",\"selectionRange\":");
+  fdumpRange(w, nameLoc);
+  if (isBlock) {
+    fprintf(w->fp, ",\"children\":");
+    fdumpSymbols(w, nChildren, children);
+  }
+  fprintf(w->fp, "}");
+  *first = false;
+}
+
+static void fdumpSymbols(fragmentWriter* w, size_t n, eexpr** xs) {
+  bool first = true;
+  fprintf(w->fp, "[");
+  for (size_t i = 0; i < n; ++i) {
+    fdumpSymbol(w, xs[i], &first);
+  }
+  fprintf(w->fp, "]");
+}
+
+static void chunk_deinit(chunk* self) {
+  fragment_deinit(&self->tokens);
+  fragment_deinit(&self->errors);
+  fragment_deinit(&self->warnings);
+  fragment_deinit(&self->symbols);
+}
+
+static void analysisCache_clear(analysisCache* self) {
+  for (size_t i = 0; i < self->chunks.len; ++i) {
+    chunk_deinit(&self->chunks.data[i]);
+  }
+  self->chunks.len = 0;
+}
+
+// The document's first newline (which the lexer takes to be the one the whole document should use), or nothing if it has none.
+static str firstNewline(str text) {
+  str out = {.len = 0, .bytes = text.bytes};
+  for (size_t i = 0; i < text.len; ++i) {
+    uint8_t c = text.bytes[i];
+    if (c != '\n' && c != '\r' && c != '\x1E') { continue; }
+    out.bytes = &text.bytes[i];
+    out.len = 1;
+    // `\r\n` and `\n\r` are each one newline to the lexer
+    if (c != '\x1E' && i + 1 < text.len && isNewlineByte(text.bytes[i+1]) && text.bytes[i+1] != c) { out.len = 2; }
+    break;
+  }
+  return out;
+}
+
+// whether `at` starts a line, as the protocol counts them
+static bool startsLine(str text, size_t at) {
+  if (at == 0) { return true; }
+  if (at > text.len || !isNewlineByte(text.bytes[at-1])) { return false; }
+  return !(text.bytes[at-1] == '\r' && at < text.len && text.bytes[at] == '\n');
+}
+
+/*
+Analyze the bytes [from, to) of the document, adding chunks for them to `out`.
+The first chunk starts at `from`, and another at each top-level eexpr after that which starts a line.
+
+A region that does not start the document is parsed after a copy of the document's first newline,
+  since the lexer takes whatever newline it sees first to be the one the rest of the input should use.
+Such a region is only analyzed if it parses without errors and (unless `syncAt` is `SIZE_MAX`) a chunk starts at `syncAt`;
+  otherwise this returns false, and `out` is left as it was.
+*/
+static bool analyzeRegion(const snapshot* doc, size_t from, size_t to, size_t syncAt, dynarr_chunk* out) {
+  str prefix = {.len = 0, .bytes = NULL};
+  if (from != 0) { prefix = firstNewline(doc->text); }
+  size_t inputLen = prefix.len + (to - from);
+  uint8_t* copy = NULL;
+  if (prefix.len != 0) {
+    copy = malloc(inputLen);
+    checkOom(copy);
+    memcpy(copy, prefix.bytes, prefix.len);
+    memcpy(copy + prefix.len, doc->text.bytes + from, to - from);
+  }
+  // (a region with a prefix never starts within the length of that prefix, so this does not wrap around)
+  fragmentWriter w = {.doc = doc, .shift = from - prefix.len};
+
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  // tokens are taken before postlexing so that comments are still in the stream
+  parser.pauseAt = EEXPR_PAUSE_AFTER_RAWLEX;
+  // positions come from the document's own line starts, so the parser need not index lines
+  parser.lazyLines = true;
+  eexpr_parse(&parser, inputLen, copy != NULL ? copy : doc->text.bytes + from);
+  dynarr_semanticToken tokens; dynarr_init_semanticToken(&tokens, parser.nTokens + 1);
+  for (size_t i = 0; i < parser.nTokens; ++i) {
+    semanticToken tok = {.span = eexpr_getTokenSpan(parser.tokens[i]), .type = classifyToken(eexpr_getTokenType(parser.tokens[i]))};
+    if (tok.type == SEM_NONE) { continue; }
+    tok.span.start += w.shift;
+    tok.span.end += w.shift;
+    dynarr_push_semanticToken(&tokens, &tok);
+  }
+  bool parsed = false;
+  if (parser.nErrors == 0) {
+    parser.pauseAt = EEXPR_DO_NOT_PAUSE;
+    parsed = eexpr_parse(&parser, 0, NULL) && parser.nErrors == 0;
+  }
+
+  dynarr_size_t starts; dynarr_init_size_t(&starts, parser.nEexprs + 1);
+  dynarr_push_size_t(&starts, &from);
+  bool synced = syncAt == SIZE_MAX;
+  for (size_t i = 0; parsed && i < parser.nEexprs; ++i) {
+    size_t start = eexpr_getSpan(parser.eexprs[i]).start + w.shift;
+    if (start > *dynarr_peek_size_t(&starts) && startsLine(doc->text, start)) {
+      dynarr_push_size_t(&starts, &start);
+      synced = synced || start == syncAt;
+    }
+  }
+  bool ok = from == 0 || (parsed && synced);
+  for (size_t i = 0; ok && from != 0 && i < parser.nWarnings; ++i) {
+    ok = parser.warnings[i].loc.start >= prefix.len;
+  }
+
+  if (ok) {
+    const eexpr_error** errors = sortErrors(parser.nErrors, parser.errors);
+    const eexpr_error** warnings = sortErrors(parser.nWarnings, parser.warnings);
+    fragment none = {.text = NULL, .len = 0, .lines = {.cap = 0, .len = 0, .data = NULL}};
+    size_t nextToken = 0, nextError = 0, nextWarning = 0, nextEexpr = 0;
+    for (size_t k = 0; k < starts.len; ++k) {
+      // whatever is past the end of the input (e.g. a missing trailing newline) goes in the last chunk
+      size_t end = k + 1 < starts.len ? starts.data[k+1] : SIZE_MAX;
+      chunk c;
+      c.start = starts.data[k];
+      c.line = toPosition(doc, c.start).line;
+      c.writtenLine = c.line;
+      semanticEncoder enc = {.fp = fragment_begin(&w), .nTokens = 0};
+      for (; nextToken < tokens.len && tokens.data[nextToken].span.start < end; ++nextToken) {
+        encodeToken(&enc, doc, &tokens.data[nextToken]);
+      }
+      c.tokens = fragment_end(&w);
+      c.nTokens = enc.nTokens;
+      c.firstToken = enc.first;
+      c.lastToken = enc.prev;
+      bool first = true;
+      fragment_begin(&w);
+      for (; nextError < parser.nErrors && errors[nextError]->loc.start + w.shift < end; ++nextError) {
+        fdumpDiagnostic(&w, 1/*Error*/, errors[nextError], &first);
+      }
+      c.errors = fragment_end(&w);
+      first = true;
+      fragment_begin(&w);
+      for (; nextWarning < parser.nWarnings && warnings[nextWarning]->loc.start + w.shift < end; ++nextWarning) {
+        fdumpDiagnostic(&w, 2/*Warning*/, warnings[nextWarning], &first);
+      }
+      c.warnings = fragment_end(&w);
+      c.symbols = none;
+      if (parsed) {
+        first = true;
+        fragment_begin(&w);
+        for (; nextEexpr < parser.nEexprs && eexpr_getSpan(parser.eexprs[nextEexpr]).start + w.shift < end; ++nextEexpr) {
+          fdumpSymbol(&w, parser.eexprs[nextEexpr], &first);
+        }
+        c.symbols = fragment_end(&w);
+      }
+      dynarr_push_chunk(out, &c);
+    }
+    free(errors);
+    free(warnings);
+  }
+
+  dynarr_deinit_size_t(&starts);
+  dynarr_deinit_semanticToken(&tokens);
+  eexpr_parser_deinit(&parser);
+  for (size_t i = 0; i < parser.nEexprs; ++i) {
+    eexpr_del(parser.eexprs[i]);
+  }
+  free(parser.eexprs);
+  free(parser.errors);
+  free(parser.warnings);
+  free(copy);
+  return ok;
+}
+
+// whether `text` has the opening of a heredoc, see `reanalyze`
+static bool mentionsHeredoc(str text) {
+  for (size_t i = 0; i + 2 < text.len; ++i) {
+    if (text.bytes[i] == '"' && text.bytes[i+1] == '"' && text.bytes[i+2] == '"') { return true; }
+  }
+  return false;
+}
+
+/*
+Bring `cache` up to date with the snapshot by reanalyzing only the chunks around the edits since the last analysis.
+Returns false if that cannot be done safely, in which case the whole document must be analyzed instead.
+
+An edit can leave a bracket open, a string unclosed, or a line continued, any of which changes how the text after it parses.
+So the chunks that were edited are reanalyzed along with the chunk after them,
+  and the result is only used if that chunk still starts a top-level eexpr and there were no errors.
+Edits that leave errors behind always get the whole document reanalyzed, since the errors may not be the same on their own.
+Two things the lexer decides once for the whole document also rule out reanalyzing a region by itself:
+  - the first newline sets what kind of newline the document should use, so the first chunk is never reanalyzed alone;
+  - the first indented heredoc sets what kind of indentation the document should use, so neither is a region with a heredoc in it.
+*/
+static bool reanalyze(const snapshot* doc, analysisCache* cache) {
+  dynarr_chunk* chunks = &cache->chunks;
+  if (chunks->len == 0) { return false; }
+  if (!doc->edits.any) {
+    cache->parsedFrom = cache->parsedTo = 0;
+    return doc->text.len == cache->textLen;
+  }
+  size_t from = doc->edits.from, to = doc->edits.to;
+  // where the edits end in the text the chunks are for
+  size_t oldTo = cache->textLen - (doc->text.len - to);
+  // start from the chunk holding the byte before the edits: a newline or indentation added there joins the edited line onto it
+  size_t a = chunks->len - 1;
+  while (a > 0 && chunks->data[a].start >= from) { --a; }
+  if (a == 0) { return false; }
+  // and stop after the first chunk whose start (and the newline before it) was not edited
+  size_t b = a + 1;
+  while (b < chunks->len && chunks->data[b].start < oldTo + 2) { ++b; }
+  size_t regionStart = chunks->data[a].start;
+  size_t regionEnd = doc->text.len;
+  size_t syncAt = SIZE_MAX;
+  size_t last = chunks->len - 1; // the last chunk to be replaced
+  if (b < chunks->len) {
+    syncAt = chunks->data[b].start - oldTo + to;
+    if (b + 1 < chunks->len) { regionEnd = chunks->data[b+1].start - oldTo + to; }
+    last = b;
+  }
+  str region = {.len = regionEnd - regionStart, .bytes = doc->text.bytes + regionStart};
+  if (mentionsHeredoc(region)) { return false; }
+  dynarr_chunk fresh; dynarr_init_chunk(&fresh, 8);
+  if (!analyzeRegion(doc, regionStart, regionEnd, syncAt, &fresh)) {
+    dynarr_deinit_chunk(&fresh);
+    return false;
+  }
+
+  dynarr_chunk merged; dynarr_init_chunk(&merged, chunks->len + fresh.len);
+  for (size_t i = 0; i < a; ++i) {
+    dynarr_push_chunk(&merged, &chunks->data[i]);
+  }
+  for (size_t i = 0; i < fresh.len; ++i) {
+    dynarr_push_chunk(&merged, &fresh.data[i]);
+  }
+  for (size_t i = a; i <= last; ++i) {
+    chunk_deinit(&chunks->data[i]);
+  }
+  // the chunks after the region keep their results, but move along with the edits
+  size_t oldLine = 0, newLine = 0;
+  if (last + 1 < chunks->len) {
+    oldLine = chunks->data[last+1].line;
+    newLine = toPosition(doc, chunks->data[last+1].start - oldTo + to).line;
+  }
+  for (size_t i = last + 1; i < chunks->len; ++i) {
+    chunk c = chunks->data[i];
+    c.start = c.start - oldTo + to;
+    c.line = c.line - oldLine + newLine;
+    dynarr_push_chunk(&merged, &c);
+  }
+  dynarr_deinit_chunk(&fresh);
+  dynarr_deinit_chunk(chunks);
+  *chunks = merged;
+  cache->parsedFrom = regionStart;
+  cache->parsedTo = regionEnd;
+  return true;
+}
+
+static void appendCStr(strBuilder* out, const char* text) {
+  str s = {.len = strlen(text), .bytes = (uint8_t*)text};
+  strBuilder_append(out, s);
+}
+
+static void appendDecimal(strBuilder* out, size_t n) {
+  uint8_t digits[3 * sizeof(size_t)];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = (uint8_t)('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  str s = {.len = sizeof(digits) - i, .bytes = &digits[i]};
+  strBuilder_append(out, s);
+}
+
+// append a fragment of `c`, moving its line numbers along with the chunk
+static void appendFragment(strBuilder* out, const chunk* c, const fragment* f) {
+  size_t done = 0;
+  for (size_t i = 0; c->line != c->writtenLine && i < f->lines.len; ++i) {
+    const lineRef* ref = &f->lines.data[i];
+    str before = {.len = ref->at - done, .bytes = (uint8_t*)f->text + done};
+    strBuilder_append(out, before);
+    appendDecimal(out, ref->line - c->writtenLine + c->line);
+    done = ref->at + ref->len;
+  }
+  str rest = {.len = f->len - done, .bytes = (uint8_t*)f->text + done};
+  strBuilder_append(out, rest);
+}
+
+// append the items in a fragment of `c` to a json list
+static void appendItems(strBuilder* out, const chunk* c, const fragment* f, bool* first) {
+  if (f->len == 0) { return; }
+  if (!*first) { strBuilder_appendByte(out, ','); }
+  appendFragment(out, c, f);
+  *first = false;
+}
+
+// finish a json fragment, and return its (owned) contents
+static char* finishJson(strBuilder* out) {
+  strBuilder_appendByte(out, '\0');
+  return (char*)out->bytes;
+}
+
+static char* joinTokens(const dynarr_chunk* chunks) {
+  strBuilder out = strBuilder_new(4096);
+  appendCStr(&out, "{\"data\":[");
+  position prev = {.line = 0, .character = 0};
+  bool first = true;
+  for (size_t i = 0; i < chunks->len; ++i) {
+    const chunk* c = &chunks->data[i];
+    if (c->nTokens == 0) { continue; }
+    size_t line = c->firstToken.line - c->writtenLine + c->line;
+    size_t deltaLine = line - prev.line;
+    size_t deltaChar = deltaLine == 0 ? c->firstToken.character - prev.character : c->firstToken.character;
+    if (!first) { strBuilder_appendByte(&out, ','); }
+    appendDecimal(&out, deltaLine);
+    strBuilder_appendByte(&out, ',');
+    appendDecimal(&out, deltaChar);
+    strBuilder_appendByte(&out, ',');
+    appendFragment(&out, c, &c->tokens);
+    prev.line = c->lastToken.line - c->writtenLine + c->line;
+    prev.character = c->lastToken.character;
+    first = false;
+  }
+  appendCStr(&out, "]}");
+  return finishJson(&out);
+}
+
+static char* joinDiagnostics(const dynarr_chunk* chunks) {
+  strBuilder out = strBuilder_new(256);
+  bool first = true;
+  strBuilder_appendByte(&out, '[');
+  for (size_t i = 0; i < chunks->len; ++i) {
+    appendItems(&out, &chunks->data[i], &chunks->data[i].errors, &first);
+  }
+  for (size_t i = 0; i < chunks->len; ++i) {
+    appendItems(&out, &chunks->data[i], &chunks->data[i].warnings, &first);
+  }
+  strBuilder_appendByte(&out, ']');
+  return finishJson(&out);
+}
+
+// NULL unless every chunk was parsed
+static char* joinSymbols(const dynarr_chunk* chunks) {
+  for (size_t i = 0; i < chunks->len; ++i) {
+    if (chunks->data[i].symbols.text == NULL) { return NULL; }
+  }
+  strBuilder out = strBuilder_new(4096);
+  bool first = true;
+  strBuilder_appendByte(&out, '[');
+  for (size_t i = 0; i < chunks->len; ++i) {
+    appendItems(&out, &chunks->data[i], &chunks->data[i].symbols, &first);
+  }
+  strBuilder_appendByte(&out, ']');
+  return finishJson(&out);
+}
+
+// Symbols are left NULL if parsing did not succeed, so that the previous outline can be kept.
+static analysis analyze(const snapshot* doc, analysisCache* cache) {
+  if (!reanalyze(doc, cache)) {
+    analysisCache_clear(cache);
+    analyzeRegion(doc, 0, doc->text.len, SIZE_MAX, &cache->chunks);
+    cache->parsedFrom = 0;
+    cache->parsedTo = doc->text.len;
+  }
+  cache->textLen = doc->text.len;
+  analysis out;
+  out.diagnostics = joinDiagnostics(&cache->chunks);
+  out.semanticTokens = joinTokens(&cache->chunks);
+  out.symbols = joinSymbols(&cache->chunks);
+  // a document that did not parse cannot be split up into chunks that are safe to reanalyze alone
+  if (out.symbols == NULL) { analysisCache_clear(cache); }
+  return out;
+}
+
+static void analysis_deinit(analysis* self) {
+  free(self->diagnostics);
+  free(self->semanticTokens);
+  free(self->symbols);
+  self->diagnostics = NULL;
+  self->semanticTokens = NULL;
+  self->symbols = NULL;
+}
+
+
+//////////////////////////////////// Documents ////////////////////////////////////
+
+static document* document_new(str uri, int64_t version, str text) {
+  document* self = malloc(sizeof(document));
+  checkOom(self);
+  self->uri = str_clone(uri);
+  self->version = version;
+  self->revision = 1;
+  self->text = strBuilder_new(text.len + 1);
+  strBuilder_append(&self->text, text);
+  dynarr_init_size_t(&self->lines, 64);
+  str current = {.len = self->text.len, .bytes = self->text.bytes};
+  scanLines(&self->lines, current, 0);
+  timespec_get(&self->changedAt, TIME_UTC);
+  self->edits.any = false;
+  self->analyzedRevision = 0;
+  self->analyzedVersion = 0;
+  self->busy = false;
+  self->closed = false;
+  self->results.diagnostics = NULL;
+  self->results.semanticTokens = NULL;
+  self->results.symbols = NULL;
+  dynarr_init_chunk(&self->cache.chunks, 8);
+  self->cache.textLen = 0;
+  dynarr_init_pendingRequest(&self->pending, 4);
+  return self;
+}
+
+static void document_del(document* self) {
+  free(self->uri.bytes);
+  free(self->text.bytes);
+  dynarr_deinit_size_t(&self->lines);
+  analysis_deinit(&self->results);
+  analysisCache_clear(&self->cache);
+  dynarr_deinit_chunk(&self->cache.chunks);
+  for (size_t i = 0; i < self->pending.len; ++i) {
+    free(self->pending.data[i].id);
+  }
+  dynarr_deinit_pendingRequest(&self->pending);
+  free(self);
+}
+
+// Widen `edits` to take in the bytes [from, to) being replaced with `len` others.
+static void editRange_add(editRange* self, size_t from, size_t to, size_t len) {
+  if (!self->any) {
+    self->any = true;
+    self->from = from;
+    self->to = from + len;
+    return;
+  }
+  // where the end of the edits so far ends up once this one is made
+  size_t end = self->to;
+  if (end >= to) { end = end - to + from + len; }
+  else if (end > from) { end = from + len; }
+  if (from < self->from) { self->from = from; }
+  self->to = end > from + len ? end : from + len;
+}
+
+// Replace the bytes in [from, to) with `repl`.
+static void document_splice(document* self, size_t from, size_t to, str repl) {
+  assert(from <= to && to <= self->text.len);
+  size_t newLen = self->text.len - (to - from) + repl.len;
+  if (newLen > self->text.cap) {
+    while (newLen > self->text.cap) { self->text.cap *= 2; }
+    self->text.bytes = realloc(self->text.bytes, self->text.cap);
+    checkOom(self->text.bytes);
+  }
+  memmove(self->text.bytes + from + repl.len, self->text.bytes + to, self->text.len - to);
+  memcpy(self->text.bytes + from, repl.bytes, repl.len);
+  self->text.len = newLen;
+  editRange_add(&self->edits, from, to, repl.len);
+}
+
+static str document_text(const document* self) {
+  str out = {.len = self->text.len, .bytes = self->text.bytes};
+  return out;
+}
+
+// apply one entry of `contentChanges` from `textDocument/didChange`
+static bool document_change(document* self, const jsonValue* change) {
+  str text;
+  if (!jsonAsString(jsonGet(change, "text"), &text)) { return false; }
+  const jsonValue* range = jsonGet(change, "range");
+  if (range == NULL) {
+    document_splice(self, 0, self->text.len, text);
+    scanLines(&self->lines, document_text(self), 0);
+    return true;
+  }
+  double startLine, startChar, endLine, endChar;
+  if ( !jsonAsNumber(jsonGet(jsonGet(range, "start"), "line"), &startLine)
+    || !jsonAsNumber(jsonGet(jsonGet(range, "start"), "character"), &startChar)
+    || !jsonAsNumber(jsonGet(jsonGet(range, "end"), "line"), &endLine)
+    || !jsonAsNumber(jsonGet(jsonGet(range, "end"), "character"), &endChar)
+    || startLine < 0 || startChar < 0 || endLine < 0 || endChar < 0
+     ) {
+    return false;
+  }
+  position start = {.line = (size_t)startLine, .character = (size_t)startChar};
+  position end = {.line = (size_t)endLine, .character = (size_t)endChar};
+  size_t from = byteOffset(document_text(self), self->lines.data, self->lines.len, start);
+  size_t to = byteOffset(document_text(self), self->lines.data, self->lines.len, end);
+  if (to < from) { to = from; }
+  document_splice(self, from, to, text);
+  // lines before the edit are unaffected, except that the edit may complete a `\r\n` that ended the previous line
+  size_t firstLine = start.line < self->lines.len ? start.line : self->lines.len - 1;
+  scanLines(&self->lines, document_text(self), firstLine == 0 ? 0 : firstLine - 1);
+  return true;
+}
+
+// Edits made after this are recorded relative to the snapshot's text.
+static snapshot document_snapshot(document* self) {
+  snapshot out;
+  out.text = str_clone(document_text(self));
+  out.nLines = self->lines.len;
+  out.lines = malloc(out.nLines * sizeof(size_t));
+  checkOom(out.lines);
+  memcpy(out.lines, self->lines.data, out.nLines * sizeof(size_t));
+  out.edits = self->edits;
+  self->edits.any = false;
+  out.revision = self->revision;
+  out.version = self->version;
+  return out;
+}
+
+static void snapshot_deinit(snapshot* self) {
+  free(self->text.bytes);
+  free(self->lines);
+}
+
+static document* findDocument(server* srv, str uri, size_t* index) {
+  for (size_t i = 0; i < srv->docs.len; ++i) {
+    document* doc = srv->docs.data[i];
+    if (doc->uri.len == uri.len && memcmp(doc->uri.bytes, uri.bytes, uri.len) == 0) {
+      if (index != NULL) { *index = i; }
+      return doc;
+    }
+  }
+  return NULL;
+}
+
+static bool needsAnalysis(const document* doc) {
+  return !doc->busy && doc->analyzedRevision < doc->revision;
+}
+
+
+//////////////////////////////////// Responses ////////////////////////////////////
+
+// The caller must hold the server lock.
+static void publishDiagnostics(const document* doc, const char* diags) {
+  message msg; FILE* fp = message_begin(&msg);
+  fprintf(fp, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+  fdumpStr(fp, doc->uri);
+  fprintf(fp, ",\"version\":%"PRId64",\"diagnostics\":%s}}", doc->analyzedVersion, diags);
+  message_send(&msg);
+}
+
+// The caller must hold the server lock.
+static void answer(const document* doc, const char* id, requestKind kind) {
+  switch (kind) {
+    case REQ_SEMANTIC_TOKENS: {
+      sendResult(id, doc != NULL && doc->results.semanticTokens != NULL ? doc->results.semanticTokens : "null");
+    }; break;
+    case REQ_DOCUMENT_SYMBOLS: {
+      sendResult(id, doc != NULL && doc->results.symbols != NULL ? doc->results.symbols : "[]");
+    }; break;
+  }
+}
+
+// Answer, in order, all pending requests that the current analysis is fresh enough for.
+// The caller must hold the server lock.
+static void answerPending(document* doc) {
+  size_t kept = 0;
+  for (size_t i = 0; i < doc->pending.len; ++i) {
+    pendingRequest* req = &doc->pending.data[i];
+    if (req->revision <= doc->analyzedRevision) {
+      answer(doc, req->id, req->kind);
+      free(req->id);
+    }
+    else {
+      doc->pending.data[kept++] = *req;
+    }
+  }
+  doc->pending.len = kept;
+}
+
+
+//////////////////////////////////// Worker Thread ////////////////////////////////////
+
+static struct timespec addMillis(struct timespec t, long ms) {
+  t.tv_sec += ms / 1000;
+  t.tv_nsec += (ms % 1000) * 1000000L;
+  if (t.tv_nsec >= 1000000000L) {
+    t.tv_sec += 1;
+    t.tv_nsec -= 1000000000L;
+  }
+  return t;
+}
+
+static bool before(struct timespec a, struct timespec b) {
+  return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+static bool sameJson(const char* a, const char* b) {
+  return a == b || (a != NULL && b != NULL && !strcmp(a, b));
+}
+
+// Analyze the whole snapshot again from scratch, and exit if that disagrees with `results` (see `parseOpts`).
+static void checkAnalysis(const snapshot* doc, const analysisCache* cache, const analysis* results) {
+  analysisCache scratch;
+  dynarr_init_chunk(&scratch.chunks, 8);
+  scratch.textLen = 0;
+  analysis expected = analyze(doc, &scratch);
+  fprintf(stderr, "revision %"PRIu64": reanalyzed bytes %zu-%zu of %zu\n", doc->revision, cache->parsedFrom, cache->parsedTo, doc->text.len);
+  if ( !sameJson(expected.diagnostics, results->diagnostics)
+    || !sameJson(expected.semanticTokens, results->semanticTokens)
+    || !sameJson(expected.symbols, results->symbols)
+     ) {
+    fprintf(stderr, "revision %"PRIu64": results differ from analyzing the whole document\n", doc->revision);
+    exit(1);
+  }
+  analysis_deinit(&expected);
+  analysisCache_clear(&scratch);
+  dynarr_deinit_chunk(&scratch.chunks);
+}
+
+static int workerMain(void* arg) {
+  server* srv = arg;
+  mtx_lock(&srv->lock);
+  while (!srv->quit) {
+    // find the document that has been quiet the longest
+    document* doc = NULL;
+    for (size_t i = 0; i < srv->docs.len; ++i) {
+      document* candidate = srv->docs.data[i];
+      if (!needsAnalysis(candidate)) { continue; }
+      if (doc == NULL || before(candidate->changedAt, doc->changedAt)) { doc = candidate; }
+    }
+    if (doc == NULL) {
+      cnd_broadcast(&srv->idle);
+      cnd_wait(&srv->wake, &srv->lock);
+      continue;
+    }
+    if (!srv->flushing) {
+      struct timespec now; timespec_get(&now, TIME_UTC);
+      struct timespec due = addMillis(doc->changedAt, srv->debounceMs);
+      if (before(now, due)) {
+        cnd_timedwait(&srv->wake, &srv->lock, &due);
+        continue;
+      }
+    }
+    snapshot snap = document_snapshot(doc);
+    doc->busy = true;
+    mtx_unlock(&srv->lock);
+
+    analysis results = analyze(&snap, &doc->cache);
+    if (srv->checkIncremental) { checkAnalysis(&snap, &doc->cache, &results); }
+
+    mtx_lock(&srv->lock);
+    doc->busy = false;
+    if (doc->closed) {
+      analysis_deinit(&results);
+      document_del(doc);
+    }
+    else {
+      free(doc->results.diagnostics);
+      doc->results.diagnostics = results.diagnostics;
+      free(doc->results.semanticTokens);
+      doc->results.semanticTokens = results.semanticTokens;
+      if (results.symbols != NULL) {
+        free(doc->results.symbols);
+        doc->results.symbols = results.symbols;
+      }
+      doc->analyzedRevision = snap.revision;
+      doc->analyzedVersion = snap.version;
+      publishDiagnostics(doc, doc->results.diagnostics);
+      answerPending(doc);
+    }
+    snapshot_deinit(&snap);
+    cnd_broadcast(&srv->idle);
+  }
+  mtx_unlock(&srv->lock);
+  return 0;
+}
+
+
+//////////////////////////////////// Message Handling ////////////////////////////////////
+
+static bool textDocumentUri(const jsonValue* params, str* uri) {
+  return jsonAsString(jsonGet(jsonGet(params, "textDocument"), "uri"), uri);
+}
+
+static void onInitialize(server* srv, const char* id) {
+  message msg; FILE* fp = message_begin(&msg);
+  fprintf(fp, "{\"capabilities\":{\"positionEncoding\":\"utf-16\"");
+  fprintf(fp, ",\"textDocumentSync\":{\"openClose\":true,\"change\":2}");
+  fprintf(fp, ",\"semanticTokensProvider\":{\"legend\":{\"tokenTypes\":[");
+  for (size_t i = 0; i < sizeof(tokenLegend) / sizeof(tokenLegend[0]); ++i) {
+    fprintf(fp, "%s\"%s\"", i == 0 ? "" : ",", tokenLegend[i]);
+  }
+  fprintf(fp, "],\"tokenModifiers\":[]},\"full\":true}");
+  fprintf(fp, ",\"documentSymbolProvider\":true}");
+  fprintf(fp, ",\"serverInfo\":{\"name\":\"eexpr-lsp\",\"version\":\"%d.%d.%d\"}}"
+         , EEXPR_VERSION_MAJOR, EEXPR_VERSION_MINOR, EEXPR_VERSION_PATCH);
+  char* result = message_end(&msg);
+  sendResult(id, result);
+  free(result);
+  srv->initialized = true;
+}
+
+static void onDidOpen(server* srv, const jsonValue* params) {
+  str uri, text; double version = 0;
+  const jsonValue* item = jsonGet(params, "textDocument");
+  if (!jsonAsString(jsonGet(item, "uri"), &uri)) { return; }
+  if (!jsonAsString(jsonGet(item, "text"), &text)) { return; }
+  jsonAsNumber(jsonGet(item, "version"), &version);
+  size_t index;
+  document* old = findDocument(srv, uri, &index);
+  document* doc = document_new(uri, (int64_t)version, text);
+  if (old != NULL) {
+    // re-opening without a close; carry over the revision so that pending requests still make sense
+    doc->revision = old->revision + 1;
+    doc->pending = old->pending;
+    dynarr_init_pendingRequest(&old->pending, 1);
+    srv->docs.data[index] = doc;
+    if (old->busy) { old->closed = true; }
+    else { document_del(old); }
+  }
+  else {
+    dynarr_push_document_p(&srv->docs, &doc);
+  }
+  cnd_signal(&srv->wake);
+}
+
+static void onDidChange(server* srv, const jsonValue* params) {
+  str uri;
+  if (!textDocumentUri(params, &uri)) { return; }
+  document* doc = findDocument(srv, uri, NULL);
+  if (doc == NULL) { return; }
+  double version;
+  if (jsonAsNumber(jsonGet(jsonGet(params, "textDocument"), "version"), &version)) {
+    doc->version = (int64_t)version;
+  }
+  const jsonValue* changes = jsonGet(params, "contentChanges");
+  if (changes == NULL || changes->type != JSON_ARRAY) { return; }
+  for (size_t i = 0; i < changes->as.array.len; ++i) {
+    document_change(doc, &changes->as.array.items[i]);
+  }
+  doc->revision++;
+  timespec_get(&doc->changedAt, TIME_UTC);
+  cnd_signal(&srv->wake);
+}
+
+static void onDidClose(server* srv, const jsonValue* params) {
+  str uri;
+  if (!textDocumentUri(params, &uri)) { return; }
+  size_t index;
+  document* doc = findDocument(srv, uri, &index);
+  if (doc == NULL) { return; }
+  srv->docs.data[index] = srv->docs.data[srv->docs.len - 1];
+  srv->docs.len--;
+  // nothing more will be computed for this document, so answer anything waiting with what we have
+  for (size_t i = 0; i < doc->pending.len; ++i) {
+    answer(doc, doc->pending.data[i].id, doc->pending.data[i].kind);
+    free(doc->pending.data[i].id);
+  }
+  doc->pending.len = 0;
+  // clear out diagnostics in the client
+  doc->analyzedVersion = doc->version;
+  publishDiagnostics(doc, "[]");
+  if (doc->busy) { doc->closed = true; }
+  else { document_del(doc); }
+}
+
+static void onDocumentRequest(server* srv, const jsonValue* params, char* id, requestKind kind) {
+  str uri;
+  document* doc = textDocumentUri(params, &uri) ? findDocument(srv, uri, NULL) : NULL;
+  if (doc == NULL) {
+    sendError(id, RPC_INVALID_PARAMS, "unknown document");
+    free(id);
+  }
+  else if (doc->analyzedRevision == doc->revision) {
+    answer(doc, id, kind);
+    free(id);
+  }
+  else {
+    pendingRequest req = {.id = id, .kind = kind, .revision = doc->revision};
+    dynarr_push_pendingRequest(&doc->pending, &req);
+    cnd_signal(&srv->wake);
+  }
+}
+
+// Wait for the worker to analyze everything that needs it, without waiting for the debounce timer.
+// This leaves `srv->flushing` set.
+static void flush(server* srv) {
+  srv->flushing = true;
+  cnd_signal(&srv->wake);
+  while (true) {
+    bool working = false;
+    for (size_t i = 0; i < srv->docs.len; ++i) {
+      document* doc = srv->docs.data[i];
+      working = working || doc->busy || needsAnalysis(doc);
+    }
+    if (!working) { break; }
+    cnd_wait(&srv->idle, &srv->lock);
+  }
+}
+
+static void onShutdown(server* srv, const char* id) {
+  // finish all outstanding work so that no request goes unanswered
+  flush(srv);
+  srv->shutdown = true;
+  sendResult(id, "null");
+}
+
+// Returns false when the server should exit.
+static bool handleMessage(server* srv, const jsonValue* msg) {
+  str method;
+  bool hasMethod = jsonAsString(jsonGet(msg, "method"), &method);
+  const jsonValue* idValue = jsonGet(msg, "id");
+  const jsonValue* params = jsonGet(msg, "params");
+  char* id = idValue == NULL ? NULL : serializeId(idValue);
+  #define IS(name) (method.len == strlen(name) && memcmp(method.bytes, name, method.len) == 0)
+  bool keepGoing = true;
+
+  mtx_lock(&srv->lock);
+  if (!hasMethod) {
+    // responses to requests we never send, or garbage
+    if (id != NULL && idValue->type != JSON_NULL && jsonGet(msg, "result") == NULL && jsonGet(msg, "error") == NULL) {
+      sendError(id, RPC_INVALID_REQUEST, "missing method");
+    }
+  }
+  else if (IS("exit")) {
+    keepGoing = false;
+  }
+  else if (IS("initialize")) {
+    if (id != NULL) { onInitialize(srv, id); }
+  }
+  else if (!srv->initialized) {
+    if (id != NULL) { sendError(id, RPC_SERVER_NOT_INITIALIZED, "server not initialized"); }
+  }
+  else if (srv->shutdown) {
+    if (id != NULL) { sendError(id, RPC_INVALID_REQUEST, "server is shutting down"); }
+  }
+  else if (IS("shutdown")) {
+    if (id != NULL) { onShutdown(srv, id); }
+  }
+  else if (IS("textDocument/didOpen")) {
+    onDidOpen(srv, params);
+    if (srv->checkIncremental) { flush(srv); srv->flushing = false; }
+  }
+  else if (IS("textDocument/didChange")) {
+    onDidChange(srv, params);
+    if (srv->checkIncremental) { flush(srv); srv->flushing = false; }
+  }
+  else if (IS("textDocument/didClose")) {
+    onDidClose(srv, params);
+  }
+  else if (IS("textDocument/semanticTokens/full") && id != NULL) {
+    onDocumentRequest(srv, params, id, REQ_SEMANTIC_TOKENS);
+    id = NULL; // ownership transferred
+  }
+  else if (IS("textDocument/documentSymbol") && id != NULL) {
+    onDocumentRequest(srv, params, id, REQ_DOCUMENT_SYMBOLS);
+    id = NULL; // ownership transferred
+  }
+  else if (id != NULL) {
+    sendError(id, RPC_METHOD_NOT_FOUND, "method not supported");
+  }
+  // otherwise, an unsupported notification (incl. `initialized` and `$/cancelRequest`) is ignored
+  mtx_unlock(&srv->lock);
+
+  #undef IS
+  free(id);
+  return keepGoing;
+}
+
+
+//////////////////////////////////// Main ////////////////////////////////////
+
+// Read one base-protocol message body from `fp`.
+// Returns false on end of input.
+static bool readMessage(FILE* fp, str* body) {
+  size_t contentLength = 0;
+  bool haveLength = false;
+  char line[256];
+  while (true) {
+    size_t len = 0;
+    int c;
+    while ((c = fgetc(fp)) != EOF && c != '\n') {
+      if (len + 1 < sizeof(line)) { line[len++] = (char)c; }
+    }
+    if (c == EOF) { return false; }
+    if (len != 0 && line[len-1] == '\r') { len--; }
+    line[len] = '\0';
+    if (len == 0) {
+      if (haveLength) { break; }
+      continue;
+    }
+    const char* prefix = "content-length:";
+    size_t prefixLen = strlen(prefix);
+    bool match = len > prefixLen;
+    for (size_t i = 0; match && i < prefixLen; ++i) {
+      char lower = ('A' <= line[i] && line[i] <= 'Z') ? line[i] - 'A' + 'a' : line[i];
+      match = lower == prefix[i];
+    }
+    if (match) {
+      contentLength = strtoull(&line[prefixLen], NULL, 10);
+      haveLength = true;
+    }
+  }
+  body->len = contentLength;
+  body->bytes = malloc(contentLength + 1);
+  checkOom(body->bytes);
+  if (fread(body->bytes, 1/*byte per element*/, contentLength/*elements*/, fp) != contentLength) {
+    free(body->bytes);
+    return false;
+  }
+  return true;
+}
+
+/*
+Options:
+  --debounce=MS  wait until a document has been quiet for this long before analyzing it (default 20)
+  --check-incremental  for testing: analyze every change before reading the next message,
+                       and after each analysis, analyze the whole document from scratch and exit if the results differ;
+                       what each analysis reparsed is logged to stderr
+*/
+static void parseOpts(server* srv, int argc, char** argv) {
+  srv->debounceMs = 20;
+  srv->checkIncremental = false;
+  for (int i = 1; i < argc; ++i) {
+    const char* debounceOpt = "--debounce=";
+    if (!strncmp(argv[i], debounceOpt, strlen(debounceOpt))) {
+      char* end;
+      srv->debounceMs = strtol(&argv[i][strlen(debounceOpt)], &end, 10);
+      if (*end != '\0' || srv->debounceMs < 0) { die("bad debounce time (milliseconds)"); }
+    }
+    else if (!strcmp(argv[i], "--check-incremental")) {
+      srv->checkIncremental = true;
+    }
+    else if (!strcmp(argv[i], "--stdio")) {
+      // the only transport, but editors like to pass it anyway
+    }
+    else {
+      fprintf(stderr, "unrecognized option: %s\n", argv[i]);
+      exit(1);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  server srv;
+  parseOpts(&srv, argc, argv);
+  srv.initialized = false;
+  srv.shutdown = false;
+  srv.flushing = false;
+  srv.quit = false;
+  dynarr_init_document_p(&srv.docs, 8);
+  if ( mtx_init(&srv.lock, mtx_plain) != thrd_success
+    || cnd_init(&srv.wake) != thrd_success
+    || cnd_init(&srv.idle) != thrd_success
+    || thrd_create(&srv.worker, workerMain, &srv) != thrd_success
+     ) {
+    die("could not start worker thread");
+  }
+
+  str body;
+  while (readMessage(stdin, &body)) {
+    jsonValue msg;
+    bool keepGoing = true;
+    if (jsonParse(&msg, body)) {
+      keepGoing = handleMessage(&srv, &msg);
+      jsonValue_deinit(&msg);
+    }
+    else {
+      mtx_lock(&srv.lock);
+      sendError("null", RPC_PARSE_ERROR, "could not parse message");
+      mtx_unlock(&srv.lock);
+    }
+    free(body.bytes);
+    if (!keepGoing) { break; }
+  }
+
+  mtx_lock(&srv.lock);
+  srv.quit = true;
+  cnd_signal(&srv.wake);
+  mtx_unlock(&srv.lock);
+  thrd_join(srv.worker, NULL);
+  for (size_t i = 0; i < srv.docs.len; ++i) {
+    document_del(srv.docs.data[i]);
+  }
+  dynarr_deinit_document_p(&srv.docs);
+  cnd_destroy(&srv.idle);
+  cnd_destroy(&srv.wake);
+  mtx_destroy(&srv.lock);
+  return srv.shutdown ? 0 : 1;
+}
@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cbor.h"
 #include "json.h"
+#include "mixfixSpec.h"
 
 void die(const char* msg) {
   fprintf(stderr, "%s\n", msg);
@@ -14,6 +16,10 @@ typedef enum level {
   WARN,
   ERROR
 } level;
+typedef enum format {
+  FORMAT_JSON,
+  FORMAT_CBOR
+} format;
 typedef struct options {
   char* inFilename;
   struct {
@@ -21,6 +27,7 @@ typedef struct options {
     char* rawTokens;
     char* tokens;
     char* eexprs;
+    char* normal;
   } dump;
   struct {
     level mixedSpace;
@@ -29,6 +36,13 @@ typedef struct options {
     level trailingSpace;
     level noTrailingNewline;
   } levels;
+  bool lazyPayloads;
+  bool lazyLines;
+  bool shareSubtrees;
+  bool reparse;
+  struct eexpr_parseLimits limits;
+  char* mixfixSpec;
+  format outFormat;
 } options;
 
 
@@ -38,11 +52,11 @@ void dumpLexer(char* filename, const eexpr_parser* parser, const options* opts)
   fprintf(fp, "{ \"filename\": ");
   fdumpCStr(fp, opts->inFilename);
   fprintf(fp, "\n, \"tokens\":");
-  fdumpTokenArray(fp, "  ", parser->nTokens, parser->tokens);
+  fdumpTokenArray(fp, parser->lines, "  ", parser->nTokens, parser->tokens);
   fprintf(fp, "\n, \"warnings\":");
-  fdumpErrorArray(fp, "  ", parser->nWarnings, parser->warnings);
+  fdumpErrorArray(fp, parser->lines, "  ", parser->nWarnings, parser->warnings);
   fprintf(fp, "\n, \"errors\":");
-  fdumpErrorArray(fp, "  ", parser->nErrors, parser->errors);
+  fdumpErrorArray(fp, parser->lines, "  ", parser->nErrors, parser->errors);
   fprintf(fp, "\n}\n");
   fclose(fp);
 }
@@ -52,11 +66,12 @@ void dumpParser(char* filename, const eexpr_parser* parser, const options* opts)
   fprintf(fp, "{ \"filename\": ");
   fdumpCStr(fp, opts->inFilename);
   fprintf(fp, "\n, \"eexprs\":");
-  fdumpEexprArray(fp, 2, parser->nEexprs, parser->eexprs);
+  jsonSpans = parser->spans;
+  fdumpEexprArray(fp, parser->lines, 2, parser->nEexprs, parser->eexprs);
   fprintf(fp, "\n, \"warnings\":");
-  fdumpErrorArray(fp, "  ", parser->nWarnings, parser->warnings);
+  fdumpErrorArray(fp, parser->lines, "  ", parser->nWarnings, parser->warnings);
   fprintf(fp, "\n, \"errors\":");
-  fdumpErrorArray(fp, "  ", parser->nErrors, parser->errors);
+  fdumpErrorArray(fp, parser->lines, "  ", parser->nErrors, parser->errors);
   fprintf(fp, "\n}\n");
   fclose(fp);
 }
@@ -69,6 +84,7 @@ options parseOpts(int argc, char** argv) {
       , .rawTokens = NULL
       , .tokens = NULL
       , .eexprs = NULL
+      , .normal = NULL
       }
     , .levels =
       // NOTE I decide default levels based on whether it's possible for a script to automatically fix things.
@@ -106,6 +122,13 @@ options parseOpts(int argc, char** argv) {
       // , .missingTemplateExpr = ERROR
       // , .missingCloseTemplate = ERROR
       }
+    , .lazyPayloads = false
+    , .lazyLines = false
+    , .shareSubtrees = false
+    , .reparse = false
+    , .limits = { 0, 0, 0, 0, 0, 0 }
+    , .mixfixSpec = NULL
+    , .outFormat = FORMAT_JSON
     };
   for (int i = 1; i < argc; ++i) {
     size_t len = strlen(argv[i]);
@@ -124,7 +147,7 @@ options parseOpts(int argc, char** argv) {
         }
         goto setInputFile;
       }
-      else if (argv[i][2] == 'd') {
+      else if (argv[i][1] == 'd') {
         argv[i] = &argv[i][2];
         char** filename_p = NULL;
         if (false) { assert(false); }
@@ -132,6 +155,7 @@ options parseOpts(int argc, char** argv) {
         else if (!strcmp(argv[i], "dumpRawTokens")) { filename_p = &opts.dump.rawTokens; }
         else if (!strcmp(argv[i], "dumpTokens")) { filename_p = &opts.dump.tokens; }
         else if (!strcmp(argv[i], "dumpEexprs")) { filename_p = &opts.dump.eexprs; }
+        else if (!strcmp(argv[i], "dumpNormal")) { filename_p = &opts.dump.normal; }
         else {
           fprintf(stderr, "unrecognized dump stage %s\n", argv[i]);
           exit(1);
@@ -141,6 +165,62 @@ options parseOpts(int argc, char** argv) {
           *filename_p = argv[i];
         }
       }
+      else if (argv[i][1] == 'f') {
+        argv[i] = &argv[i][2];
+             if (false) { assert(false); }
+        else if (!strcmp(argv[i], "lazy-payloads")) { opts.lazyPayloads = true; }
+        else if (!strcmp(argv[i], "no-lazy-payloads")) { opts.lazyPayloads = false; }
+        else if (!strcmp(argv[i], "lazy-lines")) { opts.lazyLines = true; }
+        else if (!strcmp(argv[i], "no-lazy-lines")) { opts.lazyLines = false; }
+        else if (!strcmp(argv[i], "share-subtrees")) { opts.shareSubtrees = true; }
+        else if (!strcmp(argv[i], "no-share-subtrees")) { opts.shareSubtrees = false; }
+        else if (!strcmp(argv[i], "reparse")) { opts.reparse = true; }
+        else if (!strcmp(argv[i], "no-reparse")) { opts.reparse = false; }
+        else {
+          fprintf(stderr, "unrecognized feature %s\n", argv[i]);
+          exit(1);
+        }
+      }
+      else if (argv[i][1] == 'l') {
+        argv[i] = &argv[i][2];
+        char* eq = strchr(argv[i], '=');
+        if (eq == NULL) { die("limits are given as -l<limit>=<number>"); }
+        *eq = '\0';
+        char* end;
+        unsigned long long n = strtoull(eq + 1, &end, 10);
+        if (eq[1] == '\0' || *end != '\0') {
+          fprintf(stderr, "bad number for limit %s\n", argv[i]);
+          exit(1);
+        }
+        size_t* limit_p = NULL;
+             if (false) { assert(false); }
+        else if (!strcmp(argv[i], "bytes")) { limit_p = &opts.limits.bytes; }
+        else if (!strcmp(argv[i], "tokens")) { limit_p = &opts.limits.tokens; }
+        else if (!strcmp(argv[i], "depth")) { limit_p = &opts.limits.depth; }
+        else if (!strcmp(argv[i], "digits")) { limit_p = &opts.limits.digits; }
+        else if (!strcmp(argv[i], "errors")) { limit_p = &opts.limits.errors; }
+        else if (!strcmp(argv[i], "memory")) { limit_p = &opts.limits.memory; }
+        else {
+          fprintf(stderr, "unrecognized limit %s\n", argv[i]);
+          exit(1);
+        }
+        *limit_p = n;
+      }
+      else if (!strncmp(argv[i], "--format=", 9)) {
+        argv[i] = &argv[i][9];
+             if (false) { assert(false); }
+        else if (!strcmp(argv[i], "json")) { opts.outFormat = FORMAT_JSON; }
+        else if (!strcmp(argv[i], "cbor")) { opts.outFormat = FORMAT_CBOR; }
+        else {
+          fprintf(stderr, "unrecognized output format %s\n", argv[i]);
+          exit(1);
+        }
+      }
+      else if (argv[i][1] == 'm') {
+        if (argv[i][2] != '\0') { die("the mixfix spec file is given as -m <file>"); }
+        ++i; if (i >= argc) { die("missing mixfix spec file"); }
+        opts.mixfixSpec = argv[i];
+      }
       else if (argv[i][1] == 'E' || argv[i][1] == 'W' || argv[i][1] == 'N') {
         level l;
         switch (argv[i][1]) {
@@ -179,6 +259,14 @@ options parseOpts(int argc, char** argv) {
 int main(int argc, char** argv) {
   options opts = parseOpts(argc, argv);
 
+  eexpr_mixfixTable* mixfixes = NULL;
+  if (opts.mixfixSpec != NULL) {
+    if (opts.shareSubtrees) { die("shared subtrees cannot be rewritten with mixfixes"); }
+    mixfixes = readMixfixSpec(stderr, opts.mixfixSpec);
+    if (mixfixes == NULL) { exit(1); }
+    jsonMixfixes = mixfixes;
+  }
+
   str input = readFile(opts.inFilename);
   if (input.bytes == NULL) {
     die("error opening input file for reading");
@@ -190,10 +278,29 @@ int main(int argc, char** argv) {
   }
 
   bool parsed = false;
+  size_t nMixfixErrors = 0;
+  eexpr_mixfixError* mixfixErrors = NULL;
   eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  parser.lazyPayloads = opts.lazyPayloads;
+  parser.lazyLines = opts.lazyLines;
+  if (opts.shareSubtrees) {
+    parser.shared = eexpr_shareTable_new();
+    // the output shows where each eexpr occurs, not just where it first occurred
+    parser.shareSpans = true;
+  }
+  parser.limits = opts.limits;
+  if (opts.reparse) {
+    // the real parse below then runs in the memory left over from this one
+    eexpr_parse(&parser, input.len, input.bytes);
+    eexpr_parser_reset(&parser);
+  }
 
   parser.pauseAt = EEXPR_PAUSE_AFTER_RAWLEX;
   eexpr_parse(&parser, input.len, input.bytes);
+  if (opts.lazyLines) {
+    // the parser itself does without, but the output shows lines and columns
+    parser.lines = eexpr_lineIndex_new(input.len, input.bytes);
+  }
   dumpLexer(opts.dump.rawTokens, &parser, &opts);
   if (parser.nErrors != 0) { goto finish; }
 
@@ -206,39 +313,78 @@ int main(int argc, char** argv) {
   eexpr_parse(&parser, 0, NULL);
   parsed = true;
   dumpParser(opts.dump.eexprs, &parser, &opts);
+  if (opts.dump.normal != NULL) {
+    FILE* fp = fopen(opts.dump.normal, "w");
+    eexpr_fprint(fp, parser.nEexprs, parser.eexprs);
+    fclose(fp);
+  }
+  if (mixfixes != NULL && parser.nErrors == 0) {
+    eexpr_mixfixRewrite(mixfixes, parser.nEexprs, parser.eexprs, &nMixfixErrors, &mixfixErrors);
+  }
 
   // report warnings and errors, exiting if there are any errors
   finish:
-  if (parsed && parser.nErrors == 0) {
+  if (opts.outFormat == FORMAT_CBOR) {
+    // everything goes into the one document, so that consumers need not look at stderr
+    bool ok = parsed && parser.nErrors == 0 && nMixfixErrors == 0;
+    cborMapHead(stdout, 2 + ok + (parser.nErrors != 0) + (nMixfixErrors != 0));
+    cborDumpCStr(stdout, "filename");
+    cborDumpCStr(stdout, opts.inFilename);
+    if (ok) {
+      cborDumpCStr(stdout, "eexprs");
+      jsonSpans = parser.spans;
+      cborDumpEexprArray(stdout, parser.lines, parser.nEexprs, parser.eexprs);
+    }
+    cborDumpCStr(stdout, "warnings");
+    cborDumpErrorArray(stdout, parser.lines, parser.nWarnings, parser.warnings);
+    if (parser.nErrors != 0) {
+      cborDumpCStr(stdout, "errors");
+      cborDumpErrorArray(stdout, parser.lines, parser.nErrors, parser.errors);
+    }
+    if (nMixfixErrors != 0) {
+      cborDumpCStr(stdout, "mixfixErrors");
+      cborDumpMixfixErrorArray(stdout, parser.lines, nMixfixErrors, mixfixErrors);
+    }
+  }
+  else if (parsed && parser.nErrors == 0 && nMixfixErrors == 0) {
     fprintf(stdout, "{ \"filename\": ");
     fdumpCStr(stdout, opts.inFilename);
     fprintf(stdout, "\n, \"eexprs\":");
-    fdumpEexprArray(stdout, 2, parser.nEexprs, parser.eexprs);
+    jsonSpans = parser.spans;
+    fdumpEexprArray(stdout, parser.lines, 2, parser.nEexprs, parser.eexprs);
     if (parser.nWarnings != 0) {
       fprintf(stdout, "\n, \"warnings\":");
-      fdumpErrorArray(stdout, "  ", parser.nWarnings, parser.warnings);
+      fdumpErrorArray(stdout, parser.lines, "  ", parser.nWarnings, parser.warnings);
     }
     fprintf(stdout, "\n}\n");
   }
-  if (parser.nErrors != 0 || parser.nWarnings != 0) {
+  if (parser.nErrors != 0 || parser.nWarnings != 0 || nMixfixErrors != 0) {
     fprintf(stderr, "{ \"filename\": ");
     fdumpCStr(stderr, opts.inFilename);
     fprintf(stderr, "\n, \"warnings\":");
-    fdumpErrorArray(stderr, "  ", parser.nWarnings, parser.warnings);
+    fdumpErrorArray(stderr, parser.lines, "  ", parser.nWarnings, parser.warnings);
     if (parser.nErrors != 0) {
       fprintf(stderr, "\n, \"errors\":");
-      fdumpErrorArray(stderr, "  ", parser.nErrors, parser.errors);
+      fdumpErrorArray(stderr, parser.lines, "  ", parser.nErrors, parser.errors);
+    }
+    if (nMixfixErrors != 0) {
+      fprintf(stderr, "\n, \"mixfixErrors\":");
+      fdumpMixfixErrorArray(stderr, parser.lines, "  ", nMixfixErrors, mixfixErrors);
     }
     fprintf(stderr, "\n}\n");
   }
   eexpr_parser_deinit(&parser);
   for (size_t i = 0; i < parser.nEexprs; ++i) {
-    eexpr_deinit(parser.eexprs[i]);
-    free(parser.eexprs[i]);
+    eexpr_del(parser.eexprs[i]);
   }
   free(parser.eexprs);
+  free(parser.spans);
+  eexpr_shareTable_del(parser.shared);
   free(parser.errors);
   free(parser.warnings);
+  eexpr_lineIndex_del(parser.lines);
+  free(mixfixErrors);
+  eexpr_mixfixTable_del(mixfixes);
   free(input.bytes);
-  return parser.nErrors == 0 ? 0 : 1;
+  return parser.nErrors == 0 && nMixfixErrors == 0 ? 0 : 1;
 }
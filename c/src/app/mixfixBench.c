@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "eexpr.h"
+#include "mixfixSpec.h"
+#include "strstuff.h"
+
+/*
+Throughput benchmark for mixfix rewriting.
+
+  eexpr-mixfix-bench <spec file> <input file> [iterations]
+
+Compiling the spec is timed as a whole, including reading and parsing the spec file itself.
+Each iteration then parses the input afresh (rewriting consumes its input) and rewrites it;
+  only the time spent in `eexpr_mixfixRewrite` is counted towards the rewriting throughput.
+*/
+
+static
+double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static
+void delParser(eexpr_parser* parser) {
+  eexpr_parser_deinit(parser);
+  for (size_t i = 0; i < parser->nEexprs; ++i) {
+    eexpr_del(parser->eexprs[i]);
+  }
+  free(parser->eexprs);
+  free(parser->errors);
+  free(parser->warnings);
+  eexpr_lineIndex_del(parser->lines);
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "usage: %s <spec file> <input file> [iterations]\n", argv[0]);
+    return 1;
+  }
+  long iterations = argc == 4 ? strtol(argv[3], NULL, 10) : 100;
+  if (iterations <= 0) { iterations = 1; }
+
+  // compile the table repeatedly; the spec reader reports any problems once, on the first go
+  eexpr_mixfixTable* table = readMixfixSpec(stderr, argv[1]);
+  if (table == NULL) { return 1; }
+  double compileTime = 0;
+  for (long i = 0; i < iterations; ++i) {
+    double start = now();
+    eexpr_mixfixTable* again = readMixfixSpec(stderr, argv[1]);
+    compileTime += now() - start;
+    eexpr_mixfixTable_del(again);
+  }
+
+  str input = readFile(argv[2]);
+  if (input.bytes == NULL) {
+    fprintf(stderr, "error opening input file for reading\n");
+    eexpr_mixfixTable_del(table);
+    return 1;
+  }
+  double parseTime = 0, rewriteTime = 0;
+  size_t nMixfixErrors = 0;
+  for (long i = 0; i < iterations; ++i) {
+    eexpr_parser parser; eexpr_parserInitDefault(&parser);
+    double start = now();
+    eexpr_parse(&parser, input.len, input.bytes);
+    double mid = now();
+    eexpr_mixfixError* errors = NULL;
+    if (parser.nErrors == 0) {
+      eexpr_mixfixRewrite(table, parser.nEexprs, parser.eexprs, &nMixfixErrors, &errors);
+    }
+    rewriteTime += now() - mid;
+    parseTime += mid - start;
+    size_t nErrors = parser.nErrors;
+    free(errors);
+    delParser(&parser);
+    if (nErrors != 0) {
+      fprintf(stderr, "input has parse errors\n");
+      eexpr_mixfixTable_del(table);
+      free(input.bytes);
+      return 1;
+    }
+  }
+
+  double mb = (double)input.len * (double)iterations / (1024.0 * 1024.0);
+  printf("iterations: %ld\n", iterations);
+  printf("compile spec (incl. reading it): %.3f us/iteration\n", compileTime / (double)iterations * 1e6);
+  printf("parse: %.3f ms/iteration, %.1f MiB/s\n", parseTime / (double)iterations * 1e3, mb / parseTime);
+  printf("rewrite: %.3f ms/iteration, %.1f MiB/s\n", rewriteTime / (double)iterations * 1e3, mb / rewriteTime);
+  printf("mixfix errors per iteration: %zu\n", nMixfixErrors);
+  eexpr_mixfixTable_del(table);
+  free(input.bytes);
+  return 0;
+}
@@ -0,0 +1,255 @@
+#include "mixfixSpec.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "json.h"
+
+#define TYPE eexpr_mixfixText
+#include "dynarr.h"
+
+
+typedef struct specError {
+  eexpr_span loc;
+  const char* type; // named after `MixfixSpecErrorDesc` in the Haskell package
+} specError;
+#define TYPE specError
+#include "dynarr.h"
+
+typedef struct specDef {
+  eexpr_span loc;
+  eexpr_mixfixText name;
+  eexpr_mixfixAssoc assoc;
+  bool hasAssoc;
+  bool hasPattern;
+  dynarr_eexpr_mixfixText parts;
+  dynarr_eexpr_mixfixText lowerThan;
+  dynarr_eexpr_mixfixText sameAs;
+  dynarr_eexpr_mixfixText higherThan;
+} specDef;
+#define TYPE specDef
+#include "dynarr.h"
+
+
+static
+void specErr(dynarr_specError* errs, const eexpr* at, const char* type) {
+  specError err = {.loc = eexpr_getSpan(at), .type = type};
+  dynarr_push_specError(errs, &err);
+}
+
+static
+bool asText(const eexpr* x, eexpr_mixfixText* out) {
+  size_t n; uint8_t* s;
+  if (!eexpr_asSymbol(x, &n, &s)) { return false; }
+  out->nBytes = n;
+  out->utf8str = s;
+  return true;
+}
+
+static
+bool textIs(eexpr_mixfixText text, const char* s) {
+  return text.nBytes == strlen(s) && memcmp(text.utf8str, s, text.nBytes) == 0;
+}
+
+// A symbol, or comma-separated symbols.
+static
+void readNames(dynarr_specError* errs, const eexpr* body, dynarr_eexpr_mixfixText* out) {
+  size_t n; eexpr** xs;
+  eexpr* single[1] = {(eexpr*)body};
+  if (!eexpr_asComma(body, &n, &xs)) {
+    n = 1;
+    xs = single;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    eexpr_mixfixText name;
+    if (!asText(xs[i], &name)) { specErr(errs, xs[i], "expected-symbol-list"); continue; }
+    dynarr_push_eexpr_mixfixText(out, &name);
+  }
+}
+
+static
+void readAttr(dynarr_specError* errs, specDef* def, const eexpr* attr) {
+  eexpr* key, *body;
+  eexpr_mixfixText keyText;
+  if (!eexpr_asColon(attr, &key, &body)) { specErr(errs, attr, "expected-attr"); return; }
+  if (!asText(key, &keyText)) { specErr(errs, key, "expected-attr-name"); return; }
+  if (false) { assert(false); }
+  else if (textIs(keyText, "before")) { readNames(errs, body, &def->higherThan); }
+  else if (textIs(keyText, "simul")) { readNames(errs, body, &def->sameAs); }
+  else if (textIs(keyText, "after")) { readNames(errs, body, &def->lowerThan); }
+  else if (textIs(keyText, "assoc")) {
+    eexpr_mixfixText value;
+    eexpr_mixfixAssoc assoc;
+    if (!asText(body, &value)) { specErr(errs, body, "expected-associativity"); return; }
+    if (false) { assert(false); }
+    else if (textIs(value, "left")) { assoc = EEXPR_ASSOC_LEFT; }
+    else if (textIs(value, "right")) { assoc = EEXPR_ASSOC_RIGHT; }
+    else if (textIs(value, "none")) { assoc = EEXPR_ASSOC_NONE; }
+    else { specErr(errs, body, "expected-associativity"); return; }
+    if (def->hasAssoc) { specErr(errs, attr, "duplicate-associativity"); return; }
+    def->hasAssoc = true;
+    def->assoc = assoc;
+  }
+  else if (textIs(keyText, "pattern")) {
+    size_t n; eexpr** xs;
+    if (!eexpr_asSpace(body, &n, &xs)) { specErr(errs, body, "expected-symbols-and-holes"); return; }
+    if (def->hasPattern) { specErr(errs, attr, "duplicate-template"); return; }
+    def->hasPattern = true;
+    for (size_t i = 0; i < n; ++i) {
+      eexpr_mixfixText part = {.nBytes = 0, .utf8str = NULL};
+      eexpr* inner;
+      if (asText(xs[i], &part)) { /* a literal */ }
+      else if (eexpr_asParen(xs[i], &inner) && inner == NULL) { /* a hole */ }
+      else { specErr(errs, xs[i], "expected-template-part"); continue; }
+      dynarr_push_eexpr_mixfixText(&def->parts, &part);
+    }
+  }
+  else { specErr(errs, key, "unknown-attribute-name"); }
+}
+
+// `mixfix <name>:` followed by a block of attributes.
+static
+void readDef(dynarr_specError* errs, dynarr_specDef* defs, const eexpr* top) {
+  size_t n; eexpr** xs;
+  eexpr_mixfixText keyword;
+  if (!eexpr_asSpace(top, &n, &xs) || !asText(xs[0], &keyword) || !textIs(keyword, "mixfix")) {
+    specErr(errs, top, "not-a-mixfix");
+    return;
+  }
+  if (n != 2) { specErr(errs, xs[2], "unexpected-expr-after-definition"); return; }
+  size_t nChain; eexpr** chain;
+  if (!eexpr_asChain(xs[1], &nChain, &chain) || nChain != 2) { specErr(errs, xs[1], "expected-name-and-block"); return; }
+  specDef def = {.loc = eexpr_getSpan(top), .assoc = EEXPR_ASSOC_NONE, .hasAssoc = false, .hasPattern = false};
+  if (!asText(chain[0], &def.name)) { specErr(errs, chain[0], "expected-name"); return; }
+  size_t nAttrs; eexpr** attrs;
+  if (!eexpr_asBlock(chain[1], &nAttrs, &attrs)) { specErr(errs, chain[1], "expected-block"); return; }
+  dynarr_init_eexpr_mixfixText(&def.parts, 8);
+  dynarr_init_eexpr_mixfixText(&def.lowerThan, 4);
+  dynarr_init_eexpr_mixfixText(&def.sameAs, 4);
+  dynarr_init_eexpr_mixfixText(&def.higherThan, 4);
+  for (size_t i = 0; i < nAttrs; ++i) {
+    readAttr(errs, &def, attrs[i]);
+  }
+  if (!def.hasPattern) { specErr(errs, top, "missing-template"); }
+  dynarr_push_specDef(defs, &def);
+}
+
+static
+const char* defErrorName(eexpr_mixfixDefErrorType type) {
+  switch (type) {
+    case EEXPR_MIXFIX_EMPTY_TEMPLATE: return "empty-template";
+    case EEXPR_MIXFIX_ZERO_HOLES: return "zero-holes";
+    case EEXPR_MIXFIX_ZERO_LITERALS: return "zero-literals";
+    case EEXPR_MIXFIX_DOUBLED_HOLES: return "doubled-holes";
+    case EEXPR_MIXFIX_DUPLICATE_NAME: return "duplicate-name";
+    case EEXPR_MIXFIX_UNKNOWN_NAME: return "unknown-name";
+    case EEXPR_MIXFIX_UNSOLVABLE_PRECEDENCE: return "unsolvable-precedence";
+    case EEXPR_MIXFIX_AMBIGUOUS: return "ambiguous";
+  }
+  assert(false);
+  return NULL;
+}
+
+static
+void fdumpDefName(FILE* fp, const specDef* def) {
+  fdumpStrn(fp, def->name.nBytes, (uint8_t*)def->name.utf8str);
+}
+
+eexpr_mixfixTable* readMixfixSpec(FILE* errFp, const char* filename) {
+  str input = readFile(filename);
+  if (input.bytes == NULL) {
+    fprintf(errFp, "error opening mixfix spec file for reading\n");
+    return NULL;
+  }
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  eexpr_parse(&parser, input.len, input.bytes);
+  eexpr_mixfixTable* table = NULL;
+  dynarr_specError errs; dynarr_init_specError(&errs, 4);
+  dynarr_specDef defs; dynarr_init_specDef(&defs, 16);
+  if (parser.nErrors != 0) {
+    fprintf(errFp, "{ \"filename\": ");
+    fdumpCStr(errFp, (char*)filename);
+    fprintf(errFp, "\n, \"errors\":");
+    fdumpErrorArray(errFp, parser.lines, "  ", parser.nErrors, parser.errors);
+    fprintf(errFp, "\n}\n");
+    goto cleanup;
+  }
+  for (size_t i = 0; i < parser.nEexprs; ++i) {
+    readDef(&errs, &defs, parser.eexprs[i]);
+  }
+  if (errs.len != 0) {
+    fprintf(errFp, "{ \"filename\": ");
+    fdumpCStr(errFp, (char*)filename);
+    fprintf(errFp, "\n, \"errors\":");
+    for (size_t i = 0; i < errs.len; ++i) {
+      fprintf(errFp, "\n  %s {\"loc\":", i == 0 ? "[" : ",");
+      fdumpLoc(errFp, parser.lines, errs.data[i].loc);
+      fprintf(errFp, ",\"type\":\"%s\"}", errs.data[i].type);
+    }
+    fprintf(errFp, "\n  ]\n}\n");
+    goto cleanup;
+  }
+  {
+    // the definitions borrow text from the spec's eexprs, which are still alive
+    eexpr_mixfixDef* mixfixDefs = malloc((defs.len == 0 ? 1 : defs.len) * sizeof(eexpr_mixfixDef));
+    checkOom(mixfixDefs);
+    for (size_t i = 0; i < defs.len; ++i) {
+      const specDef* def = &defs.data[i];
+      mixfixDefs[i] = (eexpr_mixfixDef){
+        .name = def->name,
+        .nParts = def->parts.len,
+        .parts = def->parts.data,
+        .assoc = def->assoc,
+        .lowerThan = {.n = def->lowerThan.len, .names = def->lowerThan.data},
+        .sameAs = {.n = def->sameAs.len, .names = def->sameAs.data},
+        .higherThan = {.n = def->higherThan.len, .names = def->higherThan.data}
+      };
+    }
+    size_t nDefErrors; eexpr_mixfixDefError* defErrors;
+    table = eexpr_mixfixTable_new(defs.len, mixfixDefs, &nDefErrors, &defErrors);
+    if (table == NULL) {
+      fprintf(errFp, "{ \"filename\": ");
+      fdumpCStr(errFp, (char*)filename);
+      fprintf(errFp, "\n, \"errors\":");
+      for (size_t i = 0; i < nDefErrors; ++i) {
+        const eexpr_mixfixDefError* err = &defErrors[i];
+        fprintf(errFp, "\n  %s {\"loc\":", i == 0 ? "[" : ",");
+        fdumpLoc(errFp, parser.lines, defs.data[err->def].loc);
+        fprintf(errFp, ",\"type\":\"%s\",\"definition\":", defErrorName(err->type));
+        fdumpDefName(errFp, &defs.data[err->def]);
+        if (err->other != EEXPR_MIXFIX_NONE) {
+          fprintf(errFp, ",\"other\":");
+          fdumpDefName(errFp, &defs.data[err->other]);
+        }
+        if (err->type == EEXPR_MIXFIX_UNKNOWN_NAME) {
+          fprintf(errFp, ",\"name\":");
+          fdumpStrn(errFp, err->name.nBytes, (uint8_t*)err->name.utf8str);
+        }
+        fprintf(errFp, "}");
+      }
+      fprintf(errFp, "\n  ]\n}\n");
+      free(defErrors);
+    }
+    free(mixfixDefs);
+  }
+  cleanup:
+  for (size_t i = 0; i < defs.len; ++i) {
+    dynarr_deinit_eexpr_mixfixText(&defs.data[i].parts);
+    dynarr_deinit_eexpr_mixfixText(&defs.data[i].lowerThan);
+    dynarr_deinit_eexpr_mixfixText(&defs.data[i].sameAs);
+    dynarr_deinit_eexpr_mixfixText(&defs.data[i].higherThan);
+  }
+  dynarr_deinit_specDef(&defs);
+  dynarr_deinit_specError(&errs);
+  eexpr_parser_deinit(&parser);
+  for (size_t i = 0; i < parser.nEexprs; ++i) {
+    eexpr_del(parser.eexprs[i]);
+  }
+  free(parser.eexprs);
+  free(parser.errors);
+  free(parser.warnings);
+  eexpr_lineIndex_del(parser.lines);
+  free(input.bytes);
+  return table;
+}
@@ -0,0 +1,33 @@
+#ifndef APP_MIXFIXSPEC_H
+#define APP_MIXFIXSPEC_H
+
+#include <stdio.h>
+
+#include "eexpr.h"
+
+/*
+Reader for the mixfix specification language, as recognized by `Data.Eexpr.Mixfix.Grammar` in the Haskell package:
+
+```
+mixfix add:
+  pattern: () + ()
+  assoc: left
+mixfix mul:
+  before: add
+  pattern: () times ()
+  assoc: left
+```
+
+Each definition is a `mixfix` keyword, a name, and a block of attributes:
+  `pattern` (required) gives the template as symbols and `()` holes,
+  `assoc` is one of `left`, `right` or `none` (the default),
+  and `before`, `simul` and `after` take a symbol or comma-separated symbols naming the definitions
+  this one binds tighter than, the same as, or looser than.
+*/
+
+// Read and compile the definitions in a spec file.
+// Problems with the spec are written to `errFp` as json, in which case this returns `NULL`.
+eexpr_mixfixTable* readMixfixSpec(FILE* errFp, const char* filename);
+
+
+#endif
@@ -0,0 +1,329 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "eexpr.h"
+
+/*
+Search eexpr files for the entries picked out by a query (see `eexpr_queryCompile` for the query language).
+
+  eexprq [-j <threads>] [-c | -l] [-m <max>] <query> <file>...
+
+Each match is written to stdout as `file:line:col: value`, where the location is that of the entry (counting from one),
+  and the value is printed as by `eexpr_print` (except that a block value goes on the following lines, indented by two spaces).
+With `-c`, only the number of matches in each file is written, as `file:count`;
+  with `-l`, only the names of files with a match, and each file is only searched up to its first match.
+`-m <max>` stops searching each file after that many matches.
+
+Files are searched in parallel by a pool of threads (`-j`, by default one per processor), each with its own parser;
+  files are memory-mapped rather than read, and parsed with lazy payloads and no line index,
+  so that only the payloads the query looks at are decoded, and only files with matches to locate are indexed.
+Output is buffered per file and written in the order the files were given, so it does not depend on the number of threads.
+Parse errors are written to stderr (with their location; see eexpr2json for the details).
+As with grep(1), the exit code is 0 if anything matched, 1 if nothing did, and 2 if the query did not compile or any file could not be read or parsed.
+*/
+
+typedef enum outputMode {
+  OUTPUT_MATCHES,
+  OUTPUT_COUNTS,
+  OUTPUT_FILES
+} outputMode;
+
+typedef struct job {
+  const char* filename;
+  char* out; // owned, the output for this file
+  size_t outLen;
+  char* err; // owned, likewise for stderr
+  size_t errLen;
+  size_t nMatches;
+  bool failed;
+  bool done; // under `pool.lock`
+} job;
+
+typedef struct pool {
+  const eexpr_query* query;
+  outputMode mode;
+  size_t maxMatches; // zero for no limit
+  size_t nJobs;
+  job* jobs;
+  mtx_t lock;
+  cnd_t finished; // signals that a job is done
+  size_t next; // the next job to take, under `.lock`
+} pool;
+
+// What a worker needs while running the query over one file.
+typedef struct search {
+  const pool* p;
+  const char* filename;
+  size_t nBytes;
+  const uint8_t* bytes;
+  eexpr_lineIndex* lines; // built on the first match that needs locating
+  FILE* out;
+  size_t nMatches;
+  size_t cap;
+  uint8_t* buf; // owned by the worker, and re-used for printing every match
+} search;
+
+static const uint8_t emptyFile[1] = {0};
+
+static
+const char* queryErrorName(eexpr_queryErrorType type) {
+  switch (type) {
+    case EEXPR_QUERY_ERR_EMPTY_STEP: return "empty step";
+    case EEXPR_QUERY_ERR_BAD_PATTERN: return "bad glob pattern";
+    case EEXPR_QUERY_ERR_BAD_PREDICATE: return "bad predicate";
+    case EEXPR_QUERY_ERR_BAD_LITERAL: return "bad literal";
+    case EEXPR_QUERY_ERR_UNCLOSED_PREDICATE: return "unclosed predicate";
+    case EEXPR_QUERY_ERR_EXPECTED_SLASH: return "expected `/`";
+    case EEXPR_QUERY_ERR_TOO_MANY_STEPS: return "too many steps";
+  }
+  return "unknown error";
+}
+
+// Empty files cannot be mapped, so they are given a stand-in.
+static
+bool mapFile(const char* filename, size_t* nBytes, const uint8_t** bytes) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) { return false; }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+  *nBytes = (size_t)st.st_size;
+  if (*nBytes == 0) {
+    close(fd);
+    *bytes = emptyFile;
+    return true;
+  }
+  void* addr = mmap(NULL, *nBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) { return false; }
+  *bytes = addr;
+  return true;
+}
+
+static
+bool onMatch(void* ctx, const eexpr* entry, size_t nValues, eexpr* const* values) {
+  search* s = ctx;
+  s->nMatches += 1;
+  if (s->p->mode == OUTPUT_FILES) { return false; }
+  if (s->p->mode == OUTPUT_MATCHES) {
+    if (s->lines == NULL) { s->lines = eexpr_lineIndex_new(s->nBytes, s->bytes); }
+    eexpr_loc loc = eexpr_locate(s->lines, entry);
+    // a block value is written as its items, indented under the location, as it would have been in the file
+    eexpr** items;
+    bool isBlock = nValues == 1 && eexpr_asBlock(values[0], &nValues, &items);
+    if (isBlock) { values = items; }
+    size_t len = eexpr_print(nValues, values, s->cap, s->buf);
+    if (len > s->cap) {
+      free(s->buf);
+      s->cap = 2 * len;
+      s->buf = malloc(s->cap);
+      if (s->buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+      }
+      eexpr_print(nValues, values, s->cap, s->buf);
+    }
+    if (len != 0 && s->buf[len - 1] == '\n') { len -= 1; }
+    if (!isBlock) {
+      fprintf(s->out, "%s:%zu:%zu: %.*s\n", s->filename, loc.start.line + 1, loc.start.col + 1, (int)len, (char*)s->buf);
+    }
+    else {
+      fprintf(s->out, "%s:%zu:%zu:\n  ", s->filename, loc.start.line + 1, loc.start.col + 1);
+      for (size_t i = 0; i < len; ++i) {
+        fputc(s->buf[i], s->out);
+        if (s->buf[i] == '\n') { fputs("  ", s->out); }
+      }
+      fputc('\n', s->out);
+    }
+  }
+  return s->p->maxMatches == 0 || s->nMatches < s->p->maxMatches;
+}
+
+static
+void runJob(const pool* p, job* j, eexpr_parser* parser, size_t* cap, uint8_t** buf) {
+  FILE* out = open_memstream(&j->out, &j->outLen);
+  FILE* err = open_memstream(&j->err, &j->errLen);
+  if (out == NULL || err == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(2);
+  }
+  search s = {.p = p, .filename = j->filename, .lines = NULL, .out = out, .nMatches = 0, .cap = *cap, .buf = *buf};
+  if (!mapFile(j->filename, &s.nBytes, &s.bytes)) {
+    fprintf(err, "%s: error opening input file for reading\n", j->filename);
+    j->failed = true;
+  }
+  else {
+    eexpr_parse(parser, s.nBytes, (uint8_t*)s.bytes);
+    if (parser->nErrors != 0) {
+      s.lines = eexpr_lineIndex_new(s.nBytes, s.bytes);
+      for (size_t i = 0; i < parser->nErrors; ++i) {
+        eexpr_loc loc = eexpr_resolveSpan(s.lines, parser->errors[i].loc);
+        fprintf(err, "%s:%zu:%zu: parse error\n", j->filename, loc.start.line + 1, loc.start.col + 1);
+      }
+      j->failed = true;
+    }
+    else {
+      eexpr_queryRun(p->query, parser->nEexprs, parser->eexprs, onMatch, &s);
+    }
+    eexpr_parser_reset(parser);
+    eexpr_lineIndex_del(s.lines);
+    if (s.bytes != emptyFile) { munmap((void*)s.bytes, s.nBytes); }
+  }
+  j->nMatches = s.nMatches;
+  if (p->mode == OUTPUT_COUNTS) { fprintf(out, "%s:%zu\n", j->filename, s.nMatches); }
+  if (p->mode == OUTPUT_FILES && s.nMatches != 0) { fprintf(out, "%s\n", j->filename); }
+  fclose(out);
+  fclose(err);
+  *cap = s.cap;
+  *buf = s.buf;
+}
+
+static
+int workerMain(void* arg) {
+  pool* p = arg;
+  eexpr_parser parser;
+  eexpr_parserInitDefault(&parser);
+  parser.lazyPayloads = true;
+  parser.lazyLines = true;
+  size_t cap = 256;
+  uint8_t* buf = malloc(cap);
+  if (buf == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(2);
+  }
+  while (true) {
+    mtx_lock(&p->lock);
+    size_t i = p->next;
+    if (i < p->nJobs) { p->next += 1; }
+    mtx_unlock(&p->lock);
+    if (i == p->nJobs) { break; }
+    runJob(p, &p->jobs[i], &parser, &cap, &buf);
+    mtx_lock(&p->lock);
+    p->jobs[i].done = true;
+    cnd_broadcast(&p->finished);
+    mtx_unlock(&p->lock);
+  }
+  eexpr_parser_deinit(&parser);
+  free(parser.eexprs);
+  free(parser.errors);
+  free(parser.warnings);
+  free(buf);
+  return 0;
+}
+
+static
+void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [-j <threads>] [-c | -l] [-m <max>] <query> <file>...\n", argv0);
+  exit(2);
+}
+
+// The value of an option is either attached to it (`-j4`) or the next argument (`-j 4`).
+static
+const char* optionValue(int argc, char** argv, int* argi) {
+  if (argv[*argi][2] != '\0') { return &argv[*argi][2]; }
+  *argi += 1;
+  return *argi < argc ? argv[*argi] : NULL;
+}
+
+static
+size_t countArg(const char* argv0, const char* arg) {
+  char* end;
+  long n = arg == NULL ? -1 : strtol(arg, &end, 10);
+  if (n < 0 || *end != '\0') { usage(argv0); }
+  return (size_t)n;
+}
+
+int main(int argc, char** argv) {
+  pool p = {.mode = OUTPUT_MATCHES, .maxMatches = 0, .next = 0};
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t nThreads = online > 0 ? (size_t)online : 1;
+  int argi = 1;
+  for (; argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0'; ++argi) {
+    const char* opt = argv[argi];
+    if (strcmp(opt, "--") == 0) {
+      argi += 1;
+      break;
+    }
+    else if (strcmp(opt, "-c") == 0) { p.mode = OUTPUT_COUNTS; }
+    else if (strcmp(opt, "-l") == 0) { p.mode = OUTPUT_FILES; }
+    else if (strncmp(opt, "-j", 2) == 0) {
+      nThreads = countArg(argv[0], optionValue(argc, argv, &argi));
+      if (nThreads == 0) { usage(argv[0]); }
+    }
+    else if (strncmp(opt, "-m", 2) == 0) {
+      p.maxMatches = countArg(argv[0], optionValue(argc, argv, &argi));
+    }
+    else { usage(argv[0]); }
+  }
+  if (argc - argi < 2) { usage(argv[0]); }
+
+  const char* queryText = argv[argi];
+  eexpr_queryError qErr;
+  eexpr_query* query = eexpr_queryCompile(strlen(queryText), (const uint8_t*)queryText, &qErr);
+  if (query == NULL) {
+    fprintf(stderr, "%s: %s at offset %zu of the query\n", argv[0], queryErrorName(qErr.type), qErr.offset);
+    return 2;
+  }
+  p.query = query;
+  p.nJobs = (size_t)(argc - argi - 1);
+  p.jobs = calloc(p.nJobs, sizeof(job));
+  thrd_t* workers = malloc((nThreads < p.nJobs ? nThreads : p.nJobs) * sizeof(thrd_t));
+  if (p.jobs == NULL || workers == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 2;
+  }
+  for (size_t i = 0; i < p.nJobs; ++i) {
+    p.jobs[i].filename = argv[argi + 1 + i];
+  }
+  if (nThreads > p.nJobs) { nThreads = p.nJobs; }
+  if (mtx_init(&p.lock, mtx_plain) != thrd_success || cnd_init(&p.finished) != thrd_success) {
+    fprintf(stderr, "could not start worker threads\n");
+    return 2;
+  }
+  for (size_t t = 0; t < nThreads; ++t) {
+    if (thrd_create(&workers[t], workerMain, &p) != thrd_success) {
+      fprintf(stderr, "could not start worker threads\n");
+      return 2;
+    }
+  }
+
+  // write each file's output as soon as it and every file before it are done
+  bool matched = false;
+  bool failed = false;
+  for (size_t i = 0; i < p.nJobs; ++i) {
+    job* j = &p.jobs[i];
+    mtx_lock(&p.lock);
+    while (!j->done) { cnd_wait(&p.finished, &p.lock); }
+    mtx_unlock(&p.lock);
+    // stdout is flushed first, so that errors land among the matches in file order, even when both go to the same place
+    if (j->errLen != 0) {
+      fflush(stdout);
+      fwrite(j->err, 1, j->errLen, stderr);
+    }
+    fwrite(j->out, 1, j->outLen, stdout);
+    free(j->err);
+    free(j->out);
+    matched = matched || j->nMatches != 0;
+    failed = failed || j->failed;
+  }
+
+  for (size_t t = 0; t < nThreads; ++t) {
+    thrd_join(workers[t], NULL);
+  }
+  cnd_destroy(&p.finished);
+  mtx_destroy(&p.lock);
+  free(workers);
+  free(p.jobs);
+  eexpr_query_del(query);
+  return failed ? 2 : matched ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "eexpr.h"
+
+/*
+Benchmark for validating eexprs against a schema (see `eexpr_schemaCompile`), compared to parsing them in the first place.
+
+  eexpr-schema-bench [records] [iterations]
+
+The document is made of server records like this one:
+
+  server host7:
+    port: 8007
+    tags: [web, "prod", 7]
+    limits: {cpu: 2, mem: 512}
+
+and is checked against the schema in `schemaText` below.
+Each iteration parses the document (with lazy payloads, as a validator would), and then validates the freshly-parsed eexprs twice:
+  the first time decodes the payloads that have to be checked, the second time finds them already decoded.
+Before timing, an invalid record is checked to make sure that validation is not trivially passing.
+*/
+
+static const char* schemaText =
+  "server: space [is server, chain [symbol \"host*\", serverBody]]\n"
+  "serverBody:\n"
+  "  port: int 1..65535\n"
+  "  tags: list oneOf [symbol, string, int 0..]\n"
+  "  limits: {cpu: int 1..64, mem: int 0.., disk: optional int 0..}\n";
+
+static const char* badRecord =
+  "server host0:\n  port: 80000\n  tags: [web, 1.5]\n  limits: {cpu: 2}\n";
+
+static
+double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static
+size_t writeText(long nRecords, size_t cap, char* buf) {
+  size_t len = 0;
+  for (long i = 0; i < nRecords; ++i) {
+    int n = snprintf(&buf[len], cap - len,
+      "server host%ld:\n  port: %ld\n  tags: [web, \"prod\", %ld]\n  limits: {cpu: 2, mem: 512}\n",
+      i, 8000 + i, i);
+    if (n < 0 || (size_t)n >= cap - len) { fprintf(stderr, "text buffer too small\n"); exit(1); }
+    len += n;
+  }
+  return len;
+}
+
+static
+void delParser(eexpr_parser* parser) {
+  eexpr_parser_deinit(parser);
+  for (size_t i = 0; i < parser->nEexprs; ++i) {
+    eexpr_del(parser->eexprs[i]);
+  }
+  free(parser->eexprs);
+  free(parser->errors);
+  free(parser->warnings);
+  eexpr_lineIndex_del(parser->lines);
+}
+
+static
+void initParser(eexpr_parser* parser, const char* text) {
+  eexpr_parserInitDefault(parser);
+  parser->lazyLines = true;
+  parser->lazyPayloads = true;
+  eexpr_parse(parser, strlen(text), (uint8_t*)text);
+  if (parser->nErrors != 0) {
+    fprintf(stderr, "failed to parse:\n%s", text);
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    fprintf(stderr, "usage: %s [records] [iterations]\n", argv[0]);
+    return 1;
+  }
+  long nRecords = argc >= 2 ? strtol(argv[1], NULL, 10) : 1000;
+  long iterations = argc >= 3 ? strtol(argv[2], NULL, 10) : 1000;
+  if (nRecords <= 0) { nRecords = 1; }
+  if (iterations <= 0) { iterations = 1; }
+
+  eexpr_parser spec;
+  initParser(&spec, schemaText);
+  size_t nErrors;
+  eexpr_schemaError* compileErrors;
+  eexpr_schema* schema = eexpr_schemaCompile(spec.nEexprs, spec.eexprs, &nErrors, &compileErrors);
+  if (schema == NULL) {
+    fprintf(stderr, "failed to compile the schema (%zu errors)\n", nErrors);
+    return 1;
+  }
+  delParser(&spec);
+
+  eexpr_parser bad;
+  initParser(&bad, badRecord);
+  eexpr_schemaError errors[16];
+  nErrors = 16;
+  // the port, the 1.5 tag and the missing mem
+  if (eexpr_schemaValidate(schema, 0, bad.nEexprs, bad.eexprs, &nErrors, errors) || nErrors != 3) {
+    fprintf(stderr, "the invalid record was not caught (%zu errors)\n", nErrors);
+    return 1;
+  }
+  delParser(&bad);
+
+  size_t cap = 128 * (size_t)nRecords;
+  char* text = malloc(cap);
+  if (text == NULL) { fprintf(stderr, "out of memory\n"); return 1; }
+  size_t len = writeText(nRecords, cap, text);
+  eexpr_parser parser;
+  initParser(&parser, text);
+  nErrors = 0;
+  if (parser.nEexprs != (size_t)nRecords || !eexpr_schemaValidate(schema, 0, parser.nEexprs, parser.eexprs, &nErrors, errors)) {
+    fprintf(stderr, "the document does not match the schema\n");
+    return 1;
+  }
+  eexpr_parser_reset(&parser);
+
+  double timeParse = 0, timeFirst = 0, timeAgain = 0;
+  for (long k = 0; k < iterations; ++k) {
+    double start = now();
+    eexpr_parse(&parser, len, (uint8_t*)text);
+    double parsed = now();
+    nErrors = 0;
+    eexpr_schemaValidate(schema, 0, parser.nEexprs, parser.eexprs, &nErrors, errors);
+    double first = now();
+    nErrors = 0;
+    eexpr_schemaValidate(schema, 0, parser.nEexprs, parser.eexprs, &nErrors, errors);
+    double again = now();
+    timeParse += parsed - start;
+    timeFirst += first - parsed;
+    timeAgain += again - first;
+    eexpr_parser_reset(&parser);
+  }
+
+  double mb = (double)len * (double)iterations / 1e6;
+  printf("iterations: %ld of %ld records (%zu bytes)\n", iterations, nRecords, len);
+  printf("parse: %.1f ns/record, %.1f MB/s\n", timeParse / (double)iterations / (double)nRecords * 1e9, mb / timeParse);
+  printf("validate (first): %.1f ns/record, %.1f MB/s\n", timeFirst / (double)iterations / (double)nRecords * 1e9, mb / timeFirst);
+  printf("validate (again): %.1f ns/record, %.1f MB/s\n", timeAgain / (double)iterations / (double)nRecords * 1e9, mb / timeAgain);
+
+  delParser(&parser);
+  eexpr_schema_del(schema);
+  free(text);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "eexpr.h"
+#include "strstuff.h"
+
+/*
+Per-parse overhead benchmark for small documents (on the order of a hundred bytes).
+
+  eexpr-small-bench <input file> [iterations]
+
+The input is parsed over and over in five ways:
+  * fresh: a new parser for every parse, with everything freed afterwards (as a one-off parse would),
+  * reset: one parser re-used with `eexpr_parser_reset` between parses,
+  * lazy lines: as reset, but without building a line index (see `eexpr_parser.lazyLines`),
+  * batch: copies of the input given to `eexpr_parseBatch` a thousand at a time,
+  * rawlex: as reset, but pausing after the raw lexer, to show what the lexing itself costs.
+The closer reset is to rawlex, the less of each parse is spent on anything but the input.
+*/
+
+static
+double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static
+void delParser(eexpr_parser* parser) {
+  eexpr_parser_deinit(parser);
+  for (size_t i = 0; i < parser->nEexprs; ++i) {
+    eexpr_del(parser->eexprs[i]);
+  }
+  free(parser->eexprs);
+  free(parser->errors);
+  free(parser->warnings);
+  eexpr_lineIndex_del(parser->lines);
+}
+
+static
+double timeFresh(str input, long iterations) {
+  double start = now();
+  for (long i = 0; i < iterations; ++i) {
+    eexpr_parser parser; eexpr_parserInitDefault(&parser);
+    eexpr_parse(&parser, input.len, input.bytes);
+    delParser(&parser);
+  }
+  return now() - start;
+}
+
+static
+double timeReset(str input, long iterations, enum eexpr_parsePauseAt pauseAt, bool lazyLines) {
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  parser.pauseAt = pauseAt;
+  parser.lazyLines = lazyLines;
+  double start = now();
+  for (long i = 0; i < iterations; ++i) {
+    eexpr_parse(&parser, input.len, input.bytes);
+    eexpr_parser_reset(&parser);
+  }
+  double out = now() - start;
+  delParser(&parser);
+  return out;
+}
+
+#define BATCH_SIZE 1000
+
+static
+double timeBatch(str input, long iterations) {
+  size_t lens[BATCH_SIZE];
+  uint8_t* inputs[BATCH_SIZE];
+  for (size_t i = 0; i < BATCH_SIZE; ++i) {
+    lens[i] = input.len;
+    inputs[i] = input.bytes;
+  }
+  eexpr_batchResult* results = malloc(BATCH_SIZE * sizeof(eexpr_batchResult));
+  if (results == NULL) { exit(1); }
+  eexpr_parser parser; eexpr_parserInitDefault(&parser);
+  double start = now();
+  for (long done = 0; done < iterations; done += BATCH_SIZE) {
+    size_t n = iterations - done < BATCH_SIZE ? (size_t)(iterations - done) : BATCH_SIZE;
+    eexpr_parseBatch(&parser, n, lens, inputs, results);
+    for (size_t i = 0; i < n; ++i) {
+      eexpr_lineIndex_del(results[i].lines);
+    }
+    eexpr_parser_reset(&parser);
+  }
+  double out = now() - start;
+  delParser(&parser);
+  free(results);
+  return out;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "usage: %s <input file> [iterations]\n", argv[0]);
+    return 1;
+  }
+  long iterations = argc == 3 ? strtol(argv[2], NULL, 10) : 100000;
+  if (iterations <= 0) { iterations = 1; }
+
+  str input = readFile(argv[1]);
+  if (input.bytes == NULL) {
+    fprintf(stderr, "error opening input file for reading\n");
+    return 1;
+  }
+  {
+    eexpr_parser parser; eexpr_parserInitDefault(&parser);
+    eexpr_parse(&parser, input.len, input.bytes);
+    size_t nErrors = parser.nErrors;
+    delParser(&parser);
+    if (nErrors != 0) {
+      fprintf(stderr, "input has parse errors\n");
+      free(input.bytes);
+      return 1;
+    }
+  }
+
+  double fresh = timeFresh(input, iterations);
+  double reset = timeReset(input, iterations, EEXPR_DO_NOT_PAUSE, false);
+  double lazyLines = timeReset(input, iterations, EEXPR_DO_NOT_PAUSE, true);
+  double batch = timeBatch(input, iterations);
+  double rawlex = timeReset(input, iterations, EEXPR_PAUSE_AFTER_RAWLEX, false);
+
+  printf("iterations: %ld of %zu bytes\n", iterations, input.len);
+  printf("fresh: %.1f ns/parse\n", fresh / (double)iterations * 1e9);
+  printf("reset: %.1f ns/parse\n", reset / (double)iterations * 1e9);
+  printf("lazy lines: %.1f ns/parse\n", lazyLines / (double)iterations * 1e9);
+  printf("batch: %.1f ns/parse\n", batch / (double)iterations * 1e9);
+  printf("rawlex: %.1f ns/parse\n", rawlex / (double)iterations * 1e9);
+  free(input.bytes);
+  return 0;
+}
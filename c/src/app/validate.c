@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/*
+Check an eexpr file against a schema (see `eexpr_schemaCompile` for the schema language).
+
+  eexpr-validate <schema file> <input file>
+
+Every top-level eexpr of the input is checked against the first definition of the schema.
+Errors are written to stdout as json, each with its location in the input and the name of the definition it was checked against.
+The exit code is 0 if the input is valid, 1 if it is not, and 2 if either file could not be read or parsed, or the schema did not compile
+  (in which case the errors are written to stderr, located in the file they were found in).
+*/
+
+#define MAX_ERRORS 256
+
+void die(const char* msg) {
+  fprintf(stderr, "%s\n", msg);
+  exit(2);
+}
+
+typedef struct input {
+  char* filename;
+  str text;
+  eexpr_parser parser;
+} input;
+
+static
+bool parseInput(input* in) {
+  in->text = readFile(in->filename);
+  if (in->text.bytes == NULL) { die("error opening input file for reading"); }
+  eexpr_parserInitDefault(&in->parser);
+  // payloads are only decoded if they have to be checked
+  in->parser.lazyPayloads = true;
+  eexpr_parse(&in->parser, in->text.len, in->text.bytes);
+  if (in->parser.nErrors == 0) { return true; }
+  fprintf(stderr, "{ \"filename\": ");
+  fdumpCStr(stderr, in->filename);
+  fprintf(stderr, "\n, \"errors\":");
+  fdumpErrorArray(stderr, in->parser.lines, "  ", in->parser.nErrors, in->parser.errors);
+  fprintf(stderr, "\n}\n");
+  return false;
+}
+
+static
+void delInput(input* in) {
+  eexpr_parser_deinit(&in->parser);
+  for (size_t i = 0; i < in->parser.nEexprs; ++i) {
+    eexpr_del(in->parser.eexprs[i]);
+  }
+  free(in->parser.eexprs);
+  free(in->parser.errors);
+  free(in->parser.warnings);
+  eexpr_lineIndex_del(in->parser.lines);
+  free(in->text.bytes);
+}
+
+static
+const char* schemaErrorName(eexpr_schemaErrorType type) {
+  switch (type) {
+    case EEXPR_SCHEMA_ERR_NO_DEFINITIONS: return "no-definitions";
+    case EEXPR_SCHEMA_ERR_BAD_DEFINITION: return "bad-definition";
+    case EEXPR_SCHEMA_ERR_DUPLICATE_NAME: return "duplicate-name";
+    case EEXPR_SCHEMA_ERR_UNKNOWN_NAME: return "unknown-name";
+    case EEXPR_SCHEMA_ERR_BAD_TYPE: return "bad-type";
+    case EEXPR_SCHEMA_ERR_BAD_ARGUMENT: return "bad-argument";
+    case EEXPR_SCHEMA_ERR_BAD_PATTERN: return "bad-pattern";
+    case EEXPR_SCHEMA_ERR_BAD_RANGE: return "bad-range";
+    case EEXPR_SCHEMA_ERR_BAD_FIELD: return "bad-field";
+    case EEXPR_SCHEMA_ERR_TOO_MANY_FIELDS: return "too-many-fields";
+    case EEXPR_SCHEMA_ERR_CYCLE: return "cycle";
+    case EEXPR_SCHEMA_ERR_WRONG_TYPE: return "wrong-type";
+    case EEXPR_SCHEMA_ERR_NO_MATCH: return "no-match";
+    case EEXPR_SCHEMA_ERR_NOT_INTEGER: return "not-integer";
+    case EEXPR_SCHEMA_ERR_OUT_OF_RANGE: return "out-of-range";
+    case EEXPR_SCHEMA_ERR_NOT_EQUAL: return "not-equal";
+    case EEXPR_SCHEMA_ERR_WRONG_LENGTH: return "wrong-length";
+    case EEXPR_SCHEMA_ERR_MISSING_FIELD: return "missing-field";
+    case EEXPR_SCHEMA_ERR_UNKNOWN_FIELD: return "unknown-field";
+    case EEXPR_SCHEMA_ERR_DUPLICATE_FIELD: return "duplicate-field";
+    case EEXPR_SCHEMA_ERR_NO_ALTERNATIVE: return "no-alternative";
+  }
+  return "unknown";
+}
+
+static const char* const typeNames[] = {
+  "symbol", "number", "string", "paren", "brack", "brace", "block", "predot",
+  "chain", "space", "ellipsis", "colon", "comma", "semicolon", "mixfix"
+};
+
+// Definitions are named, if there is a schema to name them with.
+static
+void fdumpSchemaError(FILE* fp, const eexpr_lineIndex* lines, const eexpr_schema* schema, const eexpr_schemaError* err) {
+  fprintf(fp, "{\"loc\":");
+  fdumpLoc(fp, lines, err->loc);
+  fprintf(fp, ",\"type\":\"%s\"", schemaErrorName(err->type));
+  size_t nBytes;
+  const uint8_t* name;
+  if (schema != NULL && eexpr_schema_name(schema, err->def, &nBytes, &name)) {
+    fprintf(fp, ",\"definition\":");
+    fdumpStrn(fp, nBytes, (uint8_t*)name);
+  }
+  switch (err->type) {
+    case EEXPR_SCHEMA_ERR_DUPLICATE_NAME: case EEXPR_SCHEMA_ERR_UNKNOWN_NAME:
+    case EEXPR_SCHEMA_ERR_MISSING_FIELD: case EEXPR_SCHEMA_ERR_UNKNOWN_FIELD: case EEXPR_SCHEMA_ERR_DUPLICATE_FIELD: {
+      fprintf(fp, ",\"name\":");
+      fdumpStrn(fp, err->as.name.nBytes, (uint8_t*)err->as.name.utf8str);
+    }; break;
+    case EEXPR_SCHEMA_ERR_WRONG_TYPE: {
+      fprintf(fp, ",\"expected\":[");
+      const char* separator = "";
+      for (size_t t = 0; t < sizeof(typeNames) / sizeof(typeNames[0]); ++t) {
+        if ((err->as.expected & (1u << t)) == 0) { continue; }
+        fprintf(fp, "%s\"%s\"", separator, typeNames[t]);
+        separator = ",";
+      }
+      fprintf(fp, "]");
+    }; break;
+    case EEXPR_SCHEMA_ERR_WRONG_LENGTH: {
+      fprintf(fp, ",\"length\":%zu", err->as.length);
+    }; break;
+    default: break;
+  }
+  fprintf(fp, "}");
+}
+
+static
+void fdumpSchemaErrorArray(FILE* fp, const eexpr_lineIndex* lines, const eexpr_schema* schema, size_t n, const eexpr_schemaError* arr) {
+  if (n == 0) {
+    fprintf(fp, " []");
+    return;
+  }
+  const char* separator = "[ ";
+  for (size_t i = 0; i < n; ++i) {
+    fprintf(fp, "\n  %s", separator);
+    fdumpSchemaError(fp, lines, schema, &arr[i]);
+    separator = ", ";
+  }
+  fprintf(fp, "\n  ]");
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <schema file> <input file>\n", argv[0]);
+    return 2;
+  }
+  input spec = {.filename = argv[1]};
+  input in = {.filename = argv[2]};
+  bool ok = parseInput(&spec);
+  ok = parseInput(&in) && ok;
+  if (!ok) {
+    delInput(&spec);
+    delInput(&in);
+    return 2;
+  }
+
+  size_t nErrors;
+  eexpr_schemaError* compileErrors;
+  eexpr_schema* schema = eexpr_schemaCompile(spec.parser.nEexprs, spec.parser.eexprs, &nErrors, &compileErrors);
+  if (schema == NULL) {
+    fprintf(stderr, "{ \"filename\": ");
+    fdumpCStr(stderr, spec.filename);
+    fprintf(stderr, "\n, \"schemaErrors\":");
+    fdumpSchemaErrorArray(stderr, spec.parser.lines, NULL, nErrors, compileErrors);
+    fprintf(stderr, "\n}\n");
+    free(compileErrors);
+    delInput(&spec);
+    delInput(&in);
+    return 2;
+  }
+
+  eexpr_schemaError errors[MAX_ERRORS];
+  nErrors = MAX_ERRORS;
+  bool valid = eexpr_schemaValidate(schema, 0, in.parser.nEexprs, in.parser.eexprs, &nErrors, errors);
+
+  fprintf(stdout, "{ \"filename\": ");
+  fdumpCStr(stdout, in.filename);
+  fprintf(stdout, "\n, \"errors\":");
+  fdumpSchemaErrorArray(stdout, in.parser.lines, schema, nErrors, errors);
+  fprintf(stdout, "\n}\n");
+
+  eexpr_schema_del(schema);
+  delInput(&spec);
+  delInput(&in);
+  return valid ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+#include "common.h"
+
+
+#define ARENA_FIRST_BLOCK 4096
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+eexpr_arena* arena_new(void) {
+  eexpr_arena* self = malloc(sizeof(eexpr_arena));
+  checkOom(self);
+  dynarr_init_arenaBlock(&self->blocks, 8);
+  self->block = 0;
+  self->used = 0;
+  return self;
+}
+
+void* arena_alloc(eexpr_arena* self, size_t nBytes) {
+  nBytes = (nBytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  // move on to the next block with enough room left, if need be
+  // (what is left over in the blocks skipped over goes unused until the next reset)
+  while (self->block < self->blocks.len && self->blocks.data[self->block].cap - self->used < nBytes) {
+    self->block += 1;
+    self->used = 0;
+  }
+  if (self->block == self->blocks.len) {
+    size_t cap = self->blocks.len == 0 ? ARENA_FIRST_BLOCK : 2 * self->blocks.data[self->blocks.len - 1].cap;
+    while (cap < nBytes) { cap *= 2; }
+    arenaBlock new = {.cap = cap, .bytes = malloc(cap)};
+    checkOom(new.bytes);
+    dynarr_push_arenaBlock(&self->blocks, &new);
+    self->used = 0;
+  }
+  void* out = &self->blocks.data[self->block].bytes[self->used];
+  self->used += nBytes;
+  return out;
+}
+
+void arena_reset(eexpr_arena* self) {
+  self->block = 0;
+  self->used = 0;
+}
+
+void arena_del(eexpr_arena* self) {
+  for (size_t i = 0; i < self->blocks.len; ++i) {
+    free(self->blocks.data[i].bytes);
+  }
+  dynarr_deinit_arenaBlock(&self->blocks);
+  free(self);
+}
@@ -0,0 +1,37 @@
+#ifndef INTERNAL_ARENA_H
+#define INTERNAL_ARENA_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// Memory is handed out from blocks in order, each twice the size of the one before,
+//   so that a long-lived arena makes only a logarithmic number of allocations.
+// Resetting rewinds to the first block, so that an arena re-used for similar work allocates nothing at all.
+typedef struct arenaBlock {
+  size_t cap;
+  uint8_t* bytes; // owned
+} arenaBlock;
+
+#define TYPE arenaBlock
+#include "dynarr.h"
+
+struct eexpr_arena {
+  dynarr_arenaBlock blocks;
+  size_t block; // index into `blocks` of the block memory is being handed out from
+  size_t used; // bytes handed out from that block so far
+};
+
+eexpr_arena* arena_new(void);
+
+// Uninitialized memory, suitably aligned for any type.
+void* arena_alloc(eexpr_arena* self, size_t nBytes);
+
+// Take back everything handed out, but keep the blocks for re-use.
+void arena_reset(eexpr_arena* self);
+
+void arena_del(eexpr_arena* self);
+
+
+#endif
@@ -0,0 +1,653 @@
+#include "diff.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "hash.h"
+
+/*
+The diff works on a flattened copy of each forest (`diffSide`), with a root node standing in for the forest itself.
+Nodes are matched up between the sides in three passes, after which the edits are read off of the matching:
+  * anchoring: from the tallest down, each subtree of the old forest is matched with the first subtree of the new forest
+    that is equal to it and not yet matched, found through a table of digests;
+    every node under a matched pair is matched along with it,
+  * bottom-up: an unmatched node is matched with the new node that holds the most partners of its children,
+    as long as they are of the same shape and hold enough children in common (see `bottomUp`),
+  * recovery: top-down, the children left unmatched under each pair of matched nodes are paired up (see `recover`).
+Only nodes that have children are anchored, so that a common leaf (a symbol, say) is not matched far out of its context;
+  leaves are instead matched during recovery, which only looks among the children of nodes that are already matched.
+*/
+
+#define NO_NODE UINT32_MAX
+#define IN_RUN (UINT32_MAX - 1) // see `addReorders`
+#define ANCHOR_HEIGHT 1
+
+typedef enum matchType {
+  UNMATCHED,
+  MATCH_SAME, // the whole subtree equals its partner's
+  MATCH_INNER, // of the same shape as its partner (see `sameShape`), but their children may differ
+  MATCH_REPLACE // stands where its partner does, but is otherwise unlike it
+} matchType;
+
+typedef struct diffNode {
+  const eexpr* self; // NULL for the root
+  uint64_t digest; // kept here so that matching need not go back to the eexprs (which are scattered about memory) for it
+  uint32_t parent;
+  uint32_t slot; // index among the children of the parent
+  uint32_t kids; // index into `diffSide.kids` of the first child
+  uint32_t nKids;
+  uint32_t height; // zero for a leaf
+  uint32_t partner;
+  uint8_t match; // a `matchType`
+} diffNode;
+
+#define TYPE diffNode
+#include "dynarr.h"
+#define TYPE uint32_t
+#include "dynarr.h"
+#define TYPE eexpr_edit
+#include "dynarr.h"
+
+typedef struct diffSide {
+  dynarr_diffNode nodes; // in preorder, root first
+  const eexpr_span* spans; // borrowed, may be NULL; for a shared forest, the span of each node after the root (see `eexpr_parser.spans`)
+  dynarr_uint32_t kids; // the children of each node are kept together, in order
+} diffSide;
+
+// A chain of new nodes with the same digest, linked through `differ.next` in preorder.
+typedef struct anchorBucket {
+  uint64_t digest;
+  uint32_t first;
+  bool used;
+} anchorBucket;
+
+// For sorting children by some key during recovery.
+typedef struct keyedNode {
+  uint64_t key;
+  uint32_t node;
+} keyedNode;
+
+#define TYPE keyedNode
+#include "dynarr.h"
+
+typedef struct differ {
+  diffSide a;
+  diffSide b;
+  anchorBucket* table;
+  size_t mask;
+  uint32_t* next;
+  dynarr_uint32_t ux; // scratch: the unmatched children of an old node
+  dynarr_uint32_t uy; // scratch: the unmatched children of a new node
+  dynarr_keyedNode keyed;
+  dynarr_uint32_t tails; // scratch for `addReorders`
+  dynarr_uint32_t prev; // scratch for `addReorders`
+  dynarr_eexpr_edit edits;
+} differ;
+
+
+//////////////////////////////////// Flattening ////////////////////////////////////
+
+// The children of an eexpr are its subexprs in the order they appear in, leaving out missing (`NULL`) ones.
+static
+size_t nSlots(const eexpr* self) {
+  switch (self->type) {
+    case EEXPR_SYMBOL: case EEXPR_NUMBER: return 0;
+    case EEXPR_STRING: return self->as.string.parts.len;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: return 1;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: return self->as.list.len;
+    case EEXPR_ELLIPSIS: case EEXPR_COLON: return 2;
+    case EEXPR_MIXFIX: return self->as.mixfix.args.len;
+  }
+  return 0;
+}
+
+static
+const eexpr* slotAt(const eexpr* self, size_t i) {
+  switch (self->type) {
+    case EEXPR_SYMBOL: case EEXPR_NUMBER: return NULL;
+    case EEXPR_STRING: return self->as.string.parts.data[i].subexpr;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: return self->as.wrap;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: return self->as.list.data[i];
+    case EEXPR_ELLIPSIS: return self->as.ellipsis[i];
+    case EEXPR_COLON: return self->as.pair[i];
+    case EEXPR_MIXFIX: return self->as.mixfix.args.data[i];
+  }
+  return NULL;
+}
+
+static
+uint32_t pushNode(diffSide* side, const eexpr* self, uint32_t parent, uint32_t slot) {
+  uint32_t idx = side->nodes.len;
+  diffNode node =
+    { .self = self
+    , .digest = 0
+    , .parent = parent
+    , .slot = slot
+    , .kids = 0
+    , .nKids = 0
+    , .height = 0
+    , .partner = NO_NODE
+    , .match = UNMATCHED
+    };
+  dynarr_push_diffNode(&side->nodes, &node);
+  return idx;
+}
+
+static uint32_t flatten(diffSide* side, const eexpr* self, uint32_t parent, uint32_t slot);
+
+// Flatten the children of node `idx`, which are given either by `self` or (for the root) by the forest.
+static
+void flattenKids(diffSide* side, uint32_t idx, size_t n, const eexpr* self, eexpr* const* forest) {
+  uint32_t nKids = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if ((self == NULL ? forest[i] : slotAt(self, i)) != NULL) { nKids += 1; }
+  }
+  uint32_t kids = side->kids.len;
+  for (uint32_t k = 0; k < nKids; ++k) { dynarr_push_uint32_t(&side->kids, &idx); }
+  uint32_t height = 0;
+  uint32_t k = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const eexpr* child = self == NULL ? forest[i] : slotAt(self, i);
+    if (child == NULL) { continue; }
+    uint32_t c = flatten(side, child, idx, k);
+    side->kids.data[kids + k] = c;
+    k += 1;
+    if (height < side->nodes.data[c].height + 1) { height = side->nodes.data[c].height + 1; }
+  }
+  diffNode* node = &side->nodes.data[idx];
+  node->kids = kids;
+  node->nKids = nKids;
+  node->height = height;
+}
+
+// Hands the digests of a node's children to `hash_node` in order, which is the order of their (non-`NULL`) slots.
+typedef struct kidDigests {
+  const diffSide* side;
+  uint32_t kids;
+  uint32_t k;
+} kidDigests;
+
+static
+uint64_t nextKidDigest(void* ctx, const eexpr* child) {
+  (void)child;
+  kidDigests* st = ctx;
+  uint32_t c = st->side->kids.data[st->kids + st->k];
+  st->k += 1;
+  return st->side->nodes.data[c].digest;
+}
+
+static
+uint32_t flatten(diffSide* side, const eexpr* self, uint32_t parent, uint32_t slot) {
+  uint32_t idx = pushNode(side, self, parent, slot);
+  flattenKids(side, idx, nSlots(self), self, NULL);
+  // the children were hashed by their own `flatten`, so this only hashes the one node
+  kidDigests kids = {.side = side, .kids = side->nodes.data[idx].kids, .k = 0};
+  side->nodes.data[idx].digest = hash_node(self, false, nextKidDigest, &kids);
+  return idx;
+}
+
+static
+void diffSide_init(diffSide* side, size_t n, eexpr* const* forest, const eexpr_span* spans) {
+  side->spans = spans;
+  dynarr_init_diffNode(&side->nodes, 64);
+  dynarr_init_uint32_t(&side->kids, 64);
+  uint32_t root = pushNode(side, NULL, NO_NODE, 0);
+  flattenKids(side, root, n, NULL, forest);
+}
+
+static
+void diffSide_deinit(diffSide* side) {
+  dynarr_deinit_diffNode(&side->nodes);
+  dynarr_deinit_uint32_t(&side->kids);
+}
+
+
+//////////////////////////////////// Matching ////////////////////////////////////
+
+static
+uint64_t digestOf(const diffSide* side, uint32_t node) {
+  return side->nodes.data[node].digest;
+}
+
+static
+uint32_t kidOf(const diffSide* side, uint32_t node, uint32_t k) {
+  return side->kids.data[side->nodes.data[node].kids + k];
+}
+
+static
+void pair(differ* st, uint32_t x, uint32_t y, matchType match) {
+  st->a.nodes.data[x].partner = y;
+  st->a.nodes.data[x].match = match;
+  st->b.nodes.data[y].partner = x;
+  st->b.nodes.data[y].match = match;
+}
+
+// Equal subtrees have the same shape all the way down, so their nodes pair up one-for-one.
+static
+void pairSame(differ* st, uint32_t x, uint32_t y) {
+  pair(st, x, y, MATCH_SAME);
+  uint32_t n = st->a.nodes.data[x].nKids;
+  for (uint32_t k = 0; k < n; ++k) {
+    pairSame(st, kidOf(&st->a, x, k), kidOf(&st->b, y, k));
+  }
+}
+
+static
+bool sameText(size_t n1, const uint8_t* s1, size_t n2, const uint8_t* s2) {
+  return n1 == n2 && (n1 == 0 || memcmp(s1, s2, n1) == 0);
+}
+
+// Whether two nodes could be matched while their children differ.
+// Leaves never are: they only ever match by being equal (or else are replaced).
+static
+bool sameShape(const eexpr* a, const eexpr* b) {
+  if (a->type != b->type) { return false; }
+  switch (a->type) {
+    case EEXPR_SYMBOL: case EEXPR_NUMBER: return false;
+    case EEXPR_STRING: {
+      // the text is what the string is, its subexprs only fill in the gaps
+      const eexprStrTempl* x = &a->as.string;
+      const eexprStrTempl* y = &b->as.string;
+      if (x->parts.len == 0 || x->parts.len != y->parts.len) { return false; }
+      if (!sameText(x->text1.len, x->text1.bytes, y->text1.len, y->text1.bytes)) { return false; }
+      for (size_t i = 0; i < x->parts.len; ++i) {
+        const strTemplPart* p = &x->parts.data[i];
+        const strTemplPart* q = &y->parts.data[i];
+        if ((p->subexpr == NULL) != (q->subexpr == NULL)) { return false; }
+        if (!sameText(p->nBytes, p->utf8str, q->nBytes, q->utf8str)) { return false; }
+      }
+      return true;
+    }
+    case EEXPR_MIXFIX: return a->as.mixfix.op == b->as.mixfix.op;
+    default: return true;
+  }
+}
+
+static
+anchorBucket* findBucket(const differ* st, uint64_t digest) {
+  for (size_t i = digest & st->mask; true; i = (i + 1) & st->mask) {
+    anchorBucket* bucket = &st->table[i];
+    if (!bucket->used || bucket->digest == digest) { return bucket; }
+  }
+}
+
+static
+void anchor(differ* st) {
+  const diffSide* b = &st->b;
+  size_t nB = b->nodes.len;
+  size_t cap = 16;
+  while (cap < 2 * nB) { cap *= 2; }
+  st->mask = cap - 1;
+  st->table = calloc(cap, sizeof(anchorBucket));
+  checkOom(st->table);
+  st->next = malloc(nB * sizeof(uint32_t));
+  checkOom(st->next);
+  // pushing in reverse preorder leaves each chain in preorder
+  for (size_t y = nB - 1; y >= 1; --y) {
+    if (b->nodes.data[y].height < ANCHOR_HEIGHT) { continue; }
+    anchorBucket* bucket = findBucket(st, digestOf(b, y));
+    if (!bucket->used) {
+      bucket->used = true;
+      bucket->digest = digestOf(b, y);
+      bucket->first = NO_NODE;
+    }
+    st->next[y] = bucket->first;
+    bucket->first = y;
+  }
+
+  // counting sort of the old nodes by height, tallest first, and in preorder within a height
+  diffSide* a = &st->a;
+  size_t nA = a->nodes.len;
+  uint32_t maxHeight = a->nodes.data[0].height;
+  size_t* start = calloc(maxHeight + 2, sizeof(size_t));
+  checkOom(start);
+  for (size_t x = 1; x < nA; ++x) { start[maxHeight - a->nodes.data[x].height + 1] += 1; }
+  for (uint32_t h = 1; h <= maxHeight + 1; ++h) { start[h] += start[h - 1]; }
+  uint32_t* order = malloc((nA == 0 ? 1 : nA) * sizeof(uint32_t));
+  checkOom(order);
+  for (size_t x = 1; x < nA; ++x) { order[start[maxHeight - a->nodes.data[x].height]++] = x; }
+
+  for (size_t i = 0; i + 1 < nA; ++i) {
+    uint32_t x = order[i];
+    if (a->nodes.data[x].height < ANCHOR_HEIGHT) { break; }
+    if (a->nodes.data[x].match != UNMATCHED) { continue; }
+    anchorBucket* bucket = findBucket(st, digestOf(a, x));
+    if (!bucket->used) { continue; }
+    uint32_t* link = &bucket->first;
+    while (*link != NO_NODE) {
+      uint32_t y = *link;
+      if (b->nodes.data[y].match != UNMATCHED) {
+        *link = st->next[y]; // taken as part of a larger subtree, so drop it for good
+      }
+      else if (hash_equal(a->nodes.data[x].self, b->nodes.data[y].self, false)) {
+        *link = st->next[y];
+        pairSame(st, x, y);
+        break;
+      }
+      else {
+        link = &st->next[y];
+      }
+    }
+  }
+  free(order);
+  free(start);
+}
+
+// Match an unmatched old node with the (unmatched, same-shaped) new node that holds the most partners of its children.
+// Children are matched before their parents, so this also climbs up from nodes matched by this same pass.
+// The match is only made if the children in common make up at least half of both nodes' children.
+static
+void bottomUp(differ* st) {
+  diffSide* a = &st->a;
+  diffSide* b = &st->b;
+  uint32_t* votes = calloc(b->nodes.len, sizeof(uint32_t));
+  checkOom(votes);
+  dynarr_uint32_t* touched = &st->uy;
+  for (size_t x = a->nodes.len - 1; x >= 1; --x) {
+    const diffNode* node = &a->nodes.data[x];
+    if (node->match != UNMATCHED || node->nKids == 0) { continue; }
+    touched->len = 0;
+    for (uint32_t k = 0; k < node->nKids; ++k) {
+      uint32_t p = a->nodes.data[kidOf(a, x, k)].partner;
+      if (p == NO_NODE) { continue; }
+      uint32_t c = b->nodes.data[p].parent;
+      if (b->nodes.data[c].match != UNMATCHED) { continue; } // includes the root
+      if (votes[c]++ == 0) { dynarr_push_uint32_t(touched, &c); }
+    }
+    uint32_t best = NO_NODE;
+    uint32_t bestVotes = 0;
+    for (size_t i = 0; i < touched->len; ++i) {
+      uint32_t c = touched->data[i];
+      if (votes[c] > bestVotes && sameShape(node->self, b->nodes.data[c].self)) {
+        best = c;
+        bestVotes = votes[c];
+      }
+      votes[c] = 0;
+    }
+    if (best != NO_NODE && 4 * (size_t)bestVotes >= (size_t)node->nKids + b->nodes.data[best].nKids) {
+      pair(st, x, best, MATCH_INNER);
+    }
+  }
+  free(votes);
+}
+
+static
+int compareKeyed(const void* p, const void* q) {
+  const keyedNode* x = p;
+  const keyedNode* y = q;
+  if (x->key != y->key) { return x->key < y->key ? -1 : 1; }
+  return x->node < y->node ? -1 : x->node > y->node;
+}
+
+// Gather the still-unmatched children of a node into `out`.
+static
+void unmatchedKids(const diffSide* side, uint32_t node, dynarr_uint32_t* out) {
+  out->len = 0;
+  for (uint32_t k = 0; k < side->nodes.data[node].nKids; ++k) {
+    uint32_t c = kidOf(side, node, k);
+    if (side->nodes.data[c].match == UNMATCHED) { dynarr_push_uint32_t(out, &c); }
+  }
+}
+
+// The key that `recover` pairs children by in its second step: the type, and the digest of the first child.
+static
+uint64_t headKey(const diffSide* side, uint32_t node) {
+  const diffNode* n = &side->nodes.data[node];
+  if (n->nKids == 0) { return 0; }
+  return digestOf(side, kidOf(side, node, 0)) * 31 + n->self->type + 1;
+}
+
+// Look up each unmatched old child among the unmatched new children with the same key,
+//   pairing it with the first one that `accept`s.
+static
+void pairByKey(differ* st, uint32_t x, uint32_t y, uint64_t (*keyOf)(const diffSide*, uint32_t), bool same) {
+  unmatchedKids(&st->a, x, &st->ux);
+  unmatchedKids(&st->b, y, &st->uy);
+  if (st->ux.len == 0 || st->uy.len == 0) { return; }
+  st->keyed.len = 0;
+  for (size_t i = 0; i < st->uy.len; ++i) {
+    keyedNode k = {.key = keyOf(&st->b, st->uy.data[i]), .node = st->uy.data[i]};
+    if (!same && k.key == 0) { continue; }
+    dynarr_push_keyedNode(&st->keyed, &k);
+  }
+  qsort(st->keyed.data, st->keyed.len, sizeof(keyedNode), compareKeyed);
+  for (size_t i = 0; i < st->ux.len; ++i) {
+    uint32_t cx = st->ux.data[i];
+    uint64_t key = keyOf(&st->a, cx);
+    if (!same && key == 0) { continue; }
+    size_t lo = 0, hi = st->keyed.len;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (st->keyed.data[mid].key < key) { lo = mid + 1; } else { hi = mid; }
+    }
+    for (size_t j = lo; j < st->keyed.len && st->keyed.data[j].key == key; ++j) {
+      uint32_t cy = st->keyed.data[j].node;
+      if (st->b.nodes.data[cy].match != UNMATCHED) { continue; }
+      const eexpr* ex = st->a.nodes.data[cx].self;
+      const eexpr* ey = st->b.nodes.data[cy].self;
+      if (same && hash_equal(ex, ey, false)) {
+        pairSame(st, cx, cy);
+        break;
+      }
+      if (!same && sameShape(ex, ey)
+          && hash_equal(st->a.nodes.data[kidOf(&st->a, cx, 0)].self, st->b.nodes.data[kidOf(&st->b, cy, 0)].self, false)) {
+        pair(st, cx, cy, MATCH_INNER);
+        break;
+      }
+    }
+  }
+}
+
+// Pair up the children left unmatched under a pair of matched nodes, in steps, each taking what the last left over:
+//   1. equal subtrees, wherever they are among the children,
+//   2. nodes of the same shape whose first children are equal (such as colons with the same key, or spaces with the same head),
+//   3. nodes of the same type, in order,
+//   4. whatever is left is replaced one-for-one, but only if there is as much of it on both sides.
+// Nodes matched by steps 2 and 3 have their own children recovered when the preorder walk in `diff_forests` reaches them.
+static
+void recover(differ* st, uint32_t x, uint32_t y) {
+  pairByKey(st, x, y, digestOf, true);
+  pairByKey(st, x, y, headKey, false);
+
+  unmatchedKids(&st->a, x, &st->ux);
+  unmatchedKids(&st->b, y, &st->uy);
+  if (st->ux.len == 0 || st->uy.len == 0) { return; }
+  // in order within each type, so that the n-th old child of a type pairs with the n-th new one still unmatched
+  size_t cursor[EEXPR_MIXFIX + 1] = {0};
+  for (size_t i = 0; i < st->ux.len; ++i) {
+    uint32_t cx = st->ux.data[i];
+    const eexpr* ex = st->a.nodes.data[cx].self;
+    size_t* j = &cursor[ex->type];
+    while (*j < st->uy.len && st->b.nodes.data[st->uy.data[*j]].self->type != ex->type) { *j += 1; }
+    if (*j == st->uy.len) { continue; }
+    uint32_t cy = st->uy.data[*j];
+    *j += 1;
+    const eexpr* ey = st->b.nodes.data[cy].self;
+    pair(st, cx, cy, sameShape(ex, ey) ? MATCH_INNER : MATCH_REPLACE);
+  }
+
+  unmatchedKids(&st->a, x, &st->ux);
+  unmatchedKids(&st->b, y, &st->uy);
+  if (st->ux.len != st->uy.len) { return; }
+  for (size_t i = 0; i < st->ux.len; ++i) {
+    pair(st, st->ux.data[i], st->uy.data[i], MATCH_REPLACE);
+  }
+}
+
+
+//////////////////////////////////// Edits ////////////////////////////////////
+
+static
+eexpr_span spanOf(const diffSide* side, uint32_t node) {
+  const eexpr* self = side->nodes.data[node].self;
+  if (self == NULL) {
+    eexpr_span out = {.start = 0, .end = 0};
+    return out;
+  }
+  // nodes are pushed in the same preorder as shared spans are recorded, after the root
+  if (side->spans != NULL) { return side->spans[node - 1]; }
+  return eexpr_getSpan(self);
+}
+
+static
+eexpr_span pointAt(size_t byte) {
+  eexpr_span out = {.start = byte, .end = byte};
+  return out;
+}
+
+static
+void addEdit(differ* st, eexpr_editType type, const diffSide* aSide, uint32_t x, eexpr_span aSpan, const diffSide* bSide, uint32_t y, eexpr_span bSpan) {
+  eexpr_edit edit =
+    { .type = type
+    , .a = x == NO_NODE ? NULL : aSide->nodes.data[x].self
+    , .b = y == NO_NODE ? NULL : bSide->nodes.data[y].self
+    , .aSpan = aSpan
+    , .bSpan = bSpan
+    };
+  dynarr_push_eexpr_edit(&st->edits, &edit);
+}
+
+// Report the unmatched children of `node` as deleted (or, swapping sides, inserted),
+//   each placed in `partner` just after the partner of the last child before it that stayed under `partner`.
+static
+void addLosses(differ* st, eexpr_editType type, const diffSide* from, uint32_t node, const diffSide* to, uint32_t partner) {
+  const diffNode* p = &to->nodes.data[partner];
+  size_t point = p->nKids != 0 ? spanOf(to, kidOf(to, partner, 0)).start : spanOf(to, partner).start;
+  for (uint32_t k = 0; k < from->nodes.data[node].nKids; ++k) {
+    uint32_t c = kidOf(from, node, k);
+    const diffNode* kid = &from->nodes.data[c];
+    if (kid->match == UNMATCHED) {
+      if (type == EEXPR_EDIT_DELETE) { addEdit(st, type, from, c, spanOf(from, c), to, NO_NODE, pointAt(point)); }
+      else { addEdit(st, type, to, NO_NODE, pointAt(point), from, c, spanOf(from, c)); }
+    }
+    else if (to->nodes.data[kid->partner].parent == partner) {
+      point = spanOf(to, kid->partner).end;
+    }
+  }
+}
+
+// Children that stayed under the partner of their parent, but not in the same order, are moved.
+// The most children possible are left in place: those in the longest increasing run of their partners' positions.
+static
+void addReorders(differ* st, uint32_t x, uint32_t y) {
+  const diffSide* a = &st->a;
+  const diffSide* b = &st->b;
+  dynarr_uint32_t* stayed = &st->ux; // old children that stayed, in order
+  stayed->len = 0;
+  for (uint32_t k = 0; k < a->nodes.data[x].nKids; ++k) {
+    uint32_t c = kidOf(a, x, k);
+    const diffNode* kid = &a->nodes.data[c];
+    if ((kid->match == MATCH_SAME || kid->match == MATCH_INNER) && b->nodes.data[kid->partner].parent == y) {
+      dynarr_push_uint32_t(stayed, &c);
+    }
+  }
+  size_t n = stayed->len;
+  if (n < 2) { return; }
+  // patience sorting, with `tails[i]` the index in `stayed` that ends the best run of length `i + 1` so far
+  st->tails.len = 0;
+  st->prev.len = 0;
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t slot = b->nodes.data[a->nodes.data[stayed->data[i]].partner].slot;
+    size_t lo = 0, hi = st->tails.len;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (b->nodes.data[a->nodes.data[stayed->data[st->tails.data[mid]]].partner].slot < slot) { lo = mid + 1; } else { hi = mid; }
+    }
+    uint32_t prev = lo == 0 ? NO_NODE : st->tails.data[lo - 1];
+    dynarr_push_uint32_t(&st->prev, &prev);
+    uint32_t here = i;
+    if (lo == st->tails.len) { dynarr_push_uint32_t(&st->tails, &here); }
+    else { st->tails.data[lo] = here; }
+  }
+  // mark the children in the run by overwriting their links, which are not needed once followed
+  for (uint32_t i = st->tails.data[st->tails.len - 1]; i != NO_NODE; ) {
+    uint32_t next = st->prev.data[i];
+    st->prev.data[i] = IN_RUN;
+    i = next;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (st->prev.data[i] == IN_RUN) { continue; }
+    uint32_t c = stayed->data[i];
+    uint32_t p = a->nodes.data[c].partner;
+    addEdit(st, EEXPR_EDIT_MOVE, a, c, spanOf(a, c), b, p, spanOf(b, p));
+  }
+}
+
+static
+int compareEdits(const void* p, const void* q) {
+  const eexpr_edit* x = p;
+  const eexpr_edit* y = q;
+  if (x->aSpan.start != y->aSpan.start) { return x->aSpan.start < y->aSpan.start ? -1 : 1; }
+  if (x->bSpan.start != y->bSpan.start) { return x->bSpan.start < y->bSpan.start ? -1 : 1; }
+  if (x->aSpan.end != y->aSpan.end) { return x->aSpan.end > y->aSpan.end ? -1 : 1; } // outer before inner
+  if (x->bSpan.end != y->bSpan.end) { return x->bSpan.end > y->bSpan.end ? -1 : 1; }
+  return (int)x->type - (int)y->type;
+}
+
+static
+void addEdits(differ* st) {
+  const diffSide* a = &st->a;
+  const diffSide* b = &st->b;
+  for (size_t x = 0; x < a->nodes.len; ++x) {
+    const diffNode* node = &a->nodes.data[x];
+    uint32_t y = node->partner;
+    if (node->match == MATCH_INNER) {
+      addLosses(st, EEXPR_EDIT_DELETE, a, x, b, y);
+      addLosses(st, EEXPR_EDIT_INSERT, b, y, a, x);
+      addReorders(st, x, y);
+    }
+    if (x == 0) { continue; }
+    if (node->match == MATCH_REPLACE) {
+      addEdit(st, EEXPR_EDIT_REPLACE, a, x, spanOf(a, x), b, y, spanOf(b, y));
+    }
+    else if (node->match != UNMATCHED && a->nodes.data[node->parent].match != MATCH_SAME
+             && a->nodes.data[node->parent].partner != b->nodes.data[y].parent) {
+      addEdit(st, EEXPR_EDIT_MOVE, a, x, spanOf(a, x), b, y, spanOf(b, y));
+    }
+  }
+  qsort(st->edits.data, st->edits.len, sizeof(eexpr_edit), compareEdits);
+}
+
+
+//////////////////////////////////// Diffing ////////////////////////////////////
+
+bool diff_forests(size_t nA, eexpr* const* a, const eexpr_span* aSpans, size_t nB, eexpr* const* b, const eexpr_span* bSpans, size_t* nEdits, eexpr_edit** edits) {
+  differ st;
+  diffSide_init(&st.a, nA, a, aSpans);
+  diffSide_init(&st.b, nB, b, bSpans);
+  dynarr_init_uint32_t(&st.ux, 16);
+  dynarr_init_uint32_t(&st.uy, 16);
+  dynarr_init_keyedNode(&st.keyed, 16);
+  dynarr_init_uint32_t(&st.tails, 16);
+  dynarr_init_uint32_t(&st.prev, 16);
+  dynarr_init_eexpr_edit(&st.edits, 16);
+  pair(&st, 0, 0, MATCH_INNER);
+
+  anchor(&st);
+  bottomUp(&st);
+  // preorder, so that parents are recovered before their children
+  for (size_t x = 0; x < st.a.nodes.len; ++x) {
+    if (st.a.nodes.data[x].match == MATCH_INNER) { recover(&st, x, st.a.nodes.data[x].partner); }
+  }
+  addEdits(&st);
+
+  free(st.table);
+  free(st.next);
+  diffSide_deinit(&st.a);
+  diffSide_deinit(&st.b);
+  dynarr_deinit_uint32_t(&st.ux);
+  dynarr_deinit_uint32_t(&st.uy);
+  dynarr_deinit_keyedNode(&st.keyed);
+  dynarr_deinit_uint32_t(&st.tails);
+  dynarr_deinit_uint32_t(&st.prev);
+  *nEdits = st.edits.len;
+  if (st.edits.len == 0) {
+    dynarr_deinit_eexpr_edit(&st.edits);
+    *edits = NULL;
+  }
+  else {
+    *edits = st.edits.data;
+  }
+  return *nEdits == 0;
+}
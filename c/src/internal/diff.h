@@ -0,0 +1,13 @@
+#ifndef INTERNAL_DIFF_H
+#define INTERNAL_DIFF_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// See `eexpr_diff` and `eexpr_diffShared`; the spans are `NULL` for forests that are not shared.
+bool diff_forests(size_t nA, eexpr* const* a, const eexpr_span* aSpans, size_t nB, eexpr* const* b, const eexpr_span* bSpans, size_t* nEdits, eexpr_edit** edits);
+
+
+#endif
@@ -13,13 +13,24 @@ void engine_init(engine* it) {
   str emptyStr = {.len = 0, .bytes = NULL};
   {
     it->rest = emptyStr;
-    it->loc.line = 0;
-    it->loc.col = 0;
-    it->loc.byte = 0;
+    it->loc = 0;
+    it->lines = NULL;
   }
   {
     dynarr_init_eexpr_p(&it->eexprStream, 64);
+    it->spanStream.len = 0;
+    it->spanStream.cap = 0;
+    it->spanStream.data = NULL;
     it->tokStream = dllist_empty_eexpr_token();
+    dynarr_init_tokenBlock(&it->tokPool.blocks, 4);
+    it->tokPool.block = 0;
+    it->tokPool.used = 0;
+    it->tokPool.freed = NULL;
+    it->tokPool.keep = false;
+    it->parserToks.len = 0;
+    it->parserToks.cap = 0;
+    it->parserToks.next = 0;
+    it->parserToks.data = NULL;
     it->errStream = dllist_empty_eexpr_error();
     it->fatal.type = EEXPR_ERR_NOERROR;
   }
@@ -28,6 +39,19 @@ void engine_init(engine* it) {
     it->indent.type = EEXPR_INDENT_NULL;
     it->indent.knownMixed = false;
     dynarr_init_openWrap(&it->wrapStack, 30);
+    dynarr_init_eexpr_p(&it->listScratch, 64);
+    it->payloadScratch = strBuilder_new(128);
+  }
+  it->lazyPayloads = false;
+  it->symbols = NULL;
+  it->shared = NULL;
+  it->shareSpans = false;
+  {
+    struct eexpr_parseLimits noLimits = { 0, 0, 0, 0, 0, 0 };
+    it->limits = noLimits;
+    it->used.tokens = 0;
+    it->used.errors = 0;
+    it->used.memory = 0;
   }
 }
 
@@ -40,89 +64,228 @@ engine engine_newFromStrn(size_t n, uint8_t* input) {
 }
 
 
-void engine_deinit(engine* it) {
+static
+dllistNode_eexpr_token* tokPool_take(engine* st) {
+  struct token_pool* pool = &st->tokPool;
+  if (pool->freed != NULL) {
+    dllistNode_eexpr_token* node = pool->freed;
+    pool->freed = node->next;
+    return node;
+  }
+  while (pool->block < pool->blocks.len && pool->used == pool->blocks.data[pool->block].cap) {
+    pool->block += 1;
+    pool->used = 0;
+  }
+  if (pool->block == pool->blocks.len) {
+    size_t cap = pool->blocks.len == 0 ? 64 : 2 * pool->blocks.data[pool->blocks.len - 1].cap;
+    tokenBlock new = {.cap = cap, .nodes = malloc(cap * sizeof(dllistNode_eexpr_token))};
+    checkOom(new.nodes);
+    dynarr_push_tokenBlock(&pool->blocks, &new);
+    pool->used = 0;
+  }
+  pool->used += 1;
+  return &pool->blocks.data[pool->block].nodes[pool->used - 1];
+}
+
+// Whatever the node's token owned must already have been freed or handed over.
+static
+void tokPool_give(engine* st, dllistNode_eexpr_token* node) {
+  node->next = st->tokPool.freed;
+  st->tokPool.freed = node;
+}
+
+// Call once no node is in use any more, so that nodes are handed out from the start of the first block again.
+static
+void tokPool_empty(engine* st) {
+  struct token_pool* pool = &st->tokPool;
+  pool->freed = NULL;
+  pool->block = 0;
+  pool->used = 0;
+  if (!pool->keep) {
+    for (size_t i = 0; i < pool->blocks.len; ++i) {
+      free(pool->blocks.data[i].nodes);
+    }
+    pool->blocks.len = 0;
+  }
+}
+
+void engine_reset(engine* it) {
   // .rest should aliased another string anyway
   it->rest.bytes = NULL;
   it->rest.len = 0;
-  dynarr_deinit_openWrap(&it->wrapStack);
+  it->loc = 0;
+  it->lines = NULL;
+  it->wrapStack.len = 0;
+  // the parser pops whatever it pushes to the scratch area, so there is nothing owned left in it
+  it->listScratch.len = 0;
+  it->payloadScratch.len = 0;
   // WARNING I'm assuming there's no owned pointer data in error
   it->fatal.type = EEXPR_ERR_NOERROR;
   dllist_del_eexpr_error(&it->errStream);
 
+  it->tokPool.keep = true;
   for (dllistNode_eexpr_token* node = it->tokStream.start; node != NULL; node = node->next) {
     token_deinit(&node->here);
   }
-  dllist_del_eexpr_token(&it->tokStream);
+  it->tokStream = dllist_empty_eexpr_token();
+  tokPool_empty(it);
+  for (size_t i = it->parserToks.next; i < it->parserToks.len; ++i) {
+    token_deinit(&it->parserToks.data[i]);
+  }
+  it->parserToks.len = 0;
+  it->parserToks.next = 0;
 
   for (size_t i = 0; i < it->eexprStream.len; ++i) {
-    eexpr_deinit(it->eexprStream.data[i]);
-    free(it->eexprStream.data[i]);
+    eexpr_del(it->eexprStream.data[i]);
   }
+  it->eexprStream.len = 0;
+  it->spanStream.len = 0;
+
+  it->discoveredNewline = NEWLINE_NONE;
+  it->indent.type = EEXPR_INDENT_NULL;
+  it->indent.knownMixed = false;
+  it->used.tokens = 0;
+  it->used.errors = 0;
+  it->used.memory = 0;
+}
+
+void engine_deinit(engine* it) {
+  engine_reset(it);
+  dynarr_deinit_openWrap(&it->wrapStack);
+  dynarr_deinit_eexpr_p(&it->listScratch);
+  free(it->payloadScratch.bytes);
+  it->payloadScratch.bytes = NULL;
+  it->payloadScratch.len = 0;
+  it->payloadScratch.cap = 0;
+  it->tokPool.keep = false;
+  tokPool_empty(it);
+  dynarr_deinit_tokenBlock(&it->tokPool.blocks);
+  free(it->parserToks.data);
+  it->parserToks.cap = 0;
+  it->parserToks.data = NULL;
   dynarr_deinit_eexpr_p(&it->eexprStream);
+  dynarr_deinit_eexpr_span(&it->spanStream);
 }
 
 
-//////////////////////////////////// Lexer/Postlexer Helper Functions ////////////////////////////////////
+//////////////////////////////////// Resource Limits ////////////////////////////////////
 
-void lexer_advance(engine* st, size_t bytes, size_t cols) {
-  st->rest.len -= bytes;
-  st->rest.bytes += bytes;
-  st->loc.col += cols;
-  st->loc.byte += bytes;
+void engine_limitExceeded(engine* st, eexpr_limitType which, eexpr_span loc) {
+  if (st->fatal.type != EEXPR_ERR_NOERROR) { return; }
+  st->fatal.type = EEXPR_ERR_LIMIT_EXCEEDED;
+  st->fatal.loc = loc;
+  st->fatal.as.limitExceeded = which;
 }
-void lexer_incLine(engine* st, size_t bytes) {
+
+bool engine_charge(engine* st, size_t bytes) {
+  st->used.memory += bytes;
+  if (st->limits.memory != 0 && st->used.memory > st->limits.memory) {
+    eexpr_span here = {.start = st->loc, .end = st->loc};
+    engine_limitExceeded(st, EEXPR_LIMIT_MEMORY, here);
+    return false;
+  }
+  return true;
+}
+
+void engine_addError(engine* st, const eexpr_error* err) {
+  if (st->fatal.type == EEXPR_ERR_LIMIT_EXCEEDED) { return; }
+  st->used.errors += 1;
+  if (st->limits.errors != 0 && st->used.errors > st->limits.errors) {
+    engine_limitExceeded(st, EEXPR_LIMIT_ERRORS, err->loc);
+    return;
+  }
+  if (!engine_charge(st, sizeof(dllistNode_eexpr_error))) { return; }
+  dllist_insertAfter_eexpr_error(&st->errStream, NULL, err);
+}
+
+// a rough count of the bytes owned by a token, besides the token itself
+static
+size_t payloadSize(const eexpr_token* tok) {
+  if (tok->flags & FLAG_LAZY) { return 0; }
+  switch (tok->type) {
+    case EEXPR_TOK_SYMBOL: return tok->as.symbol.text.len;
+    case EEXPR_TOK_STRING: return tok->as.string.text.len;
+    case EEXPR_TOK_NUMBER: {
+      return sizeof(uint32_t) * (tok->as.number.mantissa.len + tok->as.number.exponent.len);
+    }
+    default: return 0;
+  }
+}
+
+
+//////////////////////////////////// Lexer/Postlexer Helper Functions ////////////////////////////////////
+
+void lexer_advance(engine* st, size_t bytes) {
   st->rest.len -= bytes;
   st->rest.bytes += bytes;
-  st->loc.line += 1;
-  st->loc.col = 0;
-  st->loc.byte += bytes;
+  st->loc += bytes;
 }
 
 void lexer_addTok(engine* st, const eexpr_token* tok) {
-  dllistNode_eexpr_token* node = dllist_insertAfter_eexpr_token(&st->tokStream, NULL, tok);
+  dllistNode_eexpr_token* node = tokPool_take(st);
+  node->here = *tok;
   node->here.transparent = false;
+  dllist_linkAfter_eexpr_token(&st->tokStream, NULL, node);
+  st->used.tokens += 1;
+  if (st->limits.tokens != 0 && st->used.tokens > st->limits.tokens) {
+    engine_limitExceeded(st, EEXPR_LIMIT_TOKENS, tok->loc);
+    return;
+  }
+  engine_charge(st, sizeof(dllistNode_eexpr_token) + payloadSize(tok));
 }
 
 void lexer_insertBefore(engine* st, const eexpr_token* t, dllistNode_eexpr_token* node) {
-  dllistNode_eexpr_token* new = dllist_insertBefore_eexpr_token(&st->tokStream, t, node);
+  dllistNode_eexpr_token* new = tokPool_take(st);
+  new->here = *t;
   new->here.transparent = false;
+  dllist_linkBefore_eexpr_token(&st->tokStream, new, node);
 }
 
 void lexer_delTok(engine* st) {
-  if (st->tokStream.end != NULL) { token_deinit(&st->tokStream.end->here); }
-  dllist_popEnd_eexpr_token(&st->tokStream, NULL);
+  dllistNode_eexpr_token* node = st->tokStream.end;
+  assert(node != NULL);
+  token_deinit(&node->here);
+  dllist_unlink_eexpr_token(&st->tokStream, node);
+  tokPool_give(st, node);
 }
 
 
 //////////////////////////////////// Parser Helper Functions ////////////////////////////////////
 
-eexpr_token* parser_peek(engine* st) {
-  dllistNode_eexpr_token* node = st->tokStream.start;
-  while (node != NULL) {
+void parser_compact(engine* st) {
+  size_t n = 0;
+  for (dllistNode_eexpr_token* node = st->tokStream.start; node != NULL; node = node->next) {
+    if (!node->here.transparent) { n += 1; }
+  }
+  if (n > st->parserToks.cap) {
+    eexpr_token* toks = realloc(st->parserToks.data, n * sizeof(eexpr_token));
+    checkOom(toks);
+    st->parserToks.cap = n;
+    st->parserToks.data = toks;
+  }
+  size_t i = 0;
+  for (dllistNode_eexpr_token* node = st->tokStream.start; node != NULL; node = node->next) {
     if (node->here.transparent) {
       token_deinit(&node->here);
-      dllist_popStart_eexpr_token(&st->tokStream, NULL);
-      node = st->tokStream.start;
     }
     else {
-      return &node->here;
+      st->parserToks.data[i++] = node->here;
     }
   }
-  return NULL;
+  st->tokStream = dllist_empty_eexpr_token();
+  tokPool_empty(st);
+  st->parserToks.len = n;
+  st->parserToks.next = 0;
+}
+
+eexpr_token* parser_peek(engine* st) {
+  if (st->parserToks.next == st->parserToks.len) { return NULL; }
+  // once a resource limit is hit, act as if the input ends here, so that the parser unwinds without doing any more work
+  if (st->fatal.type == EEXPR_ERR_LIMIT_EXCEEDED) { return &st->parserToks.data[st->parserToks.len - 1]; }
+  return &st->parserToks.data[st->parserToks.next];
 }
 
 void parser_pop(engine* st) {
-  dllistNode_eexpr_token* node = st->tokStream.start;
-  while (node != NULL) {
-    if (node->here.transparent) {
-      token_deinit(&node->here);
-      dllist_popStart_eexpr_token(&st->tokStream, NULL);
-      node = st->tokStream.start;
-    }
-    else {
-      dllist_popStart_eexpr_token(&st->tokStream, NULL);
-      return;
-    }
-  }
-  assert(false);
+  assert(st->parserToks.next < st->parserToks.len);
+  st->parserToks.next += 1;
 }
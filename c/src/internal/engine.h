@@ -15,26 +15,66 @@
 
 typedef struct openWrap {
   eexpr_wrapType type;
-  eexpr_loc loc;
+  eexpr_span loc;
 } openWrap;
 
 #define TYPE openWrap
 #include "dynarr.h"
 
+#define TYPE eexpr_span
+#include "dynarr.h"
+
+// Token nodes are handed out from blocks in order, so that the token stream is laid out in memory in the order it was lexed
+//   (walking it is what the postlexer spends its time on), however many times the engine is re-used.
+typedef struct tokenBlock {
+  size_t cap;
+  dllistNode_eexpr_token* nodes; // owned
+} tokenBlock;
+
+#define TYPE tokenBlock
+#include "dynarr.h"
+
 typedef struct engine {
   str rest; // borrowed pointer to input
-  struct eexpr_locPoint loc; // use zero-indexed line/col and only translate to 1-indexd for human consumption
-  dllist_eexpr_token tokStream; //owned
+  size_t loc; // byte offset of `rest` within the input; line/col are only worked out (from `lines`) on request
+  const eexpr_lineIndex* lines; // borrowed, may be NULL if nothing needs to know where lines start
+  dllist_eexpr_token tokStream; // owned, but the memory of the nodes belongs to `tokPool`
+  struct token_pool {
+    dynarr_tokenBlock blocks;
+    size_t block; // index into `blocks` of the block nodes are being handed out from
+    size_t used; // nodes handed out from that block so far
+    dllistNode_eexpr_token* freed; // nodes given back while others are still in use, linked through `.next`
+    bool keep; // set by `engine_reset`: a one-off parse gives the blocks back as soon as it is done with tokens, but one that is likely to be repeated keeps them
+  } tokPool;
+  struct parser_tokens {
+    size_t len;
+    size_t cap;
+    size_t next; // index of the parser's lookahead
+    eexpr_token* data; // owned, but the payloads of tokens before `next` have been handed over to eexprs
+  } parserToks; // only the non-transparent tokens of `tokStream`, see `parser_compact`
   dynarr_eexpr_p eexprStream; //owned
+  dynarr_eexpr_span spanStream; // owned, only used with `shared` and `shareSpans`
   dllist_eexpr_error errStream; // owned
   eexpr_error fatal; // use EEXPRERR_NOERROR for no error
   newlineType discoveredNewline; // NEWLINE_NONE if not set
   struct lexer_indent {
     bool knownMixed;
     eexpr_indentType type;
-    eexpr_loc established;
+    eexpr_span established;
   } indent;
   dynarr_openWrap wrapStack;
+  dynarr_eexpr_p listScratch; // owned, children of the lists currently being parsed (innermost on top)
+  strBuilder payloadScratch; // owned, decoded text of the string literal currently being lexed (reset for each one)
+  bool lazyPayloads; // leave number and string payloads undecoded, see `FLAG_LAZY`
+  eexpr_symtab* symbols; // borrowed, may be NULL; when set, symbol text is interned here rather than copied into each token
+  eexpr_shareTable* shared; // borrowed, may be NULL; when set, each eexpr is replaced by the identical one in this table as it is parsed
+  bool shareSpans; // record the span of every occurrence in `spanStream` (only meaningful with `shared`)
+  struct eexpr_parseLimits limits;
+  struct engine_usage {
+    size_t tokens;
+    size_t errors;
+    size_t memory;
+  } used; // running totals to check against `limits`
 } engine;
 
 //////////////////////////////////// General Functions ////////////////////////////////////
@@ -43,6 +83,12 @@ typedef struct engine {
 engine engine_newFromStrn(size_t n, uint8_t* input);
 
 
+// Free everything the engine has produced so far (tokens, eexprs, errors) and forget the input,
+//   leaving it ready for `.rest` to be set to a new input.
+// Unlike `engine_deinit`, the memory of internal buffers is kept for re-use (and from then on, so are token nodes, see `.tokPool.keep`).
+// Options (`.lazyPayloads`, `.symbols`, `.shared`, `.shareSpans`, `.limits`) are left as-is.
+void engine_reset(engine* st);
+
 // free all internal data structures of the passed engine
 void engine_deinit(engine* st);
 
@@ -51,11 +97,23 @@ void engine_cookLex(engine* st);
 void engine_parse(engine* st);
 
 
-//////////////////////////////////// Lexer/Postlexer Helper Functions ////////////////////////////////////
+//////////////////////////////////// Resource Limits ////////////////////////////////////
+
+// Stop the engine with an `EEXPR_ERR_LIMIT_EXCEEDED` fatal error, unless it has already been stopped.
+void engine_limitExceeded(engine* st, eexpr_limitType which, eexpr_span loc);
 
-void lexer_advance(engine* st, size_t bytes, size_t cols);
+// Add to the estimate of memory allocated on behalf of the input.
+// Returns false (having stopped the engine) if that goes over the limit.
+bool engine_charge(engine* st, size_t bytes);
 
-void lexer_incLine(engine* st, size_t bytes);
+// Queue up a non-fatal error (or warning; that is decided later).
+// Once a limit has been exceeded, further errors are dropped.
+void engine_addError(engine* st, const eexpr_error* err);
+
+
+//////////////////////////////////// Lexer/Postlexer Helper Functions ////////////////////////////////////
+
+void lexer_advance(engine* st, size_t bytes);
 
 // `lexer_addTok` and `lexer_insertBefore` ensure that added tokens are non-transparent
 void lexer_addTok(engine* st, const eexpr_token* t);
@@ -66,15 +124,27 @@ void lexer_insertBefore(engine* st, const eexpr_token* t, dllistNode_eexpr_token
 void lexer_delTok(engine* st);
 
 
+//////////////////////////////////// Lazy Payload Decoding ////////////////////////////////////
+
+// Replace a lazy payload (see `FLAG_LAZY`) with the one the lexer would have produced outside of lazy mode, and clear the flag.
+// Lexing errors are not reported again: they were already reported when the source was first lexed.
+// These do nothing to tokens/eexprs that are not lazy.
+void lexer_forceToken(eexpr_token* tok);
+void lexer_forceEexpr(eexpr* e);
+
+
 //////////////////////////////////// Parser Helper Functions ////////////////////////////////////
 
 
-// both `parser_peek` and `parser_pop` destroy transparent tokens from the start of the token stream, along with their token data.
+// Move the non-transparent tokens out of `st->tokStream` into the dense `st->parserToks` array, destroying the transparent ones.
+// The parser only ever looks at the next significant token, so this way each peek/pop is just an array index rather than a walk over spaces/comments.
+// Anything that wants the full stream (e.g. for highlighting) must look at it before this is called at the start of parsing.
+void parser_compact(engine* st);
 
-// returns a borrowed pointer to the first non-transparent token
+// returns a borrowed pointer to the first token not yet popped
 eexpr_token* parser_peek(engine* st);
 
-// Removes the first non-transparent token from the stream.
+// Removes the first remaining token from `st->parserToks`.
 // It does not free any token data, so you must assume ownership of the popped token's data before popping.
 // For the foreseeable future, this should be easy, since the `malloc`d data of a token is needed to populate the data of an eexpr.
 void parser_pop(engine* st);
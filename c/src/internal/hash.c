@@ -0,0 +1,228 @@
+#include "hash.h"
+
+#include <string.h>
+
+#include "engine.h"
+
+
+//////////////////////////////////// Digests ////////////////////////////////////
+
+// Each eexpr's digest is built from its type, payload and the digests of its children, a word at a time.
+// The mixing step is a multiply-xorshift, which is enough to spread every input bit over the whole digest,
+//   and leaves the heavy lifting to the finalizer in `finish`.
+#define DIGEST_SEED 0x243f6a8885a308d3u
+#define DIGEST_MUL 0x9e3779b97f4a7c15u
+#define DIGEST_ABSENT 0x13198a2e03707344u // stands in for a missing child
+
+static
+uint64_t mix(uint64_t h, uint64_t word) {
+  h = (h ^ word) * DIGEST_MUL;
+  return h ^ (h >> 32);
+}
+
+// the splitmix64 finalizer
+static
+uint64_t finish(uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9u;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebu;
+  return h ^ (h >> 31);
+}
+
+static
+uint64_t mixBytes(uint64_t h, size_t nBytes, const uint8_t* bytes) {
+  h = mix(h, nBytes);
+  size_t i = 0;
+  for (; i + 8 <= nBytes; i += 8) {
+    uint64_t word;
+    memcpy(&word, &bytes[i], 8);
+    h = mix(h, word);
+  }
+  if (i != nBytes) {
+    uint64_t word = 0;
+    memcpy(&word, &bytes[i], nBytes - i);
+    h = mix(h, word);
+  }
+  return h;
+}
+
+static
+uint64_t mixBigint(uint64_t h, const bigint* n) {
+  h = mix(h, (uint64_t)n->pos | ((uint64_t)n->len << 1));
+  for (size_t i = 0; i < n->len; ++i) {
+    h = mix(h, n->buf[i]);
+  }
+  return h;
+}
+
+typedef struct childDigests {
+  hash_childDigest digest;
+  void* ctx;
+} childDigests;
+
+static
+uint64_t mixChild(uint64_t h, const eexpr* child, const childDigests* kids) {
+  return mix(h, child == NULL ? DIGEST_ABSENT : kids->digest(kids->ctx, child));
+}
+
+uint64_t hash_node(const eexpr* self, bool withSpans, hash_childDigest childDigest, void* ctx) {
+  childDigests kids = {.digest = childDigest, .ctx = ctx};
+  // digests are of decoded payloads, so that they do not depend on `eexpr_parser.lazyPayloads`
+  lexer_forceEexpr((eexpr*)self);
+  uint64_t h = mix(DIGEST_SEED, self->type);
+  if (withSpans) {
+    h = mix(h, self->loc.start);
+    h = mix(h, self->loc.end);
+  }
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      h = mixBytes(h, self->as.symbol.text.len, self->as.symbol.text.bytes);
+    }; break;
+    case EEXPR_NUMBER: {
+      h = mix(h, self->as.number.radix | ((uint64_t)self->as.number.fractionalDigits << 8));
+      h = mixBigint(h, &self->as.number.mantissa);
+      h = mixBigint(h, &self->as.number.exponent);
+    }; break;
+    case EEXPR_STRING: {
+      h = mixBytes(h, self->as.string.text1.len, self->as.string.text1.bytes);
+      h = mix(h, self->as.string.parts.len);
+      for (size_t i = 0; i < self->as.string.parts.len; ++i) {
+        const strTemplPart* part = &self->as.string.parts.data[i];
+        h = mixChild(h, part->subexpr, &kids);
+        h = mixBytes(h, part->nBytes, part->utf8str);
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      h = mixChild(h, self->as.wrap, &kids);
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      h = mix(h, self->as.list.len);
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        h = mixChild(h, self->as.list.data[i], &kids);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      h = mixChild(h, self->as.ellipsis[0], &kids);
+      h = mixChild(h, self->as.ellipsis[1], &kids);
+    }; break;
+    case EEXPR_COLON: {
+      h = mixChild(h, self->as.pair[0], &kids);
+      h = mixChild(h, self->as.pair[1], &kids);
+    }; break;
+    case EEXPR_MIXFIX: {
+      h = mix(h, self->as.mixfix.op);
+      h = mix(h, self->as.mixfix.args.len);
+      for (size_t i = 0; i < self->as.mixfix.args.len; ++i) {
+        h = mixChild(h, self->as.mixfix.args.data[i], &kids);
+      }
+    }; break;
+  }
+  return finish(h);
+}
+
+static
+uint64_t digestWithSpans(void* ctx, const eexpr* child) {
+  (void)ctx;
+  return hash_eexpr(child, true);
+}
+
+static
+uint64_t digestWithoutSpans(void* ctx, const eexpr* child) {
+  (void)ctx;
+  return hash_eexpr(child, false);
+}
+
+uint64_t hash_eexpr(const eexpr* self, bool withSpans) {
+  return hash_node(self, withSpans, withSpans ? digestWithSpans : digestWithoutSpans, NULL);
+}
+
+
+//////////////////////////////////// Equality ////////////////////////////////////
+
+static
+bool strEqual(size_t n1, const uint8_t* s1, size_t n2, const uint8_t* s2) {
+  return n1 == n2 && (n1 == 0 || memcmp(s1, s2, n1) == 0);
+}
+
+static
+bool bigintEqual(const bigint* a, const bigint* b) {
+  return a->pos == b->pos
+      && a->len == b->len
+      && (a->len == 0 || memcmp(a->buf, b->buf, a->len * sizeof(uint32_t)) == 0);
+}
+
+static bool equalIn(const eexpr* a, const eexpr* b, bool withSpans);
+
+static
+bool childEqual(const eexpr* a, const eexpr* b, bool withSpans) {
+  if (a == NULL || b == NULL) { return a == b; }
+  return equalIn(a, b, withSpans);
+}
+
+static
+bool listEqual(const eexprList* a, const eexprList* b, bool withSpans) {
+  if (a->len != b->len) { return false; }
+  for (size_t i = 0; i < a->len; ++i) {
+    if (!equalIn(a->data[i], b->data[i], withSpans)) { return false; }
+  }
+  return true;
+}
+
+// A plain walk over both eexprs, which stops at the first difference.
+// Identical pointers are equal without looking any further, so comparing eexprs whose subexprs are shared (see `share_eexpr`) is shallow.
+static
+bool equalIn(const eexpr* a, const eexpr* b, bool withSpans) {
+  if (a == b) { return true; }
+  if (a->type != b->type) { return false; }
+  if (withSpans && (a->loc.start != b->loc.start || a->loc.end != b->loc.end)) { return false; }
+  // payloads compare by their decoded values, as for digests
+  lexer_forceEexpr((eexpr*)a);
+  lexer_forceEexpr((eexpr*)b);
+  switch (a->type) {
+    case EEXPR_SYMBOL: {
+      return strEqual(a->as.symbol.text.len, a->as.symbol.text.bytes, b->as.symbol.text.len, b->as.symbol.text.bytes);
+    }
+    case EEXPR_NUMBER: {
+      return a->as.number.radix == b->as.number.radix
+          && a->as.number.fractionalDigits == b->as.number.fractionalDigits
+          && bigintEqual(&a->as.number.mantissa, &b->as.number.mantissa)
+          && bigintEqual(&a->as.number.exponent, &b->as.number.exponent);
+    }
+    case EEXPR_STRING: {
+      const eexprStrTempl* x = &a->as.string;
+      const eexprStrTempl* y = &b->as.string;
+      if (!strEqual(x->text1.len, x->text1.bytes, y->text1.len, y->text1.bytes)) { return false; }
+      if (x->parts.len != y->parts.len) { return false; }
+      for (size_t i = 0; i < x->parts.len; ++i) {
+        const strTemplPart* p = &x->parts.data[i];
+        const strTemplPart* q = &y->parts.data[i];
+        if (!strEqual(p->nBytes, p->utf8str, q->nBytes, q->utf8str)) { return false; }
+        if (!childEqual(p->subexpr, q->subexpr, withSpans)) { return false; }
+      }
+      return true;
+    }
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      return childEqual(a->as.wrap, b->as.wrap, withSpans);
+    }
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      return listEqual(&a->as.list, &b->as.list, withSpans);
+    }
+    case EEXPR_ELLIPSIS: {
+      return childEqual(a->as.ellipsis[0], b->as.ellipsis[0], withSpans)
+          && childEqual(a->as.ellipsis[1], b->as.ellipsis[1], withSpans);
+    }
+    case EEXPR_COLON: {
+      return equalIn(a->as.pair[0], b->as.pair[0], withSpans)
+          && equalIn(a->as.pair[1], b->as.pair[1], withSpans);
+    }
+    case EEXPR_MIXFIX: {
+      return a->as.mixfix.op == b->as.mixfix.op
+          && listEqual(&a->as.mixfix.args, &b->as.mixfix.args, withSpans);
+    }
+  }
+  return false;
+}
+
+bool hash_equal(const eexpr* a, const eexpr* b, bool withSpans) {
+  if (a == NULL || b == NULL) { return a == b; }
+  return equalIn(a, b, withSpans);
+}
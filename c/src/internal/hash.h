@@ -0,0 +1,23 @@
+#ifndef INTERNAL_HASH_H
+#define INTERNAL_HASH_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// The structural digest of an eexpr, computed afresh over the whole tree each time.
+uint64_t hash_eexpr(const eexpr* self, bool withSpans);
+
+// Digests are not cached on the eexprs, so that plain parses do not pay for them.
+// Instead, callers that need the digests of every subtree (such as `eexpr_diff`) keep them on the side,
+//   and compute each one from those of its subexprs with `hash_node`, which takes the digest of each non-`NULL` subexpr from `childDigest`.
+// Given `hash_eexpr` as `childDigest`, this is `hash_eexpr`; the share table instead passes the addresses of its (already shared) subexprs.
+typedef uint64_t (*hash_childDigest)(void* ctx, const eexpr* child);
+uint64_t hash_node(const eexpr* self, bool withSpans, hash_childDigest childDigest, void* ctx);
+
+// Structural equality, as a plain walk that stops at the first difference.
+bool hash_equal(const eexpr* a, const eexpr* b, bool withSpans);
+
+
+#endif
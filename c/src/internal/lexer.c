@@ -53,7 +53,7 @@ bool takeCharEscape(engine* st, char32_t* out) {
   // standard escapes
   for (size_t i = 0; commonEscapes[i].source != UCHAR_NULL; ++i) {
     if (c == commonEscapes[i].source) {
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
       *out = commonEscapes[i].decode;
       return true;
     }
@@ -61,14 +61,14 @@ bool takeCharEscape(engine* st, char32_t* out) {
   char32_t digits[6] = {'0', '0', '0', '0', '0', '0'};
   eexpr_error decodeError = {.type = EEXPR_ERR_BAD_ESCAPE_CODE};
   if (c == twoHexEscapeLeader) {
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     decodeError.loc.start = st->loc;
     adv = peekUchars(&digits[4], 2, st->rest);
-    lexer_advance(st, adv, 2);
+    lexer_advance(st, adv);
     if (!decodeUnihex(&c, 2, &digits[4])) {
       decodeError.loc.end = st->loc;
       for (int i = 0; i < 6; ++i) { decodeError.as.badEscapeCode[i] = digits[i]; }
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &decodeError);
+      engine_addError(st, &decodeError);
       *out = UCHAR_NULL;
     }
     else {
@@ -77,14 +77,14 @@ bool takeCharEscape(engine* st, char32_t* out) {
     return true;
   }
   else if (c == fourHexEscapeLeader) {
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     decodeError.loc.start = st->loc;
     adv = peekUchars(&digits[2], 4, st->rest);
-    lexer_advance(st, adv, 4);
+    lexer_advance(st, adv);
     if (!decodeUnihex(&c, 4, &digits[2])) {
       decodeError.loc.end = st->loc;
       for (int i = 0; i < 6; ++i) { decodeError.as.badEscapeCode[i] = digits[i]; };
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &decodeError);
+      engine_addError(st, &decodeError);
       *out = UCHAR_NULL;
     }
     else {
@@ -93,14 +93,14 @@ bool takeCharEscape(engine* st, char32_t* out) {
     return true;
   }
   else if (c == sixHexEscapeLeader) {
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     decodeError.loc.start = st->loc;
     adv = peekUchars(digits, 6, st->rest);
-    lexer_advance(st, adv, 6);
+    lexer_advance(st, adv);
     if (!decodeUnihex(&c, 6, digits)) {
       decodeError.loc.end = st->loc;
       for (int i = 0; i < 6; ++i) { decodeError.as.badEscapeCode[i] = digits[i]; };
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &decodeError);
+      engine_addError(st, &decodeError);
       *out = UCHAR_NULL;
     }
     else {
@@ -137,16 +137,16 @@ bool takeNullEscape(engine* st) {
     if (takeWhitespace(st)) { lexer_delTok(st); }
     adv = peekUchar(&c, st->rest);
     if (c == escapeLeader) {
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
     }
     else {
       eexpr_error err = {.loc = {.start = st->loc, .end = st->loc}, .type = EEXPR_ERR_MISSING_LINE_PICKUP};
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
     return true;
   }
   else if (c == nullEscape) {
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     return true;
   }
   return false;
@@ -160,17 +160,26 @@ void tryBadBytes(engine* st, bool fatal) {
   while (true) {
     adv = peekUchar(&c, st->rest);
     if (c != UCHAR_NULL || adv == 0) { break; }
-    lexer_advance(st, adv, 0);
+    lexer_advance(st, adv);
   }
   err.loc.end = st->loc;
   if (fatal) {
     st->fatal = err;
   }
   else {
-    dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+    engine_addError(st, &err);
   }
 }
 
+// Building the value of a number is quadratic in its length, so this is checked before each digit is added in.
+static
+bool overDigitLimit(engine* st, size_t tokStart, size_t nDigits) {
+  if (st->limits.digits == 0 || nDigits <= st->limits.digits) { return false; }
+  eexpr_span loc = {.start = tokStart, .end = st->loc};
+  engine_limitExceeded(st, EEXPR_LIMIT_DIGITS, loc);
+  return true;
+}
+
 //////////////////////////////////// Individual Token Consumers ////////////////////////////////////
 
 /*
@@ -198,7 +207,7 @@ bool takeWhitespace(engine* st) {
       if (newWs != tok.as.unknownSpace.type) {
         tok.as.unknownSpace.type = EEXPR_WSMIXED;
       }
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
       advChars += 1;
     }
     else {
@@ -211,7 +220,7 @@ bool takeWhitespace(engine* st) {
   lexer_addTok(st, &tok);
   if (tok.as.unknownSpace.type == EEXPR_WSMIXED) {
     eexpr_error err = { .loc = tok.loc, .type = EEXPR_ERR_MIXED_SPACE };
-    dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+    engine_addError(st, &err);
   }
   return true;
 }
@@ -230,7 +239,7 @@ bool takeLineContinue(engine* st) {
     char32_t lookahead;
     size_t adv = peekUchar(&lookahead, st->rest);
     if (lookahead != escapeLeader) { return false; }
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     tok.loc.end = st->loc;
   }
   tok.as.unknownSpace.type = EEXPR_WSLINECONTINUE;
@@ -242,19 +251,19 @@ bool takeLineContinue(engine* st) {
       char32_t c;
       size_t adv = peekUchar(&c, st->rest);
       if (isSpaceChar(c)) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         trailingSpace = true;
       }
       else if (isNewlineChar(c)) {
         if (trailingSpace) {
           err.loc.end = st->loc;
-          dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+          engine_addError(st, &err);
         }
         break;
       }
       else {
         eexpr_error err = {.loc = tok.loc, .type = EEXPR_ERR_BAD_CHAR, .as.badChar = escapeLeader};
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
         tok.loc.end = st->loc;
         lexer_addTok(st, &tok);
         return true;
@@ -287,7 +296,7 @@ bool takeNewline(engine* st) {
     if (type == NEWLINE_NONE) { return false; }
   }
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_UNKNOWN_NEWLINE};
-  lexer_incLine(st, newlineSize(type));
+  lexer_advance(st, newlineSize(type));
   tok.loc.end = st->loc;
   lexer_addTok(st, &tok);
   if (type != st->discoveredNewline) {
@@ -299,7 +308,7 @@ bool takeNewline(engine* st) {
         { .loc = tok.loc
         , .type = EEXPR_ERR_MIXED_NEWLINES
         };
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
   }
   return true;
@@ -339,7 +348,7 @@ bool takeComment(engine* st) {
   }
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_COMMENT};
   struct untilEol skip = untilEol(st->rest);
-  lexer_advance(st, skip.bytes, skip.chars);
+  lexer_advance(st, skip.bytes);
   tok.loc.end = st->loc;
   lexer_addTok(st, &tok);
   tryBadBytes(st, true); // since untilEol will also stop at decoding errors
@@ -364,7 +373,7 @@ bool takeSymbol(engine* st) {
     size_t adv = peekUchar(&c, st->rest);
     if (isSymbolChar(c)) {
       text.len += adv;
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
     }
     else {
       break;
@@ -372,20 +381,27 @@ bool takeSymbol(engine* st) {
   }
   assert(text.len != 0);
   tok.loc.end = st->loc;
-  tok.as.symbol.text = str_clone(text);
+  if (st->symbols != NULL) {
+    tok.as.symbol.id = symtab_intern(st->symbols, text);
+    tok.as.symbol.text = st->symbols->symbols.data[tok.as.symbol.id];
+  }
+  else {
+    tok.as.symbol.id = EEXPR_NO_SYMBOL;
+    tok.as.symbol.text = str_clone(text);
+  }
   lexer_addTok(st, &tok);
   return true;
 }
 
 static
-void checkDigitSepContext(const radixParams* radix, struct eexpr_locPoint start, bool alwaysError, engine* st) {
+void checkDigitSepContext(const radixParams* radix, size_t start, bool alwaysError, engine* st) {
   char32_t lookahead;
   peekUchar(&lookahead, st->rest);
   if ( alwaysError
     || (!isDigit(radix, lookahead) && lookahead != digitSep)
      ) {
     eexpr_error err = {.loc = {.start = start, .end = st->loc}, .type = EEXPR_ERR_BAD_DIGIT_SEPARATOR};
-    dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+    engine_addError(st, &err);
   }
 }
 /*
@@ -404,6 +420,7 @@ Then, if the exponent letter was generic, a radix specificaion may be given (jus
 static
 bool takeNumber(engine* st) {
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_NUMBER};
+  uint8_t* start = st->rest.bytes;
   ////// gather sign (or early exit) //////
   bool neg;
   {
@@ -416,7 +433,7 @@ bool takeNumber(engine* st) {
       neg = lookahead[0] == negativeSign;
       peekUchars(lookahead, 2, st->rest);
       if (isDigit(defaultRadix, lookahead[1])) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
       }
       else { return false; }
     }
@@ -430,7 +447,7 @@ bool takeNumber(engine* st) {
     if (lookahead[0] == defaultRadix->digits[0]) {
       radix = decodeRadix(lookahead[1]);
       if (radix != NULL) {
-        lexer_advance(st, adv, 2);
+        lexer_advance(st, adv);
       }
     }
     if (radix == NULL) {
@@ -439,24 +456,32 @@ bool takeNumber(engine* st) {
   }
   ////// gather integer part //////
   bigint mantissa = bigint_new();
+  uint32_t mantissaDigits;
   {
     uint32_t integerDigits = 0;
     while (true) {
       char32_t c;
       size_t adv = peekUchar(&c, st->rest);
       if (isDigit(radix, c)) {
-        lexer_advance(st, adv, 1);
-        bigint_scale(&mantissa, radix->radix);
-        bigint_inc(&mantissa, decodeDigit(radix, c));
+        lexer_advance(st, adv);
         integerDigits += 1;
+        if (overDigitLimit(st, tok.loc.start, integerDigits)) {
+          bigint_del(&mantissa);
+          return true;
+        }
+        if (!st->lazyPayloads) {
+          bigint_scale(&mantissa, radix->radix);
+          bigint_inc(&mantissa, decodeDigit(radix, c));
+        }
       }
       else if (c == digitSep) {
-        struct eexpr_locPoint loc0 = st->loc;
-        lexer_advance(st, adv, 1);
+        size_t loc0 = st->loc;
+        lexer_advance(st, adv);
         checkDigitSepContext(radix, loc0, integerDigits == 0, st);
       }
       else { break; }
     }
+    mantissaDigits = integerDigits;
   }
   ////// gather fractional part //////
   uint32_t fractionalDigits = 0;
@@ -465,19 +490,25 @@ bool takeNumber(engine* st) {
     size_t adv = peekUchar(lookahead, st->rest);
     peekUchars(lookahead, 2, st->rest);
     if (lookahead[0] == digitPoint && isDigit(radix, lookahead[1])) {
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
       while (true) {
         char32_t c;
         size_t adv = peekUchar(&c, st->rest);
         if (isDigit(radix, c)) {
-          lexer_advance(st, adv, 1);
-          bigint_scale(&mantissa, radix->radix);
-          bigint_inc(&mantissa, decodeDigit(radix, c));
+          lexer_advance(st, adv);
           fractionalDigits += 1;
+          if (overDigitLimit(st, tok.loc.start, mantissaDigits + fractionalDigits)) {
+            bigint_del(&mantissa);
+            return true;
+          }
+          if (!st->lazyPayloads) {
+            bigint_scale(&mantissa, radix->radix);
+            bigint_inc(&mantissa, decodeDigit(radix, c));
+          }
         }
         else if (c == digitSep) {
-          struct eexpr_locPoint loc0 = st->loc;
-          lexer_advance(st, adv, 1);
+          size_t loc0 = st->loc;
+          lexer_advance(st, adv);
           checkDigitSepContext(radix, loc0, fractionalDigits == 0, st);
         }
         else { break; }
@@ -495,12 +526,12 @@ bool takeNumber(engine* st) {
       char32_t lookahead;
       size_t adv = peekUchar(&lookahead, st->rest);
       if (ucharElem(lookahead, radix->exponentLetters)) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         expPresent = true;
         expRadixMayDiffer = false;
       }
       else if (lookahead == genericExpLetter) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         expPresent = true;
         expRadixMayDiffer = true;
       }
@@ -516,13 +547,13 @@ bool takeNumber(engine* st) {
         if (isSign(lookahead)) {
           expNeg = lookahead == negativeSign;
           if (fractionalDigits) {
-            lexer_advance(st, adv, 1);
+            lexer_advance(st, adv);
           }
           else {
             eexpr_error err = {.loc = {.start = st->loc}, .type = EEXPR_ERR_BAD_EXPONENT_SIGN};
-            lexer_advance(st, adv, 1);
+            lexer_advance(st, adv);
             err.loc.end = st->loc;
-            dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+            engine_addError(st, &err);
           }
         }
         else {
@@ -540,7 +571,7 @@ bool takeNumber(engine* st) {
         if (lookahead[0] == defaultRadix->digits[0]) {
           expRadix = decodeRadix(lookahead[1]);
           if (expRadix != NULL) {
-            lexer_advance(st, adv, 2);
+            lexer_advance(st, adv);
           }
         }
         if (expRadix == NULL) {
@@ -556,35 +587,81 @@ bool takeNumber(engine* st) {
           size_t adv = peekUchar(&c, st->rest);
           if (isDigit(expRadix, c)) {
             expDigits += 1;
-            lexer_advance(st, adv, 1);
-            bigint_scale(&exponent, expRadix->radix);
-            bigint_inc(&exponent, decodeDigit(expRadix, c));
+            lexer_advance(st, adv);
+            if (overDigitLimit(st, tok.loc.start, expDigits)) {
+              bigint_del(&mantissa);
+              bigint_del(&exponent);
+              return true;
+            }
+            if (!st->lazyPayloads) {
+              bigint_scale(&exponent, expRadix->radix);
+              bigint_inc(&exponent, decodeDigit(expRadix, c));
+            }
           }
           else if (c == digitSep) {
-            struct eexpr_locPoint loc0 = st->loc;
-            lexer_advance(st, adv, 1);
+            size_t loc0 = st->loc;
+            lexer_advance(st, adv);
             checkDigitSepContext(expRadix, loc0, expDigits == 0, st);
           }
           else { break; }
         }
         if (expDigits == 0) {
           eexpr_error err = {.loc = tok.loc, .type = EEXPR_ERR_MISSING_EXPONENT};
-          dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+          engine_addError(st, &err);
         }
       }
     }
   }
   tok.loc.end = st->loc;
-  if (mantissa.len != 0) { mantissa.pos = !neg; }  // finally make use of the sign we may have parsed at the beginning
-  tok.as.number.mantissa = mantissa;
-  tok.as.number.radix = radix->radix;
-  tok.as.number.fractionalDigits = fractionalDigits;
-  if (exponent.len != 0) { exponent.pos = !expNeg; }
-  tok.as.number.exponent = exponent;
+  if (st->lazyPayloads) {
+    tok.flags |= FLAG_LAZY;
+    tok.as.lazy.len = st->rest.bytes - start;
+    tok.as.lazy.bytes = start;
+  }
+  else {
+    if (mantissa.len != 0) { mantissa.pos = !neg; }  // finally make use of the sign we may have parsed at the beginning
+    tok.as.number.mantissa = mantissa;
+    tok.as.number.radix = radix->radix;
+    tok.as.number.fractionalDigits = fractionalDigits;
+    if (exponent.len != 0) { exponent.pos = !expNeg; }
+    tok.as.number.exponent = exponent;
+  }
   lexer_addTok(st, &tok);
   return true;
 }
 
+// The string lexers below accumulate decoded text only when payloads are eager (see `FLAG_LAZY`).
+// In lazy mode, they still scan (and report errors) exactly as usual, but the token only records its own source text.
+// The text is accumulated in the engine's scratch builder, which is reused from one literal to the next,
+//   and is copied out at its exact size once the token is finished.
+static
+strBuilder* payload_start(engine* st) {
+  st->payloadScratch.len = 0;
+  return &st->payloadScratch;
+}
+static
+void payload_append(const engine* st, strBuilder* buf, str more) {
+  if (!st->lazyPayloads) { strBuilder_append(buf, more); }
+}
+static
+void payload_finishString(const engine* st, eexpr_token* tok, uint8_t* start, const strBuilder* buf) {
+  if (st->lazyPayloads) {
+    tok->flags |= FLAG_LAZY;
+    tok->as.string.text.len = st->rest.bytes - start;
+    tok->as.string.text.bytes = start;
+  }
+  else if (buf->len == 0) {
+    tok->as.string.text.len = 0;
+    tok->as.string.text.bytes = NULL;
+  }
+  else {
+    tok->as.string.text.len = buf->len;
+    tok->as.string.text.bytes = malloc(buf->len);
+    checkOom(tok->as.string.text.bytes);
+    memcpy(tok->as.string.text.bytes, buf->bytes, buf->len);
+  }
+}
+
 /*
 Strings are make of a number of (reasonable, as in the codepoitn parser) characters and escape sequences.
 The valid escape sequences are those of character strings, plus null escape sequences (see `takeNullEscape`).
@@ -596,12 +673,13 @@ These parts can end with a backtick (to begin an interpolation), start with a ba
 static
 bool takeString(engine* st) {
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_STRING};
+  uint8_t* start = st->rest.bytes;
   char32_t open; {
     size_t adv = peekUchar(&open, st->rest);
     if (!isStringDelim(open)) { return false; }
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
   }
-  strBuilder buf = strBuilder_new(128);
+  strBuilder* buf = payload_start(st);
   for (bool more = true; more; ) {
     more = false;
     { // standard characters
@@ -610,26 +688,26 @@ bool takeString(engine* st) {
         char32_t c;
         size_t adv = peekUchar(&c, st->rest);
         if (!isStringChar(c)) { break; }
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         tmp.len += adv;
       }
       if (tmp.len != 0) {
         more = true;
-        strBuilder_append(&buf, tmp);
+        payload_append(st, buf, tmp);
       }
     }
     { // escape sequences
       char32_t c;
       size_t adv = peekUchar(&c, st->rest);
       if (c == escapeLeader) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         more = true;
         char32_t decoded;
         if (takeCharEscape(st, &decoded)) { // found a single-character escape
           if (decoded != UCHAR_NULL) {
             utf8Char encoded = encodeUchar(decoded);
             str tmp = {.len = encoded.nbytes, .bytes = encoded.codeunits};
-            strBuilder_append(&buf, tmp);
+            payload_append(st, buf, tmp);
           }
         }
         else if (takeNullEscape(st)) { // found a null escape
@@ -647,9 +725,9 @@ bool takeString(engine* st) {
           else { // no valid escape sequence found
             more = true;
             eexpr_error err = {.loc = {.start = st->loc}, .type = EEXPR_ERR_BAD_ESCAPE_CHAR, .as.badEscapeChar = c};
-            lexer_advance(st, adv, 1);
+            lexer_advance(st, adv);
             err.loc.end = st->loc;
-            dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+            engine_addError(st, &err);
           }
         }
       }
@@ -664,25 +742,24 @@ bool takeString(engine* st) {
         ) { break; }
       else if (!more) { // characters that did not match above are invalid and error recovery should skip them
         eexpr_error err = {.loc = {.start = st->loc}, .type = EEXPR_ERR_BAD_STRING_CHAR, .as.badStringChar = c};
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         err.loc.end = st->loc;
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
     }
   }
   char32_t close; {
     size_t adv = peekUchar(&close, st->rest);
     if (isStringDelim(close)) {
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
     }
     else {
       eexpr_error err = {.loc = {.start = tok.loc.start, .end = st->loc}, .type = EEXPR_ERR_UNCLOSED_STRING};
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
   }
   tok.loc.end = st->loc;
-  tok.as.string.text.len = buf.len;
-  tok.as.string.text.bytes = realloc(buf.bytes, buf.len);
+  payload_finishString(st, &tok, start, buf);
   tok.as.string.splice = spliceType(open, close);
   lexer_addTok(st, &tok);
   return true;
@@ -698,8 +775,9 @@ bool takeSqlString(engine* st) {
   char32_t c; size_t adv = peekUchar(&c, st->rest);
   if (c != sqlStringDelim) { return false; }
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_STRING};
-  lexer_advance(st, adv, 1);
-  strBuilder buf = strBuilder_new(128);
+  uint8_t* start = st->rest.bytes;
+  lexer_advance(st, adv);
+  strBuilder* buf = payload_start(st);
   while (true) {
     adv = peekUchar(&c, st->rest);
     str tmp = {.len = adv, .bytes = st->rest.bytes};
@@ -707,7 +785,7 @@ bool takeSqlString(engine* st) {
       if (takeNewline(st)) {
         lexer_delTok(st);
         tmp.len = st->rest.bytes - tmp.bytes;
-        strBuilder_append(&buf, tmp);
+        payload_append(st, buf, tmp);
       }
       else {
         goto unclosed;
@@ -716,14 +794,13 @@ bool takeSqlString(engine* st) {
     else if (c == sqlStringDelim) {
       char32_t lookahead[2]; size_t bigAdv = peekUchars(lookahead, 2, st->rest);
       if (lookahead[1] == sqlStringDelim) {
-        strBuilder_append(&buf, tmp);
-        lexer_advance(st, bigAdv, 1);
+        payload_append(st, buf, tmp);
+        lexer_advance(st, bigAdv);
       }
       else {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         tok.loc.end = st->loc;
-        tok.as.string.text.len = buf.len;
-        tok.as.string.text.bytes = realloc(buf.bytes, buf.len);
+        payload_finishString(st, &tok, start, buf);
         tok.as.string.splice = EEXPR_STRPLAIN;
         lexer_addTok(st, &tok);
         return true;
@@ -731,23 +808,22 @@ bool takeSqlString(engine* st) {
     }
     else if (adv == 0) unclosed: {
       tok.loc.end = st->loc;
-      tok.as.string.text.len = buf.len;
-      tok.as.string.text.bytes = realloc(buf.bytes, buf.len);
+      payload_finishString(st, &tok, start, buf);
       tok.as.string.splice = EEXPR_STRCORRUPT;
       lexer_addTok(st, &tok);
       eexpr_error err =
         { .loc = {.start = tok.loc.start, .end = st->loc}
         , .type = EEXPR_ERR_UNCLOSED_MULTILINE_STRING
         };
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
       return true;
     }
     else if (c == UCHAR_NULL) {
       tryBadBytes(st, false);
     }
     else {
-      lexer_advance(st, adv, 1);
-      strBuilder_append(&buf, tmp);
+      lexer_advance(st, adv);
+      payload_append(st, buf, tmp);
     }
   }
 }
@@ -780,9 +856,26 @@ If the indentation is listed in tabs, the terminating backslash must be followed
 The last newline of a heredoc is not included in the string.
 If you want a trailing newline in the string, explicitly include a blank line.
 */
+// A heredoc ends with its delimiter name followed by three plain string delimiters.
+// Returns the length in bytes of that end marker if `rest` starts with one, otherwise zero.
+static
+size_t heredocEnder(str rest, str delimName) {
+  if (!isPrefixOf(rest, delimName)) { return 0; }
+  rest.bytes += delimName.len;
+  rest.len -= delimName.len;
+  char32_t lookahead[3];
+  size_t adv = peekUchars(lookahead, 3, rest);
+  if ( lookahead[0] != plainStringDelim
+    || lookahead[1] != plainStringDelim
+    || lookahead[2] != plainStringDelim
+     ) { return 0; }
+  return delimName.len + adv;
+}
+
 static
 bool takeHeredoc(engine* st) {
   eexpr_token tok = {.loc = {.start = st->loc}, .type = EEXPR_TOK_STRING};
+  uint8_t* start = st->rest.bytes;
   {
     char32_t lookahead[3];
     size_t adv = peekUchars(lookahead, 3, st->rest);
@@ -790,33 +883,21 @@ bool takeHeredoc(engine* st) {
       || lookahead[1] != plainStringDelim
       || lookahead[2] != plainStringDelim
        ) { return false; }
-    lexer_advance(st, adv, 3);
+    lexer_advance(st, adv);
     tok.as.string.splice = EEXPR_STRPLAIN;
   }
-  str ender;
-  size_t enderNChars = 0;
+  // the name is borrowed from the input, so that finding the end marker needs no allocation (see `heredocEnder`)
+  str delimName = {.len = 0, .bytes = st->rest.bytes};
   { // accumulate delimiter name
-    str delimName = {.len = 0, .bytes = st->rest.bytes};
     while (true) {
       char32_t c;
       size_t adv = peekUchar(&c, st->rest);
       if (isSymbolChar(c)) {
         delimName.len += adv;
-        lexer_advance(st, adv, 1);
-        enderNChars += 1;
+        lexer_advance(st, adv);
       }
       else { break; }
     }
-    size_t quoteBytes = encodeUchar(plainStringDelim).nbytes;
-    ender.len = delimName.len + 3*quoteBytes;
-    ender.bytes = malloc(ender.len * sizeof(uint8_t));
-    checkOom(ender.bytes);
-    memcpy(ender.bytes, delimName.bytes, delimName.len);
-    ender.bytes[ender.len - 3*quoteBytes]
-      = ender.bytes[ender.len - 2*quoteBytes]
-      = ender.bytes[ender.len - 1*quoteBytes]
-      = plainStringDelim;
-    enderNChars += 3;
   }
   bool indented = false;
   { // detect indentation flag (skipping whitespace around first backslash)
@@ -825,7 +906,7 @@ bool takeHeredoc(engine* st) {
     while (true) {
       char32_t c; size_t adv = peekUchar(&c, st->rest);
       if (isSpaceChar(c)) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         trailingSpace = true;
       }
       else { break; }
@@ -834,12 +915,12 @@ bool takeHeredoc(engine* st) {
     if (lookahead == escapeLeader) {
       trailingSpace = false;
       indented = true;
-      lexer_advance(st, adv, 1);
+      lexer_advance(st, adv);
       err.loc.start = st->loc;
       while (true) {
         char32_t c; size_t adv = peekUchar(&c, st->rest);
         if (isSpaceChar(c)) {
-          lexer_advance(st, adv, 1);
+          lexer_advance(st, adv);
           trailingSpace = true;
         }
         else { break; }
@@ -847,7 +928,7 @@ bool takeHeredoc(engine* st) {
     }
     if (trailingSpace) {
       err.loc.end = st->loc;
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
   }
   { // consume a newline, or else it's a fatal error
@@ -867,10 +948,10 @@ bool takeHeredoc(engine* st) {
     char32_t indentChar;
     if (indented) {
       // determine indentation character
-      struct eexpr_locPoint indentPosStart = st->loc;
+      size_t indentPosStart = st->loc;
       char32_t c; size_t adv = peekUchar(&c, st->rest);
       if (isSpaceChar(c)) {
-        lexer_advance(st, adv, 1);
+        lexer_advance(st, adv);
         indentChar = c;
         indentNChars += 1;
       }
@@ -881,17 +962,17 @@ bool takeHeredoc(engine* st) {
       while (true) {
         char32_t c; size_t adv = peekUchar(&c, st->rest);
         if (c == indentChar) {
-          lexer_advance(st, adv, 1);
+          lexer_advance(st, adv);
           indentNChars += 1;
         }
         else if (c == escapeLeader) {
-          lexer_advance(st, adv, 1);
+          lexer_advance(st, adv);
           indentNChars += 1;
           if (indentChar == tabChar) {
             // tab-based indentation needs an alignment tab after the closing backslash
             char32_t c; size_t adv = peekUchar(&c, st->rest);
             if (c == tabChar) {
-              lexer_advance(st, adv, 1);
+              lexer_advance(st, adv);
             }
             else {
               goto badIndentDef;
@@ -922,7 +1003,7 @@ bool takeHeredoc(engine* st) {
         err.as.mixedIndentation.establishedType = st->indent.type;
         err.as.mixedIndentation.establishedAt = st->indent.established;
         st->indent.knownMixed = true;
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
     }
     else {
@@ -930,7 +1011,7 @@ bool takeHeredoc(engine* st) {
     }
   }
   // accumulate lines until end marker
-  strBuilder textBuf = strBuilder_new(256);
+  strBuilder* textBuf = payload_start(st);
   while (true) {
     { // consume line
       str tmp = {.len = 0, .bytes = st->rest.bytes};
@@ -939,16 +1020,16 @@ bool takeHeredoc(engine* st) {
         if ( adv == 0
           || isNewlineChar(c)
            ) {
-          strBuilder_append(&textBuf, tmp);
+          payload_append(st, textBuf, tmp);
           break;
         }
         else if (c == UCHAR_NULL) {
-          strBuilder_append(&textBuf, tmp);
+          payload_append(st, textBuf, tmp);
           tryBadBytes(st, false);
           tmp.len = 0; tmp.bytes = st->rest.bytes;
         }
         else {
-          lexer_advance(st, adv, 1);
+          lexer_advance(st, adv);
           tmp.len += adv;
         }
       }
@@ -960,10 +1041,8 @@ bool takeHeredoc(engine* st) {
         nlText.len = st->rest.bytes - nlText.bytes;
       }
       else {
-        free(ender.bytes);
         tok.loc.end = st->loc;
-        tok.as.string.text.len = textBuf.len;
-        tok.as.string.text.bytes = textBuf.bytes;
+        payload_finishString(st, &tok, start, textBuf);
         lexer_addTok(st, &tok);
         st->fatal.type = EEXPR_ERR_UNCLOSED_MULTILINE_STRING;
         st->fatal.loc = tok.loc;
@@ -975,37 +1054,36 @@ bool takeHeredoc(engine* st) {
       for (size_t i = 0; i < indentNChars; ++i) {
         char32_t c; size_t adv = peekUchar(&c, st->rest);
         if (isSpaceChar(c) && decodeIndentChar(c) == indentType) {
-          lexer_advance(st, adv, 1);
+          lexer_advance(st, adv);
         }
         else if (isNewlineChar(c)) {
           if (i != 0) {
             err.type = EEXPR_ERR_TRAILING_SPACE;
             err.loc.end = st->loc;
-            dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+            engine_addError(st, &err);
           }
           break;
         }
         else {
           err.loc.end = st->loc;
-          dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+          engine_addError(st, &err);
           break;
         }
       }
     }
     { // detect end-of-heredoc
-      if (isPrefixOf(st->rest, ender)) {
-        lexer_advance(st, ender.len, enderNChars);
+      size_t enderLen = heredocEnder(st->rest, delimName);
+      if (enderLen != 0) {
+        lexer_advance(st, enderLen);
         break;
       }
       else {
-        strBuilder_append(&textBuf, nlText);
+        payload_append(st, textBuf, nlText);
       }
     }
   }
-  free(ender.bytes);
   tok.loc.end = st->loc;
-  tok.as.string.text.len = textBuf.len;
-  tok.as.string.text.bytes = textBuf.bytes;
+  payload_finishString(st, &tok, start, textBuf);
   lexer_addTok(st, &tok);
   return true;
 }
@@ -1025,7 +1103,7 @@ bool takeWrap(engine* st) {
     tok.as.wrap.type = type;
     tok.as.wrap.isOpen = isOpenWrap(lookahead);
   }
-  lexer_advance(st, adv, 1);
+  lexer_advance(st, adv);
   tok.loc.end = st->loc;
   lexer_addTok(st, &tok);
   return true;
@@ -1053,7 +1131,7 @@ bool takeSplitter(engine* st) {
     case SPLITTER_COMMA: tok.type = EEXPR_TOK_COMMA; break;
     default: assert(false);
   }
-  lexer_advance(st, info.bytes, info.chars);
+  lexer_advance(st, info.bytes);
   tok.loc.end = st->loc;
   lexer_addTok(st, &tok);
   return true;
@@ -1071,9 +1149,9 @@ bool takeUnexpected(engine* st) {
   else {
     eexpr_error err = {.loc = {.start = st->loc}, .type = EEXPR_ERR_BAD_CHAR};
     err.as.badChar = c;
-    lexer_advance(st, adv, 1);
+    lexer_advance(st, adv);
     err.loc.end = st->loc;
-    dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+    engine_addError(st, &err);
     return true;
   }
 }
@@ -1081,6 +1159,11 @@ bool takeUnexpected(engine* st) {
 //////////////////////////////////// Main Lexer Functions ////////////////////////////////////
 
 void engine_rawLex(engine* st) {
+  if (st->limits.bytes != 0 && st->rest.len > st->limits.bytes) {
+    eexpr_span loc = {.start = st->loc + st->limits.bytes, .end = st->loc + st->rest.len};
+    engine_limitExceeded(st, EEXPR_LIMIT_BYTES, loc);
+    return;
+  }
   while (st->fatal.type == EEXPR_ERR_NOERROR) {
     if (takeWhitespace(st)) { continue; }
     if (takeNewline(st)) { continue; }
@@ -1099,3 +1182,96 @@ void engine_rawLex(engine* st) {
     assert(false);
   }
 }
+
+
+//////////////////////////////////// Lazy Payload Decoding ////////////////////////////////////
+
+// an engine just big enough to re-run a single `take*` procedure over a known token
+static
+engine scratchEngine(str source) {
+  engine st =
+    { .rest = source
+    , .tokStream = dllist_empty_eexpr_token()
+    , .errStream = dllist_empty_eexpr_error()
+    , .discoveredNewline = NEWLINE_NONE
+    , .indent = {.knownMixed = false, .type = EEXPR_INDENT_NULL}
+    , .lazyPayloads = false
+    , .payloadScratch = {.len = 0, .cap = 0, .bytes = NULL}
+    };
+  st.fatal.type = EEXPR_ERR_NOERROR;
+  return st;
+}
+static
+void scratchEngine_deinit(engine* st) {
+  // everything not set up by `scratchEngine` is empty, which `engine_deinit` is fine with
+  engine_deinit(st);
+}
+
+static
+eexprNumber decodeNumber(str source) {
+  engine st = scratchEngine(source);
+  eexprNumber out = {.mantissa = bigint_new(), .radix = 10, .fractionalDigits = 0, .exponent = bigint_new()};
+  if (takeNumber(&st)) {
+    eexpr_token* tok = &st.tokStream.end->here;
+    out = tok->as.number;
+    tok->as.number.mantissa = bigint_new();
+    tok->as.number.exponent = bigint_new();
+  }
+  scratchEngine_deinit(&st);
+  return out;
+}
+
+static
+str decodeString(str source) {
+  str out = {.len = 0, .bytes = NULL};
+  if (source.len == 0) { return out; }
+  engine st = scratchEngine(source);
+  if (takeHeredoc(&st) || takeString(&st) || takeSqlString(&st)) {
+    // newline tokens that strings consume are already deleted, so only the string can remain
+    if (st.tokStream.end != NULL) {
+      eexpr_token* tok = &st.tokStream.end->here;
+      out = tok->as.string.text;
+      tok->as.string.text.len = 0;
+      tok->as.string.text.bytes = NULL;
+    }
+  }
+  scratchEngine_deinit(&st);
+  return out;
+}
+
+void lexer_forceToken(eexpr_token* tok) {
+  if (!(tok->flags & FLAG_LAZY)) { return; }
+  switch (tok->type) {
+    case EEXPR_TOK_NUMBER: {
+      tok->as.number = decodeNumber(tok->as.lazy);
+    }; break;
+    case EEXPR_TOK_STRING: {
+      tok->as.string.text = decodeString(tok->as.string.text);
+    }; break;
+    default: break;
+  }
+  tok->flags &= ~FLAG_LAZY;
+}
+
+void lexer_forceEexpr(eexpr* e) {
+  if (!(e->flags & FLAG_LAZY)) { return; }
+  // shared eexprs are decoded before they go into their table, and built ones are never lazy
+  assert(!(e->flags & (FLAG_SHARED | FLAG_ARENA)));
+  switch (e->type) {
+    case EEXPR_NUMBER: {
+      e->as.number = decodeNumber(e->as.lazy);
+    }; break;
+    case EEXPR_STRING: {
+      e->as.string.text1 = decodeString(e->as.string.text1);
+      for (size_t i = 0; i < e->as.string.parts.len; ++i) {
+        strTemplPart* part = &e->as.string.parts.data[i];
+        str source = {.len = part->nBytes, .bytes = part->utf8str};
+        str text = decodeString(source);
+        part->nBytes = text.len;
+        part->utf8str = text.bytes;
+      }
+    }; break;
+    default: break;
+  }
+  e->flags &= ~FLAG_LAZY;
+}
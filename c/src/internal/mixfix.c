@@ -0,0 +1,687 @@
+#include "mixfix.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+typedef eexpr_mixfixDefError defError;
+#define TYPE defError
+#include "dynarr.h"
+
+typedef eexpr_mixfixError mixfixError;
+#define TYPE mixfixError
+#include "dynarr.h"
+
+#define TYPE uint32_t
+#include "dynarr.h"
+
+
+static
+str textStr(eexpr_mixfixText text) {
+  str out = {.len = text.nBytes, .bytes = (uint8_t*)text.utf8str};
+  return out;
+}
+
+static
+void pushDefError(dynarr_defError* errors, eexpr_mixfixDefErrorType type, size_t def, size_t other) {
+  defError err = {.type = type, .def = def, .other = other, .name = {.nBytes = 0, .utf8str = NULL}};
+  dynarr_push_defError(errors, &err);
+}
+
+
+//////////////////////////////////// Compiling Tables ////////////////////////////////////
+
+// Same checks as `toTemplate` in the Haskell prototype, in the same order.
+static
+bool checkTemplate(dynarr_defError* errors, size_t i, const eexpr_mixfixDef* def) {
+  if (def->nParts == 0) {
+    pushDefError(errors, EEXPR_MIXFIX_EMPTY_TEMPLATE, i, EEXPR_MIXFIX_NONE);
+    return false;
+  }
+  size_t nHoles = 0;
+  bool doubled = false;
+  for (size_t k = 0; k < def->nParts; ++k) {
+    if (def->parts[k].utf8str != NULL) { continue; }
+    nHoles += 1;
+    if (k != 0 && def->parts[k-1].utf8str == NULL) { doubled = true; }
+  }
+  eexpr_mixfixDefErrorType type;
+  if (nHoles == 0) { type = EEXPR_MIXFIX_ZERO_HOLES; }
+  else if (nHoles == def->nParts) { type = EEXPR_MIXFIX_ZERO_LITERALS; }
+  else if (doubled) { type = EEXPR_MIXFIX_DOUBLED_HOLES; }
+  else { return true; }
+  pushDefError(errors, type, i, EEXPR_MIXFIX_NONE);
+  return false;
+}
+
+// Union-find over definitions, for "same as" constraints.
+static
+uint32_t classOf(uint32_t* classes, uint32_t i) {
+  while (classes[i] != i) {
+    classes[i] = classes[classes[i]];
+    i = classes[i];
+  }
+  return i;
+}
+
+// A precedence constraint, as an edge from the looser-binding class to the tighter-binding one.
+typedef struct precEdge {
+  uint32_t from;
+  uint32_t to;
+  uint32_t def; // the definition that declared the constraint
+  uint32_t other; // the definition it named
+} precEdge;
+#define TYPE precEdge
+#include "dynarr.h"
+
+// Look up each name in `names`, reporting the unknown ones.
+// The found definitions are appended to `out`.
+static
+void resolveNames(dynarr_defError* errors, const eexpr_symtab* nameTab, const uint32_t* defOfName, size_t i, struct eexpr_mixfixNames names, dynarr_uint32_t* out) {
+  for (size_t k = 0; k < names.n; ++k) {
+    uint32_t id = symtab_find(nameTab, textStr(names.names[k]));
+    if (id == EEXPR_NO_SYMBOL) {
+      defError err = {.type = EEXPR_MIXFIX_UNKNOWN_NAME, .def = i, .other = EEXPR_MIXFIX_NONE, .name = names.names[k]};
+      dynarr_push_defError(errors, &err);
+      continue;
+    }
+    dynarr_push_uint32_t(out, &defOfName[id]);
+  }
+}
+
+// Adjacency lists in compressed form: the edges out of `u` lead to `adj[start[u]]` up to `adj[start[u+1]]`.
+// With `reverse` set, these are the edges into `u` instead, leading back to where they came from.
+static
+void buildAdjacency(size_t nDefs, const dynarr_precEdge* edges, bool reverse, uint32_t** start_out, uint32_t** adj_out) {
+  uint32_t* start = calloc(nDefs + 1, sizeof(uint32_t));
+  checkOom(start);
+  uint32_t* adj = malloc((edges->len == 0 ? 1 : edges->len) * sizeof(uint32_t));
+  checkOom(adj);
+  for (size_t e = 0; e < edges->len; ++e) {
+    uint32_t u = reverse ? edges->data[e].to : edges->data[e].from;
+    start[u + 1] += 1;
+  }
+  for (size_t u = 0; u < nDefs; ++u) { start[u+1] += start[u]; }
+  for (size_t e = 0; e < edges->len; ++e) {
+    uint32_t u = reverse ? edges->data[e].to : edges->data[e].from;
+    uint32_t v = reverse ? edges->data[e].from : edges->data[e].to;
+    adj[start[u]++] = v;
+  }
+  // filling advanced each start to the next one's, so shift them back into place
+  for (size_t u = nDefs; u > 0; --u) { start[u] = start[u-1]; }
+  start[0] = 0;
+  *start_out = start;
+  *adj_out = adj;
+}
+
+// Assign each class a level so that every edge goes from a lower level to a higher one,
+//   using as few levels as possible (Kahn's algorithm, tracking the longest path to each class).
+// Constraints that take part in a cycle are reported instead.
+static
+void solveLevels(dynarr_defError* errors, size_t nDefs, const uint32_t* classes, const dynarr_precEdge* edges, uint32_t* levels) {
+  uint32_t *outStart, *outAdj, *inStart, *inAdj;
+  buildAdjacency(nDefs, edges, false, &outStart, &outAdj);
+  buildAdjacency(nDefs, edges, true, &inStart, &inAdj);
+  uint32_t* inDeg = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(inDeg);
+  // each class representative passes through the queue at most once
+  uint32_t* queue = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(queue);
+  size_t head = 0, tail = 0;
+  for (uint32_t u = 0; u < nDefs; ++u) {
+    levels[u] = 0;
+    inDeg[u] = inStart[u+1] - inStart[u];
+    if (classes[u] == u && inDeg[u] == 0) { queue[tail++] = u; }
+  }
+  while (head < tail) {
+    uint32_t u = queue[head++];
+    for (uint32_t k = outStart[u]; k < outStart[u+1]; ++k) {
+      uint32_t v = outAdj[k];
+      if (levels[v] < levels[u] + 1) { levels[v] = levels[u] + 1; }
+      if (--inDeg[v] == 0) { queue[tail++] = v; }
+    }
+  }
+  // Classes left with incoming edges are either on a cycle, or downstream of one.
+  // Peel off the downstream ones in the same way, but backwards from the sinks, so that only cycles get blamed.
+  bool* stuck = calloc(nDefs == 0 ? 1 : nDefs, sizeof(bool));
+  checkOom(stuck);
+  for (uint32_t u = 0; u < nDefs; ++u) { stuck[u] = inDeg[u] != 0; }
+  head = tail = 0;
+  uint32_t* outDeg = inDeg; // in-degrees are not needed any more, so reuse their storage
+  for (uint32_t u = 0; u < nDefs; ++u) {
+    outDeg[u] = 0;
+    if (!stuck[u]) { continue; }
+    for (uint32_t k = outStart[u]; k < outStart[u+1]; ++k) {
+      if (stuck[outAdj[k]]) { outDeg[u] += 1; }
+    }
+    if (outDeg[u] == 0) { queue[tail++] = u; }
+  }
+  while (head < tail) {
+    uint32_t v = queue[head++];
+    stuck[v] = false;
+    for (uint32_t k = inStart[v]; k < inStart[v+1]; ++k) {
+      uint32_t u = inAdj[k];
+      if (stuck[u] && --outDeg[u] == 0) { queue[tail++] = u; }
+    }
+  }
+  for (size_t e = 0; e < edges->len; ++e) {
+    const precEdge* edge = &edges->data[e];
+    if (!stuck[edge->from] || !stuck[edge->to]) { continue; }
+    pushDefError(errors, EEXPR_MIXFIX_UNSOLVABLE_PRECEDENCE, edge->def, edge->other);
+  }
+  free(stuck);
+  free(queue);
+  free(inDeg);
+  free(inAdj);
+  free(inStart);
+  free(outAdj);
+  free(outStart);
+}
+
+// Operators that share a key are matched together, part by part.
+// That only works if, at each part, they agree on whether to expect a hole or a literal;
+//   one may end early only if the other continues with a literal (that decides between them).
+static
+bool compatible(const mixfixOp* a, const mixfixOp* b) {
+  if (a->level != b->level || a->assoc != b->assoc) { return false; }
+  for (uint32_t k = 0; true; ++k) {
+    bool aEnds = k == a->nParts, bEnds = k == b->nParts;
+    if (aEnds && bEnds) { return false; } // the templates are the same
+    if (aEnds) { return b->parts[k] != MIXFIX_HOLE; }
+    if (bEnds) { return a->parts[k] != MIXFIX_HOLE; }
+    bool aHole = a->parts[k] == MIXFIX_HOLE, bHole = b->parts[k] == MIXFIX_HOLE;
+    if (aHole != bHole) { return false; }
+    if (!aHole && a->parts[k] != b->parts[k]) { return true; }
+  }
+}
+
+static
+void pushEdge(dynarr_defError* errors, dynarr_precEdge* edges, uint32_t from, uint32_t to, uint32_t def, uint32_t other) {
+  if (from == to) {
+    pushDefError(errors, EEXPR_MIXFIX_UNSOLVABLE_PRECEDENCE, def, other);
+    return;
+  }
+  precEdge edge = {.from = from, .to = to, .def = def, .other = other};
+  dynarr_push_precEdge(edges, &edge);
+}
+
+static
+void checkGroup(dynarr_defError* errors, const eexpr_mixfixTable* self, uint32_t start, uint32_t end) {
+  for (uint32_t a = start; a < end; ++a) {
+    for (uint32_t b = a + 1; b < end; ++b) {
+      if (compatible(&self->ops[self->byKey[a]], &self->ops[self->byKey[b]])) { continue; }
+      pushDefError(errors, EEXPR_MIXFIX_AMBIGUOUS, self->byKey[b], self->byKey[a]);
+    }
+  }
+}
+
+// Lay out the operators and their lookup tables, once the levels are known.
+static
+eexpr_mixfixTable* buildTable(size_t nDefs, const eexpr_mixfixDef* defs, uint32_t* classes, const uint32_t* levels) {
+  eexpr_mixfixTable* self = malloc(sizeof(eexpr_mixfixTable));
+  checkOom(self);
+  self->literals = symtab_new();
+  self->nOps = nDefs;
+  self->ops = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(mixfixOp));
+  checkOom(self->ops);
+  size_t nParts = 0;
+  for (size_t i = 0; i < nDefs; ++i) { nParts += defs[i].nParts; }
+  self->parts = malloc((nParts == 0 ? 1 : nParts) * sizeof(uint32_t));
+  checkOom(self->parts);
+  nParts = 0;
+  for (size_t i = 0; i < nDefs; ++i) {
+    mixfixOp* op = &self->ops[i];
+    op->name = str_clone(textStr(defs[i].name));
+    op->level = levels[classOf(classes, i)];
+    op->assoc = defs[i].assoc;
+    op->nParts = defs[i].nParts;
+    op->parts = &self->parts[nParts];
+    nParts += op->nParts;
+    for (size_t k = 0; k < op->nParts; ++k) {
+      const eexpr_mixfixText* part = &defs[i].parts[k];
+      op->parts[k] = part->utf8str == NULL ? MIXFIX_HOLE : symtab_intern(self->literals, textStr(*part));
+    }
+  }
+  // bucket the operators by key, prefix keys first and then infix keys, all in one `byKey` array
+  size_t nLits = self->literals->symbols.len;
+  self->prefixStart = calloc(nLits + 1, sizeof(uint32_t));
+  checkOom(self->prefixStart);
+  self->infixStart = calloc(nLits + 1, sizeof(uint32_t));
+  checkOom(self->infixStart);
+  for (size_t i = 0; i < nDefs; ++i) {
+    const mixfixOp* op = &self->ops[i];
+    if (op->parts[0] == MIXFIX_HOLE) { self->infixStart[op->parts[1] + 1] += 1; }
+    else { self->prefixStart[op->parts[0] + 1] += 1; }
+  }
+  for (size_t lit = 0; lit < nLits; ++lit) { self->prefixStart[lit+1] += self->prefixStart[lit]; }
+  self->infixStart[0] = self->prefixStart[nLits];
+  for (size_t lit = 0; lit < nLits; ++lit) { self->infixStart[lit+1] += self->infixStart[lit]; }
+  self->byKey = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(self->byKey);
+  uint32_t* fill = malloc(2 * (nLits == 0 ? 1 : nLits) * sizeof(uint32_t));
+  checkOom(fill);
+  memcpy(fill, self->prefixStart, nLits * sizeof(uint32_t));
+  memcpy(&fill[nLits], self->infixStart, nLits * sizeof(uint32_t));
+  for (uint32_t i = 0; i < nDefs; ++i) {
+    const mixfixOp* op = &self->ops[i];
+    if (op->parts[0] == MIXFIX_HOLE) { self->byKey[fill[nLits + op->parts[1]]++] = i; }
+    else { self->byKey[fill[op->parts[0]]++] = i; }
+  }
+  free(fill);
+  return self;
+}
+
+eexpr_mixfixTable* mixfixTable_new(size_t nDefs, const eexpr_mixfixDef* defs, size_t* nErrors, eexpr_mixfixDefError** errors_out) {
+  assert(nDefs < EEXPR_MIXFIX_NONE);
+  dynarr_defError errors; dynarr_init_defError(&errors, 4);
+  for (size_t i = 0; i < nDefs; ++i) {
+    checkTemplate(&errors, i, &defs[i]);
+  }
+  // names
+  eexpr_symtab* names = symtab_new();
+  uint32_t* defOfName = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(defOfName);
+  for (uint32_t i = 0; i < nDefs; ++i) {
+    size_t nNames = names->symbols.len;
+    uint32_t id = symtab_intern(names, textStr(defs[i].name));
+    if (id == nNames) { defOfName[id] = i; }
+    else { pushDefError(&errors, EEXPR_MIXFIX_DUPLICATE_NAME, i, defOfName[id]); }
+  }
+  // "same as" constraints merge definitions into classes, which then get one level each
+  uint32_t* classes = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(classes);
+  for (uint32_t i = 0; i < nDefs; ++i) { classes[i] = i; }
+  dynarr_uint32_t named; dynarr_init_uint32_t(&named, 8);
+  for (uint32_t i = 0; i < nDefs; ++i) {
+    named.len = 0;
+    resolveNames(&errors, names, defOfName, i, defs[i].sameAs, &named);
+    for (size_t k = 0; k < named.len; ++k) {
+      uint32_t a = classOf(classes, i), b = classOf(classes, named.data[k]);
+      if (a < b) { classes[b] = a; }
+      else { classes[a] = b; }
+    }
+  }
+  // "lower/higher than" constraints order the classes
+  dynarr_precEdge edges; dynarr_init_precEdge(&edges, 16);
+  for (uint32_t i = 0; i < nDefs; ++i) {
+    named.len = 0;
+    resolveNames(&errors, names, defOfName, i, defs[i].lowerThan, &named);
+    for (size_t k = 0; k < named.len; ++k) {
+      uint32_t j = named.data[k];
+      pushEdge(&errors, &edges, classOf(classes, i), classOf(classes, j), i, j);
+    }
+    named.len = 0;
+    resolveNames(&errors, names, defOfName, i, defs[i].higherThan, &named);
+    for (size_t k = 0; k < named.len; ++k) {
+      uint32_t j = named.data[k];
+      pushEdge(&errors, &edges, classOf(classes, j), classOf(classes, i), i, j);
+    }
+  }
+  uint32_t* levels = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(uint32_t));
+  checkOom(levels);
+  solveLevels(&errors, nDefs, classes, &edges, levels);
+  eexpr_mixfixTable* self = NULL;
+  if (errors.len == 0) {
+    self = buildTable(nDefs, defs, classes, levels);
+    size_t nLits = self->literals->symbols.len;
+    for (size_t lit = 0; lit < nLits; ++lit) {
+      checkGroup(&errors, self, self->prefixStart[lit], self->prefixStart[lit+1]);
+      checkGroup(&errors, self, self->infixStart[lit], self->infixStart[lit+1]);
+    }
+    if (errors.len != 0) {
+      mixfixTable_del(self);
+      self = NULL;
+    }
+  }
+  free(levels);
+  dynarr_deinit_precEdge(&edges);
+  dynarr_deinit_uint32_t(&named);
+  free(classes);
+  free(defOfName);
+  eexpr_symtab_del(names);
+  *nErrors = errors.len;
+  if (errors.len == 0) {
+    dynarr_deinit_defError(&errors);
+    *errors_out = NULL;
+  }
+  else {
+    *errors_out = errors.data;
+  }
+  return self;
+}
+
+void mixfixTable_del(eexpr_mixfixTable* self) {
+  if (self == NULL) { return; }
+  eexpr_symtab_del(self->literals);
+  for (size_t i = 0; i < self->nOps; ++i) {
+    free(self->ops[i].name.bytes);
+  }
+  free(self->ops);
+  free(self->parts);
+  free(self->prefixStart);
+  free(self->infixStart);
+  free(self->byKey);
+  free(self);
+}
+
+
+//////////////////////////////////// Rewriting ////////////////////////////////////
+
+/*
+Each space eexpr is rewritten by precedence climbing over its items.
+Items are first classified as literals (by id) or operands, so the climbing itself only compares integers.
+Consecutive operands (and prefix or closed operators among them) are gathered into an application,
+  which fills a single hole.
+
+A hole in the middle of a template is filled with whatever comes before the next literal of that template,
+  so it ignores precedence; to get that effect, the literals that could come next are registered in `.stopAt`
+  for as long as the hole is being filled, and nothing will consume them until then.
+A hole at the end of a template is filled at a precedence that depends on the operator's level and associativity.
+*/
+
+typedef struct rewriter {
+  const eexpr_mixfixTable* table;
+  ////// the space eexpr being rewritten //////
+  eexpr* space;
+  size_t nItems;
+  eexpr** items;
+  uint32_t* lits; // literal id of each item, or `EEXPR_NO_SYMBOL` for operands
+  size_t pos; // index of the next item to consume
+  bool failed;
+  ////// scratch space //////
+  dynarr_uint32_t lits_store;
+  uint32_t* stopAt; // for each literal, how many holes being filled will stop before it
+  dynarr_eexpr_p operands; // a stack of args and application items being gathered
+  dynarr_uint32_t candidates; // a stack of the operators that could still match, for each operator being matched
+  dynarr_eexpr_p created; // new eexprs, which must be freed (but not their children) if the rewrite fails
+  dynarr_mixfixError errors;
+} rewriter;
+
+static
+bool isPrefixKey(const rewriter* st, uint32_t lit) {
+  return st->table->prefixStart[lit] != st->table->prefixStart[lit+1];
+}
+
+static
+bool isInfixKey(const rewriter* st, uint32_t lit) {
+  return st->table->infixStart[lit] != st->table->infixStart[lit+1];
+}
+
+// Where the item at `.pos` is, or an empty span at the end of the space eexpr if all items are consumed.
+static
+eexpr_span hereLoc(const rewriter* st) {
+  if (st->pos < st->nItems) { return st->items[st->pos]->loc; }
+  eexpr_span out = {.start = st->space->loc.end, .end = st->space->loc.end};
+  return out;
+}
+
+static
+eexpr* fail(rewriter* st, eexpr_mixfixErrorType type, uint32_t op) {
+  mixfixError err = {.loc = hereLoc(st), .type = type, .op = op};
+  dynarr_push_mixfixError(&st->errors, &err);
+  st->failed = true;
+  return NULL;
+}
+
+// Build a list-shaped eexpr from the top `n` operands, popping them.
+// Its location runs from the start of the first operand to the end of the last consumed item.
+static
+eexpr* popList(rewriter* st, eexpr_type type, size_t n) {
+  eexpr** first = &st->operands.data[st->operands.len - n];
+  eexpr* self = eexprList_new(type, n, first);
+  self->loc.start = first[0]->loc.start;
+  self->loc.end = st->items[st->pos - 1]->loc.end;
+  self->flags = 0;
+  st->operands.len -= n;
+  dynarr_push_eexpr_p(&st->created, &self);
+  return self;
+}
+
+static eexpr* parseExpr(rewriter* st, uint32_t minLevel);
+
+// Match an operator whose key literal is at `.pos`, given its left operand if it is infix or postfix.
+static
+eexpr* parseOp(rewriter* st, uint32_t lit, eexpr* left) {
+  const eexpr_mixfixTable* table = st->table;
+  size_t argBase = st->operands.len;
+  size_t candBase = st->candidates.len;
+  uint32_t start = left == NULL ? table->prefixStart[lit] : table->infixStart[lit];
+  uint32_t end = left == NULL ? table->prefixStart[lit+1] : table->infixStart[lit+1];
+  for (uint32_t i = start; i < end; ++i) {
+    dynarr_push_uint32_t(&st->candidates, &table->byKey[i]);
+  }
+  if (left != NULL) { dynarr_push_eexpr_p(&st->operands, &left); }
+  size_t startByte = left != NULL ? left->loc.start : st->items[st->pos]->loc.start;
+  st->pos += 1;
+  // all candidates agree up to part `k` (exclusive), see `compatible`
+  uint32_t k = left == NULL ? 1 : 2;
+  uint32_t matched = EEXPR_MIXFIX_NONE;
+  while (matched == EEXPR_MIXFIX_NONE) {
+    uint32_t* cands = &st->candidates.data[candBase];
+    size_t nCands = st->candidates.len - candBase;
+    const mixfixOp* op0 = &table->ops[cands[0]];
+    bool hole = false, trailing = false;
+    for (size_t c = 0; c < nCands; ++c) {
+      const mixfixOp* op = &table->ops[cands[c]];
+      if (k < op->nParts && op->parts[k] == MIXFIX_HOLE) {
+        hole = true;
+        trailing |= k + 1 == op->nParts;
+      }
+    }
+    if (hole) {
+      // when candidates disagree about whether this hole is the last part, treat it as the last (think dangling else)
+      uint32_t minLevel = !trailing ? 0 : op0->assoc == EEXPR_ASSOC_RIGHT ? op0->level : op0->level + 1;
+      for (size_t c = 0; c < nCands; ++c) {
+        const mixfixOp* op = &table->ops[cands[c]];
+        if (k + 1 < op->nParts) { st->stopAt[op->parts[k+1]] += 1; }
+      }
+      eexpr* arg = parseExpr(st, minLevel);
+      cands = &st->candidates.data[candBase];
+      for (size_t c = 0; c < nCands; ++c) {
+        const mixfixOp* op = &table->ops[cands[c]];
+        if (k + 1 < op->nParts) { st->stopAt[op->parts[k+1]] -= 1; }
+      }
+      if (arg == NULL) {
+        if (!st->failed) { fail(st, EEXPR_MIXFIX_ERR_EXPECTED_OPERAND, cands[0]); }
+        break;
+      }
+      dynarr_push_eexpr_p(&st->operands, &arg);
+      k += 1;
+      continue;
+    }
+    // otherwise, the candidates either expect a literal here or are complete
+    uint32_t next = st->pos < st->nItems ? st->lits[st->pos] : EEXPR_NO_SYMBOL;
+    size_t nKept = 0;
+    for (size_t c = 0; c < nCands; ++c) {
+      const mixfixOp* op = &table->ops[cands[c]];
+      if (next != EEXPR_NO_SYMBOL && k < op->nParts && op->parts[k] == next) {
+        cands[nKept++] = cands[c];
+      }
+    }
+    if (nKept != 0) {
+      st->candidates.len = candBase + nKept;
+      st->pos += 1;
+      k += 1;
+      continue;
+    }
+    for (size_t c = 0; c < nCands; ++c) {
+      if (table->ops[cands[c]].nParts == k) { matched = cands[c]; break; }
+    }
+    if (matched == EEXPR_MIXFIX_NONE) {
+      fail(st, EEXPR_MIXFIX_ERR_EXPECTED_LITERAL, cands[0]);
+      break;
+    }
+  }
+  st->candidates.len = candBase;
+  if (st->failed) {
+    st->operands.len = argBase;
+    return NULL;
+  }
+  eexpr* self = popList(st, EEXPR_MIXFIX, st->operands.len - argBase);
+  self->as.mixfix.op = matched;
+  self->loc.start = startByte;
+  return self;
+}
+
+// Gather operands up to the next literal that is not a prefix or closed operator.
+// Returns `NULL` if there were no operands at all, which is only an error if `.failed` is set.
+static
+eexpr* parseApplication(rewriter* st) {
+  size_t base = st->operands.len;
+  while (st->pos < st->nItems) {
+    uint32_t lit = st->lits[st->pos];
+    if (lit == EEXPR_NO_SYMBOL) {
+      dynarr_push_eexpr_p(&st->operands, &st->items[st->pos]);
+      st->pos += 1;
+      continue;
+    }
+    if (st->stopAt[lit] != 0) { break; }
+    // a literal that could go either way is infix if there is something to its left
+    if (isInfixKey(st, lit) && st->operands.len != base) { break; }
+    if (!isPrefixKey(st, lit)) { break; }
+    eexpr* x = parseOp(st, lit, NULL);
+    if (x == NULL) {
+      st->operands.len = base;
+      return NULL;
+    }
+    dynarr_push_eexpr_p(&st->operands, &x);
+  }
+  size_t n = st->operands.len - base;
+  if (n == 0) { return NULL; }
+  if (n == 1) { return *dynarr_pop_eexpr_p(&st->operands); }
+  return popList(st, EEXPR_SPACE, n);
+}
+
+// Parse an application, then any infix and postfix operators at or above `minLevel`.
+static
+eexpr* parseExpr(rewriter* st, uint32_t minLevel) {
+  eexpr* left = parseApplication(st);
+  if (left == NULL) { return NULL; }
+  const mixfixOp* prev = NULL;
+  while (st->pos < st->nItems) {
+    uint32_t lit = st->lits[st->pos];
+    if (lit == EEXPR_NO_SYMBOL || st->stopAt[lit] != 0 || !isInfixKey(st, lit)) { break; }
+    uint32_t opIx = st->table->byKey[st->table->infixStart[lit]];
+    const mixfixOp* op = &st->table->ops[opIx];
+    if (op->level < minLevel) { break; }
+    // right-associative operators have already taken everything at their level, so only left and non-associative ones get here
+    if (prev != NULL && prev->level == op->level && (op->assoc == EEXPR_ASSOC_NONE || op->assoc != prev->assoc)) {
+      return fail(st, EEXPR_MIXFIX_ERR_NON_ASSOCIATIVE, opIx);
+    }
+    left = parseOp(st, lit, left);
+    if (left == NULL) { return NULL; }
+    prev = op;
+  }
+  return left;
+}
+
+static
+void rewriteSpace(rewriter* st, eexpr** slot) {
+  eexpr* space = *slot;
+  size_t n = space->as.list.len;
+  st->lits_store.len = 0;
+  bool anyLits = false;
+  for (size_t i = 0; i < n; ++i) {
+    const eexpr* item = space->as.list.data[i];
+    uint32_t lit = item->type == EEXPR_SYMBOL ? symtab_find(st->table->literals, item->as.symbol.text) : EEXPR_NO_SYMBOL;
+    anyLits |= lit != EEXPR_NO_SYMBOL;
+    dynarr_push_uint32_t(&st->lits_store, &lit);
+  }
+  if (!anyLits) { return; }
+  st->space = space;
+  st->nItems = n;
+  st->items = space->as.list.data;
+  st->lits = st->lits_store.data;
+  st->pos = 0;
+  st->failed = false;
+  eexpr* out = parseExpr(st, 0);
+  if (!st->failed && out == NULL) {
+    // nothing to the left of an infix or postfix operator
+    uint32_t lit = st->lits[0];
+    uint32_t op = isInfixKey(st, lit) ? st->table->byKey[st->table->infixStart[lit]] : EEXPR_MIXFIX_NONE;
+    fail(st, op == EEXPR_MIXFIX_NONE ? EEXPR_MIXFIX_ERR_UNEXPECTED_LITERAL : EEXPR_MIXFIX_ERR_EXPECTED_OPERAND, op);
+  }
+  else if (!st->failed && st->pos != n) {
+    fail(st, EEXPR_MIXFIX_ERR_UNEXPECTED_LITERAL, EEXPR_MIXFIX_NONE);
+  }
+  if (st->failed) {
+    // the original eexpr still owns all its items, so only the new eexprs themselves go
+    for (size_t i = 0; i < st->created.len; ++i) { free(st->created.data[i]); }
+  }
+  else {
+    // the new eexprs have taken over the operands, so the literals and the old eexpr itself go
+    // (on success, every item that names a literal was matched as part of some operator)
+    for (size_t i = 0; i < n; ++i) {
+      if (st->lits[i] != EEXPR_NO_SYMBOL) { eexpr_deinit(space->as.list.data[i]); free(space->as.list.data[i]); }
+    }
+    *slot = out;
+    free(space);
+  }
+  st->created.len = 0;
+  st->operands.len = 0;
+}
+
+// Rewrite the subexprs of an eexpr (innermost first), and then the eexpr itself.
+static
+void rewriteIn(rewriter* st, eexpr** slot) {
+  eexpr* self = *slot;
+  // shared eexprs may occur in other places, which must not change along with this one, and arena eexprs cannot be freed when replaced
+  assert(!(self->flags & (FLAG_SHARED | FLAG_ARENA)));
+  switch (self->type) {
+    case EEXPR_SYMBOL: case EEXPR_NUMBER: break;
+    case EEXPR_STRING: {
+      for (size_t i = 0; i < self->as.string.parts.len; ++i) {
+        if (self->as.string.parts.data[i].subexpr != NULL) { rewriteIn(st, &self->as.string.parts.data[i].subexpr); }
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      if (self->as.wrap != NULL) { rewriteIn(st, &self->as.wrap); }
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: case EEXPR_MIXFIX: {
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        rewriteIn(st, &self->as.list.data[i]);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      if (self->as.ellipsis[0] != NULL) { rewriteIn(st, &self->as.ellipsis[0]); }
+      if (self->as.ellipsis[1] != NULL) { rewriteIn(st, &self->as.ellipsis[1]); }
+    }; break;
+    case EEXPR_COLON: {
+      rewriteIn(st, &self->as.pair[0]);
+      rewriteIn(st, &self->as.pair[1]);
+    }; break;
+  }
+  if (self->type == EEXPR_SPACE) { rewriteSpace(st, slot); }
+}
+
+bool mixfixRewrite(const eexpr_mixfixTable* table, size_t n, eexpr** eexprs, size_t* nErrors, eexpr_mixfixError** errors) {
+  rewriter st;
+  st.table = table;
+  dynarr_init_uint32_t(&st.lits_store, 16);
+  size_t nLits = table->literals->symbols.len;
+  st.stopAt = calloc(nLits == 0 ? 1 : nLits, sizeof(uint32_t));
+  checkOom(st.stopAt);
+  dynarr_init_eexpr_p(&st.operands, 16);
+  dynarr_init_uint32_t(&st.candidates, 16);
+  dynarr_init_eexpr_p(&st.created, 16);
+  dynarr_init_mixfixError(&st.errors, 4);
+  for (size_t i = 0; i < n; ++i) {
+    rewriteIn(&st, &eexprs[i]);
+  }
+  dynarr_deinit_uint32_t(&st.lits_store);
+  free(st.stopAt);
+  dynarr_deinit_eexpr_p(&st.operands);
+  dynarr_deinit_uint32_t(&st.candidates);
+  dynarr_deinit_eexpr_p(&st.created);
+  *nErrors = st.errors.len;
+  if (st.errors.len == 0) {
+    dynarr_deinit_mixfixError(&st.errors);
+    *errors = NULL;
+  }
+  else {
+    *errors = st.errors.data;
+  }
+  return *nErrors == 0;
+}
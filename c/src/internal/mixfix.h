@@ -0,0 +1,41 @@
+#ifndef INTERNAL_MIXFIX_H
+#define INTERNAL_MIXFIX_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// Marks a hole in `mixfixOp.parts`; any other part is a literal id.
+#define MIXFIX_HOLE UINT32_MAX
+
+typedef struct mixfixOp {
+  str name; // owned
+  uint32_t level; // operators with higher levels bind tighter
+  eexpr_mixfixAssoc assoc;
+  uint32_t nParts;
+  uint32_t* parts; // points into `eexpr_mixfixTable.parts`
+} mixfixOp;
+
+struct eexpr_mixfixTable {
+  eexpr_symtab* literals; // owned, gives every literal of every template an id
+  size_t nOps;
+  mixfixOp* ops; // owned, indexed the same as the definitions
+  uint32_t* parts; // owned, the parts of all templates back-to-back
+  // Operators keyed by literal id, as ranges into `.byKey`:
+  //   `.prefixStart[lit]` up to `.prefixStart[lit+1]` are the operators that start with `lit`,
+  //   and likewise `.infixStart` for the operators that start with a hole followed by `lit`.
+  // Operators sharing a key are kept in definition order.
+  uint32_t* prefixStart; // owned, one more than the number of literals
+  uint32_t* infixStart; // owned, ditto
+  uint32_t* byKey; // owned
+};
+
+eexpr_mixfixTable* mixfixTable_new(size_t nDefs, const eexpr_mixfixDef* defs, size_t* nErrors, eexpr_mixfixDefError** errors);
+
+void mixfixTable_del(eexpr_mixfixTable* self);
+
+bool mixfixRewrite(const eexpr_mixfixTable* table, size_t n, eexpr** eexprs, size_t* nErrors, eexpr_mixfixError** errors);
+
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "engine.h"
+#include "share.h"
 
 
 //////////////////////////////////// Helper Procedures ////////////////////////////////////
@@ -23,6 +24,27 @@ void mkUnbalanceError(engine* st) {
   }
 }
 
+// Refuse to open another wrapper (and so recurse further) when that would go over the depth limit.
+static
+bool overDepthLimit(engine* st, const eexpr_token* open) {
+  if (st->limits.depth == 0 || st->wrapStack.len < st->limits.depth) { return false; }
+  engine_limitExceeded(st, EEXPR_LIMIT_DEPTH, open->loc);
+  return true;
+}
+
+// Build a list-shaped eexpr out of the children pushed to `st->listScratch` since it had length `base`, and pop them off again.
+// Collecting children on the shared scratch stack means each list gets allocated just once, at its exact size.
+static
+eexpr* mkList(engine* st, eexpr_type type, eexpr_span loc, size_t base) {
+  size_t n = st->listScratch.len - base;
+  eexpr* out = eexprList_new(type, n, st->listScratch.data + base);
+  engine_charge(st, sizeof(eexpr) + (n <= LIST_SMALL ? 0 : n * sizeof(eexpr*)));
+  out->flags = 0;
+  out->loc = loc;
+  st->listScratch.len = base;
+  return out;
+}
+
 
 //////////////////////////////////// Individual Expression Parsers ////////////////////////////////////
 
@@ -44,35 +66,40 @@ eexpr* parseWrap(engine* st) {
   if ( open->type != EEXPR_TOK_WRAP
     || !open->as.wrap.isOpen
      ) { return NULL; }
-  eexpr* out = malloc(sizeof(eexpr));
-  checkOom(out);
+  if (overDepthLimit(st, open)) { return NULL; }
+  eexpr_type type;
   {
     openWrap openInfo = {.loc = open->loc, .type = open->as.wrap.type};
     switch (open->as.wrap.type) {
       case EEXPR_WRAP_NULL: assert(false);
       case EEXPR_WRAP_PAREN: {
         dynarr_push_openWrap(&st->wrapStack, &openInfo);
-        out->type = EEXPR_PAREN;
+        type = EEXPR_PAREN;
         goto nonIndent;
       }; break;
       case EEXPR_WRAP_BRACK: {
         dynarr_push_openWrap(&st->wrapStack, &openInfo);
-        out->type = EEXPR_BRACK;
+        type = EEXPR_BRACK;
         goto nonIndent;
       }; break;
       case EEXPR_WRAP_BRACE: {
         dynarr_push_openWrap(&st->wrapStack, &openInfo);
-        out->type = EEXPR_BRACE;
+        type = EEXPR_BRACE;
         goto nonIndent;
       }; break;
       case EEXPR_WRAP_BLOCK: {
         dynarr_push_openWrap(&st->wrapStack, &openInfo);
-        out->type = EEXPR_BLOCK;
+        type = EEXPR_BLOCK;
         goto indent;
       }; break;
     }
   } assert(false);
   nonIndent: {
+    eexpr* out = malloc(sizeof(eexpr));
+    checkOom(out);
+    engine_charge(st, sizeof(eexpr));
+    out->flags = 0;
+    out->type = type;
     out->loc.start = open->loc.start;
     parser_pop(st);
     out->as.wrap = parseSemicolon(st);
@@ -93,13 +120,13 @@ eexpr* parseWrap(engine* st) {
     return out;
   } assert(false);
   indent: {
-    out->loc.start = open->loc.start;
+    size_t base = st->listScratch.len;
+    eexpr_span loc = {.start = open->loc.start};
     parser_pop(st);
-    dynarr_init_eexpr_p(&out->as.list, 4);
     while (true) {
       eexpr* subexpr = parseSemicolon(st);
       if (subexpr != NULL) {
-        dynarr_push_eexpr_p(&out->as.list, &subexpr);
+        dynarr_push_eexpr_p(&st->listScratch, &subexpr);
       }
       eexpr_token* lookahead = parser_peek(st);
       if (lookahead->type == EEXPR_TOK_WRAP) {
@@ -108,22 +135,23 @@ eexpr* parseWrap(engine* st) {
           && lookahead->as.wrap.type == dynarr_peek_openWrap(&st->wrapStack)->type
            ) {
           dynarr_pop_openWrap(&st->wrapStack);
-          out->loc.end = lookahead->loc.end;
+          loc.end = lookahead->loc.end;
           parser_pop(st);
         }
         else {
-          out->loc.end = lookahead->loc.start;
+          loc.end = lookahead->loc.start;
           mkUnbalanceError(st);
         }
-        return out;
+        return mkList(st, type, loc, base);
       }
       else if (lookahead->type == EEXPR_TOK_NEWLINE) {
         parser_pop(st);
       }
       else {
         eexpr_error err = {.loc = lookahead->loc, .type = EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT};
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
-        return out;
+        engine_addError(st, &err);
+        loc.end = lookahead->loc.start;
+        return mkList(st, type, loc, base);
       }
     }
   }; assert(false);
@@ -144,8 +172,10 @@ eexpr* parseTemplate(engine* st) {
     case EEXPR_STRPLAIN: {
       eexpr* out = malloc(sizeof(eexpr));
       checkOom(out);
+      engine_charge(st, sizeof(eexpr));
       out->loc = tok->loc;
       out->type = EEXPR_STRING;
+      out->flags = tok->flags;
       out->as.string.text1 = tok->as.string.text;
       out->as.string.parts.cap = 0;
       out->as.string.parts.len = 0;
@@ -154,11 +184,14 @@ eexpr* parseTemplate(engine* st) {
       return out;
     }; break;
     case EEXPR_STROPEN: {
+      if (overDepthLimit(st, tok)) { return NULL; }
       eexpr* out = malloc(sizeof(eexpr));
       checkOom(out);
+      engine_charge(st, sizeof(eexpr));
       { // initialize output buffer
         out->loc = tok->loc;
         out->type = EEXPR_STRING;
+        out->flags = tok->flags;
         out->as.string.text1 = tok->as.string.text;
         dynarr_init_strTemplPart(&out->as.string.parts, 2);
       }
@@ -194,15 +227,20 @@ eexpr* parseTemplate(engine* st) {
           if ( lookahead->type == EEXPR_TOK_STRING
             && (lookahead->as.string.splice == EEXPR_STRMIDDLE || lookahead->as.string.splice == EEXPR_STRCLOSE)
              ) {
-            dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+            engine_addError(st, &err);
           }
           else {
-            st->fatal = err;
+            if (st->fatal.type != EEXPR_ERR_LIMIT_EXCEEDED) { st->fatal = err; }
             return out;
           }
         }
         if (lookahead->type == EEXPR_TOK_STRING) {
           { // append last template part
+            // parts can only be mixed eager/lazy if a token was inspected before parsing
+            if ((out->flags ^ lookahead->flags) & FLAG_LAZY) {
+              lexer_forceEexpr(out);
+              lexer_forceToken(lookahead);
+            }
             part.nBytes = lookahead->as.string.text.len;
             part.utf8str = lookahead->as.string.text.bytes;
             dynarr_push_strTemplPart(&out->as.string.parts, &part);
@@ -235,7 +273,7 @@ eexpr* parseTemplate(engine* st) {
             { .loc = {.start = out->loc.end, .end = lookahead->loc.start}
             , .type = EEXPR_ERR_MISSING_CLOSE_TEMPLATE
             };
-          dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+          engine_addError(st, &err);
           return out;
         }
       }
@@ -265,6 +303,8 @@ eexpr* parseAtomic(engine* st) {
     case EEXPR_TOK_SYMBOL: {
       eexpr* out = malloc(sizeof(eexpr));
       checkOom(out);
+      engine_charge(st, sizeof(eexpr));
+      out->flags = 0;
       out->loc = tok->loc;
       out->type = EEXPR_SYMBOL;
       out->as.symbol = tok->as.symbol;
@@ -274,8 +314,10 @@ eexpr* parseAtomic(engine* st) {
     case EEXPR_TOK_NUMBER: {
       eexpr* out = malloc(sizeof(eexpr));
       checkOom(out);
+      engine_charge(st, sizeof(eexpr));
       out->loc = tok->loc;
       out->type = EEXPR_NUMBER;
+      out->flags = tok->flags;
       out->as.number = tok->as.number;
       parser_pop(st);
       return out;
@@ -310,12 +352,16 @@ eexpr* parseChain(engine* st) {
     if (lookahead->type == EEXPR_TOK_PREDOT) {
       predot = malloc(sizeof(eexpr));
       checkOom(predot);
+      engine_charge(st, sizeof(eexpr));
+      predot->flags = 0;
       predot->type = EEXPR_PREDOT;
       predot->loc.start = lookahead->loc.start;
       parser_pop(st);
     }
   }
   eexpr* chain = NULL;
+  size_t base = st->listScratch.len;
+  eexpr_span loc = {.start = 0, .end = 0};
   {
     { // get the first expression and look for a following dot
       eexpr* expr1 = parseAtomic(st);
@@ -329,16 +375,12 @@ eexpr* parseChain(engine* st) {
           && (lookahead->as.string.splice == EEXPR_STRPLAIN || lookahead->as.string.splice == EEXPR_STROPEN)
            )
          ) {
-        chain = malloc(sizeof(eexpr));
-        checkOom(chain);
-        chain->type = EEXPR_CHAIN;
-        chain->loc = expr1->loc;
+        loc = expr1->loc;
         if (lookahead->type == EEXPR_TOK_CHAIN) {
-          chain->loc.end = lookahead->loc.end;
+          loc.end = lookahead->loc.end;
           parser_pop(st);
         }
-        dynarr_init_eexpr_p(&chain->as.list, 4);
-        dynarr_push_eexpr_p(&chain->as.list, &expr1);
+        dynarr_push_eexpr_p(&st->listScratch, &expr1);
       }
       else {
         chain = expr1;
@@ -347,30 +389,33 @@ eexpr* parseChain(engine* st) {
     }
     while (true) { // get further chained expressions
       eexpr* next = parseAtomic(st);
-      if (next == NULL) { goto finish; }
-      dynarr_push_eexpr_p(&chain->as.list, &next);
+      if (next == NULL) { goto mkChain; }
+      dynarr_push_eexpr_p(&st->listScratch, &next);
       eexpr_token* lookahead = parser_peek(st);
       if (lookahead->type == EEXPR_TOK_CHAIN) {
         // continue the chain when there's another chain dot
-        chain->loc.end = lookahead->loc.end;
+        loc.end = lookahead->loc.end;
         parser_pop(st);
       }
       else if (lookahead->type == EEXPR_TOK_WRAP && lookahead->as.wrap.isOpen) {
         // continue the chain when there's an open paren/brace/brack/indent
-        chain->loc.end = next->loc.end;
+        loc.end = next->loc.end;
       }
       else if ( lookahead->type == EEXPR_TOK_STRING
              && (lookahead->as.string.splice == EEXPR_STRPLAIN || lookahead->as.string.splice == EEXPR_STROPEN)
               ) {
         // continue the chain when there's the start of a string
-        chain->loc.end = next->loc.end;
+        loc.end = next->loc.end;
       }
       else {
-        chain->loc.end = next->loc.end;
-        goto finish;
+        loc.end = next->loc.end;
+        goto mkChain;
       }
     }
   } assert(false);
+  mkChain: {
+    chain = mkList(st, EEXPR_CHAIN, loc, base);
+  }
   finish: {
     if (predot == NULL && chain == NULL) {
       return NULL;
@@ -396,23 +441,17 @@ eexpr* parseSpace(engine* st) {
   }
   eexpr* expr1 = parseChain(st);
   if (expr1 == NULL) { return NULL; }
-  eexpr* out = malloc(sizeof(eexpr));
-  { // prepare the output
-    checkOom(out);
-    out->loc.start = expr1->loc.start;
-    out->loc.end = expr1->loc.end;
-    out->type = EEXPR_SPACE;
-    dynarr_init_eexpr_p(&out->as.list, 4);
-    dynarr_push_eexpr_p(&out->as.list, &expr1);
-  }
+  size_t base = st->listScratch.len;
+  eexpr_span loc = expr1->loc;
+  dynarr_push_eexpr_p(&st->listScratch, &expr1);
   while (true) {
     eexpr_token* lookahead = parser_peek(st);
     if (lookahead->type == EEXPR_TOK_SPACE) {
       parser_pop(st);
       eexpr* next = parseChain(st);
       if (next != NULL) {
-        dynarr_push_eexpr_p(&out->as.list, &next);
-        out->loc.end = next->loc.end;
+        dynarr_push_eexpr_p(&st->listScratch, &next);
+        loc.end = next->loc.end;
       }
       else {
         goto output;
@@ -423,14 +462,12 @@ eexpr* parseSpace(engine* st) {
     }
   } assert(false);
   output: {
-    if (out->as.list.len == 1) {
-      dynarr_deinit_eexpr_p(&out->as.list);
-      free(out);
+    if (st->listScratch.len - base == 1) {
+      st->listScratch.len = base;
       return expr1;
     }
     else {
-      // TODO shrink the list? and all other lists generated by the parser?
-      return out;
+      return mkList(st, EEXPR_SPACE, loc, base);
     }
   } assert(false);
 }
@@ -440,11 +477,13 @@ eexpr* parseEllipsis(engine* st) {
   eexpr* expr1 = parseSpace(st);
   eexpr_token* lookahead = parser_peek(st);
   if (lookahead->type == EEXPR_TOK_ELLIPSIS) {
-    eexpr_loc dotsLoc = lookahead->loc;
+    eexpr_span dotsLoc = lookahead->loc;
     parser_pop(st);
     eexpr* expr2 = parseSpace(st);
     eexpr* out = malloc(sizeof(eexpr));
     checkOom(out);
+    engine_charge(st, sizeof(eexpr));
+    out->flags = 0;
     out->type = EEXPR_ELLIPSIS;
     out->loc.start = (expr1 == NULL ? dotsLoc : expr1->loc).start;
     out->loc.end = (expr2 == NULL ? dotsLoc : expr2->loc).end;
@@ -465,7 +504,7 @@ eexpr* parseColon(engine* st) {
     return expr1;
   }
   else {
-    eexpr_loc colonLoc = colon->loc;
+    eexpr_span colonLoc = colon->loc;
     parser_pop(st);
     eexpr* expr2 = parseEllipsis(st);
     if (expr2 == NULL) {
@@ -474,6 +513,8 @@ eexpr* parseColon(engine* st) {
     }
     eexpr* out = malloc(sizeof(eexpr));
     checkOom(out);
+    engine_charge(st, sizeof(eexpr));
+    out->flags = 0;
     out->type = EEXPR_COLON;
     out->loc.start = expr1->loc.start;
     out->loc.end = expr2->loc.end;
@@ -485,14 +526,14 @@ eexpr* parseColon(engine* st) {
 
 static
 eexpr* parseComma(engine* st) {
-  eexpr* out = NULL;
+  bool isList = false;
+  size_t base = st->listScratch.len;
+  eexpr_span loc = {.start = 0, .end = 0};
   { // optional initial comma
     eexpr_token* maybeComma = parser_peek(st);
     if (maybeComma->type == EEXPR_TOK_COMMA) {
-      out = malloc(sizeof(eexpr));
-      checkOom(out);
-      dynarr_init_eexpr_p(&out->as.list, 4);
-      out->loc = maybeComma->loc;
+      isList = true;
+      loc = maybeComma->loc;
       parser_pop(st);
     }
   }
@@ -500,31 +541,28 @@ eexpr* parseComma(engine* st) {
     eexpr* tmp = parseColon(st);
     eexpr_token* lookahead = parser_peek(st);
     if (tmp == NULL) { // no further sub-expressions
-      if (out != NULL) {
-        out->type = EEXPR_COMMA;
-        return out;
+      if (isList) {
+        return mkList(st, EEXPR_COMMA, loc, base);
       }
       else {
         return NULL;
       }
     }
-    else if (out != NULL) { // found a sub-expression, and we already have evidence of a comma
-      dynarr_push_eexpr_p(&out->as.list, &tmp);
+    else if (isList) { // found a sub-expression, and we already have evidence of a comma
+      dynarr_push_eexpr_p(&st->listScratch, &tmp);
       if (lookahead->type == EEXPR_TOK_COMMA) { // there's also comma afterwards to be consumed
-        out->loc.end = lookahead->loc.end;
+        loc.end = lookahead->loc.end;
         parser_pop(st);
       }
       else {
-        out->loc.end = tmp->loc.end;
+        loc.end = tmp->loc.end;
       }
     }
     else if (lookahead->type == EEXPR_TOK_COMMA) { // found a sub-expression, and the first evidence of a comma
-      out = malloc(sizeof(eexpr));
-      checkOom(out);
-      dynarr_init_eexpr_p(&out->as.list, 4);
-      dynarr_push_eexpr_p(&out->as.list, &tmp);
-      out->loc.start = tmp->loc.start;
-      out->loc.end = lookahead->loc.end;
+      isList = true;
+      dynarr_push_eexpr_p(&st->listScratch, &tmp);
+      loc.start = tmp->loc.start;
+      loc.end = lookahead->loc.end;
       parser_pop(st);
     }
     else { // found a sub-expression, with no evidence of a comma before, and no evidence of a comma after
@@ -535,14 +573,14 @@ eexpr* parseComma(engine* st) {
 
 static
 eexpr* parseSemicolon(engine* st) {
-  eexpr* out = NULL;
+  bool isList = false;
+  size_t base = st->listScratch.len;
+  eexpr_span loc = {.start = 0, .end = 0};
   { // optional initial semicolon
     eexpr_token* maybeSemi = parser_peek(st);
     if (maybeSemi->type == EEXPR_TOK_SEMICOLON) {
-      out = malloc(sizeof(eexpr));
-      checkOom(out);
-      dynarr_init_eexpr_p(&out->as.list, 4);
-      out->loc = maybeSemi->loc;
+      isList = true;
+      loc = maybeSemi->loc;
       parser_pop(st);
     }
   }
@@ -550,31 +588,28 @@ eexpr* parseSemicolon(engine* st) {
     eexpr* tmp = parseComma(st);
     eexpr_token* lookahead = parser_peek(st);
     if (tmp == NULL) { // no further sub-expressions
-      if (out != NULL) {
-        out->type = EEXPR_SEMICOLON;
-        return out;
+      if (isList) {
+        return mkList(st, EEXPR_SEMICOLON, loc, base);
       }
       else {
         return NULL;
       }
     }
-    else if (out != NULL) { // found a sub-expression, and we already have evidence of a semicolon
-      dynarr_push_eexpr_p(&out->as.list, &tmp);
+    else if (isList) { // found a sub-expression, and we already have evidence of a semicolon
+      dynarr_push_eexpr_p(&st->listScratch, &tmp);
       if (lookahead->type == EEXPR_TOK_SEMICOLON) { // there's also semicolon afterwards to be consumed
-        out->loc.end = lookahead->loc.end;
+        loc.end = lookahead->loc.end;
         parser_pop(st);
       }
       else {
-        out->loc.end = tmp->loc.end;
+        loc.end = tmp->loc.end;
       }
     }
     else if (lookahead->type == EEXPR_TOK_SEMICOLON) { // found a sub-expression, and the first evidence of a semicolon
-      out = malloc(sizeof(eexpr));
-      checkOom(out);
-      dynarr_init_eexpr_p(&out->as.list, 4);
-      dynarr_push_eexpr_p(&out->as.list, &tmp);
-      out->loc.start = tmp->loc.start;
-      out->loc.end = lookahead->loc.end;
+      isList = true;
+      dynarr_push_eexpr_p(&st->listScratch, &tmp);
+      loc.start = tmp->loc.start;
+      loc.end = lookahead->loc.end;
       parser_pop(st);
     }
     else { // found a sub-expression, with no evidence of a semicolon before, and no evidence of a semicolon after
@@ -589,6 +624,7 @@ static
 void parseLine(engine* st) {
   eexpr* line = parseSemicolon(st);
   if (line != NULL) {
+      if (st->shared != NULL) { line = share_eexpr(st, line); }
       dynarr_push_eexpr_p(&st->eexprStream, &line);
   }
   else {
@@ -641,6 +677,7 @@ void parseLine(engine* st) {
 }
 
 void engine_parse(engine* st) {
+  parser_compact(st);
   bool atStart = true;
   while (st->fatal.type == EEXPR_ERR_NOERROR) {
     eexpr_token* lookahead = parser_peek(st);
@@ -663,7 +700,7 @@ void engine_parse(engine* st) {
         }
         else {
           // eexpr_token* tok = parser_peek(st);
-          // fprintf(stderr, "%zu:%zu--%zu:%zu\n", tok->loc.start.line+1, tok->loc.start.col+1, tok->loc.end.line+1, tok->loc.end.col+1);
+          // fprintf(stderr, "%zu--%zu\n", tok->loc.start, tok->loc.end);
           assert(atStart);
         }
       } break;
@@ -0,0 +1,186 @@
+#include "payload.h"
+
+#include <string.h>
+
+#include "engine.h"
+
+#define NONE SIZE_MAX
+
+
+//////////////////////////////////// Strings and Numbers ////////////////////////////////////
+
+const str* payload_plainString(const eexpr* e) {
+  if (e->type != EEXPR_STRING) { return NULL; }
+  lexer_forceEexpr((eexpr*)e);
+  return e->as.string.parts.len == 0 ? &e->as.string.text1 : NULL;
+}
+
+// The exponent of a number, less its fractional digits, saturated well outside the range of any `double`.
+static
+int64_t scaleOf(const eexprNumber* num) {
+  const bigint* exp = &num->exponent;
+  int64_t out = 0;
+  if (exp->len > 1) { out = INT32_MAX; }
+  else if (exp->len == 1) { out = exp->buf[0]; }
+  if (!exp->pos) { out = -out; }
+  return out - (int64_t)num->fractionalDigits;
+}
+
+bool payload_asInt(const eexprNumber* num, bool* integral, int64_t* out) {
+  int64_t scale = scaleOf(num);
+  *integral = scale >= 0;
+  if (scale < 0) { return false; }
+  const bigint* m = &num->mantissa;
+  if (m->len == 0) {
+    *out = 0;
+    return true;
+  }
+  if (m->len > 2) { return false; }
+  uint64_t mag = m->buf[0] | (m->len == 2 ? (uint64_t)m->buf[1] << 32 : 0);
+  // overflows within 64 steps, since the mantissa is not zero
+  for (int64_t i = 0; i < scale; ++i) {
+    if (mag > UINT64_MAX / num->radix) { return false; }
+    mag *= num->radix;
+  }
+  if (m->pos) {
+    if (mag > INT64_MAX) { return false; }
+    *out = (int64_t)mag;
+  }
+  else {
+    if (mag - 1 > INT64_MAX) { return false; }
+    *out = -(int64_t)(mag - 1) - 1;
+  }
+  return true;
+}
+
+double payload_asDouble(const eexprNumber* num) {
+  const bigint* m = &num->mantissa;
+  double out = 0;
+  for (size_t i = m->len; i-- > 0; ) {
+    out = out * 4294967296.0 + m->buf[i];
+  }
+  // a few thousand steps take any non-zero double to infinity or zero, so that is as far as scaling needs to go
+  int64_t scale = scaleOf(num);
+  for (int64_t i = 0; i < scale && i < 2200; ++i) { out *= num->radix; }
+  for (int64_t i = 0; i > scale && i > -2200; --i) { out /= num->radix; }
+  return m->pos ? out : -out;
+}
+
+
+//////////////////////////////////// Glob Patterns ////////////////////////////////////
+
+static
+size_t peekAt(char32_t* c, size_t n, const uint8_t* bytes, size_t i) {
+  str rest = {.len = n - i, .bytes = (uint8_t*)bytes + i};
+  return peekUchar(c, rest);
+}
+
+// Match one character against the set starting at `pat[*i]` (just past the `[`), leaving `*i` just past the closing `]`.
+// The pattern has already been checked by `payload_checkGlob`.
+static
+bool matchSet(size_t nPat, const uint8_t* pat, size_t* i, char32_t c) {
+  char32_t pc;
+  size_t p = *i;
+  bool negate = false;
+  if (p < nPat && pat[p] == '!') {
+    negate = true;
+    p += 1;
+  }
+  bool found = false;
+  bool first = true; // a `]` straight after the `[` (or `[!`) is taken literally
+  while (true) {
+    p += peekAt(&pc, nPat, pat, p);
+    if (pc == ']' && !first) { break; }
+    first = false;
+    if (pc == '\\') { p += peekAt(&pc, nPat, pat, p); }
+    char32_t lo = pc;
+    char32_t hi = pc;
+    if (p + 1 < nPat && pat[p] == '-' && pat[p+1] != ']') {
+      p += 1;
+      p += peekAt(&hi, nPat, pat, p);
+      if (hi == '\\') { p += peekAt(&hi, nPat, pat, p); }
+    }
+    if (lo <= c && c <= hi) { found = true; }
+  }
+  *i = p;
+  return found != negate;
+}
+
+// Glob matching only ever has to go back to the most recent `*`, so it needs nothing more than a few cursors.
+bool payload_glob(size_t nPat, const uint8_t* pat, size_t nText, const uint8_t* text) {
+  size_t p = 0, t = 0;
+  size_t starP = NONE, starT = 0;
+  while (t < nText) {
+    if (p < nPat) {
+      char32_t pc, tc;
+      size_t pn = peekAt(&pc, nPat, pat, p);
+      size_t tn = peekAt(&tc, nText, text, t);
+      if (pc == '*') {
+        p += pn;
+        starP = p;
+        starT = t;
+        continue;
+      }
+      if (pc == '?') {
+        p += pn;
+        t += tn;
+        continue;
+      }
+      if (pc == '[') {
+        size_t q = p + pn;
+        if (matchSet(nPat, pat, &q, tc)) {
+          p = q;
+          t += tn;
+          continue;
+        }
+      }
+      else {
+        size_t q = p;
+        if (pc == '\\') {
+          q += pn;
+          pn = peekAt(&pc, nPat, pat, q);
+        }
+        if (pc == tc) {
+          p = q + pn;
+          t += tn;
+          continue;
+        }
+      }
+    }
+    if (starP == NONE) { return false; }
+    // let the last `*` swallow one more character, and try again from there
+    char32_t skipped;
+    starT += peekAt(&skipped, nText, text, starT);
+    p = starP;
+    t = starT;
+  }
+  while (p < nPat && pat[p] == '*') { p += 1; }
+  return p == nPat;
+}
+
+bool payload_checkGlob(size_t nPat, const uint8_t* pat) {
+  size_t p = 0;
+  while (p < nPat) {
+    char32_t pc;
+    p += peekAt(&pc, nPat, pat, p);
+    if (pc == '\\') {
+      if (p == nPat) { return false; }
+      p += peekAt(&pc, nPat, pat, p);
+    }
+    else if (pc == '[') {
+      if (p < nPat && pat[p] == '!') { p += 1; }
+      bool first = true;
+      while (true) {
+        if (p == nPat) { return false; }
+        p += peekAt(&pc, nPat, pat, p);
+        if (pc == ']' && !first) { break; }
+        first = false;
+        if (pc == '\\') {
+          if (p == nPat) { return false; }
+          p += peekAt(&pc, nPat, pat, p);
+        }
+      }
+    }
+  }
+  return true;
+}
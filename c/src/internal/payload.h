@@ -0,0 +1,30 @@
+#ifndef INTERNAL_PAYLOAD_H
+#define INTERNAL_PAYLOAD_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// Checks on the payloads of symbols, numbers and strings, shared by `schema.*` and `query.*`.
+// Lazy payloads are decoded as needed (see `lexer_forceEexpr`).
+
+// The text of a string without splices, or `NULL` for any other eexpr.
+const str* payload_plainString(const eexpr* e);
+
+// The value of a number, if it is an int: it has no fractional digits beyond what its exponent makes up for, and fits in an `int64_t`.
+// Whether or not it does, `*integral` tells if it has a fractional part.
+bool payload_asInt(const eexprNumber* num, bool* integral, int64_t* out);
+
+// The value of a number, to within the precision of a `double`.
+double payload_asDouble(const eexprNumber* num);
+
+// Glob patterns: `*` matches any run of characters, `?` any one character, `[a-z]` (or `[!a-z]`) any one character in (or out of) a set,
+//   and `\` escapes the next character.
+// Patterns are only malformed by an unclosed set or a dangling escape, which `payload_checkGlob` looks for;
+//   `payload_glob` expects a well-formed pattern.
+bool payload_checkGlob(size_t nPat, const uint8_t* pat);
+bool payload_glob(size_t nPat, const uint8_t* pat, size_t nText, const uint8_t* text);
+
+
+#endif
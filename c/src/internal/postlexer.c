@@ -7,6 +7,20 @@
 #define TYPE size_t
 #include "dynarr.h"
 
+// the byte offset of the start of the line containing `byte`
+static
+size_t lineStart(const engine* st, size_t byte) {
+  if (st->lines != NULL) {
+    return st->lines->starts[lineIndex_lineOf(st->lines, byte)];
+  }
+  // without an index, scan back to the end of the previous newline
+  // all newline characters are single bytes (see `decodeNewline`), so there is no need to decode utf8 here
+  if (byte == 0) { return 0; }
+  const uint8_t* input = st->rest.bytes - st->loc;
+  while (byte != 0 && !isNewlineChar(input[byte - 1])) { byte -= 1; }
+  return byte;
+}
+
 static
 dllistNode_eexpr_token* getPrev(dllistNode_eexpr_token* tok) {
   if (tok == NULL) { return NULL; }
@@ -38,7 +52,7 @@ void ensureTrailingNewline(engine* st) {
     && penultimate->here.type != EEXPR_TOK_UNKNOWN_NEWLINE
      ) {
     eexpr_error err = {.loc = ultimate->here.loc, .type = EEXPR_ERR_NO_TRAILING_NEWLINE};
-    dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+    engine_addError(st, &err);
   }
 }
 
@@ -59,7 +73,7 @@ void ignoreTrailingStuff(engine* st) {
          ) {
         strm->here.transparent = true;
         eexpr_error err = {.loc = strm->here.loc, .type = EEXPR_ERR_TRAILING_SPACE};
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
       else if (strm->here.as.unknownSpace.type == EEXPR_WSLINECONTINUE) {
         dllistNode_eexpr_token* prev = getPrev(strm);
@@ -132,7 +146,7 @@ void disambiguateDots(engine* st) {
       }
       else {
         eexpr_error err = {.loc = strm->here.loc, .type = EEXPR_ERR_BAD_DOT};
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
     }
   }
@@ -217,10 +231,7 @@ bool insertDedents(engine* st, dynarr_size_t* depths, dllistNode_eexpr_token* en
     insertPoint = endOfLine;
   }
   else { assert(false); }
-  eexpr_loc loc =
-    { .start = {.line = insertPoint->here.loc.start.line, .col = 0}
-    , .end = insertPoint->here.loc.start
-    };
+  eexpr_span loc = {.start = lineStart(st, insertPoint->here.loc.start), .end = insertPoint->here.loc.start};
   assert(newDepth <= indentState_peek(depths)); // this should have been handled above, before the newline and whitespace was ignored
   while (true) {
     size_t depth = indentState_peek(depths);
@@ -244,7 +255,7 @@ bool insertDedents(engine* st, dynarr_size_t* depths, dllistNode_eexpr_token* en
     }
     else {
       eexpr_error err = {.loc = loc, .type = EEXPR_ERR_OFFSIDES};
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
       return false;
     }
   }
@@ -276,10 +287,7 @@ bool detectIndentation(engine* st) {
     if (strm->here.transparent) { continue; }
     if (strm->here.type == EEXPR_TOK_INDENT) {
       dllistNode_eexpr_token* next = getNext(strm);
-      eexpr_loc loc =
-        { .start = {.line = next->here.loc.start.line, .col = 0}
-        , .end = next->here.loc.start
-        };
+      eexpr_span loc = {.start = lineStart(st, next->here.loc.start), .end = next->here.loc.start};
       size_t depth = strm->here.as.indent.depth;
       size_t depth0 = indentState_peek(&depths);
       if (depth > depth0) {
@@ -291,7 +299,7 @@ bool detectIndentation(engine* st) {
       }
       else {
         eexpr_error err = {.loc = loc, .type = EEXPR_ERR_SHALLOW_INDENT};
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
         success = false;
       }
     }
@@ -387,24 +395,24 @@ void detectCramming(engine* st) {
     dllistNode_eexpr_token* next = getNext(strm);
     eexpr_tokenType nextType = next->here.type;
     bool nextIsDotLike = nextType == EEXPR_TOK_ELLIPSIS || nextType == EEXPR_TOK_CHAIN || nextType == EEXPR_TOK_PREDOT;
-    eexpr_loc loc = {.start = strm->here.loc.start, .end = next->here.loc.end};
+    eexpr_span loc = {.start = strm->here.loc.start, .end = next->here.loc.end};
     eexpr_error err = {.loc = loc, .type = EEXPR_ERR_CRAMMED_TOKENS};
     if (hereIsDotLike && nextIsDotLike) {
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
     else if (hereType == EEXPR_TOK_NUMBER && nextType == EEXPR_TOK_CHAIN) {
-      dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+      engine_addError(st, &err);
     }
     else if (hereType == EEXPR_TOK_SYMBOL || hereType == EEXPR_TOK_NUMBER) {
       if (nextType == EEXPR_TOK_SYMBOL || nextType == EEXPR_TOK_NUMBER) {
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
     }
     else if (hereType == EEXPR_TOK_STRING && nextType == EEXPR_TOK_STRING) {
       bool hereStringClosed = strm->here.as.string.splice == EEXPR_STRPLAIN || strm->here.as.string.splice == EEXPR_STRCLOSE;
       bool nextStringOpen = strm->here.as.string.splice == EEXPR_STRPLAIN || strm->here.as.string.splice == EEXPR_STROPEN;
       if (hereStringClosed && nextStringOpen) {
-        dllist_insertAfter_eexpr_error(&st->errStream, NULL, &err);
+        engine_addError(st, &err);
       }
     }
   }
@@ -0,0 +1,476 @@
+#include "printer.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "engine.h"
+#include "parameters.h"
+
+
+// Writes are staged in `buf`:
+//   without a file, `buf` is the caller's buffer, and `len` keeps counting past `cap` so the full length is known;
+//   with a file, `buf` is flushed to it whenever it fills, and `total` counts what has been flushed.
+typedef struct printer {
+  FILE* fp;
+  uint8_t* buf;
+  size_t cap;
+  size_t len;
+  size_t total;
+  bool failed;
+  // scratch space for converting bignums, kept between numbers so that it is only grown, not reallocated each time
+  uint32_t* words;
+  size_t wordsCap;
+  uint8_t* digits;
+  size_t digitsCap;
+} printer;
+
+
+//////////////////////////////////// Output ////////////////////////////////////
+
+static
+void flush(printer* p) {
+  if (p->len != 0 && fwrite(p->buf, 1, p->len, p->fp) != p->len) {
+    p->failed = true;
+  }
+  p->total += p->len;
+  p->len = 0;
+}
+
+static
+void put(printer* p, size_t n, const uint8_t* bytes) {
+  if (p->fp == NULL) {
+    if (p->len < p->cap) {
+      size_t room = p->cap - p->len;
+      memcpy(&p->buf[p->len], bytes, n < room ? n : room);
+    }
+    p->len += n;
+    return;
+  }
+  while (n != 0) {
+    if (p->len == p->cap) { flush(p); }
+    size_t room = p->cap - p->len;
+    size_t k = n < room ? n : room;
+    memcpy(&p->buf[p->len], bytes, k);
+    p->len += k;
+    bytes += k;
+    n -= k;
+  }
+}
+
+static
+void putByte(printer* p, uint8_t c) {
+  if (p->fp == NULL) {
+    if (p->len < p->cap) { p->buf[p->len] = c; }
+    p->len += 1;
+  }
+  else {
+    if (p->len == p->cap) { flush(p); }
+    p->buf[p->len++] = c;
+  }
+}
+
+static
+void putCStr(printer* p, const char* s) {
+  put(p, strlen(s), (const uint8_t*)s);
+}
+
+static
+void putUchar(printer* p, char32_t c) {
+  utf8Char encoded = encodeUchar(c);
+  put(p, encoded.nbytes, encoded.codeunits);
+}
+
+static
+void newline(printer* p, size_t indent) {
+  static const uint8_t spaces[] = "\n                ";
+  const size_t nSpaces = sizeof(spaces) - 2;
+  putByte(p, '\n');
+  while (indent > nSpaces) {
+    put(p, nSpaces, &spaces[1]);
+    indent -= nSpaces;
+  }
+  put(p, indent, &spaces[1]);
+}
+
+
+//////////////////////////////////// Numbers ////////////////////////////////////
+
+static
+void reserveScratch(printer* p, size_t nWords, size_t nDigits) {
+  if (p->wordsCap < nWords) {
+    p->wordsCap = nWords < 2 * p->wordsCap ? 2 * p->wordsCap : nWords;
+    free(p->words);
+    p->words = malloc(p->wordsCap * sizeof(uint32_t));
+    checkOom(p->words);
+  }
+  if (p->digitsCap < nDigits) {
+    p->digitsCap = nDigits < 2 * p->digitsCap ? 2 * p->digitsCap : nDigits;
+    free(p->digits);
+    p->digits = malloc(p->digitsCap);
+    checkOom(p->digits);
+  }
+}
+
+// Convert a bignum into digits of the given radix, placed least-significant first into `p->digits`.
+// Returns the number of digits, which is zero for zero.
+// Each pass divides by the largest power of the radix that fits in a word, which yields several digits at once.
+static
+size_t toDigits(printer* p, size_t nBigDigits, const uint32_t* bigDigits, uint8_t radix) {
+  if (nBigDigits == 0) { return 0; }
+  reserveScratch(p, nBigDigits, 32 * nBigDigits);
+  memcpy(p->words, bigDigits, nBigDigits * sizeof(uint32_t));
+  uint32_t* words = p->words;
+  uint64_t chunk = radix;
+  size_t perChunk = 1;
+  while (chunk * radix <= UINT32_MAX) {
+    chunk *= radix;
+    perChunk += 1;
+  }
+  size_t len = nBigDigits;
+  size_t nDigits = 0;
+  while (len != 0) {
+    uint64_t rem = 0;
+    for (size_t i = len; i-- != 0; ) {
+      uint64_t cur = rem << 32 | words[i];
+      words[i] = (uint32_t)(cur / chunk);
+      rem = cur % chunk;
+    }
+    while (len != 0 && words[len-1] == 0) { len -= 1; }
+    // the most-significant chunk is not padded out with zeros
+    for (size_t k = 0; k < perChunk && (len != 0 || rem != 0); ++k) {
+      p->digits[nDigits++] = (uint8_t)(rem % radix);
+      rem /= radix;
+    }
+  }
+  return nDigits;
+}
+
+static
+void putDigit(printer* p, uint8_t radix, uint8_t d) {
+  if (radix == 12 && d >= 10) {
+    putUchar(p, d == 10 ? 0x218A/*↊*/ : 0x218B/*↋*/);
+  }
+  else {
+    putByte(p, "0123456789abcdef"[d]);
+  }
+}
+
+/*
+  `-?(0[:radixLetter:])?[:digit:]+(\.[:digit:]+)?(^-?[:decimalDigit:]+)?`
+The significand is written in its original radix, and any fractional digits are padded with leading zeros as needed.
+*/
+static
+void printNumber(printer* p, const eexprNumber* num) {
+  if (!num->mantissa.pos && num->mantissa.len != 0) { putUchar(p, negativeSign); }
+  if (num->radix != defaultRadix->radix) {
+    const radixParams* radix = NULL;
+    for (size_t i = 0; radices[i].radix != 0; ++i) {
+      if (radices[i].radix == num->radix) { radix = &radices[i]; break; }
+    }
+    assert(radix != NULL);
+    putByte(p, '0');
+    putUchar(p, radix->leaderLetters[0]);
+  }
+  size_t nDigits = toDigits(p, num->mantissa.len, num->mantissa.buf, num->radix);
+  size_t width = nDigits;
+  if (width < (size_t)num->fractionalDigits + 1) { width = (size_t)num->fractionalDigits + 1; }
+  for (size_t i = width; i-- != 0; ) {
+    putDigit(p, num->radix, i < nDigits ? p->digits[i] : 0);
+    if (i == num->fractionalDigits && i != 0) { putUchar(p, digitPoint); }
+  }
+  if (num->exponent.len != 0) {
+    putUchar(p, genericExpLetter);
+    if (!num->exponent.pos) { putUchar(p, negativeSign); }
+    size_t nExpDigits = toDigits(p, num->exponent.len, num->exponent.buf, 10);
+    for (size_t i = nExpDigits; i-- != 0; ) {
+      putByte(p, '0' + p->digits[i]);
+    }
+  }
+}
+
+
+//////////////////////////////////// Strings ////////////////////////////////////
+
+// Write string text as it would appear between delimiters, escaping whatever `isStringChar` rejects.
+// Escapes are taken from `commonEscapes` when there is one, or else are the shortest hex escape that fits.
+static
+void putEscaped(printer* p, size_t nBytes, const uint8_t* bytes) {
+  str rest = {.len = nBytes, .bytes = (uint8_t*)bytes};
+  while (rest.len != 0) {
+    // runs of unremarkable characters are written all at once
+    size_t run = 0;
+    while (run < rest.len) {
+      uint8_t b = rest.bytes[run];
+      if (b < 0x80 && !isStringChar(b)) { break; }
+      if (b >= 0x80) {
+        str here = {.len = rest.len - run, .bytes = &rest.bytes[run]};
+        char32_t c; size_t adv = peekUchar(&c, here);
+        if (c == UCHAR_NULL || !isStringChar(c)) { break; }
+        run += adv;
+      }
+      else { run += 1; }
+    }
+    put(p, run, rest.bytes);
+    rest.bytes += run; rest.len -= run;
+    if (rest.len == 0) { break; }
+    char32_t c; size_t adv = peekUchar(&c, rest);
+    if (c == UCHAR_NULL) {
+      // not utf8, so the best that can be done is to give the byte its own codepoint
+      c = rest.bytes[0];
+      adv = 1;
+    }
+    rest.bytes += adv; rest.len -= adv;
+    putUchar(p, escapeLeader);
+    bool common = false;
+    for (size_t i = 0; commonEscapes[i].source != UCHAR_NULL; ++i) {
+      if (commonEscapes[i].decode == c) {
+        putUchar(p, commonEscapes[i].source);
+        common = true;
+        break;
+      }
+    }
+    if (common) { continue; }
+    char32_t leader; int nHex;
+    if (c <= 0xFF) { leader = twoHexEscapeLeader; nHex = 2; }
+    else if (c <= 0xFFFF) { leader = fourHexEscapeLeader; nHex = 4; }
+    else { leader = sixHexEscapeLeader; nHex = 6; }
+    putUchar(p, leader);
+    for (int i = nHex; i-- != 0; ) {
+      putByte(p, "0123456789ABCDEF"[(c >> (4 * i)) & 0xF]);
+    }
+  }
+}
+
+// Heredocs can hold any text with a line break in it, so long as it is valid utf8 and every line break is a plain newline
+//   (the heredoc keeps line breaks as they are in the source, but the one written before the end marker is always `\n`).
+static
+bool wantsHeredoc(str text) {
+  bool multiline = false;
+  str rest = text;
+  while (rest.len != 0) {
+    char32_t c; size_t adv = peekUchar(&c, rest);
+    if (c == UCHAR_NULL) { return false; }
+    if (c == '\n') { multiline = true; }
+    else if (isNewlineChar(c)) { return false; }
+    rest.bytes += adv; rest.len -= adv;
+  }
+  return multiline;
+}
+
+// Does any line of `text` start with `name` and then the triple quote?
+static
+bool heredocClash(str text, size_t nameLen, const uint8_t* name) {
+  for (size_t i = 0; i < text.len; ) {
+    size_t lineLen = 0;
+    while (i + lineLen < text.len && text.bytes[i + lineLen] != '\n') { lineLen += 1; }
+    if ( lineLen >= nameLen + 3
+      && memcmp(&text.bytes[i], name, nameLen) == 0
+      && text.bytes[i + nameLen] == '\"' && text.bytes[i + nameLen + 1] == '\"' && text.bytes[i + nameLen + 2] == '\"'
+       ) { return true; }
+    i += lineLen + 1;
+  }
+  return false;
+}
+
+/*
+  `"""[:name:][:newline:][:text:][:newline:][:name:]"""`
+The end marker is named only when the text has a line that would otherwise end the heredoc early.
+*/
+static
+void printHeredoc(printer* p, str text) {
+  uint8_t name[24] = "";
+  size_t nameLen = 0;
+  for (unsigned i = 0; heredocClash(text, nameLen, name); ++i) {
+    nameLen = (size_t)sprintf((char*)name, i == 0 ? "END" : "END%u", i);
+  }
+  putCStr(p, "\"\"\"");
+  put(p, nameLen, name);
+  putByte(p, '\n');
+  put(p, text.len, text.bytes);
+  putByte(p, '\n');
+  put(p, nameLen, name);
+  putCStr(p, "\"\"\"");
+}
+
+
+//////////////////////////////////// Eexprs ////////////////////////////////////
+
+// Returns whether the text ends with an (open) block, in which case anything that closes around it must start a new line.
+static bool printExpr(printer* p, size_t indent, const eexpr* self);
+
+static
+bool printList(printer* p, size_t indent, const char* sep, const eexprList* list) {
+  bool endsInBlock = false;
+  for (size_t i = 0; i < list->len; ++i) {
+    if (i != 0) { putCStr(p, sep); }
+    endsInBlock = printExpr(p, indent, list->data[i]);
+  }
+  return endsInBlock;
+}
+
+// Commas and semicolons only make a list of fewer than two items with a stray separator.
+static
+bool printSeparated(printer* p, size_t indent, char sep, const eexprList* list) {
+  char sepSpace[3] = {sep, ' ', '\0'};
+  bool endsInBlock = printList(p, indent, sepSpace, list);
+  if (list->len < 2) {
+    putByte(p, sep);
+    endsInBlock = false;
+  }
+  return endsInBlock;
+}
+
+static
+void printBlockLines(printer* p, size_t indent, const eexprList* list) {
+  for (size_t i = 0; i < list->len; ++i) {
+    newline(p, indent + 2);
+    printExpr(p, indent + 2, list->data[i]);
+  }
+}
+
+static
+void printWrap(printer* p, size_t indent, char open, char close, const eexpr* sub) {
+  putByte(p, open);
+  if (sub != NULL && sub->type == EEXPR_BLOCK) {
+    printBlockLines(p, indent, &sub->as.list);
+    newline(p, indent);
+  }
+  else if (sub != NULL && printExpr(p, indent, sub)) {
+    newline(p, indent);
+  }
+  putByte(p, close);
+}
+
+// Whether the printed text starts with a dot (from a predot or an ellipsis with no before-part),
+//   so that it would run together with the dots of an ellipsis in front of it.
+static
+bool startsWithDot(const eexpr* self) {
+  while (true) {
+    switch (self->type) {
+      case EEXPR_PREDOT: return true;
+      case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+        if (self->as.list.len == 0) { return false; }
+        self = self->as.list.data[0];
+      }; break;
+      case EEXPR_COLON: self = self->as.pair[0]; break;
+      case EEXPR_ELLIPSIS: {
+        if (self->as.ellipsis[0] == NULL) { return true; }
+        self = self->as.ellipsis[0];
+      }; break;
+      default: return false;
+    }
+  }
+}
+
+static
+bool printExpr(printer* p, size_t indent, const eexpr* self) {
+  switch (self->type) {
+    case EEXPR_SYMBOL: {
+      put(p, self->as.symbol.text.len, self->as.symbol.text.bytes);
+    }; return false;
+    case EEXPR_NUMBER: {
+      lexer_forceEexpr((eexpr*)self); // memoize the payload on first access, see `FLAG_LAZY`
+      printNumber(p, &self->as.number);
+    }; return false;
+    case EEXPR_STRING: {
+      lexer_forceEexpr((eexpr*)self); // memoize the payload on first access, see `FLAG_LAZY`
+      const eexprStrTempl* string = &self->as.string;
+      if (string->parts.len == 0 && wantsHeredoc(string->text1)) {
+        printHeredoc(p, string->text1);
+        return false;
+      }
+      putUchar(p, plainStringDelim);
+      putEscaped(p, string->text1.len, string->text1.bytes);
+      for (size_t i = 0; i < string->parts.len; ++i) {
+        const strTemplPart* part = &string->parts.data[i];
+        putByte(p, '`');
+        if (part->subexpr != NULL) { printExpr(p, indent, part->subexpr); }
+        putByte(p, '`');
+        putEscaped(p, part->nBytes, part->utf8str);
+      }
+      putUchar(p, plainStringDelim);
+    }; return false;
+    case EEXPR_PAREN: printWrap(p, indent, '(', ')', self->as.wrap); return false;
+    case EEXPR_BRACK: printWrap(p, indent, '[', ']', self->as.wrap); return false;
+    case EEXPR_BRACE: printWrap(p, indent, '{', '}', self->as.wrap); return false;
+    case EEXPR_BLOCK: {
+      putByte(p, ':');
+      printBlockLines(p, indent, &self->as.list);
+    }; return true;
+    case EEXPR_PREDOT: {
+      putByte(p, '.');
+    }; return printExpr(p, indent, self->as.wrap);
+    case EEXPR_CHAIN: {
+      bool endsInBlock = false;
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        const eexpr* item = self->as.list.data[i];
+        // wrappers and strings chain on without a dot
+        switch (item->type) {
+          case EEXPR_STRING: case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_BLOCK: break;
+          default: if (i != 0) { putByte(p, '.'); } break;
+        }
+        endsInBlock = printExpr(p, indent, item);
+      }
+      return endsInBlock;
+    }; break;
+    case EEXPR_SPACE: return printList(p, indent, " ", &self->as.list);
+    case EEXPR_ELLIPSIS: {
+      const eexpr* before = self->as.ellipsis[0];
+      const eexpr* after = self->as.ellipsis[1];
+      if (before != NULL) { printExpr(p, indent, before); }
+      putCStr(p, "..");
+      if (after == NULL) { return false; }
+      // without the space, the dots would run together
+      if (startsWithDot(after)) { putByte(p, ' '); }
+      return printExpr(p, indent, after);
+    }; break;
+    case EEXPR_COLON: {
+      printExpr(p, indent, self->as.pair[0]);
+      putCStr(p, ": ");
+    }; return printExpr(p, indent, self->as.pair[1]);
+    case EEXPR_COMMA: return printSeparated(p, indent, ',', &self->as.list);
+    case EEXPR_SEMICOLON: return printSeparated(p, indent, ';', &self->as.list);
+    case EEXPR_MIXFIX: {
+      putByte(p, '(');
+      for (size_t i = 0; i < self->as.mixfix.args.len; ++i) {
+        const eexpr* arg = self->as.mixfix.args.data[i];
+        if (i != 0) { putByte(p, ' '); }
+        if (arg->type == EEXPR_SPACE) { printWrap(p, indent, '(', ')', arg); }
+        else if (printExpr(p, indent, arg)) { newline(p, indent); }
+      }
+      putByte(p, ')');
+    }; return false;
+  }
+  assert(false);
+  return false;
+}
+
+
+//////////////////////////////////// Main Printer ////////////////////////////////////
+
+size_t printer_print(FILE* fp, size_t n, eexpr* const* eexprs, size_t cap, uint8_t* buf) {
+  uint8_t staging[4096];
+  printer p =
+    { .fp = fp
+    , .buf = fp == NULL ? buf : staging
+    , .cap = fp == NULL ? cap : sizeof(staging)
+    , .len = 0
+    , .total = 0
+    , .failed = false
+    , .words = NULL
+    , .wordsCap = 0
+    , .digits = NULL
+    , .digitsCap = 0
+    };
+  for (size_t i = 0; i < n; ++i) {
+    printExpr(&p, 0, eexprs[i]);
+    putByte(&p, '\n');
+  }
+  if (fp != NULL) { flush(&p); }
+  free(p.words);
+  free(p.digits);
+  if (p.failed) { return SIZE_MAX; }
+  return p.total + p.len;
+}
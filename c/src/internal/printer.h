@@ -0,0 +1,16 @@
+#ifndef INTERNAL_PRINTER_H
+#define INTERNAL_PRINTER_H
+
+#include <stdio.h>
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// When `fp` is null, the text goes into `buf` (see `eexpr_print`); otherwise, `buf` is only a staging area for writes to `fp`.
+// Returns the length of the whole text, or `SIZE_MAX` if writing to `fp` failed.
+size_t printer_print(FILE* fp, size_t n, eexpr* const* eexprs, size_t cap, uint8_t* buf);
+
+
+#endif
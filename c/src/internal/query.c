@@ -0,0 +1,446 @@
+#include "query.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "engine.h"
+#include "payload.h"
+
+#define TYPE queryStep
+#include "dynarr.h"
+
+#define TYPE queryPred
+#include "dynarr.h"
+
+_Static_assert(EEXPR_QUERY_MAX_STEPS <= 64, "query steps do not fit in a `uint64_t` bitset");
+
+// Longest number literal that is handed to `strtod`.
+#define MAX_NUMBER_LEN 63
+
+
+//////////////////////////////////// Compiling Queries ////////////////////////////////////
+
+static const char* const typeNames[] = {
+  "symbol", "number", "string", "paren", "brack", "brace", "block", "predot",
+  "chain", "space", "ellipsis", "colon", "comma", "semicolon", "mixfix"
+};
+_Static_assert(sizeof(typeNames) / sizeof(typeNames[0]) == EEXPR_MIXFIX + 1, "every eexpr type needs a name");
+
+// Two-character operators come first, so that they are not taken for their first character.
+static const struct queryOperator {
+  const char* text;
+  queryOp op;
+} operators[] = {
+  {"!=", QUERY_NE}, {"<=", QUERY_LE}, {">=", QUERY_GE},
+  {"=", QUERY_EQ}, {"<", QUERY_LT}, {">", QUERY_GT}, {"~", QUERY_GLOB}
+};
+
+typedef struct compiler {
+  size_t n;
+  const uint8_t* s;
+  size_t pos;
+  dynarr_queryStep steps;
+  dynarr_queryPred preds;
+  strBuilder text;
+  eexpr_queryError* error;
+} compiler;
+
+static
+bool fail(compiler* cc, size_t offset, eexpr_queryErrorType type) {
+  cc->error->offset = offset;
+  cc->error->type = type;
+  return false;
+}
+
+static
+uint32_t addText(compiler* cc, size_t n, const uint8_t* bytes) {
+  uint32_t off = (uint32_t)cc->text.len;
+  str text = {.len = n, .bytes = (uint8_t*)bytes};
+  strBuilder_append(&cc->text, text);
+  return off;
+}
+
+static
+void skipSpaces(compiler* cc) {
+  while (cc->pos < cc->n && (cc->s[cc->pos] == ' ' || cc->s[cc->pos] == '\t')) { cc->pos += 1; }
+}
+
+// The end of a bare word or number, which runs up to a space or the end of the predicate.
+static
+size_t wordEnd(const compiler* cc) {
+  size_t end = cc->pos;
+  while (end < cc->n && cc->s[end] != ' ' && cc->s[end] != '\t' && cc->s[end] != ']') { end += 1; }
+  return end;
+}
+
+static
+bool startsNumber(const compiler* cc, size_t end) {
+  size_t i = cc->pos;
+  if (i < end && (cc->s[i] == '-' || cc->s[i] == '+')) { i += 1; }
+  if (i < end && cc->s[i] == '.') { i += 1; }
+  return i < end && '0' <= cc->s[i] && cc->s[i] <= '9';
+}
+
+// A number is whatever `strtod` makes of the whole word.
+static
+bool compileNumber(compiler* cc, size_t end, double* out) {
+  size_t len = end - cc->pos;
+  if (len > MAX_NUMBER_LEN) { return false; }
+  char buf[MAX_NUMBER_LEN + 1];
+  memcpy(buf, &cc->s[cc->pos], len);
+  buf[len] = '\0';
+  char* stop;
+  *out = strtod(buf, &stop);
+  return stop == &buf[len];
+}
+
+// Inside double-quotes, only `\"` and `\\` are unescaped; any other backslash is kept, so that it can escape a glob pattern.
+static
+bool compileString(compiler* cc, queryPred* pred) {
+  size_t start = cc->pos;
+  cc->pos += 1;
+  pred->text = (uint32_t)cc->text.len;
+  while (true) {
+    if (cc->pos == cc->n) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_LITERAL); }
+    uint8_t c = cc->s[cc->pos];
+    if (c == '"') { break; }
+    if (c == '\\' && cc->pos + 1 < cc->n && (cc->s[cc->pos + 1] == '"' || cc->s[cc->pos + 1] == '\\')) {
+      cc->pos += 1;
+      c = cc->s[cc->pos];
+    }
+    strBuilder_appendByte(&cc->text, c);
+    cc->pos += 1;
+  }
+  cc->pos += 1;
+  pred->textLen = (uint32_t)(cc->text.len - pred->text);
+  return true;
+}
+
+static
+bool compileLiteral(compiler* cc, queryPred* pred) {
+  size_t start = cc->pos;
+  bool comparison = pred->op != QUERY_EQ && pred->op != QUERY_NE && pred->op != QUERY_GLOB;
+  if (cc->pos < cc->n && cc->s[cc->pos] == '"') {
+    if (comparison) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_LITERAL); }
+    if (!compileString(cc, pred)) { return false; }
+  }
+  else {
+    size_t end = wordEnd(cc);
+    if (end == start) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_LITERAL); }
+    if (pred->op != QUERY_GLOB && startsNumber(cc, end)) {
+      if (!compileNumber(cc, end, &pred->number)) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_LITERAL); }
+      pred->isNumber = true;
+    }
+    else {
+      if (comparison) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_LITERAL); }
+      pred->text = addText(cc, end - start, &cc->s[start]);
+      pred->textLen = (uint32_t)(end - start);
+    }
+    cc->pos = end;
+  }
+  if (pred->op == QUERY_GLOB && !payload_checkGlob(pred->textLen, &cc->text.bytes[pred->text])) {
+    return fail(cc, start, EEXPR_QUERY_ERR_BAD_PATTERN);
+  }
+  return true;
+}
+
+static
+bool compileTypeName(compiler* cc, queryPred* pred) {
+  size_t end = wordEnd(cc);
+  size_t len = end - cc->pos;
+  const uint8_t* word = &cc->s[cc->pos];
+  if (len == 3 && memcmp(word, "int", 3) == 0) {
+    pred->op = QUERY_INT;
+    cc->pos = end;
+    return true;
+  }
+  for (size_t t = 0; t < sizeof(typeNames) / sizeof(typeNames[0]); ++t) {
+    if (strlen(typeNames[t]) == len && memcmp(word, typeNames[t], len) == 0) {
+      pred->op = QUERY_TYPE;
+      pred->eType = (uint8_t)t;
+      cc->pos = end;
+      return true;
+    }
+  }
+  return fail(cc, cc->pos, EEXPR_QUERY_ERR_BAD_PREDICATE);
+}
+
+static
+bool compilePred(compiler* cc) {
+  size_t open = cc->pos;
+  cc->pos += 1;
+  skipSpaces(cc);
+  queryPred pred = {.op = QUERY_TYPE, .eType = 0, .isNumber = false, .text = 0, .textLen = 0, .number = 0};
+  if (cc->pos == cc->n) { return fail(cc, open, EEXPR_QUERY_ERR_UNCLOSED_PREDICATE); }
+  bool isOperator = false;
+  for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); ++i) {
+    size_t len = strlen(operators[i].text);
+    if (cc->pos + len <= cc->n && memcmp(&cc->s[cc->pos], operators[i].text, len) == 0) {
+      pred.op = operators[i].op;
+      cc->pos += len;
+      isOperator = true;
+      break;
+    }
+  }
+  if (isOperator) {
+    skipSpaces(cc);
+    if (!compileLiteral(cc, &pred)) { return false; }
+  }
+  else if (!compileTypeName(cc, &pred)) { return false; }
+  skipSpaces(cc);
+  if (cc->pos == cc->n) { return fail(cc, open, EEXPR_QUERY_ERR_UNCLOSED_PREDICATE); }
+  if (cc->s[cc->pos] != ']') { return fail(cc, cc->pos, EEXPR_QUERY_ERR_BAD_PREDICATE); }
+  cc->pos += 1;
+  dynarr_push_queryPred(&cc->preds, &pred);
+  return true;
+}
+
+// A step's pattern runs up to the next `/` or `[` (other than an escaped one), and is kept as written.
+static
+bool compileStep(compiler* cc, bool descendant) {
+  size_t start = cc->pos;
+  while (cc->pos < cc->n && cc->s[cc->pos] != '/' && cc->s[cc->pos] != '[') {
+    if (cc->s[cc->pos] == '\\' && cc->pos + 1 < cc->n) { cc->pos += 1; }
+    cc->pos += 1;
+  }
+  size_t len = cc->pos - start;
+  if (len == 0) { return fail(cc, start, EEXPR_QUERY_ERR_EMPTY_STEP); }
+  if (!payload_checkGlob(len, &cc->s[start])) { return fail(cc, start, EEXPR_QUERY_ERR_BAD_PATTERN); }
+  queryStep step = {
+    .descendant = descendant,
+    .anyKey = len == 1 && cc->s[start] == '*',
+    .key = addText(cc, len, &cc->s[start]),
+    .keyLen = (uint32_t)len,
+    .preds = (uint32_t)cc->preds.len,
+    .nPreds = 0
+  };
+  while (cc->pos < cc->n && cc->s[cc->pos] == '[') {
+    if (!compilePred(cc)) { return false; }
+    step.nPreds += 1;
+  }
+  dynarr_push_queryStep(&cc->steps, &step);
+  return true;
+}
+
+eexpr_query* query_compile(size_t nBytes, const uint8_t* utf8str, eexpr_queryError* error) {
+  compiler cc = {.n = nBytes, .s = utf8str, .pos = 0, .error = error};
+  dynarr_init_queryStep(&cc.steps, 8);
+  dynarr_init_queryPred(&cc.preds, 4);
+  cc.text = strBuilder_new(64);
+  bool descendant = nBytes >= 2 && utf8str[0] == '/' && utf8str[1] == '/';
+  cc.pos = descendant ? 2 : nBytes >= 1 && utf8str[0] == '/' ? 1 : 0;
+  bool ok;
+  while (true) {
+    if (cc.steps.len == EEXPR_QUERY_MAX_STEPS) {
+      ok = fail(&cc, cc.pos, EEXPR_QUERY_ERR_TOO_MANY_STEPS);
+      break;
+    }
+    ok = compileStep(&cc, descendant);
+    if (!ok || cc.pos == nBytes) { break; }
+    if (utf8str[cc.pos] != '/') {
+      ok = fail(&cc, cc.pos, EEXPR_QUERY_ERR_EXPECTED_SLASH);
+      break;
+    }
+    descendant = cc.pos + 1 < nBytes && utf8str[cc.pos + 1] == '/';
+    cc.pos += descendant ? 2 : 1;
+  }
+  if (!ok) {
+    dynarr_deinit_queryStep(&cc.steps);
+    dynarr_deinit_queryPred(&cc.preds);
+    free(cc.text.bytes);
+    return NULL;
+  }
+  eexpr_query* self = malloc(sizeof(eexpr_query));
+  checkOom(self);
+  self->nSteps = (uint32_t)cc.steps.len;
+  self->steps = cc.steps.data;
+  self->preds = cc.preds.data;
+  self->text = cc.text.bytes;
+  self->descendants = 0;
+  for (uint32_t i = 0; i < self->nSteps; ++i) {
+    if (self->steps[i].descendant) { self->descendants |= (uint64_t)1 << i; }
+  }
+  return self;
+}
+
+void query_del(eexpr_query* self) {
+  if (self == NULL) { return; }
+  free(self->steps);
+  free(self->preds);
+  free(self->text);
+  free(self);
+}
+
+
+//////////////////////////////////// Running Queries ////////////////////////////////////
+
+typedef struct runner {
+  const eexpr_query* query;
+  eexpr_queryCallback onMatch;
+  void* ctx;
+  size_t nMatches;
+  bool stopped;
+} runner;
+
+// Split an entry into its key and value (see `eexpr_queryCompile`).
+static
+bool entryOf(const eexpr* e, const str** key, size_t* nValues, eexpr* const** values) {
+  switch (e->type) {
+    case EEXPR_COLON: {
+      if (e->as.pair[0]->type != EEXPR_SYMBOL) { return false; }
+      *key = &e->as.pair[0]->as.symbol.text;
+      *nValues = 1;
+      *values = &e->as.pair[1];
+      return true;
+    }
+    case EEXPR_CHAIN: case EEXPR_SPACE: {
+      if (e->as.list.data[0]->type != EEXPR_SYMBOL) { return false; }
+      *key = &e->as.list.data[0]->as.symbol.text;
+      *nValues = e->as.list.len - 1;
+      *values = &e->as.list.data[1];
+      return true;
+    }
+    default: return false;
+  }
+}
+
+static
+const str* textOf(const eexpr* e) {
+  return e->type == EEXPR_SYMBOL ? &e->as.symbol.text : payload_plainString(e);
+}
+
+static
+bool isLiteral(const eexpr_query* q, const queryPred* pred, const eexpr* e) {
+  if (pred->isNumber) {
+    if (e->type != EEXPR_NUMBER) { return false; }
+    lexer_forceEexpr((eexpr*)e);
+    return payload_asDouble(&e->as.number) == pred->number;
+  }
+  const str* text = textOf(e);
+  return text != NULL && text->len == pred->textLen && memcmp(text->bytes, &q->text[pred->text], text->len) == 0;
+}
+
+static
+bool holds(const eexpr_query* q, const queryPred* pred, size_t nValues, eexpr* const* values) {
+  if (nValues != 1) { return false; }
+  const eexpr* e = values[0];
+  switch ((queryOp)pred->op) {
+    case QUERY_TYPE: return e->type == pred->eType;
+    case QUERY_INT: {
+      if (e->type != EEXPR_NUMBER) { return false; }
+      lexer_forceEexpr((eexpr*)e);
+      bool integral;
+      int64_t value;
+      return payload_asInt(&e->as.number, &integral, &value);
+    }
+    case QUERY_EQ: return isLiteral(q, pred, e);
+    case QUERY_NE: return !isLiteral(q, pred, e);
+    case QUERY_GLOB: {
+      const str* text = textOf(e);
+      return text != NULL && payload_glob(pred->textLen, &q->text[pred->text], text->len, text->bytes);
+    }
+    case QUERY_LT: case QUERY_LE: case QUERY_GT: case QUERY_GE: {
+      if (e->type != EEXPR_NUMBER) { return false; }
+      lexer_forceEexpr((eexpr*)e);
+      double value = payload_asDouble(&e->as.number);
+      switch ((queryOp)pred->op) {
+        case QUERY_LT: return value < pred->number;
+        case QUERY_LE: return value <= pred->number;
+        case QUERY_GT: return value > pred->number;
+        default: return value >= pred->number;
+      }
+    }
+  }
+  return false;
+}
+
+static
+bool stepMatches(const eexpr_query* q, const queryStep* step, const str* key, size_t nValues, eexpr* const* values) {
+  if (!step->anyKey && !payload_glob(step->keyLen, &q->text[step->key], key->len, key->bytes)) { return false; }
+  for (uint32_t i = 0; i < step->nPreds; ++i) {
+    if (!holds(q, &q->preds[step->preds + i], nValues, values)) { return false; }
+  }
+  return true;
+}
+
+static void visit(runner* r, const eexpr* e, uint64_t active);
+
+static
+void visitAll(runner* r, size_t n, eexpr* const* items, uint64_t active) {
+  for (size_t i = 0; i < n && !r->stopped; ++i) {
+    if (items[i] != NULL) { visit(r, items[i], active); }
+  }
+}
+
+// `active` holds the steps that could match here: the next step of every path that has led here, and any `//` steps along the way.
+// Descendant steps stay active all the way down, while the rest only last through containers that are looked through.
+static
+void visit(runner* r, const eexpr* e, uint64_t active) {
+  const eexpr_query* q = r->query;
+  switch (e->type) {
+    case EEXPR_BLOCK: case EEXPR_COMMA: case EEXPR_SEMICOLON: {
+      visitAll(r, e->as.list.len, e->as.list.data, active);
+      return;
+    }
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: {
+      if (e->as.wrap != NULL) { visit(r, e->as.wrap, active); }
+      return;
+    }
+    default: break;
+  }
+  uint64_t deeper = active & q->descendants;
+  const str* key;
+  size_t nValues;
+  eexpr* const* values;
+  if (entryOf(e, &key, &nValues, &values)) {
+    uint64_t next = deeper;
+    bool matched = false;
+    for (uint32_t i = 0; i < q->nSteps; ++i) {
+      if ((active & ((uint64_t)1 << i)) == 0) { continue; }
+      if (!stepMatches(q, &q->steps[i], key, nValues, values)) { continue; }
+      if (i + 1 == q->nSteps) { matched = true; }
+      else { next |= (uint64_t)1 << (i + 1); }
+    }
+    if (matched) {
+      r->nMatches += 1;
+      if (!r->onMatch(r->ctx, e, nValues, values)) {
+        r->stopped = true;
+        return;
+      }
+    }
+    if (next != 0) { visitAll(r, nValues, values, next); }
+    return;
+  }
+  if (deeper == 0) { return; }
+  switch (e->type) {
+    case EEXPR_STRING: {
+      for (size_t i = 0; i < e->as.string.parts.len && !r->stopped; ++i) {
+        const eexpr* sub = e->as.string.parts.data[i].subexpr;
+        if (sub != NULL) { visit(r, sub, deeper); }
+      }
+    }; break;
+    case EEXPR_PREDOT: {
+      visit(r, e->as.wrap, deeper);
+    }; break;
+    case EEXPR_CHAIN: case EEXPR_SPACE: {
+      visitAll(r, e->as.list.len, e->as.list.data, deeper);
+    }; break;
+    case EEXPR_MIXFIX: {
+      visitAll(r, e->as.mixfix.args.len, e->as.mixfix.args.data, deeper);
+    }; break;
+    case EEXPR_COLON: {
+      visitAll(r, 2, e->as.pair, deeper);
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      visitAll(r, 2, e->as.ellipsis, deeper);
+    }; break;
+    default: break;
+  }
+}
+
+size_t query_run(const eexpr_query* self, size_t n, eexpr* const* eexprs, eexpr_queryCallback onMatch, void* ctx) {
+  runner r = {.query = self, .onMatch = onMatch, .ctx = ctx, .nMatches = 0, .stopped = false};
+  visitAll(&r, n, eexprs, 1);
+  return r.nMatches;
+}
@@ -0,0 +1,56 @@
+#ifndef INTERNAL_QUERY_H
+#define INTERNAL_QUERY_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// What a `queryPred` tests the value of an entry for.
+typedef enum queryOp {
+  QUERY_TYPE, // an eexpr of type `.eType`
+  QUERY_INT, // a number that is an int
+  QUERY_EQ, // equal to the literal
+  QUERY_NE, // not equal to the literal
+  QUERY_GLOB, // a symbol or string matching the glob pattern in `.text`
+  QUERY_LT, // a number compared to `.number`, likewise below
+  QUERY_LE,
+  QUERY_GT,
+  QUERY_GE
+} queryOp;
+
+typedef struct queryPred {
+  uint8_t op; // a `queryOp`
+  uint8_t eType; // an `eexpr_type`, for `QUERY_TYPE`
+  bool isNumber; // for `QUERY_EQ` and `QUERY_NE`: the literal is `.number`, rather than `.text`
+  uint32_t text; // offset into `eexpr_query.text`
+  uint32_t textLen;
+  double number;
+} queryPred;
+
+typedef struct queryStep {
+  bool descendant; // written after `//`, so it matches at any depth
+  bool anyKey; // the pattern is just `*`, so the key need not be looked at
+  uint32_t key; // offset of the glob pattern into `eexpr_query.text`
+  uint32_t keyLen;
+  uint32_t preds; // the first of `.nPreds` predicates in `eexpr_query.preds`
+  uint32_t nPreds;
+} queryStep;
+
+// All the arrays are owned.
+struct eexpr_query {
+  uint32_t nSteps;
+  queryStep* steps;
+  queryPred* preds;
+  uint8_t* text; // patterns and literals, back-to-back
+  uint64_t descendants; // the steps written after `//`, as a bitset of `1 << step`
+};
+
+eexpr_query* query_compile(size_t nBytes, const uint8_t* utf8str, eexpr_queryError* error);
+
+void query_del(eexpr_query* self);
+
+size_t query_run(const eexpr_query* self, size_t n, eexpr* const* eexprs, eexpr_queryCallback onMatch, void* ctx);
+
+
+#endif
@@ -0,0 +1,898 @@
+#include "schema.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "engine.h"
+#include "payload.h"
+
+typedef eexpr_schemaError schemaError;
+#define TYPE schemaError
+#include "dynarr.h"
+
+#define TYPE schemaNode
+#include "dynarr.h"
+
+#define TYPE schemaRange
+#include "dynarr.h"
+
+#define TYPE schemaField
+#include "dynarr.h"
+
+#define TYPE schemaDef
+#include "dynarr.h"
+
+#define TYPE uint32_t
+#include "dynarr.h"
+
+#define NONE EEXPR_SCHEMA_NONE
+#define BIT(t) ((uint16_t)(1u << (t)))
+#define ALL_TYPES ((uint16_t)((1u << (EEXPR_MIXFIX + 1)) - 1))
+_Static_assert(EEXPR_MIXFIX < 16, "eexpr types do not fit in `schemaNode.accepts`");
+
+// Records remember which fields they have seen in a bitset.
+#define MAX_FIELDS 64
+
+
+//////////////////////////////////// Helpers ////////////////////////////////////
+
+// The items of a bracket or brace: none, the comma-separated subexprs, or the lone subexpr.
+static
+size_t wrappedItems(const eexpr* e, eexpr* const** items) {
+  const eexpr* wrap = e->as.wrap;
+  if (wrap == NULL) {
+    *items = NULL;
+    return 0;
+  }
+  if (wrap->type == EEXPR_COMMA) {
+    *items = wrap->as.list.data;
+    return wrap->as.list.len;
+  }
+  *items = &e->as.wrap;
+  return 1;
+}
+
+// A `key: value` pair, where the key is a symbol; the value can also be an indented block after a `key:`, which parses as a chain.
+static
+bool keyValue(const eexpr* e, const eexpr** key, const eexpr** value) {
+  *key = NULL;
+  if (e->type == EEXPR_COLON) {
+    *key = e->as.pair[0];
+    *value = e->as.pair[1];
+  }
+  else if (e->type == EEXPR_CHAIN && e->as.list.len == 2 && e->as.list.data[1]->type == EEXPR_BLOCK) {
+    *key = e->as.list.data[0];
+    *value = e->as.list.data[1];
+  }
+  else { return false; }
+  return (*key)->type == EEXPR_SYMBOL;
+}
+
+static
+int compareText(size_t n1, const uint8_t* s1, size_t n2, const uint8_t* s2) {
+  size_t n = n1 < n2 ? n1 : n2;
+  int c = n == 0 ? 0 : memcmp(s1, s2, n);
+  if (c != 0) { return c; }
+  return (n1 > n2) - (n1 < n2);
+}
+
+
+//////////////////////////////////// Compiling Schemas ////////////////////////////////////
+
+typedef enum keyword {
+  KW_ANY,
+  KW_SYMBOL,
+  KW_STRING,
+  KW_INT,
+  KW_NUMBER,
+  KW_IS,
+  KW_LIST,
+  KW_ONE_OF,
+  KW_OPTIONAL,
+  KW_PAREN,
+  KW_BRACK,
+  KW_BRACE,
+  KW_PREDOT,
+  KW_BLOCK,
+  KW_CHAIN,
+  KW_SPACE,
+  KW_COMMA,
+  KW_SEMICOLON,
+  KW_ELLIPSIS,
+  KW_COLON,
+  KW_NONE
+} keyword;
+
+static const char* const keywordNames[KW_NONE] = {
+  "any", "symbol", "string", "int", "number", "is", "list", "oneOf", "optional",
+  "paren", "brack", "brace", "predot",
+  "block", "chain", "space", "comma", "semicolon",
+  "ellipsis", "colon"
+};
+
+// the type of eexpr that each of the wrapper and list keywords stands for
+static const eexpr_type keywordTypes[KW_NONE] = {
+  [KW_PAREN] = EEXPR_PAREN, [KW_BRACK] = EEXPR_BRACK, [KW_BRACE] = EEXPR_BRACE, [KW_PREDOT] = EEXPR_PREDOT,
+  [KW_BLOCK] = EEXPR_BLOCK, [KW_CHAIN] = EEXPR_CHAIN, [KW_SPACE] = EEXPR_SPACE, [KW_COMMA] = EEXPR_COMMA, [KW_SEMICOLON] = EEXPR_SEMICOLON,
+  [KW_ELLIPSIS] = EEXPR_ELLIPSIS, [KW_COLON] = EEXPR_COLON
+};
+
+static
+keyword keywordOf(const eexpr* e) {
+  if (e->type != EEXPR_SYMBOL) { return KW_NONE; }
+  const str* text = &e->as.symbol.text;
+  for (int kw = 0; kw < KW_NONE; ++kw) {
+    size_t len = strlen(keywordNames[kw]);
+    if (text->len == len && memcmp(text->bytes, keywordNames[kw], len) == 0) { return (keyword)kw; }
+  }
+  return KW_NONE;
+}
+
+typedef struct compiler {
+  dynarr_schemaDef defs;
+  dynarr_schemaNode nodes;
+  dynarr_uint32_t kids;
+  dynarr_schemaField fields;
+  dynarr_schemaRange ranges;
+  strBuilder text;
+  dynarr_schemaError errors;
+  uint32_t def; // the definition being compiled
+  bool optionalOk; // set only while starting on the type of a record field, which may be `optional`
+  bool optional; // set when it was
+} compiler;
+
+static
+void pushError(compiler* cc, eexpr_span loc, eexpr_schemaErrorType type) {
+  schemaError err = {.loc = loc, .type = type, .def = cc->def};
+  dynarr_push_schemaError(&cc->errors, &err);
+}
+
+static
+void pushNameError(compiler* cc, const eexpr* name, eexpr_schemaErrorType type) {
+  schemaError err = {.loc = name->loc, .type = type, .def = cc->def};
+  err.as.name.nBytes = name->as.symbol.text.len;
+  err.as.name.utf8str = name->as.symbol.text.bytes;
+  dynarr_push_schemaError(&cc->errors, &err);
+}
+
+static
+uint32_t addNode(compiler* cc, schemaOp op, eexpr_type eType, uint32_t a, uint32_t b) {
+  schemaNode node = {.op = op, .eType = eType, .accepts = 0, .a = a, .b = b};
+  dynarr_push_schemaNode(&cc->nodes, &node);
+  return (uint32_t)(cc->nodes.len - 1);
+}
+
+// Compiling carries on past an error with a stand-in node, so that one mistake does not hide the next.
+static
+uint32_t compileError(compiler* cc, eexpr_span loc, eexpr_schemaErrorType type) {
+  pushError(cc, loc, type);
+  return addNode(cc, SCHEMA_ANY, EEXPR_SYMBOL, NONE, NONE);
+}
+
+static
+uint32_t addText(compiler* cc, const str* text) {
+  uint32_t off = (uint32_t)cc->text.len;
+  strBuilder_append(&cc->text, *text);
+  return off;
+}
+
+static
+uint32_t findDef(const compiler* cc, const str* name) {
+  for (uint32_t i = 0; i < cc->defs.len; ++i) {
+    const schemaDef* def = &cc->defs.data[i];
+    if (compareText(def->nameLen, &cc->text.bytes[def->name], name->len, name->bytes) == 0) { return i; }
+  }
+  return NONE;
+}
+
+static uint32_t compileType(compiler* cc, const eexpr* e);
+static uint32_t compileApp(compiler* cc, eexpr_span loc, size_t n, eexpr* const* items, uint32_t tail);
+
+static
+uint32_t compileBare(compiler* cc, keyword kw, const eexpr* e) {
+  switch (kw) {
+    case KW_ANY: return addNode(cc, SCHEMA_ANY, EEXPR_SYMBOL, NONE, NONE);
+    case KW_SYMBOL: return addNode(cc, SCHEMA_SYMBOL, EEXPR_SYMBOL, NONE, NONE);
+    case KW_STRING: return addNode(cc, SCHEMA_STRING, EEXPR_STRING, NONE, NONE);
+    case KW_INT: return addNode(cc, SCHEMA_INT, EEXPR_NUMBER, NONE, NONE);
+    case KW_NUMBER: return addNode(cc, SCHEMA_TYPE, EEXPR_NUMBER, NONE, NONE);
+    case KW_LIST: return addNode(cc, SCHEMA_LIST, EEXPR_BRACK, NONE, NONE);
+    case KW_IS: case KW_ONE_OF: case KW_OPTIONAL: case KW_NONE: {
+      return compileError(cc, e->loc, EEXPR_SCHEMA_ERR_BAD_ARGUMENT);
+    }
+    default: return addNode(cc, SCHEMA_TYPE, keywordTypes[kw], NONE, NONE);
+  }
+}
+
+// Compile each of the eexprs, and lay out the nodes for them side-by-side in `cc->kids`, returning where they start.
+static
+uint32_t compileKids(compiler* cc, size_t n, eexpr* const* items) {
+  uint32_t* nodes = malloc((n == 0 ? 1 : n) * sizeof(uint32_t));
+  checkOom(nodes);
+  for (size_t i = 0; i < n; ++i) {
+    nodes[i] = compileType(cc, items[i]);
+  }
+  uint32_t start = (uint32_t)cc->kids.len;
+  for (size_t i = 0; i < n; ++i) {
+    dynarr_push_uint32_t(&cc->kids, &nodes[i]);
+  }
+  free(nodes);
+  return start;
+}
+
+// The arguments of a keyword that itself takes a type: the rest of the items (with `tail` after them).
+static
+uint32_t compileRest(compiler* cc, eexpr_span loc, size_t n, eexpr* const* items, uint32_t tail) {
+  if (n == 0) { return tail; }
+  if (n == 1 && tail == NONE) { return compileType(cc, items[0]); }
+  return compileApp(cc, loc, n, items, tail);
+}
+
+static
+uint32_t compileIs(compiler* cc, const eexpr* arg) {
+  if (arg->type == EEXPR_SYMBOL) {
+    const str* text = &arg->as.symbol.text;
+    return addNode(cc, SCHEMA_IS_TEXT, EEXPR_SYMBOL, addText(cc, text), (uint32_t)text->len);
+  }
+  const str* text = payload_plainString(arg);
+  if (text != NULL) {
+    return addNode(cc, SCHEMA_IS_TEXT, EEXPR_STRING, addText(cc, text), (uint32_t)text->len);
+  }
+  schemaRange range = {.hasLo = true, .hasHi = true};
+  bool integral;
+  if (arg->type == EEXPR_NUMBER) {
+    lexer_forceEexpr((eexpr*)arg);
+    if (payload_asInt(&arg->as.number, &integral, &range.iLo)) {
+      range.iHi = range.iLo;
+      dynarr_push_schemaRange(&cc->ranges, &range);
+      return addNode(cc, SCHEMA_IS_INT, EEXPR_NUMBER, (uint32_t)(cc->ranges.len - 1), NONE);
+    }
+  }
+  return compileError(cc, arg->loc, EEXPR_SCHEMA_ERR_BAD_ARGUMENT);
+}
+
+// A space of a keyword followed by its arguments.
+// The `tail` is a node that was already compiled from a range (see `compileRange`), and stands as the last argument; or `NONE`.
+static
+uint32_t compileApp(compiler* cc, eexpr_span loc, size_t n, eexpr* const* items, uint32_t tail) {
+  bool optionalOk = cc->optionalOk;
+  cc->optionalOk = false;
+  keyword kw = keywordOf(items[0]);
+  if (kw == KW_NONE) { return compileError(cc, items[0]->loc, EEXPR_SCHEMA_ERR_BAD_TYPE); }
+  if (n == 1 && tail == NONE) { return compileBare(cc, kw, items[0]); }
+  // for the keywords that take something other than a type
+  const eexpr* arg = n == 2 && tail == NONE ? items[1] : NULL;
+  eexpr_span restLoc = loc;
+  if (n > 1) { restLoc.start = items[1]->loc.start; }
+  switch (kw) {
+    case KW_SYMBOL: case KW_STRING: {
+      const str* pattern = arg == NULL ? NULL : payload_plainString(arg);
+      if (pattern == NULL) { break; }
+      if (!payload_checkGlob(pattern->len, pattern->bytes)) {
+        return compileError(cc, arg->loc, EEXPR_SCHEMA_ERR_BAD_PATTERN);
+      }
+      schemaOp op = kw == KW_SYMBOL ? SCHEMA_SYMBOL : SCHEMA_STRING;
+      return addNode(cc, op, kw == KW_SYMBOL ? EEXPR_SYMBOL : EEXPR_STRING, addText(cc, pattern), (uint32_t)pattern->len);
+    }
+    case KW_IS: {
+      if (arg == NULL) { break; }
+      return compileIs(cc, arg);
+    }
+    case KW_ONE_OF: {
+      if (arg == NULL || arg->type != EEXPR_BRACK || arg->as.wrap == NULL) { break; }
+      eexpr* const* alts;
+      size_t nAlts = wrappedItems(arg, &alts);
+      uint32_t start = compileKids(cc, nAlts, alts);
+      return addNode(cc, SCHEMA_ALT, EEXPR_SYMBOL, start, (uint32_t)nAlts);
+    }
+    case KW_OPTIONAL: {
+      if (!optionalOk) { return compileError(cc, items[0]->loc, EEXPR_SCHEMA_ERR_BAD_TYPE); }
+      cc->optional = true;
+      return compileRest(cc, restLoc, n - 1, items + 1, tail);
+    }
+    case KW_LIST: {
+      uint32_t elem = compileRest(cc, restLoc, n - 1, items + 1, tail);
+      return addNode(cc, SCHEMA_LIST, EEXPR_BRACK, elem, NONE);
+    }
+    case KW_PAREN: case KW_BRACK: case KW_BRACE: case KW_PREDOT: {
+      uint32_t inner = compileRest(cc, restLoc, n - 1, items + 1, tail);
+      return addNode(cc, SCHEMA_WRAP, keywordTypes[kw], inner, NONE);
+    }
+    case KW_BLOCK: case KW_CHAIN: case KW_SPACE: case KW_COMMA: case KW_SEMICOLON: {
+      if (arg != NULL && arg->type == EEXPR_BRACK) {
+        eexpr* const* elems;
+        size_t nElems = wrappedItems(arg, &elems);
+        uint32_t start = compileKids(cc, nElems, elems);
+        return addNode(cc, SCHEMA_TUPLE, keywordTypes[kw], start, (uint32_t)nElems);
+      }
+      uint32_t elem = compileRest(cc, restLoc, n - 1, items + 1, tail);
+      return addNode(cc, SCHEMA_EACH, keywordTypes[kw], elem, NONE);
+    }
+    case KW_COLON: {
+      if (arg == NULL || arg->type != EEXPR_BRACK) { break; }
+      eexpr* const* elems;
+      if (wrappedItems(arg, &elems) != 2) { break; }
+      uint32_t start = compileKids(cc, 2, elems);
+      return addNode(cc, SCHEMA_TUPLE, EEXPR_COLON, start, 2);
+    }
+    default: break;
+  }
+  return compileError(cc, loc, EEXPR_SCHEMA_ERR_BAD_ARGUMENT);
+}
+
+static
+bool rangeBound(compiler* cc, keyword kw, const eexpr* bound, bool* has, int64_t* i, double* d) {
+  *has = bound != NULL;
+  if (bound == NULL) { return true; }
+  if (bound->type == EEXPR_NUMBER) {
+    lexer_forceEexpr((eexpr*)bound);
+    bool integral;
+    if (kw == KW_NUMBER) {
+      *d = payload_asDouble(&bound->as.number);
+      return true;
+    }
+    if (payload_asInt(&bound->as.number, &integral, i)) { return true; }
+  }
+  pushError(cc, bound->loc, EEXPR_SCHEMA_ERR_BAD_RANGE);
+  return false;
+}
+
+// An ellipsis binds looser than a space, so a range like `list int 0..9` is an ellipsis of `list int 0` and `9`;
+//   whatever comes before the `int` (or `number`) is compiled as though the range were written in its place.
+static
+uint32_t compileRange(compiler* cc, const eexpr* e) {
+  eexpr* const* items = NULL;
+  size_t n = 0;
+  if (e->as.ellipsis[0] != NULL && e->as.ellipsis[0]->type == EEXPR_SPACE) {
+    items = e->as.ellipsis[0]->as.list.data;
+    n = e->as.ellipsis[0]->as.list.len;
+  }
+  else if (e->as.ellipsis[0] != NULL) {
+    items = &e->as.ellipsis[0];
+    n = 1;
+  }
+  const eexpr* lo = NULL;
+  keyword kw = n == 0 ? KW_NONE : keywordOf(items[n-1]);
+  if (kw != KW_INT && kw != KW_NUMBER && n >= 2) {
+    lo = items[n-1];
+    n -= 1;
+    kw = keywordOf(items[n-1]);
+  }
+  if (kw != KW_INT && kw != KW_NUMBER) { return compileError(cc, e->loc, EEXPR_SCHEMA_ERR_BAD_TYPE); }
+  n -= 1;
+  schemaRange range = {.hasLo = false, .hasHi = false, .iLo = 0, .iHi = 0, .lo = 0, .hi = 0};
+  bool ok = rangeBound(cc, kw, lo, &range.hasLo, &range.iLo, &range.lo);
+  ok = rangeBound(cc, kw, e->as.ellipsis[1], &range.hasHi, &range.iHi, &range.hi) && ok;
+  if (ok && range.hasLo && range.hasHi && (kw == KW_INT ? range.iLo > range.iHi : range.lo > range.hi)) {
+    pushError(cc, e->loc, EEXPR_SCHEMA_ERR_BAD_RANGE);
+  }
+  dynarr_push_schemaRange(&cc->ranges, &range);
+  uint32_t node = addNode(cc, kw == KW_INT ? SCHEMA_INT : SCHEMA_NUMBER, EEXPR_NUMBER, (uint32_t)(cc->ranges.len - 1), NONE);
+  if (n == 0) { return node; }
+  eexpr_span loc = {.start = items[0]->loc.start, .end = e->loc.end};
+  return compileApp(cc, loc, n, items, node);
+}
+
+typedef struct pendingField {
+  schemaField field;
+  const eexpr* key;
+} pendingField;
+
+static
+uint32_t compileRecord(compiler* cc, const eexpr* e, size_t n, eexpr* const* items) {
+  if (n > MAX_FIELDS) { return compileError(cc, e->loc, EEXPR_SCHEMA_ERR_TOO_MANY_FIELDS); }
+  pendingField fields[MAX_FIELDS];
+  size_t nFields = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const eexpr* key;
+    const eexpr* value;
+    if (!keyValue(items[i], &key, &value)) {
+      pushError(cc, items[i]->loc, EEXPR_SCHEMA_ERR_BAD_FIELD);
+      continue;
+    }
+    cc->optionalOk = true;
+    cc->optional = false;
+    uint32_t node = compileType(cc, value);
+    pendingField* f = &fields[nFields++];
+    f->key = key;
+    f->field.key = addText(cc, &key->as.symbol.text);
+    f->field.keyLen = (uint32_t)key->as.symbol.text.len;
+    f->field.node = node;
+    f->field.optional = cc->optional;
+    cc->optional = false;
+  }
+  // sorted (stably, so a repeated key is reported where it is repeated) for binary search during validation
+  for (size_t i = 1; i < nFields; ++i) {
+    pendingField f = fields[i];
+    size_t j = i;
+    for (; j > 0; --j) {
+      const str* prev = &fields[j-1].key->as.symbol.text;
+      if (compareText(prev->len, prev->bytes, f.field.keyLen, f.key->as.symbol.text.bytes) <= 0) { break; }
+      fields[j] = fields[j-1];
+    }
+    fields[j] = f;
+  }
+  uint32_t start = (uint32_t)cc->fields.len;
+  for (size_t i = 0; i < nFields; ++i) {
+    if (i != 0 && fields[i-1].field.keyLen == fields[i].field.keyLen
+        && compareText(fields[i-1].field.keyLen, fields[i-1].key->as.symbol.text.bytes, fields[i].field.keyLen, fields[i].key->as.symbol.text.bytes) == 0) {
+      pushNameError(cc, fields[i].key, EEXPR_SCHEMA_ERR_DUPLICATE_FIELD);
+      continue;
+    }
+    dynarr_push_schemaField(&cc->fields, &fields[i].field);
+  }
+  return addNode(cc, SCHEMA_RECORD, EEXPR_BLOCK, start, (uint32_t)(cc->fields.len - start));
+}
+
+static
+uint32_t compileType(compiler* cc, const eexpr* e) {
+  bool optionalOk = cc->optionalOk;
+  cc->optionalOk = false;
+  switch (e->type) {
+    case EEXPR_SYMBOL: {
+      keyword kw = keywordOf(e);
+      if (kw != KW_NONE) { return compileBare(cc, kw, e); }
+      uint32_t def = findDef(cc, &e->as.symbol.text);
+      if (def == NONE) {
+        pushNameError(cc, e, EEXPR_SCHEMA_ERR_UNKNOWN_NAME);
+        return addNode(cc, SCHEMA_ANY, EEXPR_SYMBOL, NONE, NONE);
+      }
+      return addNode(cc, SCHEMA_REF, EEXPR_SYMBOL, def, NONE);
+    }
+    case EEXPR_PAREN: {
+      if (e->as.wrap == NULL) { break; }
+      cc->optionalOk = optionalOk;
+      return compileType(cc, e->as.wrap);
+    }
+    case EEXPR_BRACE: {
+      eexpr* const* items;
+      size_t n = wrappedItems(e, &items);
+      return compileRecord(cc, e, n, items);
+    }
+    case EEXPR_BLOCK: {
+      return compileRecord(cc, e, e->as.list.len, e->as.list.data);
+    }
+    case EEXPR_SPACE: {
+      cc->optionalOk = optionalOk;
+      return compileApp(cc, e->loc, e->as.list.len, e->as.list.data, NONE);
+    }
+    case EEXPR_ELLIPSIS: {
+      cc->optionalOk = optionalOk;
+      return compileRange(cc, e);
+    }
+    default: break;
+  }
+  return compileError(cc, e->loc, EEXPR_SCHEMA_ERR_BAD_TYPE);
+}
+
+static
+uint16_t acceptsOf(const compiler* cc, const schemaNode* node) {
+  switch ((schemaOp)node->op) {
+    case SCHEMA_ANY: return ALL_TYPES;
+    case SCHEMA_RECORD: return BIT(EEXPR_BLOCK) | BIT(EEXPR_BRACE);
+    case SCHEMA_ALT: {
+      uint16_t out = 0;
+      for (uint32_t i = 0; i < node->b; ++i) {
+        out |= cc->nodes.data[cc->kids.data[node->a + i]].accepts;
+      }
+      return out;
+    }
+    case SCHEMA_REF: return cc->nodes.data[cc->defs.data[node->a].node].accepts;
+    default: return BIT(node->eType);
+  }
+}
+
+// References can go round in circles, so this iterates up to a fixpoint; it terminates because bits are only ever added.
+static
+void computeAccepts(compiler* cc) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 0; i < cc->nodes.len; ++i) {
+      uint16_t accepts = acceptsOf(cc, &cc->nodes.data[i]);
+      if (accepts != cc->nodes.data[i].accepts) {
+        cc->nodes.data[i].accepts = accepts;
+        changed = true;
+      }
+    }
+  }
+}
+
+// Whether `node` leads to definition `def` through only references and alternatives, i.e. without going into a subexpr.
+static
+bool reaches(const compiler* cc, uint8_t* visited, uint32_t node, uint32_t def) {
+  if (visited[node]) { return false; }
+  visited[node] = 1;
+  const schemaNode* n = &cc->nodes.data[node];
+  if (n->op == SCHEMA_REF) {
+    return n->a == def || reaches(cc, visited, cc->defs.data[n->a].node, def);
+  }
+  if (n->op == SCHEMA_ALT) {
+    for (uint32_t i = 0; i < n->b; ++i) {
+      if (reaches(cc, visited, cc->kids.data[n->a + i], def)) { return true; }
+    }
+  }
+  return false;
+}
+
+static
+void checkCycles(compiler* cc, const eexpr_span* nameLocs) {
+  uint8_t* visited = malloc(cc->nodes.len);
+  checkOom(visited);
+  for (uint32_t d = 0; d < cc->defs.len; ++d) {
+    memset(visited, 0, cc->nodes.len);
+    if (reaches(cc, visited, cc->defs.data[d].node, d)) {
+      cc->def = d;
+      pushError(cc, nameLocs[d], EEXPR_SCHEMA_ERR_CYCLE);
+    }
+  }
+  free(visited);
+}
+
+eexpr_schema* schema_compile(size_t nDefs, eexpr* const* defs, size_t* nErrors, eexpr_schemaError** errors) {
+  compiler cc;
+  dynarr_init_schemaDef(&cc.defs, 8);
+  dynarr_init_schemaNode(&cc.nodes, 32);
+  dynarr_init_uint32_t(&cc.kids, 16);
+  dynarr_init_schemaField(&cc.fields, 16);
+  dynarr_init_schemaRange(&cc.ranges, 8);
+  cc.text = strBuilder_new(256);
+  dynarr_init_schemaError(&cc.errors, 4);
+  cc.def = NONE;
+  cc.optionalOk = false;
+  cc.optional = false;
+  // every name is known before any type is compiled, so that definitions can refer to each other in any order
+  const eexpr** types = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(eexpr*));
+  checkOom(types);
+  eexpr_span* nameLocs = malloc((nDefs == 0 ? 1 : nDefs) * sizeof(eexpr_span));
+  checkOom(nameLocs);
+  if (nDefs == 0) {
+    eexpr_span nowhere = {.start = 0, .end = 0};
+    pushError(&cc, nowhere, EEXPR_SCHEMA_ERR_NO_DEFINITIONS);
+  }
+  for (size_t i = 0; i < nDefs; ++i) {
+    const eexpr* name;
+    const eexpr* type;
+    if (!keyValue(defs[i], &name, &type)) {
+      pushError(&cc, defs[i]->loc, EEXPR_SCHEMA_ERR_BAD_DEFINITION);
+      continue;
+    }
+    if (keywordOf(name) != KW_NONE) {
+      pushError(&cc, name->loc, EEXPR_SCHEMA_ERR_BAD_DEFINITION);
+      continue;
+    }
+    if (findDef(&cc, &name->as.symbol.text) != NONE) {
+      pushNameError(&cc, name, EEXPR_SCHEMA_ERR_DUPLICATE_NAME);
+      continue;
+    }
+    schemaDef def = {.name = addText(&cc, &name->as.symbol.text), .nameLen = (uint32_t)name->as.symbol.text.len, .node = NONE};
+    types[cc.defs.len] = type;
+    nameLocs[cc.defs.len] = name->loc;
+    dynarr_push_schemaDef(&cc.defs, &def);
+  }
+  for (uint32_t d = 0; d < cc.defs.len; ++d) {
+    cc.def = d;
+    cc.defs.data[d].node = compileType(&cc, types[d]);
+  }
+  if (cc.errors.len == 0) {
+    computeAccepts(&cc);
+    checkCycles(&cc, nameLocs);
+  }
+  free(types);
+  free(nameLocs);
+
+  *nErrors = cc.errors.len;
+  if (cc.errors.len != 0) {
+    *errors = cc.errors.data;
+    dynarr_deinit_schemaDef(&cc.defs);
+    dynarr_deinit_schemaNode(&cc.nodes);
+    dynarr_deinit_uint32_t(&cc.kids);
+    dynarr_deinit_schemaField(&cc.fields);
+    dynarr_deinit_schemaRange(&cc.ranges);
+    free(cc.text.bytes);
+    return NULL;
+  }
+  dynarr_deinit_schemaError(&cc.errors);
+  eexpr_schema* self = malloc(sizeof(eexpr_schema));
+  checkOom(self);
+  self->nDefs = (uint32_t)cc.defs.len;
+  self->defs = cc.defs.data;
+  self->nodes = cc.nodes.data;
+  self->kids = cc.kids.data;
+  self->fields = cc.fields.data;
+  self->ranges = cc.ranges.data;
+  self->text = cc.text.bytes;
+  return self;
+}
+
+void schema_del(eexpr_schema* self) {
+  if (self == NULL) { return; }
+  free(self->defs);
+  free(self->nodes);
+  free(self->kids);
+  free(self->fields);
+  free(self->ranges);
+  free(self->text);
+  free(self);
+}
+
+
+//////////////////////////////////// Validating Eexprs ////////////////////////////////////
+
+typedef struct validator {
+  const eexpr_schema* schema;
+  size_t cap;
+  size_t n;
+  schemaError* errors;
+  bool valid;
+  bool full; // the errors array is full, so there is nothing more to do
+  uint32_t quiet; // non-zero while trying out the alternatives of a `oneOf`: nothing is reported, and the first mismatch is the end of it
+} validator;
+
+static
+bool giveUp(const validator* v) {
+  return v->quiet != 0 || v->full;
+}
+
+// Always returns false, so that a mismatch can be reported and returned in one go.
+static
+bool fail(validator* v, eexpr_span loc, eexpr_schemaErrorType type, uint32_t def, union eexpr_schemaErrorInfo as) {
+  if (v->quiet != 0) { return false; }
+  v->valid = false;
+  if (v->n < v->cap) {
+    schemaError* err = &v->errors[v->n++];
+    err->loc = loc;
+    err->type = type;
+    err->def = def;
+    err->as = as;
+  }
+  if (v->n == v->cap) { v->full = true; }
+  return false;
+}
+
+static const union eexpr_schemaErrorInfo noInfo = {.length = 0};
+
+static bool check(validator* v, uint32_t node, uint32_t def, const eexpr* e);
+
+static
+bool checkEach(validator* v, uint32_t node, uint32_t def, size_t n, eexpr* const* items) {
+  bool ok = true;
+  for (size_t i = 0; i < n; ++i) {
+    if (!check(v, node, def, items[i])) {
+      ok = false;
+      if (giveUp(v)) { return false; }
+    }
+  }
+  return ok;
+}
+
+static
+uint32_t findField(const eexpr_schema* s, const schemaNode* record, const str* key) {
+  uint32_t lo = record->a, hi = record->a + record->b;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    const schemaField* f = &s->fields[mid];
+    int c = compareText(f->keyLen, &s->text[f->key], key->len, key->bytes);
+    if (c == 0) { return mid; }
+    if (c < 0) { lo = mid + 1; }
+    else { hi = mid; }
+  }
+  return NONE;
+}
+
+static
+bool checkRecord(validator* v, const schemaNode* record, uint32_t def, const eexpr* e) {
+  const eexpr_schema* s = v->schema;
+  eexpr* const* items;
+  size_t n;
+  if (e->type == EEXPR_BLOCK) {
+    items = e->as.list.data;
+    n = e->as.list.len;
+  }
+  else {
+    n = wrappedItems(e, &items);
+  }
+  bool ok = true;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const eexpr* key;
+    const eexpr* value;
+    if (!keyValue(items[i], &key, &value)) {
+      // either a pair with the wrong kind of key, or not a pair at all
+      union eexpr_schemaErrorInfo as = {.expected = key != NULL ? BIT(EEXPR_SYMBOL) : BIT(EEXPR_COLON)};
+      ok = fail(v, key != NULL ? key->loc : items[i]->loc, EEXPR_SCHEMA_ERR_WRONG_TYPE, def, as);
+      if (giveUp(v)) { return false; }
+      continue;
+    }
+    uint32_t field = findField(s, record, &key->as.symbol.text);
+    uint64_t bit = field == NONE ? 0 : (uint64_t)1 << (field - record->a);
+    if (field == NONE || (seen & bit)) {
+      union eexpr_schemaErrorInfo as;
+      as.name.nBytes = key->as.symbol.text.len;
+      as.name.utf8str = key->as.symbol.text.bytes;
+      eexpr_schemaErrorType type = field == NONE ? EEXPR_SCHEMA_ERR_UNKNOWN_FIELD : EEXPR_SCHEMA_ERR_DUPLICATE_FIELD;
+      ok = fail(v, key->loc, type, def, as);
+      if (giveUp(v)) { return false; }
+      continue;
+    }
+    seen |= bit;
+    if (!check(v, s->fields[field].node, def, value)) {
+      ok = false;
+      if (giveUp(v)) { return false; }
+    }
+  }
+  for (uint32_t i = 0; i < record->b; ++i) {
+    const schemaField* f = &s->fields[record->a + i];
+    if (f->optional || (seen & ((uint64_t)1 << i))) { continue; }
+    union eexpr_schemaErrorInfo as;
+    as.name.nBytes = f->keyLen;
+    as.name.utf8str = &s->text[f->key];
+    ok = fail(v, e->loc, EEXPR_SCHEMA_ERR_MISSING_FIELD, def, as);
+    if (giveUp(v)) { return false; }
+  }
+  return ok;
+}
+
+// A quick look at whether a node might match, without going into subexprs;
+//   except that a list (or colon) of fixed length also has its first subexpr looked at, to pick out tags like the `server` in `space [is server, …]`.
+static
+bool mightMatch(const eexpr_schema* s, uint32_t node, const eexpr* e, bool top) {
+  const schemaNode* n = &s->nodes[node];
+  if ((n->accepts & BIT(e->type)) == 0) { return false; }
+  switch ((schemaOp)n->op) {
+    case SCHEMA_IS_TEXT: {
+      const str* text = e->type == EEXPR_SYMBOL ? &e->as.symbol.text : payload_plainString(e);
+      return text != NULL && compareText(text->len, text->bytes, n->b, &s->text[n->a]) == 0;
+    }
+    case SCHEMA_TUPLE: {
+      if (!top) { return true; }
+      eexpr* const* items = e->type == EEXPR_COLON ? e->as.pair : e->as.list.data;
+      size_t nItems = e->type == EEXPR_COLON ? 2 : e->as.list.len;
+      return nItems == n->b && (nItems == 0 || mightMatch(s, s->kids[n->a], items[0], false));
+    }
+    case SCHEMA_ALT: {
+      for (uint32_t i = 0; i < n->b; ++i) {
+        if (mightMatch(s, s->kids[n->a + i], e, top)) { return true; }
+      }
+      return false;
+    }
+    case SCHEMA_REF: return mightMatch(s, s->defs[n->a].node, e, top);
+    default: return true;
+  }
+}
+
+// Alternatives that cannot match (see `mightMatch`) are skipped outright.
+// If that leaves only one, it is checked as though it were the only type given, so its errors are reported as usual;
+//   likewise if none are left, but only one was for this type of eexpr.
+// Otherwise, the alternatives are tried in turn without reporting anything.
+static
+bool checkAlt(validator* v, const schemaNode* alt, uint32_t def, const eexpr* e) {
+  const eexpr_schema* s = v->schema;
+  uint32_t only = NONE, onlyTyped = NONE;
+  size_t count = 0, countTyped = 0;
+  for (uint32_t i = 0; i < alt->b; ++i) {
+    uint32_t kid = s->kids[alt->a + i];
+    if ((s->nodes[kid].accepts & BIT(e->type)) == 0) { continue; }
+    if (countTyped++ == 0) { onlyTyped = kid; }
+    if (mightMatch(s, kid, e, true) && count++ == 0) { only = kid; }
+  }
+  if (count == 1) { return check(v, only, def, e); }
+  if (count == 0 && countTyped == 1) { return check(v, onlyTyped, def, e); }
+  if (count == 0) { return fail(v, e->loc, EEXPR_SCHEMA_ERR_NO_ALTERNATIVE, def, noInfo); }
+  v->quiet += 1;
+  for (uint32_t i = 0; i < alt->b; ++i) {
+    uint32_t kid = s->kids[alt->a + i];
+    if (mightMatch(s, kid, e, true) && check(v, kid, def, e)) {
+      v->quiet -= 1;
+      return true;
+    }
+  }
+  v->quiet -= 1;
+  return fail(v, e->loc, EEXPR_SCHEMA_ERR_NO_ALTERNATIVE, def, noInfo);
+}
+
+static
+bool inRange(const schemaRange* r, int64_t value) {
+  return (!r->hasLo || r->iLo <= value) && (!r->hasHi || value <= r->iHi);
+}
+
+static
+bool check(validator* v, uint32_t node, uint32_t def, const eexpr* e) {
+  const eexpr_schema* s = v->schema;
+  const schemaNode* n = &s->nodes[node];
+  if ((n->accepts & BIT(e->type)) == 0) {
+    union eexpr_schemaErrorInfo as = {.expected = n->accepts};
+    return fail(v, e->loc, EEXPR_SCHEMA_ERR_WRONG_TYPE, def, as);
+  }
+  switch ((schemaOp)n->op) {
+    case SCHEMA_ANY: case SCHEMA_TYPE: return true;
+    case SCHEMA_SYMBOL: {
+      const str* text = &e->as.symbol.text;
+      if (n->a == NONE || payload_glob(n->b, &s->text[n->a], text->len, text->bytes)) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_NO_MATCH, def, noInfo);
+    }
+    case SCHEMA_STRING: {
+      if (n->a == NONE) { return true; }
+      const str* text = payload_plainString(e);
+      if (text != NULL && payload_glob(n->b, &s->text[n->a], text->len, text->bytes)) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_NO_MATCH, def, noInfo);
+    }
+    case SCHEMA_IS_TEXT: {
+      const str* text = e->type == EEXPR_SYMBOL ? &e->as.symbol.text : payload_plainString(e);
+      if (text != NULL && compareText(text->len, text->bytes, n->b, &s->text[n->a]) == 0) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_NOT_EQUAL, def, noInfo);
+    }
+    case SCHEMA_IS_INT: {
+      lexer_forceEexpr((eexpr*)e);
+      bool integral;
+      int64_t value;
+      if (payload_asInt(&e->as.number, &integral, &value) && value == s->ranges[n->a].iLo) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_NOT_EQUAL, def, noInfo);
+    }
+    case SCHEMA_INT: {
+      lexer_forceEexpr((eexpr*)e);
+      bool integral;
+      int64_t value;
+      bool fits = payload_asInt(&e->as.number, &integral, &value);
+      if (!integral) { return fail(v, e->loc, EEXPR_SCHEMA_ERR_NOT_INTEGER, def, noInfo); }
+      if (fits && (n->a == NONE || inRange(&s->ranges[n->a], value))) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_OUT_OF_RANGE, def, noInfo);
+    }
+    case SCHEMA_NUMBER: {
+      lexer_forceEexpr((eexpr*)e);
+      const schemaRange* r = &s->ranges[n->a];
+      double value = payload_asDouble(&e->as.number);
+      if ((!r->hasLo || r->lo <= value) && (!r->hasHi || value <= r->hi)) { return true; }
+      return fail(v, e->loc, EEXPR_SCHEMA_ERR_OUT_OF_RANGE, def, noInfo);
+    }
+    case SCHEMA_LIST: {
+      if (n->a == NONE) { return true; }
+      eexpr* const* items;
+      size_t nItems = wrappedItems(e, &items);
+      return checkEach(v, n->a, def, nItems, items);
+    }
+    case SCHEMA_WRAP: {
+      if (e->as.wrap == NULL) {
+        union eexpr_schemaErrorInfo as = {.length = 1};
+        return fail(v, e->loc, EEXPR_SCHEMA_ERR_WRONG_LENGTH, def, as);
+      }
+      return check(v, n->a, def, e->as.wrap);
+    }
+    case SCHEMA_EACH: {
+      return checkEach(v, n->a, def, e->as.list.len, e->as.list.data);
+    }
+    case SCHEMA_TUPLE: {
+      eexpr* const* items = e->type == EEXPR_COLON ? e->as.pair : e->as.list.data;
+      size_t nItems = e->type == EEXPR_COLON ? 2 : e->as.list.len;
+      if (nItems != n->b) {
+        union eexpr_schemaErrorInfo as = {.length = n->b};
+        return fail(v, e->loc, EEXPR_SCHEMA_ERR_WRONG_LENGTH, def, as);
+      }
+      bool ok = true;
+      for (size_t i = 0; i < nItems; ++i) {
+        if (!check(v, s->kids[n->a + i], def, items[i])) {
+          ok = false;
+          if (giveUp(v)) { return false; }
+        }
+      }
+      return ok;
+    }
+    case SCHEMA_RECORD: return checkRecord(v, n, def, e);
+    case SCHEMA_ALT: return checkAlt(v, n, def, e);
+    case SCHEMA_REF: return check(v, s->defs[n->a].node, n->a, e);
+  }
+  assert(false);
+  return false;
+}
+
+bool schema_validate(const eexpr_schema* self, uint32_t def, size_t n, eexpr* const* eexprs, size_t* nErrors, eexpr_schemaError* errors) {
+  assert(def < self->nDefs);
+  validator v = {.schema = self, .cap = *nErrors, .n = 0, .errors = errors, .valid = true, .full = false, .quiet = 0};
+  for (size_t i = 0; i < n && !v.full; ++i) {
+    check(&v, self->defs[def].node, def, eexprs[i]);
+  }
+  *nErrors = v.n;
+  return v.valid;
+}
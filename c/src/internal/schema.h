@@ -0,0 +1,75 @@
+#ifndef INTERNAL_SCHEMA_H
+#define INTERNAL_SCHEMA_H
+
+#include "eexpr.h"
+
+#include "types.h"
+
+
+// What a `schemaNode` checks, with the meaning of its operands.
+// An operand of `EEXPR_SCHEMA_NONE` leaves the contents unconstrained.
+typedef enum schemaOp {
+  SCHEMA_ANY,
+  SCHEMA_TYPE, // any eexpr of type `.eType`
+  SCHEMA_SYMBOL, // a symbol matching the glob pattern of `.b` bytes at `.a` in `eexpr_schema.text`
+  SCHEMA_STRING, // a string without splices matching the glob pattern, as above (any string at all if there is no pattern)
+  SCHEMA_IS_TEXT, // a symbol or string (per `.eType`) of exactly the `.b` bytes at `.a` in `eexpr_schema.text`
+  SCHEMA_IS_INT, // an int equal to `.ranges[.a].iLo`
+  SCHEMA_INT, // an int within `.ranges[.a]`
+  SCHEMA_NUMBER, // a number within `.ranges[.a]`
+  SCHEMA_LIST, // a bracket list of `.a`
+  SCHEMA_WRAP, // an `.eType` wrapper around `.a`
+  SCHEMA_EACH, // an `.eType` list of `.a`
+  SCHEMA_TUPLE, // an `.eType` list (or colon) of `.b` subexprs, matching `.kids[.a]` onwards
+  SCHEMA_RECORD, // a brace or block of `key: value`, with the `.b` fields from `.fields[.a]` onwards (sorted by key)
+  SCHEMA_ALT, // any of the `.b` nodes from `.kids[.a]` onwards
+  SCHEMA_REF // whatever definition `.a` is
+} schemaOp;
+
+typedef struct schemaNode {
+  uint8_t op; // a `schemaOp`
+  uint8_t eType; // an `eexpr_type`
+  uint16_t accepts; // the types of eexpr that this node could possibly match, as a bitset of `1 << eexpr_type`
+  uint32_t a;
+  uint32_t b;
+} schemaNode;
+
+typedef struct schemaRange {
+  bool hasLo;
+  bool hasHi;
+  int64_t iLo, iHi; // for `SCHEMA_INT` and `SCHEMA_IS_INT`
+  double lo, hi; // for `SCHEMA_NUMBER`
+} schemaRange;
+
+typedef struct schemaField {
+  uint32_t key; // offset into `eexpr_schema.text`
+  uint32_t keyLen;
+  uint32_t node;
+  bool optional;
+} schemaField;
+
+typedef struct schemaDef {
+  uint32_t name; // offset into `eexpr_schema.text`
+  uint32_t nameLen;
+  uint32_t node;
+} schemaDef;
+
+// All the arrays are owned, and nodes refer to each other by index.
+struct eexpr_schema {
+  uint32_t nDefs;
+  schemaDef* defs;
+  schemaNode* nodes;
+  uint32_t* kids;
+  schemaField* fields;
+  schemaRange* ranges;
+  uint8_t* text; // names, keys, patterns and `is` text, back-to-back
+};
+
+eexpr_schema* schema_compile(size_t nDefs, eexpr* const* defs, size_t* nErrors, eexpr_schemaError** errors);
+
+void schema_del(eexpr_schema* self);
+
+bool schema_validate(const eexpr_schema* self, uint32_t def, size_t n, eexpr* const* eexprs, size_t* nErrors, eexpr_schemaError* errors);
+
+
+#endif
@@ -0,0 +1,114 @@
+#include "share.h"
+
+#include <stdlib.h>
+
+#include "common.h"
+#include "hash.h"
+
+
+//////////////////////////////////// Share Table ////////////////////////////////////
+
+eexpr_shareTable* shareTable_new(void) {
+  eexpr_shareTable* self = malloc(sizeof(eexpr_shareTable));
+  checkOom(self);
+  self->nEexprs = 0;
+  self->nSlots = 256;
+  self->slots = calloc(self->nSlots, sizeof(eexpr*));
+  checkOom(self->slots);
+  self->digests = malloc(self->nSlots * sizeof(uint64_t));
+  checkOom(self->digests);
+  return self;
+}
+
+// The slot holding an eexpr structurally identical to `self`, or else the empty slot where it would go.
+// Since the subexprs of `self` have already been shared, comparing them is only a pointer comparison (see `hash_equal`).
+static
+size_t shareTable_probe(const eexpr_shareTable* self, const eexpr* e, uint64_t digest) {
+  size_t mask = self->nSlots - 1;
+  for (size_t i = digest & mask; true; i = (i + 1) & mask) {
+    const eexpr* slot = self->slots[i];
+    if (slot == NULL) { return i; }
+    if (self->digests[i] == digest && hash_equal(slot, e, false)) { return i; }
+  }
+}
+
+static
+void shareTable_grow(eexpr_shareTable* self) {
+  size_t nOld = self->nSlots;
+  eexpr** old = self->slots;
+  uint64_t* oldDigests = self->digests;
+  self->nSlots *= 2;
+  self->slots = calloc(self->nSlots, sizeof(eexpr*));
+  checkOom(self->slots);
+  self->digests = malloc(self->nSlots * sizeof(uint64_t));
+  checkOom(self->digests);
+  size_t mask = self->nSlots - 1;
+  for (size_t j = 0; j < nOld; ++j) {
+    if (old[j] == NULL) { continue; }
+    // everything in the table is distinct, so there is no need to compare, only to find an empty slot
+    size_t i = oldDigests[j] & mask;
+    while (self->slots[i] != NULL) { i = (i + 1) & mask; }
+    self->slots[i] = old[j];
+    self->digests[i] = oldDigests[j];
+  }
+  free(old);
+  free(oldDigests);
+}
+
+
+//////////////////////////////////// Hash-Consing ////////////////////////////////////
+
+// The subexprs of an eexpr being shared are already canonical, so their addresses stand in for their digests.
+static
+uint64_t sharedDigest(void* ctx, const eexpr* child) {
+  (void)ctx;
+  return (uint64_t)(uintptr_t)child;
+}
+
+eexpr* share_eexpr(engine* st, eexpr* self) {
+  if (st->shareSpans) {
+    dynarr_push_eexpr_span(&st->spanStream, &self->loc);
+  }
+  switch (self->type) {
+    case EEXPR_SYMBOL: case EEXPR_NUMBER: break;
+    case EEXPR_STRING: {
+      for (size_t i = 0; i < self->as.string.parts.len; ++i) {
+        strTemplPart* part = &self->as.string.parts.data[i];
+        if (part->subexpr != NULL) { part->subexpr = share_eexpr(st, part->subexpr); }
+      }
+    }; break;
+    case EEXPR_PAREN: case EEXPR_BRACK: case EEXPR_BRACE: case EEXPR_PREDOT: {
+      if (self->as.wrap != NULL) { self->as.wrap = share_eexpr(st, self->as.wrap); }
+    }; break;
+    case EEXPR_BLOCK: case EEXPR_CHAIN: case EEXPR_SPACE: case EEXPR_COMMA: case EEXPR_SEMICOLON: case EEXPR_MIXFIX: {
+      for (size_t i = 0; i < self->as.list.len; ++i) {
+        self->as.list.data[i] = share_eexpr(st, self->as.list.data[i]);
+      }
+    }; break;
+    case EEXPR_ELLIPSIS: {
+      if (self->as.ellipsis[0] != NULL) { self->as.ellipsis[0] = share_eexpr(st, self->as.ellipsis[0]); }
+      if (self->as.ellipsis[1] != NULL) { self->as.ellipsis[1] = share_eexpr(st, self->as.ellipsis[1]); }
+    }; break;
+    case EEXPR_COLON: {
+      self->as.pair[0] = share_eexpr(st, self->as.pair[0]);
+      self->as.pair[1] = share_eexpr(st, self->as.pair[1]);
+    }; break;
+  }
+  // hashing also decodes any lazy payload, which is what the table compares
+  uint64_t digest = hash_node(self, false, sharedDigest, NULL);
+  eexpr_shareTable* table = st->shared;
+  size_t i = shareTable_probe(table, self, digest);
+  if (table->slots[i] != NULL) {
+    // all of its subexprs are shared by now, so this frees only the one eexpr (and its payload)
+    eexpr_del(self);
+    return table->slots[i];
+  }
+  self->flags |= FLAG_SHARED;
+  table->slots[i] = self;
+  table->digests[i] = digest;
+  table->nEexprs += 1;
+  if (openTable_shouldGrow(table->nEexprs, table->nSlots)) {
+    shareTable_grow(table);
+  }
+  return self;
+}
@@ -0,0 +1,25 @@
+#ifndef INTERNAL_SHARE_H
+#define INTERNAL_SHARE_H
+
+#include "eexpr.h"
+
+#include "engine.h"
+
+
+// Every eexpr in the table is flagged `FLAG_SHARED`, and so are all of its subexprs (since they were shared first).
+struct eexpr_shareTable {
+  size_t nEexprs;
+  size_t nSlots; // always a power of two
+  eexpr** slots; // owned, as are the eexprs they point to; open-addressed by digest, `NULL` for an empty slot
+  uint64_t* digests; // owned; parallel to `slots`, and only meaningful where the slot is not `NULL`
+};
+
+eexpr_shareTable* shareTable_new(void);
+
+// Replace a freshly-parsed eexpr (and, first, its subexprs) with the structurally identical ones from `st->shared`,
+//   adding any that are not there yet, and freeing the duplicates.
+// When `st->shareSpans` is set, the span of each eexpr is also pushed onto `st->spanStream`, in preorder.
+eexpr* share_eexpr(engine* st, eexpr* self);
+
+
+#endif
@@ -1,15 +1,24 @@
 #include "types.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "parameters.h"
+
+#define TYPE size_t
+#include "dynarr.h"
 
 
 void token_deinit(eexpr_token* tok) {
   if (tok == NULL) { return; }
+  if (tok->flags & FLAG_LAZY) { return; } // payload is borrowed from the input
   switch (tok->type) {
     case EEXPR_TOK_STRING: {
       if (tok->as.string.text.bytes != NULL) { free(tok->as.string.text.bytes); }
     }; break;
     case EEXPR_TOK_SYMBOL: {
+      if (tok->as.symbol.id != EEXPR_NO_SYMBOL) { break; } // text is borrowed from the symbol table
       if (tok->as.symbol.text.bytes != NULL) { free(tok->as.symbol.text.bytes); }
     }; break;
     case EEXPR_TOK_NUMBER: {
@@ -19,3 +28,118 @@ void token_deinit(eexpr_token* tok) {
     default: /* do nothing */ break;
   }
 }
+
+
+eexpr* eexprList_new(eexpr_type type, size_t n, eexpr* const* items) {
+  size_t extra = n <= LIST_SMALL ? 0 : n * sizeof(eexpr*);
+  eexpr* self = malloc(sizeof(eexpr) + extra);
+  checkOom(self);
+  self->type = type;
+  self->as.list.len = n;
+  self->as.list.data = n <= LIST_SMALL ? self->as.list.small : (eexpr**)(self + 1);
+  if (n != 0) {
+    memcpy(self->as.list.data, items, n * sizeof(eexpr*));
+  }
+  return self;
+}
+
+
+eexpr_lineIndex* lineIndex_new(str input) {
+  eexpr_lineIndex* self = malloc(sizeof(eexpr_lineIndex));
+  checkOom(self);
+  dynarr_size_t starts; dynarr_init_size_t(&starts, 64);
+  self->cap = starts.cap;
+  self->starts = starts.data;
+  lineIndex_rebuild(self, input);
+  return self;
+}
+
+void lineIndex_rebuild(eexpr_lineIndex* self, str input) {
+  self->input = input;
+  dynarr_size_t starts = {.cap = self->cap, .len = 0, .data = self->starts};
+  size_t start = 0;
+  dynarr_push_size_t(&starts, &start);
+  for (size_t i = 0; i < input.len; ++i) {
+    uint8_t c = input.bytes[i];
+    // all newline characters are single bytes (see `decodeNewline`), so there is no need to decode utf8 here
+    if (!isNewlineChar(c)) { continue; }
+    char32_t lookahead[2] = {c, i + 1 < input.len ? input.bytes[i+1] : UCHAR_NULL};
+    i += newlineSize(decodeNewline(lookahead)) - 1;
+    start = i + 1;
+    dynarr_push_size_t(&starts, &start);
+  }
+  self->nLines = starts.len;
+  self->cap = starts.cap;
+  self->starts = starts.data;
+}
+
+size_t lineIndex_lineOf(const eexpr_lineIndex* self, size_t byte) {
+  // find the last line that starts at or before `byte`
+  size_t lo = 0, hi = self->nLines;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->starts[mid] <= byte) { lo = mid; }
+    else { hi = mid; }
+  }
+  return lo;
+}
+
+
+// FNV-1a; symbols are short, so anything fancier would not pay for itself
+static
+uint32_t symtab_hash(str text) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < text.len; ++i) {
+    h = (h ^ text.bytes[i]) * 16777619u;
+  }
+  return h;
+}
+
+bool openTable_shouldGrow(size_t nEntries, size_t nSlots) {
+  return 2 * nEntries > nSlots;
+}
+
+// The slot holding the given text, or else the empty slot where it would go.
+static
+size_t symtab_probe(const eexpr_symtab* self, str text) {
+  size_t mask = self->nSlots - 1;
+  for (size_t i = symtab_hash(text) & mask; true; i = (i + 1) & mask) {
+    uint32_t slot = self->slots[i];
+    if (slot == 0) { return i; }
+    if (str_eq(self->symbols.data[slot - 1], text)) { return i; }
+  }
+}
+
+eexpr_symtab* symtab_new(void) {
+  eexpr_symtab* self = malloc(sizeof(eexpr_symtab));
+  checkOom(self);
+  dynarr_init_str(&self->symbols, 64);
+  self->nSlots = 128;
+  self->slots = calloc(self->nSlots, sizeof(uint32_t));
+  checkOom(self->slots);
+  return self;
+}
+
+uint32_t symtab_find(const eexpr_symtab* self, str text) {
+  uint32_t slot = self->slots[symtab_probe(self, text)];
+  return slot == 0 ? EEXPR_NO_SYMBOL : slot - 1;
+}
+
+uint32_t symtab_intern(eexpr_symtab* self, str text) {
+  size_t i = symtab_probe(self, text);
+  if (self->slots[i] != 0) { return self->slots[i] - 1; }
+  uint32_t id = self->symbols.len;
+  str copy = str_clone(text);
+  dynarr_push_str(&self->symbols, &copy);
+  self->slots[i] = id + 1;
+  if (openTable_shouldGrow(self->symbols.len, self->nSlots)) {
+    free(self->slots);
+    self->nSlots *= 2;
+    self->slots = calloc(self->nSlots, sizeof(uint32_t));
+    checkOom(self->slots);
+    for (uint32_t j = 0; j < self->symbols.len; ++j) {
+      self->slots[symtab_probe(self, self->symbols.data[j])] = j + 1;
+    }
+  }
+  return id;
+}
@@ -10,7 +10,8 @@
 //////////////////////////////////// Payloads ////////////////////////
 
 typedef struct eexprSymbol {
-  str text; // owned
+  str text; // owned, unless interned
+  uint32_t id; // `EEXPR_NO_SYMBOL` unless interned, in which case `.text` is borrowed from the symbol table
 } eexprSymbol;
 
 typedef struct eexprNumber {
@@ -33,29 +34,76 @@ typedef eexpr* eexpr_p;
 #define TYPE eexpr_p
 #include "dynarr.h"
 
+// Lists never grow once the parser has built them, so they are allocated along with the eexpr that holds them (see `eexprList_new`).
+// Short lists (which are the majority of space and chain expressions) fit entirely inside the eexpr in `.small`,
+//   longer ones are placed just past the end of the eexpr struct.
+// Either way, there is no separate allocation to free, but it also means list-shaped eexprs must not be copied by value.
+#define LIST_SMALL 3
+typedef struct eexprList {
+  size_t len;
+  eexpr** data; // points into the same allocation as the eexpr holding this list
+  eexpr* small[LIST_SMALL];
+} eexprList;
+
+// The args come first so that mixfix eexprs can be allocated with `eexprList_new` just like the other list-shaped eexprs.
+typedef struct eexprMixfix {
+  eexprList args;
+  uint32_t op; // index into the definitions of the `eexpr_mixfixTable` that built it
+} eexprMixfix;
+
+
+//////////////////////////////////// Flags ////////////////////////
+
+// Bits for the `.flags` of tokens and eexprs.
+
+// The payload has not been decoded yet, and refers to source text instead:
+//   a number holds its source text in `.as.lazy`,
+//   and each text part of a string holds the source text of the token it came from (delimiters and all).
+// Source text is borrowed from the parser input.
+// Decoding replaces the payload with the usual owned data and clears the flag.
+// Shared and built eexprs (`FLAG_SHARED`, `FLAG_ARENA`) never have it, so reading their payloads never writes to them.
+#define FLAG_LAZY 0x01
+
+// Only for eexprs: the eexpr belongs to an `eexpr_shareTable` (see `share_eexpr`), and may occur in many places.
+// It must not be changed, and is only freed along with the table, so `eexpr_del` and `eexpr_deinit` leave it alone.
+#define FLAG_SHARED 0x08
+
+// Only for eexprs: the eexpr, its payload and its list of subexprs (if any) were allocated from an `eexpr_arena`, and are freed along with it.
+// So, `eexpr_del` and `eexpr_deinit` leave it alone, as for `FLAG_SHARED`.
+#define FLAG_ARENA 0x10
+
 
 //////////////////////////////////// Eexprs ////////////////////////
 
 struct eexpr {
-  eexpr_loc loc;
+  eexpr_span loc;
   eexpr_type type;
+  uint8_t flags;
   union eexprData {
     eexprSymbol symbol;
     eexprNumber number;
+    str lazy; // see `FLAG_LAZY`
     eexprStrTempl string;
     eexpr* wrap; // paren, bracket, brace, predot
-    dynarr_eexpr_p list; // chain, space, comma, semicolon, block
+    eexprList list; // chain, space, comma, semicolon, block
+    eexprMixfix mixfix;
     eexpr* pair[2]; // non-nullable pointers
     eexpr* ellipsis[2]; // nullable pointers
   } as;
 };
 
 
+// Allocate a list-shaped eexpr holding a copy of the `n` children in `items`.
+// Only the list itself is initialized; location and flags are left to the caller.
+eexpr* eexprList_new(eexpr_type type, size_t n, eexpr* const* items);
+
+
 //////////////////////////////////// Tokens ////////////////////////
 
 struct eexpr_token {
-  eexpr_loc loc;
+  eexpr_span loc;
   eexpr_tokenType type;
+  uint8_t flags;
   union tokenData {
     eexprSymbol symbol;
     struct token_unknownSpace {
@@ -63,6 +111,7 @@ struct eexpr_token {
       size_t size;
     } unknownSpace;
     eexprNumber number;
+    str lazy; // see `FLAG_LAZY`
     struct token_string {
       str text; // owned
       eexpr_stringType splice;
@@ -84,4 +133,47 @@ struct eexpr_token {
 void token_deinit(eexpr_token* tok);
 
 
+//////////////////////////////////// Line Index ////////////////////////
+
+struct eexpr_lineIndex {
+  str input; // borrowed, needed to count columns
+  size_t nLines;
+  size_t cap; // capacity of `starts`
+  size_t* starts; // owned, byte offset of the start of each line (so `.starts[0] == 0`)
+};
+
+// Scan the input for newlines (in the same way the lexer splits lines) to build a line index.
+eexpr_lineIndex* lineIndex_new(str input);
+
+// Build the index over again for a new input, re-using the memory of the old one.
+void lineIndex_rebuild(eexpr_lineIndex* self, str input);
+
+// The (zero-indexed) line containing the given byte offset.
+size_t lineIndex_lineOf(const eexpr_lineIndex* self, size_t byte);
+
+
+//////////////////////////////////// Symbol Table ////////////////////////
+
+// The symbol table and share tables (see `share.h`) are both open-addressed with linear probing,
+//   and double their slots once more than half of them are taken, so that probe sequences stay short.
+bool openTable_shouldGrow(size_t nEntries, size_t nSlots);
+
+#define TYPE str
+#include "dynarr.h"
+
+struct eexpr_symtab {
+  dynarr_str symbols; // indexed by id, each owned
+  size_t nSlots; // always a power of two
+  uint32_t* slots; // owned, open-addressed hash table holding `id + 1`, or zero for an empty slot
+};
+
+eexpr_symtab* symtab_new(void);
+
+// The id of the given text, or `EEXPR_NO_SYMBOL` if it has not been interned.
+uint32_t symtab_find(const eexpr_symtab* self, str text);
+
+// The id of the given text, adding a copy of it to the table if it is not already there.
+uint32_t symtab_intern(eexpr_symtab* self, str text);
+
+
 #endif
@@ -171,7 +171,7 @@ str bigint_toDecimal(bigint val) {
   }
   bigint tmp = bigint_clone(val);
   str out; uint8_t* next; {
-    size_t maxBufLen = 1 + 9 * tmp.len;
+    size_t maxBufLen = 1 + 10 * tmp.len; // a 32-bit digit is worth up to ten decimal digits, plus one for the sign
     out.bytes = malloc(maxBufLen);
     checkOom(out.bytes);
     out.len = 0;
@@ -31,8 +31,7 @@ _dllist _dllist_cat(_dllist* l1, _dllist* l2) {
   return out;
 }
 
-_dllistNode* _dllist_insertBefore(_dllist* list, const void* elem, _dllistNode* node, size_t elemSize) {
-  _dllistNode* new = newNode(elem, elemSize);
+void _dllist_linkBefore(_dllist* list, _dllistNode* new, _dllistNode* node) {
   if (node == NULL) {
     new->prev = NULL;
     new->next = list->start;
@@ -47,11 +46,9 @@ _dllistNode* _dllist_insertBefore(_dllist* list, const void* elem, _dllistNode*
     else { list->start = new; }
     node->prev = new;
   }
-  return new;
 }
 
-_dllistNode* _dllist_insertAfter(_dllist* list, _dllistNode* node, const void* elem, size_t elemSize) {
-  _dllistNode* new = newNode(elem, elemSize);
+void _dllist_linkAfter(_dllist* list, _dllistNode* node, _dllistNode* new) {
   if (node == NULL) {
     new->next = NULL;
     new->prev = list->end;
@@ -66,31 +63,31 @@ _dllistNode* _dllist_insertAfter(_dllist* list, _dllistNode* node, const void* e
     else { list->end = new; }
     node->next = new;
   }
+}
+
+void _dllist_unlink(_dllist* list, _dllistNode* node) {
+  assert(node != NULL);
+  if (node->prev != NULL) { node->prev->next = node->next; }
+  else { list->start = node->next; }
+  if (node->next != NULL) { node->next->prev = node->prev; }
+  else { list->end = node->prev; }
+}
+
+_dllistNode* _dllist_insertBefore(_dllist* list, const void* elem, _dllistNode* node, size_t elemSize) {
+  _dllistNode* new = newNode(elem, elemSize);
+  _dllist_linkBefore(list, new, node);
+  return new;
+}
+
+_dllistNode* _dllist_insertAfter(_dllist* list, _dllistNode* node, const void* elem, size_t elemSize) {
+  _dllistNode* new = newNode(elem, elemSize);
+  _dllist_linkAfter(list, node, new);
   return new;
 }
 
 void _dllist_moveAfter(_dllist* dstList, _dllistNode* dstNode, _dllist* srcList, _dllistNode* srcNode) {
-  assert(srcNode != NULL);
-  // extricate the source node
-  if (srcNode->prev != NULL) { srcNode->prev->next = srcNode->next; }
-  else { srcList->start = srcNode->next; }
-  if (srcNode->next != NULL) { srcNode->next->prev = srcNode->prev; }
-  else { srcList->end = srcNode->prev; }
-  // place the source node into the destination list
-  if (dstNode == NULL) {
-    srcNode->next = NULL;
-    srcNode->prev = dstList->end;
-    if (dstList->end != NULL) { dstList->end->next = srcNode; }
-    else { dstList->start = srcNode; }
-    dstList->end = srcNode;
-  }
-  else {
-    srcNode->prev = dstNode;
-    srcNode->next = dstNode->next;
-    if (dstNode->next != NULL) { dstNode->next->prev = srcNode; }
-    else { dstList->end = srcNode; }
-    dstNode->next = srcNode;
-  }
+  _dllist_unlink(srcList, srcNode);
+  _dllist_linkAfter(dstList, dstNode, srcNode);
 }
 
 void _dllist_popStart(_dllist* list, void* into, size_t elemSize) {
@@ -61,6 +61,16 @@ _dllistNode* _dllist_insertAfter(_dllist* list, _dllistNode* node, const void* e
 // Ownership of the memory for the node is transferred from the source list to the destination list.
 void _dllist_moveAfter(_dllist* dstList, _dllistNode* dstNode, _dllist* srcList, _dllistNode* srcNode);
 
+// Link a node into a list directly before/after the given node, as in `_dllist_insertBefore`/`_dllist_insertAfter`.
+// The new node's memory is not managed by the list: it must be unlinked again before the list is deleted or popped from.
+// This is for callers that allocate nodes themselves (e.g. from a pool).
+void _dllist_linkBefore(_dllist* list, _dllistNode* new, _dllistNode* node);
+void _dllist_linkAfter(_dllist* list, _dllistNode* node, _dllistNode* new);
+
+// Remove a node from a list without freeing it.
+// It is undefined behavior for the node not to be in the list.
+void _dllist_unlink(_dllist* list, _dllistNode* node);
+
 // Removes the first element of a (non-null, non-empty) list and copies it into the given address.
 // If the address is NULL, the copy does not occur.
 // The memory used by the node is freed.
@@ -88,6 +98,9 @@ void _dllist_del(_dllist* list);
   #define _dllist_insertBefore_paste(T) dllist_insertBefore_ ## T
   #define _dllist_insertAfter_paste(T) dllist_insertAfter_ ## T
   #define _dllist_moveAfter_paste(T) dllist_moveAfter_ ## T
+  #define _dllist_linkBefore_paste(T) dllist_linkBefore_ ## T
+  #define _dllist_linkAfter_paste(T) dllist_linkAfter_ ## T
+  #define _dllist_unlink_paste(T) dllist_unlink_ ## T
   #define _dllist_popStart_paste(T) dllist_popStart_ ## T
   #define _dllist_popEnd_paste(T) dllist_popEnd_ ## T
   #define _dllist_del_paste(T) dllist_del_ ## T
@@ -100,6 +113,9 @@ void _dllist_del(_dllist* list);
   #define dllist_insertBefore(T) _dllist_insertBefore_paste(T)
   #define dllist_insertAfter(T) _dllist_insertAfter_paste(T)
   #define dllist_moveAfter(T) _dllist_moveAfter_paste(T)
+  #define dllist_linkBefore(T) _dllist_linkBefore_paste(T)
+  #define dllist_linkAfter(T) _dllist_linkAfter_paste(T)
+  #define dllist_unlink(T) _dllist_unlink_paste(T)
   #define dllist_popStart(T) _dllist_popStart_paste(T)
   #define dllist_popEnd(T) _dllist_popEnd_paste(T)
   #define dllist_del(T) _dllist_del_paste(T)
@@ -160,6 +176,19 @@ void dllist_moveAfter(TYPE)(dllist(TYPE)* dstList, dllistNode(TYPE)* dstNode, dl
   _dllist_moveAfter((_dllist*)dstList, (_dllistNode*)dstNode, (_dllist*)srcList, (_dllistNode*)srcNode);
 }
 
+static inline
+void dllist_linkBefore(TYPE)(dllist(TYPE)* list, dllistNode(TYPE)* new, dllistNode(TYPE)* node) {
+  _dllist_linkBefore((_dllist*)list, (_dllistNode*)new, (_dllistNode*)node);
+}
+static inline
+void dllist_linkAfter(TYPE)(dllist(TYPE)* list, dllistNode(TYPE)* node, dllistNode(TYPE)* new) {
+  _dllist_linkAfter((_dllist*)list, (_dllistNode*)node, (_dllistNode*)new);
+}
+static inline
+void dllist_unlink(TYPE)(dllist(TYPE)* list, dllistNode(TYPE)* node) {
+  _dllist_unlink((_dllist*)list, (_dllistNode*)node);
+}
+
 static inline
 void dllist_popStart(TYPE)(dllist(TYPE)* list, TYPE* into) {
   _dllist_popStart((_dllist*)list, (void*)into, sizeof(TYPE));
@@ -183,6 +212,9 @@ void dllist_del(TYPE)(dllist(TYPE)* list) {
   #undef dllist_insertBefore
   #undef dllist_insertAfter
   #undef dllist_moveAfter
+  #undef dllist_linkBefore
+  #undef dllist_linkAfter
+  #undef dllist_unlink
   #undef dllist_popStart
   #undef dllist_popEnd
   #undef dllist_del
@@ -194,6 +226,9 @@ void dllist_del(TYPE)(dllist(TYPE)* list) {
   #undef _dllist_insertBefore_paste
   #undef _dllist_insertAfter_paste
   #undef _dllist_moveAfter_paste
+  #undef _dllist_linkBefore_paste
+  #undef _dllist_linkAfter_paste
+  #undef _dllist_unlink_paste
   #undef _dllist_popStart_paste
   #undef _dllist_popEnd_paste
   #undef _dllist_del_paste
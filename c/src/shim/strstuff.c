@@ -50,6 +50,11 @@ bool isPrefixOf(str s, str prefix) {
   return true;
 }
 
+bool str_eq(str a, str b) {
+  if (a.len != b.len) { return false; }
+  return a.len == 0 || memcmp(a.bytes, b.bytes, a.len) == 0;
+}
+
 
 strBuilder strBuilder_new(size_t cap0) {
   assert(cap0 > 0);
@@ -59,23 +64,27 @@ strBuilder strBuilder_new(size_t cap0) {
   return out;
 }
 
+// make room for `more` bytes past the current length
+// this also works on a zero-capacity builder, such as one that was never allocated
+static
+void strBuilder_reserve(strBuilder* self, size_t more) {
+  if (self->len + more <= self->cap) { return; }
+  size_t cap = self->cap < 16 ? 16 : self->cap;
+  while (self->len + more > cap) { cap *= 2; }
+  self->bytes = realloc(self->bytes, cap * sizeof(uint8_t));
+  checkOom(self->bytes);
+  self->cap = cap;
+}
+
 void strBuilder_appendByte(strBuilder* self, uint8_t c) {
-  if (self->len == self->cap) {
-    self->bytes = realloc(self->bytes, 2 * self->cap * sizeof(uint8_t));
-    checkOom(self->bytes);
-  }
+  strBuilder_reserve(self, 1);
   self->bytes[self->len++] = c;
 }
 
 void strBuilder_append(strBuilder* self, str other) {
-  if (self->len + other.len > self->cap) {
-    while (self->len + other.len > self->cap) { self->cap *= 2; }
-    self->bytes = realloc(self->bytes, self->cap * sizeof(uint8_t));
-    checkOom(self->bytes);
-  }
-  for (size_t i = 0; i < other.len; ++i) {
-    self->bytes[self->len+i] = other.bytes[i];
-  }
+  if (other.len == 0) { return; }
+  strBuilder_reserve(self, other.len);
+  memcpy(&self->bytes[self->len], other.bytes, other.len);
   self->len += other.len;
 }
 
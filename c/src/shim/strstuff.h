@@ -26,6 +26,8 @@ str str_clone(const str orig);
 
 bool isPrefixOf(str s, str prefix);
 
+bool str_eq(str a, str b);
+
 
 //////////////////////////////////// String Builder ////////////////////////////////////
 
@@ -0,0 +1,28 @@
+#!/bin/bash
+set -e
+
+cmd="$(realpath ../../../bin/static/eexpr2json)"
+gold="$(realpath ../01-smoke-001)"
+out="$(mktemp -d)"
+trap 'rm -rf "$out"' EXIT
+
+# run from 01-smoke-001, since the filename appears in the output
+cd "$gold"
+for flag in -flazy-payloads -freparse -flazy-lines -fshare-subtrees; do
+  set +e
+  "$cmd" "$flag" \
+    -ddumpRawTokens "$out/rawTokens" \
+    -ddumpTokens "$out/tokens" \
+    -ddumpEexprs "$out/eexprs" \
+    input.eexpr >"$out/stdout" 2>"$out/stderr"
+  echo "$?" >"$out/exitcode"
+  set -e
+  for dump in exitcode stdout stderr rawTokens tokens eexprs; do
+    if diff -u "$gold/$dump.golden" "$out/$dump" >"$out/diff"; then
+      echo "$flag $dump: same"
+    else
+      echo "$flag $dump: differs"
+      cat "$out/diff"
+    fi
+  done
+done
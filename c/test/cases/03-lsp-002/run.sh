@@ -0,0 +1,12 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-lsp
+
+# frame each line as a message; lengths are in bytes
+export LC_ALL=C
+set +e
+while IFS= read -r line; do
+  printf 'Content-Length: %d\r\n\r\n%s' "${#line}" "$line"
+done <messages.jsonl | "$cmd" --debounce=60000
+echo "$?" >exitcode.output
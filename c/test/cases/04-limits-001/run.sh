@@ -0,0 +1,11 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+set +e
+"$cmd" \
+  -ldepth=3 \
+  -ddumpEexprs eexprs.output \
+  input.eexpr
+echo "$?" >exitcode.output
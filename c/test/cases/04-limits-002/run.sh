@@ -0,0 +1,11 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+set +e
+"$cmd" \
+  -ltokens=10 \
+  -ddumpRawTokens tokens.output \
+  input.eexpr
+echo "$?" >exitcode.output
@@ -0,0 +1,11 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+set +e
+"$cmd" \
+  -lmemory=4300 \
+  -ddumpEexprs eexprs.output \
+  input.eexpr
+echo "$?" >exitcode.output
@@ -0,0 +1,10 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+set +e
+"$cmd" \
+  -m spec.eexpr \
+  input.eexpr
+echo "$?" >exitcode.output
@@ -0,0 +1,19 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+# strip locations, which are the only thing printing is allowed to change
+function stripLocs() {
+  sed -E 's/"loc":\{"from":\{[^}]*\},"to":\{[^}]*\}\}//g' | grep -v '"filename"'
+}
+
+set +e
+"$cmd" -ddumpNormal normal.output input.eexpr >tree.output
+echo "$?" >exitcode.output
+stripLocs <tree.output >stripped.output && mv stripped.output tree.output
+# the printed text parses back to the same eexprs, and prints the same again
+"$cmd" -ddumpNormal reprint.output normal.output | stripLocs >retree.output
+diff tree.output retree.output >roundtrip.output
+diff normal.output reprint.output >>roundtrip.output
+rm reprint.output retree.output
@@ -0,0 +1,10 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-fix
+
+set +e
+"$cmd" input.eexpr fixed.output
+echo "$?" >exitcode.output
+# cutting the input into tiny chunks (even mid-template) gives the same result
+"$cmd" -c 3 input.eexpr | diff fixed.output - >chunked.output
@@ -0,0 +1,18 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-fix
+
+set +e
+for input in unix mac; do
+  "$cmd" "$input.eexpr" "$input.output"
+  echo "$input: $?" >>exitcode.output
+  size="$(wc -c <"$input.eexpr")"
+  for chunk in $(seq 1 "$size"); do
+    if "$cmd" -c "$chunk" "$input.eexpr" | cmp -s "$input.output" -; then
+      echo "$input -c $chunk: same"
+    else
+      echo "$input -c $chunk: differs"
+    fi
+  done
+done
@@ -0,0 +1,19 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-fix
+
+set +e
+"$cmd" input.eexpr fixed.output
+echo "$?" >exitcode.output
+# the lines after each error are fixed the same way however the input is cut into chunks
+size="$(wc -c <input.eexpr)"
+for chunk in $(seq 1 "$size"); do
+  "$cmd" -c "$chunk" input.eexpr 2>/dev/null | cmp -s fixed.output -
+  status=("${PIPESTATUS[@]}")
+  if [ "${status[1]}" = 0 ]; then
+    echo "-c $chunk: same, exit ${status[0]}"
+  else
+    echo "-c $chunk: differs, exit ${status[0]}"
+  fi
+done >chunked.output
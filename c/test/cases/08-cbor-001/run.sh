@@ -0,0 +1,10 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr2json
+
+set +e
+"$cmd" --format=cbor input.eexpr >cbor.bin
+echo "$?" >exitcode.output
+od -An -tx1 -v cbor.bin >cbor.output
+rm -f cbor.bin
@@ -0,0 +1,14 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexprdiff
+
+set +e
+"$cmd" old.eexpr new.eexpr
+echo "$?" >exitcode.output
+# layout, comments and escapes make no difference
+"$cmd" old.eexpr reformatted.eexpr >reformatted.output
+echo "$?" >>reformatted.output
+# the output is the same without sharing subtrees
+"$cmd" -fno-share-subtrees old.eexpr new.eexpr >unshared.output
+echo "$?" >>unshared.output
@@ -0,0 +1,15 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-validate
+
+set +e
+"$cmd" schema.eexpr good.eexpr >good.output
+echo "$?" >>good.output
+"$cmd" schema.eexpr bad.eexpr
+echo "$?" >exitcode.output
+# a schema that does not compile
+"$cmd" broken.eexpr good.eexpr >broken.output 2>&1
+echo "$?" >>broken.output
+"$cmd" cycle.eexpr good.eexpr >>broken.output 2>&1
+echo "$?" >>broken.output
@@ -0,0 +1,45 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexprq
+files="servers.eexpr databases.eexpr empty.eexpr"
+
+set +e
+for query in \
+    'server/*/port' \
+    '//port' \
+    '//port[int][> 8000]' \
+    '//port[string]' \
+    'server/host?/limits/cpu[int]' \
+    '//cpu[!= 2]' \
+    '//enabled[= on]' \
+    '//url[~ "postgres:*"]' \
+    'server//port' \
+    'database/main/replicas' \
+    '//replica/r2' \
+    'nothing'
+do
+  echo "== $query"
+  "$cmd" -j 1 "$query" $files
+  echo "$?"
+done
+echo "== counts"
+"$cmd" -c '//port' $files
+echo "== files"
+"$cmd" -l '//url' $files
+echo "== max"
+"$cmd" -m 1 '//port' $files
+
+# the output does not depend on the number of threads
+"$cmd" -j 1 '//port' $files >threads.output
+"$cmd" -j 4 '//port' $files >>threads.output
+"$cmd" -j 1 '//port' $files | cmp - <("$cmd" -j4 '//port' $files) >>threads.output
+echo "$?" >>threads.output
+
+# errors: in a file, and in the query
+"$cmd" '//port' servers.eexpr broken.eexpr missing.eexpr >errors.output 2>&1
+echo "$?" >>errors.output
+for query in '' 'a/' 'a[' 'a[foo]' 'a[< x]' 'a[int]b' 'a[~ "[x"]'; do
+  "$cmd" "$query" servers.eexpr >>errors.output 2>&1
+  echo "$?" >>errors.output
+done
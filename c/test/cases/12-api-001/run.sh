@@ -0,0 +1,14 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-api-check
+out="$(mktemp -d)"
+trap 'rm -rf "$out"' EXIT
+
+set +e
+"$cmd" flat -m spec.eexpr input.eexpr >flat.output
+echo "$?" >exitcode.output
+# payloads decoded on demand are flattened the same as ones decoded up front
+"$cmd" flat -flazy-payloads -m spec.eexpr input.eexpr >"$out/lazy"
+echo "$?" >>exitcode.output
+diff -u flat.output "$out/lazy" && echo "-flazy-payloads: same"
@@ -0,0 +1,8 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-api-check
+
+set +e
+"$cmd" hash -m spec.eexpr input.eexpr
+echo "$?" >exitcode.output
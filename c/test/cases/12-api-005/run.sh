@@ -0,0 +1,8 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-api-check
+
+set +e
+"$cmd" batch a.eexpr b.eexpr c.eexpr
+echo "$?" >exitcode.output
@@ -0,0 +1,8 @@
+#!/bin/bash
+set -e
+
+cmd=../../../bin/static/eexpr-api-check
+
+set +e
+"$cmd" share a.eexpr b.eexpr a.eexpr
+echo "$?" >exitcode.output
@@ -12,6 +12,7 @@
 
 #define parser_nEexprs(x) (((eexpr_parser*)x)->nEexprs)
 #define parser_eexprAt(x, i) (((eexpr_parser*)x)->eexprs[i])
+#define parser_eexprs(x) (((eexpr_parser*)x)->eexprs)
 #define parser_delEexprs(x) do { \
     eexpr_parser* p = (eexpr_parser*)(x); \
     if (p->eexprs != NULL) { free(p->eexprs); } \
@@ -19,6 +20,13 @@
     p->eexprs = NULL; \
   } while(false)
 
+#define parser_lines(x) (((eexpr_parser*)x)->lines)
+#define parser_delLines(x) do { \
+    eexpr_parser* p = (eexpr_parser*)(x); \
+    eexpr_lineIndex_del(p->lines); \
+    p->lines = NULL; \
+  } while(false)
+
 #define parser_nTokens(x) (((eexpr_parser*)x)->nTokens)
 #define parser_tokenAt(x, i) (((eexpr_parser*)x)->tokens[i])
 
@@ -43,7 +51,7 @@
 
 //////////// Errors and Warnings ////////////
 
-#define errLocation(e) (&((eexpr_error*)e)->loc)
+#define errLocatePtr(lines,e,l) (*(eexpr_loc*)l = eexpr_resolveSpan((eexpr_lineIndex*)lines, ((eexpr_error*)e)->loc))
 #define errType(e) (((eexpr_error*)e)->type)
 
 
@@ -51,7 +59,7 @@
 
 #define sizeofLoc sizeof(eexpr_loc)
 
-#define locatePtr(e,l) (*(eexpr_loc*)l = eexpr_locate((eexpr*)e))
+#define locatePtr(lines,e,l) (*(eexpr_loc*)l = eexpr_locate((eexpr_lineIndex*)lines, (eexpr*)e))
 
 #define locStartByte(l) (((eexpr_loc*)l)->start.byte)
 #define locStartLine(l) (((eexpr_loc*)l)->start.line)
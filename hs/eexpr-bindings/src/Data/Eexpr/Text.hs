@@ -1,11 +1,20 @@
+{-# LANGUAGE LambdaCase #-}
+{-# LANGUAGE TypeApplications #-}
+
 module Data.Eexpr.Text
   ( parse
+  , parseMany
   ) where
 
+import Control.Concurrent (forkOn,getNumCapabilities)
+import Control.Concurrent.MVar (newEmptyMVar,putMVar,takeMVar)
+import Control.Exception (SomeException,evaluate,throwIO,try)
+import Control.Monad (forM,forM_)
 import Control.Monad.ST (runST)
 import Data.ByteString (ByteString)
 import Data.Eexpr.Types (Eexpr,Error,Location)
 import Data.Foldable (toList)
+import Data.IORef (newIORef,atomicModifyIORef')
 import Data.Primitive.Array (sizeofArray)
 
 import qualified Data.Eexpr.Text.Internal as Ffi
@@ -21,3 +30,29 @@ parse input = runST $ do
   pure $ if sizeofArray errs == 0
     then (toList warns, Right $ toList eexprs)
     else (toList warns, Left $ toList errs)
+
+-- | Parse independent documents in parallel, one worker (each with its own C parser) per capability.
+-- Results are in the same order as the inputs.
+-- Without the threaded runtime (and `+RTS -N`), this is just `map parse` with extra steps.
+parseMany :: [ByteString] -> IO [([Error], Either [Error] [Eexpr Location])]
+parseMany [] = pure []
+parseMany inputs = do
+  nCaps <- getNumCapabilities
+  -- each job fills its own result slot; workers pull the next job from a shared queue
+  jobs <- forM inputs $ \input -> (,) input <$> newEmptyMVar
+  queue <- newIORef jobs
+  let next = atomicModifyIORef' queue $ \case
+        [] -> ([], Nothing)
+        (job:rest) -> (rest, Just job)
+      worker = next >>= \case
+        Nothing -> pure ()
+        Just (input, slot) -> do
+          -- force the parse here, rather than in whichever thread looks at the result first
+          r <- try $ do
+            result@(_, eexprs) <- evaluate (parse input)
+            _ <- evaluate (either length length eexprs)
+            pure result
+          putMVar slot r
+          worker
+  forM_ [0 .. min nCaps (length jobs) - 1] $ \i -> forkOn i worker
+  forM jobs $ \(_, slot) -> takeMVar slot >>= either (throwIO @SomeException) pure
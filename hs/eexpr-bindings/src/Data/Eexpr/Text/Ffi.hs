@@ -21,11 +21,17 @@ module Data.Eexpr.Text.Ffi
   , setPauseAt
   -- ** Perform Parsing
   , parse
+  , parseSafe
   , deinitParser
   -- ** Extract Results
   , nEexprs
   , eexprAt
+  , eexprsPtr
   , delEexprs
+  -- ** Flat Serialization
+  , serializedSize
+  , serialize
+  , serialAbsent
   , nErrors
   , delErrors
   , nTokens
@@ -93,7 +99,7 @@ module Data.Eexpr.Text.Ffi
   , tailAt_utf8str
   -- * Errors and Warnings
   , CError
-  , errLocation
+  , errLocate
   , errType
   , errTypeBadBytes
   , errTypeBadChar
@@ -123,8 +129,12 @@ module Data.Eexpr.Text.Ffi
   , errTypeExpectingNewlineOrDedent
   , errTypeMissingTemplateExpr
   , errTypeMissingCloseTemplate
+  , errTypeLimitExceeded
   -- TODO more error info, as needed
   -- * Locations
+  , CLineIndex
+  , parserLines
+  , delLines
   , CLocation
   , sizeofLoc
   , locStartByte
@@ -135,7 +145,7 @@ module Data.Eexpr.Text.Ffi
   , locEndCol
   ) where
 
-import Data.Word (Word8,Word32)
+import Data.Word (Word8,Word32,Word64)
 import Foreign.C.Types (CBool(..),CChar,CInt(..),CSize(..))
 import Foreign.Ptr (Ptr)
 
@@ -187,6 +197,14 @@ foreign import ccall unsafe "eexpr_parse" parse
   -> CSize -- the length of the input string
   -> Ptr CChar -- a pinned input string
   -> IO ()
+-- | Same as 'parse', but as a safe call, so that other Haskell threads (and the GC) can keep running while it works.
+-- This costs more per call, so it only pays off for large inputs.
+-- Both the parser object and the input must be pinned, and kept alive until the call returns.
+foreign import ccall safe "eexpr_parse" parseSafe
+  :: Ptr CParserObj
+  -> CSize
+  -> Ptr CChar
+  -> IO ()
 
 
 foreign import capi "hs_eexpr.h parser_nEexprs" nEexprs
@@ -196,10 +214,25 @@ foreign import capi "hs_eexpr.h parser_eexprAt" eexprAt
   :: Ptr CParserObj
   -> CSize
   -> IO (Ptr CEexpr)
+foreign import capi "hs_eexpr.h parser_eexprs" eexprsPtr
+  :: Ptr CParserObj
+  -> IO (Ptr (Ptr CEexpr))
 foreign import capi "hs_eexpr.h parser_delEexprs" delEexprs
   :: Ptr CParserObj
   -> IO ()
 
+foreign import ccall unsafe "eexpr_serializedSize" serializedSize
+  :: CSize -- number of eexprs
+  -> Ptr (Ptr CEexpr) -- the eexprs
+  -> IO CSize -- size of the buffer needed, in bytes
+foreign import ccall unsafe "eexpr_serialize" serialize
+  :: Ptr CLineIndex -- may be null to skip line/col info
+  -> CSize -- number of eexprs
+  -> Ptr (Ptr CEexpr) -- the eexprs
+  -> Ptr Word64 -- an 8-byte-aligned buffer of at least `serializedSize` bytes
+  -> IO CSize -- bytes written
+foreign import capi "eexpr.h value EEXPR_SERIAL_ABSENT" serialAbsent :: Word64
+
 foreign import capi "hs_eexpr.h parser_nTokens" nTokens
   :: Ptr CParserObj
   -> IO CSize
@@ -304,7 +337,7 @@ foreign import ccall unsafe "eexpr_asSemicolon" asSemicolon
 foreign import capi "hs_eexpr.h value sizeofLoc" sizeofLoc :: CSize
 
 foreign import capi "hs_eexpr.h locatePtr" eexprLocate
-  :: Ptr CEexpr -> Ptr CLocation -> IO ()
+  :: Ptr CLineIndex -> Ptr CEexpr -> Ptr CLocation -> IO ()
 
 
 ------------ Extracting Data About Tokens ------------
@@ -316,7 +349,8 @@ data CToken
 
 data CError
 
-foreign import capi "hs_eexpr.h errLocation" errLocation :: Ptr CError -> IO (Ptr CLocation)
+foreign import capi "hs_eexpr.h errLocatePtr" errLocate
+  :: Ptr CLineIndex -> Ptr CError -> Ptr CLocation -> IO ()
 
 foreign import capi "hs_eexpr.h errType" errType :: Ptr CError -> IO CInt
 
@@ -348,9 +382,19 @@ foreign import capi "eexpr.h value EEXPR_ERR_UNBALANCED_WRAP" errTypeUnbalancedW
 foreign import capi "eexpr.h value EEXPR_ERR_EXPECTING_NEWLINE_OR_DEDENT" errTypeExpectingNewlineOrDedent :: CInt
 foreign import capi "eexpr.h value EEXPR_ERR_MISSING_TEMPLATE_EXPR" errTypeMissingTemplateExpr :: CInt
 foreign import capi "eexpr.h value EEXPR_ERR_MISSING_CLOSE_TEMPLATE" errTypeMissingCloseTemplate :: CInt
+foreign import capi "eexpr.h value EEXPR_ERR_LIMIT_EXCEEDED" errTypeLimitExceeded :: CInt
 
 ------------ Location Data ------------
 
+data CLineIndex
+
+foreign import capi "hs_eexpr.h parser_lines" parserLines
+  :: Ptr CParserObj
+  -> IO (Ptr CLineIndex)
+foreign import capi "hs_eexpr.h parser_delLines" delLines
+  :: Ptr CParserObj
+  -> IO ()
+
 data CLocation
 
 foreign import capi "hs_eexpr.h locStartByte" locStartByte :: Ptr CLocation -> IO CSize
@@ -11,6 +11,7 @@ module Data.Eexpr.Text.Internal
   ( ParserObj
   , newDefaultParser
   , parse
+  , safeParseThreshold
   , deinitParser
   , drainEexprs
   , drainErrors
@@ -21,21 +22,20 @@ module Data.Eexpr.Text.Internal
 import Data.Eexpr.Types
 import Prelude hiding (significand)
 
-import Control.Monad (forM_,foldM)
-import Control.Monad.Primitive (PrimMonad, PrimState, unsafeIOToPrim)
-import Data.Bits (shiftL, (.|.))
+import Control.Monad (forM_)
+import Control.Monad.Primitive (PrimMonad, PrimState, touch, unsafeIOToPrim)
+import Data.Bits (shiftL, shiftR, testBit, (.&.), (.|.))
 import Data.ByteString (ByteString)
-import Data.Eexpr.Text.Ffi (CEexpr,CError,CLocation)
-import Data.Foldable (toList)
+import Data.Eexpr.Text.Ffi (CError,CLineIndex,CLocation)
+import Data.Foldable (foldl')
 import Data.Functor ((<&>))
 import Data.Primitive.Array (Array,newArray,writeArray,unsafeFreezeArray,arrayFromListN)
-import Data.Primitive.ByteArray (ByteArray(..),newByteArray,writeByteArray,unsafeFreezeByteArray)
+import Data.Primitive.ByteArray (ByteArray(..),indexByteArray,unsafeFreezeByteArray)
 import Data.Text.Short (ShortText)
-import Data.Word (Word8,Word32)
-import Foreign.C.Types (CSize,CBool)
-import Foreign.ForeignPtr (mallocForeignPtr,mallocForeignPtrBytes,withForeignPtr)
-import Foreign.Ptr (Ptr,nullPtr,castPtr)
-import Foreign.Storable (Storable(..))
+import Data.Word (Word8,Word32,Word64)
+import Foreign.C.Types (CInt)
+import Foreign.ForeignPtr (mallocForeignPtrBytes,withForeignPtr)
+import Foreign.Ptr (Ptr,castPtr)
 
 import qualified Data.ByteString.Short.Internal as SBS
 import qualified Data.ByteString.Unsafe as BS
@@ -67,17 +67,27 @@ data PauseAt
 newDefaultParser :: (PrimMonad m) => ByteString -> m (ParserObj (PrimState m))
 {-# NOINLINE newDefaultParser #-}
 newDefaultParser inp = do
-  -- TODO since I'm using the unsafe ffi, I don't need to pin this; so I can bang `unParser` and eliminate two indirections
+  -- this must be pinned, since large inputs are parsed with a safe call, during which the GC may run
   st <- Prim.newPinnedByteArray (fromIntegral Ffi.sizeofParser)
   let obj = ParserObj st inp
   unsafeIOToPrim $ Ffi.initDefault (parserPtr obj)
   pure obj
 
+-- | Inputs of at least this many bytes are parsed with a safe foreign call.
+-- An unsafe call is cheaper, but it blocks the whole capability (and any GC sync) until it returns,
+-- which is noticeable on large documents.
+safeParseThreshold :: Int
+safeParseThreshold = 64 * 1024
+
 parse :: (PrimMonad m) => ParserObj (PrimState m) -> m ()
 {-# NOINLINE parse #-}
-parse st = unsafeIOToPrim $
+parse st = unsafeIOToPrim $ do
   BS.unsafeUseAsCStringLen (input st) $ \(bytes, nBytes) ->
-    Ffi.parse (parserPtr st) (fromIntegral nBytes) bytes
+    if nBytes < safeParseThreshold
+    then Ffi.parse (parserPtr st) (fromIntegral nBytes) bytes
+    else Ffi.parseSafe (parserPtr st) (fromIntegral nBytes) bytes
+  -- only a Ptr into the parser object was passed, so make sure the GC didn't collect it during a safe call
+  touch (unParser st)
 
 deinitParser :: (PrimMonad m) => ParserObj (PrimState m) -> m ()
 {-# NOINLINE deinitParser #-}
@@ -87,6 +97,7 @@ deinitParser st = unsafeIOToPrim $ do
   -- deleting tokens handled by deinitParser
   Ffi.delErrors (parserPtr st)
   Ffi.delWarnings (parserPtr st)
+  Ffi.delLines (parserPtr st)
 
 
 drainEexprs :: (PrimMonad m) => ParserObj (PrimState m) -> m (Array (Eexpr Location))
@@ -96,184 +107,110 @@ drainEexprs st = unsafeIOToPrim $ do
   if n == 0
   then pure emptyArray
   else do
-    arr <- newArray (fromIntegral n) (error "uninitialized eexpr")
-    forM_ [0 .. n-1] $ \i -> do
-      cEexpr <- Ffi.eexprAt (parserPtr st) i
-      eexpr <- fromC cEexpr
-      Ffi.eexprDel cEexpr
-      writeArray arr (fromIntegral i) eexpr
+    lines_p <- Ffi.parserLines (parserPtr st)
+    eexprs_p <- Ffi.eexprsPtr (parserPtr st)
+    -- one call flattens the whole forest, rather than several foreign calls per node
+    -- C writes the buffer directly, so it must be pinned (and aligned for its 64-bit words)
+    size <- Ffi.serializedSize n eexprs_p
+    buf <- Prim.newAlignedPinnedByteArray (fromIntegral size) 8
+    _ <- Ffi.serialize lines_p n eexprs_p (castPtr $ Prim.mutableByteArrayContents buf)
+    forM_ [0 .. n-1] $ \i -> Ffi.eexprDel =<< Ffi.eexprAt (parserPtr st) i
     Ffi.delEexprs (parserPtr st)
-    unsafeFreezeArray arr
+    decodeForest <$> unsafeFreezeByteArray buf
 
 
 ------------ Eexprs ------------
 
-
-fromC :: Ptr CEexpr -> IO (Eexpr Location)
-fromC eexpr_p = do
-  location <- unsafeIOToPrim $ do
-    loc_fp <- mallocForeignPtrBytes (fromIntegral Ffi.sizeofLoc)
-    withForeignPtr loc_fp $ \loc_p -> do
-      Ffi.eexprLocate eexpr_p loc_p
-      copyCLoc loc_p
-  case Ffi.eexprType eexpr_p of
-    typ
-      | typ == Ffi.eexprSymbol -> unsafeIOToPrim $ do
-        nBytes_fp <- mallocForeignPtr
-        bytes_fp <- mallocForeignPtr
-        name <- withForeignPtr nBytes_fp $ \nBytes_p -> withForeignPtr bytes_fp $ \bytes_p -> do
-          _ <- Ffi.asSymbol eexpr_p nBytes_p bytes_p
-          liftJoin2 copyCUtf8Str (peek nBytes_p) (peek bytes_p)
-        pure $ Symbol location name
-      | typ == Ffi.eexprNumber -> unsafeIOToPrim $ do
-        value_fp <- mallocForeignPtrBytes (fromIntegral Ffi.sizeofBignum)
-        value <- withForeignPtr value_fp $ \value_p -> do
-          _ <- Ffi.asNumber eexpr_p value_p
-          significand <- liftJoin3 copyCBigint
-                                    (Ffi.isPositive value_p)
-                                    (Ffi.nBigDigits value_p)
-                                    (Ffi.bigDigits value_p)
-          radix <- Radix <$> Ffi.radix value_p
-          fractionalExponent <- Ffi.nFracDigits value_p
-          explicitExponent <- liftJoin3 copyCBigint
-                                          (Ffi.isPositive_exp value_p)
-                                          (Ffi.nBigDigits_exp value_p)
-                                          (Ffi.bigDigits_exp value_p)
-          pure $ Bignum{significand,radix,fractionalExponent,explicitExponent}
-        pure $ Number location value
-      | typ == Ffi.eexprString -> unsafeIOToPrim $ do
-        tmpl_fp <- mallocForeignPtrBytes (fromIntegral Ffi.sizeofStrTemplate)
-        withForeignPtr tmpl_fp $ \tmpl_p -> do
-          _ <- Ffi.asString eexpr_p tmpl_p
-          headString <- liftJoin2 copyCUtf8Str (Ffi.head_nBytes tmpl_p) (Ffi.head_utf8str tmpl_p)
-          nTail <- Ffi.tail_nSubexprs tmpl_p
-          tailParts <- if nTail == 0
-            then pure emptyArray
-            else do
-              arr <- newArray (fromIntegral nTail) (error "uninitialized string template subexpr+text")
-              forM_ [0 .. nTail-1] $ \(ci :: CSize) -> do
-                let i = fromIntegral @CSize @Int ci
-                !subexpr <- fromC =<< Ffi.tailAt_subexpr tmpl_p ci
-                !text <- liftJoin2 copyCUtf8Str (Ffi.tailAt_nBytes tmpl_p ci) (Ffi.tailAt_utf8str tmpl_p ci)
-                writeArray arr i (subexpr, text)
-              unsafeFreezeArray arr
-          pure $ String location headString (toList tailParts)
-      | typ == Ffi.eexprParen -> unsafeIOToPrim $ do
-        subexpr_p_fp <- mallocForeignPtr
-        subexpr_p <- withForeignPtr subexpr_p_fp $ \subexpr_p_p -> do
-          _ <- Ffi.asParen eexpr_p subexpr_p_p
-          peek subexpr_p_p
-        subexpr <- copyEexprNullable subexpr_p
-        pure $ Paren location subexpr
-      | typ == Ffi.eexprBrack -> unsafeIOToPrim $ do
-        subexpr_p_fp <- mallocForeignPtr
-        subexpr_p <- withForeignPtr subexpr_p_fp $ \subexpr_p_p -> do
-          _ <- Ffi.asBrack eexpr_p subexpr_p_p
-          peek subexpr_p_p
-        subexpr <- copyEexprNullable subexpr_p
-        pure $ Bracket location subexpr
-      | typ == Ffi.eexprBrace -> unsafeIOToPrim $ do
-        subexpr_p_fp <- mallocForeignPtr
-        subexpr_p <- withForeignPtr subexpr_p_fp $ \subexpr_p_p -> do
-          _ <- Ffi.asBrace eexpr_p subexpr_p_p
-          peek subexpr_p_p
-        subexpr <- copyEexprNullable subexpr_p
-        pure $ Brace location subexpr
-      | typ == Ffi.eexprBlock -> unsafeIOToPrim $ do
-        nSubexprs_fp <- mallocForeignPtr
-        subexprs_p_fp <- mallocForeignPtr
-        withForeignPtr nSubexprs_fp $ \nSubexprs_p -> withForeignPtr subexprs_p_fp $ \subexprs_p_p -> do
-          _ <- Ffi.asBlock eexpr_p nSubexprs_p subexprs_p_p
-          nSubexprs <- peek nSubexprs_p
-          subexprs_p <- peek subexprs_p_p
-          subexprs <- copyCEexprArr nSubexprs subexprs_p
-          pure $ Block location (NE.fromList $ toList subexprs)
-      | typ == Ffi.eexprPredot -> unsafeIOToPrim $ do
-        subexpr_p_fp <- mallocForeignPtr
-        subexpr_p <- withForeignPtr subexpr_p_fp $ \subexpr_p_p -> do
-          _ <- Ffi.asPredot eexpr_p subexpr_p_p
-          peek subexpr_p_p
-        !subexpr <- fromC subexpr_p
-        pure $ Predot location subexpr
-      | typ == Ffi.eexprChain -> unsafeIOToPrim $ do
-        nSubexprs_fp <- mallocForeignPtr
-        subexprs_p_fp <- mallocForeignPtr
-        withForeignPtr nSubexprs_fp $ \nSubexprs_p -> withForeignPtr subexprs_p_fp $ \subexprs_p_p -> do
-          _ <- Ffi.asChain eexpr_p nSubexprs_p subexprs_p_p
-          nSubexprs <- peek nSubexprs_p
-          subexprs_p <- peek subexprs_p_p
-          subexprs <- copyCEexprArr nSubexprs subexprs_p
-          pure $ Chain location (NE2.fromList $ toList subexprs)
-      | typ == Ffi.eexprSpace -> unsafeIOToPrim $ do
-        nSubexprs_fp <- mallocForeignPtr
-        subexprs_p_fp <- mallocForeignPtr
-        withForeignPtr nSubexprs_fp $ \nSubexprs_p -> withForeignPtr subexprs_p_fp $ \subexprs_p_p -> do
-          _ <- Ffi.asSpace eexpr_p nSubexprs_p subexprs_p_p
-          nSubexprs <- peek nSubexprs_p
-          subexprs_p <- peek subexprs_p_p
-          subexprs <- copyCEexprArr nSubexprs subexprs_p
-          pure $ Space location (NE2.fromList $ toList subexprs)
-      | typ == Ffi.eexprEllipsis -> unsafeIOToPrim $ do
-        before_p_fp <- mallocForeignPtr
-        after_p_fp <- mallocForeignPtr
-        withForeignPtr before_p_fp $ \before_p_p -> withForeignPtr after_p_fp $ \after_p_p -> do
-          _ <- Ffi.asEllipsis eexpr_p before_p_p after_p_p
-          before <- copyEexprNullable =<< peek before_p_p
-          after <- copyEexprNullable =<< peek after_p_p
-          pure $ Ellipsis location before after
-      | typ == Ffi.eexprColon -> unsafeIOToPrim $ do
-        before_p_fp <- mallocForeignPtr
-        after_p_fp <- mallocForeignPtr
-        withForeignPtr before_p_fp $ \before_p_p -> withForeignPtr after_p_fp $ \after_p_p -> do
-          _ <- Ffi.asColon eexpr_p before_p_p after_p_p
-          before <- fromC =<< peek before_p_p
-          after <- fromC =<< peek after_p_p
-          pure $ Colon location before after
-      | typ == Ffi.eexprComma -> unsafeIOToPrim $ do
-        nSubexprs_fp <- mallocForeignPtr
-        subexprs_p_fp <- mallocForeignPtr
-        withForeignPtr nSubexprs_fp $ \nSubexprs_p -> withForeignPtr subexprs_p_fp $ \subexprs_p_p -> do
-          _ <- Ffi.asComma eexpr_p nSubexprs_p subexprs_p_p
-          nSubexprs <- peek nSubexprs_p
-          subexprs_p <- peek subexprs_p_p
-          subexprs <- copyCEexprArr nSubexprs subexprs_p
-          pure $ Comma location (toList subexprs)
-      | typ == Ffi.eexprSemicolon -> unsafeIOToPrim $ do
-        nSubexprs_fp <- mallocForeignPtr
-        subexprs_p_fp <- mallocForeignPtr
-        withForeignPtr nSubexprs_fp $ \nSubexprs_p -> withForeignPtr subexprs_p_fp $ \subexprs_p_p -> do
-          _ <- Ffi.asSemicolon eexpr_p nSubexprs_p subexprs_p_p
-          nSubexprs <- peek nSubexprs_p
-          subexprs_p <- peek subexprs_p_p
-          subexprs <- copyCEexprArr nSubexprs subexprs_p
-          pure $ Semicolon location (toList subexprs)
-      | otherwise -> error "unrecognized C `eexpr_type` from C `eexpr*`"
-
-copyCEexprArr :: CSize -> Ptr (Ptr CEexpr) -> IO (Array (Eexpr Location))
-copyCEexprArr (fromIntegral -> nSubexprs) subexprs_p
-  | nSubexprs == 0 = pure emptyArray
-  | otherwise = do
-    arr <- newArray nSubexprs (error "uninitialized eexpr")
-    forM_ [0 .. nSubexprs-1] $ \i -> do
-      !e <- fromC =<< peekElemOff subexprs_p i
-      writeArray arr i e
-    unsafeFreezeArray arr
-
-copyCUtf8Str :: CSize -> Ptr Word8 -> IO ShortText
-copyCUtf8Str (fromIntegral -> nBytes) bytes_p = do
-  bytes <- newByteArray (fromIntegral nBytes)
-  forM_ [0 .. nBytes-1] $ \i -> writeByteArray bytes i =<< peekElemOff bytes_p i
-  (ByteArray bytes#) <- unsafeFreezeByteArray bytes
-  pure $ T.fromShortByteStringUnsafe $ SBS.SBS bytes#
-
-copyCBigint :: CBool -> CSize -> Ptr Word32 -> IO Integer
-copyCBigint isPositive nBigDigits bigDigits = do
-  !magnitude <- (\go -> foldM go 0 [0 .. (fromIntegral nBigDigits)-1]) $ \acc i -> do
-    bigDigit <- fromIntegral @Word32 @Integer <$> peekElemOff bigDigits i
-    pure $ acc .|. (bigDigit  `shiftL` (i * 32))
-  pure $ if (fromIntegral @CBool @Word8 isPositive == 0 :: Bool)
-    then negate magnitude
-    else magnitude
+-- These decode the format described at `eexpr_serialize` in `eexpr.h`.
+-- Each takes an offset (in 64-bit words) into the buffer, and returns the offset just past what it decoded.
+
+decodeForest :: ByteArray -> Array (Eexpr Location)
+decodeForest buf =
+  let n = fromIntegral @Word64 @Int (wordAt buf 0)
+  in case decodeMany n buf 1 of
+    (_, eexprs) -> arrayFromListN n eexprs
+
+decodeEexpr :: ByteArray -> Int -> (Int, Eexpr Location)
+decodeEexpr buf off0 =
+  let header = wordAt buf off0
+      typ = fromIntegral @Word64 @CInt (header .&. 0xff)
+      n = fromIntegral @Word64 @Int (header `shiftR` 8)
+      !location = decodeLoc buf (off0 + 1)
+      off = off0 + 7
+  in if
+    | typ == Ffi.eexprSymbol -> Symbol location <$> decodeBytes buf off
+    | typ == Ffi.eexprNumber ->
+        let radix = Radix (fromIntegral @Word64 @Word8 $ wordAt buf off)
+            fractionalExponent = fromIntegral @Word64 @Word32 $ wordAt buf (off + 1)
+        in case decodeBignum buf (off + 2) of
+          (off', significand) -> case decodeBignum buf off' of
+            (off'', explicitExponent) ->
+              (off'', Number location Bignum{significand,radix,fractionalExponent,explicitExponent})
+    | typ == Ffi.eexprString -> case decodeBytes buf off of
+        (off', headString) -> String location headString <$> decodeParts n off'
+    | typ == Ffi.eexprParen -> Paren location <$> decodeNullable buf off
+    | typ == Ffi.eexprBrack -> Bracket location <$> decodeNullable buf off
+    | typ == Ffi.eexprBrace -> Brace location <$> decodeNullable buf off
+    | typ == Ffi.eexprBlock -> Block location . NE.fromList <$> decodeMany n buf off
+    | typ == Ffi.eexprPredot -> Predot location <$> decodeEexpr buf off
+    | typ == Ffi.eexprChain -> Chain location . NE2.fromList <$> decodeMany n buf off
+    | typ == Ffi.eexprSpace -> Space location . NE2.fromList <$> decodeMany n buf off
+    | typ == Ffi.eexprEllipsis -> case decodeNullable buf off of
+        (off', before) -> Ellipsis location before <$> decodeNullable buf off'
+    | typ == Ffi.eexprColon -> case decodeEexpr buf off of
+        (off', before) -> Colon location before <$> decodeEexpr buf off'
+    | typ == Ffi.eexprComma -> Comma location <$> decodeMany n buf off
+    | typ == Ffi.eexprSemicolon -> Semicolon location <$> decodeMany n buf off
+    | otherwise -> error "unrecognized C `eexpr_type` in serialized eexprs"
+  where
+  decodeParts :: Int -> Int -> (Int, [(Eexpr Location, ShortText)])
+  decodeParts 0 off = (off, [])
+  decodeParts k off = case decodeEexpr buf off of
+    (off', !subexpr) -> case decodeBytes buf off' of
+      (off'', !text) -> ((subexpr, text) :) <$> decodeParts (k - 1) off''
+
+decodeMany :: Int -> ByteArray -> Int -> (Int, [Eexpr Location])
+decodeMany 0 _ off = (off, [])
+decodeMany k buf off = case decodeEexpr buf off of
+  (off', !e) -> (e :) <$> decodeMany (k - 1) buf off'
+
+decodeNullable :: ByteArray -> Int -> (Int, Maybe (Eexpr Location))
+decodeNullable buf off
+  | wordAt buf off == Ffi.serialAbsent = (off + 1, Nothing)
+  | otherwise = case decodeEexpr buf off of
+    (off', !e) -> (off', Just e)
+
+decodeBytes :: ByteArray -> Int -> (Int, ShortText)
+decodeBytes buf off =
+  let nBytes = fromIntegral @Word64 @Int (wordAt buf off)
+      !(ByteArray bytes#) = Prim.cloneByteArray buf ((off + 1) * 8) nBytes
+  in (off + 1 + (nBytes + 7) `div` 8, T.fromShortByteStringUnsafe $ SBS.SBS bytes#)
+
+decodeBignum :: ByteArray -> Int -> (Int, Integer)
+decodeBignum buf off =
+  let header = wordAt buf off
+      nBigDigits = fromIntegral @Word64 @Int (header `shiftR` 1)
+      bigDigitAt i = fromIntegral @Word32 @Integer $ indexByteArray buf ((off + 1) * 2 + i)
+      !magnitude = foldl' (\acc i -> acc .|. (bigDigitAt i `shiftL` (i * 32))) 0 [0 .. nBigDigits - 1]
+      !value = if testBit header 0 then magnitude else negate magnitude
+  in (off + 1 + (nBigDigits * 4 + 7) `div` 8, value)
+
+decodeLoc :: ByteArray -> Int -> Location
+decodeLoc buf off = Location{start,end}
+  where
+  start = LocPoint
+    { byteOff = fromIntegral $ wordAt buf off
+    , lineOff = fromIntegral $ wordAt buf (off + 1)
+    , colOff = fromIntegral $ wordAt buf (off + 2)
+    }
+  end = LocPoint
+    { byteOff = fromIntegral $ wordAt buf (off + 3)
+    , lineOff = fromIntegral $ wordAt buf (off + 4)
+    , colOff = fromIntegral $ wordAt buf (off + 5)
+    }
+
+wordAt :: ByteArray -> Int -> Word64
+wordAt = indexByteArray
 
 copyCLoc :: Ptr CLocation -> IO Location
 copyCLoc loc_p = do
@@ -289,14 +226,6 @@ copyCLoc loc_p = do
     pure LocPoint{byteOff,lineOff,colOff}
   pure Location{start,end}
 
-copyEexprNullable :: Ptr CEexpr -> IO (Maybe (Eexpr Location))
-copyEexprNullable subexpr_p
-  | subexpr_p == castPtr nullPtr = pure Nothing
-  | otherwise = do
-    !e <- fromC subexpr_p
-    pure $ Just e
-
-
 ------------ Errors and Warnings ------------
 
 drainErrors :: (PrimMonad m) => ParserObj (PrimState m) -> m (Array Error)
@@ -306,9 +235,10 @@ drainErrors st = unsafeIOToPrim $ do
   if n == 0
   then pure emptyArray
   else do
+    lines_p <- Ffi.parserLines (parserPtr st)
     arr <- newArray (fromIntegral n) (error "uninitialized eexpr error")
     forM_ [0 .. n-1] $ \i -> do
-      Ffi.errorAt (parserPtr st) i >>= copyError >>=
+      Ffi.errorAt (parserPtr st) i >>= copyError lines_p >>=
         writeArray arr (fromIntegral i)
     Ffi.delErrors (parserPtr st)
     unsafeFreezeArray arr
@@ -320,16 +250,20 @@ drainWarnings st = unsafeIOToPrim $ do
   if n == 0
   then pure emptyArray
   else do
+    lines_p <- Ffi.parserLines (parserPtr st)
     arr <- newArray (fromIntegral n) (error "uninitialized eexpr warning")
     forM_ [0 .. n-1] $ \i -> do
-      Ffi.warningAt (parserPtr st) i >>= copyError >>=
+      Ffi.warningAt (parserPtr st) i >>= copyError lines_p >>=
         writeArray arr (fromIntegral i)
     Ffi.delWarnings (parserPtr st)
     unsafeFreezeArray arr
 
-copyError :: Ptr CError -> IO Error
-copyError err_p = do
-  loc <- copyCLoc =<< Ffi.errLocation err_p
+copyError :: Ptr CLineIndex -> Ptr CError -> IO Error
+copyError lines_p err_p = do
+  loc_fp <- mallocForeignPtrBytes (fromIntegral Ffi.sizeofLoc)
+  loc <- withForeignPtr loc_fp $ \loc_p -> do
+    Ffi.errLocate lines_p err_p loc_p
+    copyCLoc loc_p
   ctor <- Ffi.errType err_p <&> \typ -> if
     | typ == Ffi.errTypeBadBytes -> BadBytes
     | typ == Ffi.errTypeBadChar -> BadChar
@@ -359,16 +293,11 @@ copyError err_p = do
     | typ == Ffi.errTypeExpectingNewlineOrDedent -> ExpectingNewlineOrDedent
     | typ == Ffi.errTypeMissingTemplateExpr -> MissingTemplateExpr
     | typ == Ffi.errTypeMissingCloseTemplate -> MissingCloseTemplate
+    | typ == Ffi.errTypeLimitExceeded -> LimitExceeded
     | otherwise -> error "unrecognized C `eexpr_errorType` from C `eexpr_error*`"
   pure $ ctor loc
 
 ------------ Utility ------------
 
-liftJoin2 :: Monad m => (a -> b -> m z) -> m a -> m b -> m z
-liftJoin2 f ma mb = ma >>= \a -> mb >>= f a
-
-liftJoin3 :: Monad m => (a -> b -> c -> m z) -> m a -> m b -> m c -> m z
-liftJoin3 f ma mb mc = ma >>= \a -> mb >>= \b -> mc >>= f a b
-
 emptyArray :: Array a
 emptyArray = arrayFromListN 0 []
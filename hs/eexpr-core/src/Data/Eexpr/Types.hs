@@ -147,4 +147,5 @@ data Error
   | ExpectingNewlineOrDedent !Location
   | MissingTemplateExpr !Location
   | MissingCloseTemplate !Location
+  | LimitExceeded !Location
   deriving stock (Read, Show)
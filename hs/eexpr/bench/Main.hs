@@ -0,0 +1,61 @@
+-- Compare with `eexpr-mixfix-bench` from the C library, which times the same tables being compiled (and then used for rewriting).
+
+import Data.Eexpr.Mixfix
+
+import Data.Either (fromRight)
+import Gauge.Main (bench,bgroup,defaultMain,whnf)
+
+import qualified Data.Set as Set
+import qualified Data.Text.Short as T
+
+main :: IO ()
+main = defaultMain
+  [ bgroup "mkMixfixTable"
+    [ bench "arith" $ whnf compile arith
+    , bench "chain-10" $ whnf compile (chain 10)
+    , bench "chain-100" $ whnf compile (chain 100)
+    , bench "chain-1000" $ whnf compile (chain 1000)
+    ]
+  ]
+
+-- force the table, but not the definitions inside it (which are shared with the input)
+compile :: [MixfixDefinition ()] -> Int
+compile defs = case mkMixfixTable defs of
+  (errs, table) -> length errs + maybe 0 (sum . map length) table
+
+-- the same definitions as the C library's mixfix test case
+arith :: [MixfixDefinition ()]
+arith =
+  [ def "add" [] [] [] LeftAssociative [h, l "+", h]
+  , def "sub" [] ["add"] [] LeftAssociative [h, l "-", h]
+  , def "mul" [] [] ["add"] LeftAssociative [h, l "times", h]
+  , def "neg" [] [] ["mul"] NonAssociative [l "-", h]
+  , def "pow" ["neg"] [] ["mul"] RightAssociative [h, l "to", h]
+  , def "eq" ["add"] [] [] NonAssociative [h, l "is", h]
+  , def "if" ["eq"] [] [] NonAssociative [l "if", h, l "then", h]
+  , def "ifelse" [] ["if"] [] NonAssociative [l "if", h, l "then", h, l "else", h]
+  , def "fact" [] [] ["pow"] LeftAssociative [h, l "factorial"]
+  , def "abs" [] [] [] NonAssociative [l "bar", h, l "rab"]
+  ]
+  where
+  h = Hole
+  l = Literal . T.fromString
+
+-- `n` infix operators, each binding tighter than the one before
+chain :: Int -> [MixfixDefinition ()]
+chain n = [ def (op i) [] [] [op (i - 1) | i > 0] LeftAssociative [Hole, Literal (T.fromString $ op i), Hole] | i <- [0 .. n - 1] ]
+  where
+  op i = "op" ++ show i
+
+def :: String -> [String] -> [String] -> [String] -> Associativity -> [MixfixTemplElem] -> MixfixDefinition ()
+def name lower same higher assoc templ = MixfixDef
+  { annotation = ()
+  , name = T.fromString name
+  , lowerPrecedenceThan = names lower
+  , samePrecedenceAs = names same
+  , higherPrecedenceThan = names higher
+  , associativity = assoc
+  , template = fromRight (error $ "bad template for " ++ name) (toTemplate templ)
+  }
+  where
+  names = Set.fromList . map T.fromString